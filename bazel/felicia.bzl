@@ -188,6 +188,7 @@ def fel_deps():
         "//felicia/core/thread:main_thread",
         "//felicia/core/util",
         "//felicia/drivers/camera",
+        "//felicia/drivers/camera:camera_frame_publisher",
         "//felicia/drivers/imu",
         "//felicia/drivers/lidar",
         "//felicia/map",
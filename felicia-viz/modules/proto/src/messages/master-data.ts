@@ -39,6 +39,7 @@ export enum TopicInfoStatusProtobuf {
 export enum TopicInfoImplTypeProtobuf {
   PROTOBUF = 0,
   ROS = 1,
+  POD = 2,
 }
 
 export interface TopicInfoProtobuf {
@@ -48,6 +49,7 @@ export interface TopicInfoProtobuf {
   topicSource: ChannelSourceProtobuf;
   status: TopicInfoStatusProtobuf;
   rosNodeName: string;
+  typeHash: number;
 }
 
 export enum ServiceInfoStatusProtobuf {
@@ -66,6 +68,8 @@ export interface ServiceInfoProtobuf {
 export interface MasterNotification {
   topicInfo: TopicInfoProtobuf;
   serviceInfo: ServiceInfoProtobuf;
+  topicInfos: TopicInfoProtobuf[];
+  serviceInfos: ServiceInfoProtobuf[];
 }
 
 export interface ClientFilterProtobuf {
@@ -4,6 +4,9 @@
 
 #include "felicia/core/channel/channel.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "third_party/chromium/base/bind.h"
 #include "third_party/chromium/base/strings/string_util.h"
 #include "third_party/chromium/build/build_config.h"
@@ -59,6 +62,10 @@ bool Channel::ShouldReceiveMessageWithHeader() const { return false; }
 
 bool Channel::HasNativeHeader() const { return false; }
 
+bool Channel::SupportsChunkedTransfer() const {
+  return !HasNativeHeader() && !ShouldReceiveMessageWithHeader();
+}
+
 bool Channel::IsSending() const { return !send_callback_.is_null(); }
 bool Channel::IsReceiving() const { return !receive_callback_.is_null(); }
 
@@ -98,6 +105,21 @@ void Channel::SetDynamicReceiveBuffer(bool is_dynamic) {
   receive_buffer_.SetDynamicBuffer(is_dynamic);
 }
 
+void Channel::SetChunkedTransfer(bool is_chunked) {
+  is_chunked_transfer_ = is_chunked && SupportsChunkedTransfer();
+}
+
+void Channel::SetMaxChunkedMessageSize(Bytes bytes) {
+  DCHECK_GT(bytes.bytes(), 0);
+  max_chunked_message_size_ = static_cast<int>(
+      std::min(bytes.bytes(), static_cast<int64_t>(
+                                  std::numeric_limits<int>::max())));
+}
+
+Bytes Channel::max_chunked_message_size() const {
+  return Bytes::FromBytes(max_chunked_message_size_);
+}
+
 void Channel::Send(const std::string& text, StatusOnceCallback callback) {
   send_buffer_.Reset();
   int to_send = text.length();
@@ -154,6 +176,95 @@ void Channel::ReceiveInternalBuffer(int size, StatusOnceCallback callback) {
       base::BindOnce(&Channel::OnReceive, base::Unretained(this)));
 }
 
+void Channel::SendChunked(int header_size, scoped_refptr<net::IOBuffer> buffer,
+                          int size, StatusOnceCallback callback) {
+  DCHECK(channel_impl_);
+  DCHECK(send_callback_.is_null());
+  DCHECK(!callback.is_null());
+  DCHECK(is_chunked_transfer_);
+  DCHECK_GT(header_size, 0);
+  DCHECK_GT(size, 0);
+
+  send_callback_ = std::move(callback);
+  chunked_send_buffer_ = base::MakeRefCounted<net::DrainableIOBuffer>(
+      std::move(buffer), static_cast<size_t>(size));
+  // The header goes first, as a chunk of nothing from |chunked_send_buffer_|.
+  channel_impl_->WriteAsync(
+      send_buffer_.buffer(), header_size,
+      base::BindOnce(&Channel::OnSendChunk, base::Unretained(this), 0));
+}
+
+void Channel::ReceiveChunked(int size, StatusOnceCallback callback) {
+  DCHECK(channel_impl_);
+  DCHECK(receive_callback_.is_null());
+  DCHECK(!callback.is_null());
+  DCHECK(is_chunked_transfer_);
+  DCHECK_GT(size, 0);
+
+  receive_callback_ = std::move(callback);
+  chunked_receive_buffer_ = base::MakeRefCounted<net::GrowableIOBuffer>();
+  chunked_receive_size_ = size;
+  ReceiveNextChunk();
+}
+
+scoped_refptr<net::GrowableIOBuffer> Channel::TakeChunkedReceiveBuffer() {
+  return std::move(chunked_receive_buffer_);
+}
+
+void Channel::SendNextChunk() {
+  int chunk_size = chunked_send_buffer_->BytesRemaining();
+  if (send_buffer_.capacity() > 0)
+    chunk_size = std::min(chunk_size, send_buffer_.capacity());
+
+  channel_impl_->WriteAsync(
+      chunked_send_buffer_, chunk_size,
+      base::BindOnce(&Channel::OnSendChunk, base::Unretained(this),
+                     chunk_size));
+}
+
+void Channel::OnSendChunk(int chunk_size, Status s) {
+  if (s.ok()) {
+    chunked_send_buffer_->DidConsume(chunk_size);
+    if (chunked_send_buffer_->BytesRemaining() > 0) {
+      SendNextChunk();
+      return;
+    }
+  }
+
+  chunked_send_buffer_ = nullptr;
+  OnSend(std::move(s));
+}
+
+void Channel::ReceiveNextChunk() {
+  int received = chunked_receive_buffer_->offset();
+  int chunk_size = std::min(chunked_receive_size_ - received,
+                            receive_buffer_.capacity());
+  DCHECK_GT(chunk_size, 0);
+  // The size comes from the wire, so the buffer grows with what arrives
+  // instead of being allocated up front. It grows at least twice as large,
+  // so that what is received isn't moved for every chunk.
+  int capacity = chunked_receive_buffer_->capacity();
+  if (received + chunk_size > capacity) {
+    int grow = std::max(received + chunk_size - capacity,
+                        std::min(capacity, chunked_receive_size_ - capacity));
+    chunked_receive_buffer_->SetCapacity(capacity + grow);
+  }
+
+  channel_impl_->ReadAsync(
+      chunked_receive_buffer_, chunk_size,
+      base::BindOnce(&Channel::OnReceiveChunk, base::Unretained(this)));
+}
+
+void Channel::OnReceiveChunk(Status s) {
+  if (s.ok() && chunked_receive_buffer_->offset() < chunked_receive_size_) {
+    ReceiveNextChunk();
+    return;
+  }
+
+  if (!s.ok()) chunked_receive_buffer_ = nullptr;
+  std::move(receive_callback_).Run(std::move(s));
+}
+
 void Channel::OnSend(Status s) { std::move(send_callback_).Run(std::move(s)); }
 
 void Channel::OnReceive(Status s) {
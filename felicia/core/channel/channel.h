@@ -25,6 +25,8 @@ class WSChannel;
 
 class FEL_EXPORT Channel {
  public:
+  static constexpr int kDefaultMaxChunkedMessageSize = 256 * Bytes::kMegaBytes;
+
   virtual ~Channel();
 
   virtual bool IsShmChannel() const;
@@ -53,6 +55,11 @@ class FEL_EXPORT Channel {
   // implementation will attach header.
   virtual bool HasNativeHeader() const;
 
+  // Returns true if it is a stream channel without native header, in other
+  // words, TCPChannel and UDSChannel. A message on these channels can be
+  // split into chunks, because it is just a sequence of bytes after a header.
+  bool SupportsChunkedTransfer() const;
+
   bool IsSending() const;
   bool IsReceiving() const;
 
@@ -70,6 +77,17 @@ class FEL_EXPORT Channel {
   void SetDynamicSendBuffer(bool is_dynamic);
   void SetDynamicReceiveBuffer(bool is_dynamic);
 
+  // If |is_chunked| is true and SupportsChunkedTransfer() returns true,
+  // a message larger than the buffer is sent and received in chunks of
+  // the capacity of the buffer.
+  void SetChunkedTransfer(bool is_chunked);
+  bool is_chunked_transfer() const { return is_chunked_transfer_; }
+
+  // A message received in chunks is rejected if its header says it is larger
+  // than |bytes|, before any memory is allocated for it.
+  void SetMaxChunkedMessageSize(Bytes bytes);
+  Bytes max_chunked_message_size() const;
+
  protected:
   friend class ChannelFactory;
   template <typename T>
@@ -86,7 +104,21 @@ class FEL_EXPORT Channel {
 
   void SendInternalBuffer(int size, StatusOnceCallback callback);
   void ReceiveInternalBuffer(int size, StatusOnceCallback callback);
-
+  // Sends |header_size| bytes of |send_buffer_|, which hold the header, and
+  // then |size| bytes of |buffer| in chunks of the capacity of
+  // |send_buffer_|, without copying them into |send_buffer_|.
+  void SendChunked(int header_size, scoped_refptr<net::IOBuffer> buffer,
+                   int size, StatusOnceCallback callback);
+  // Receives |size| bytes in chunks of the capacity of |receive_buffer_|
+  // right into a buffer, which grows as the chunks arrive. The buffer is
+  // taken by TakeChunkedReceiveBuffer() once |callback| is called with OK.
+  void ReceiveChunked(int size, StatusOnceCallback callback);
+  scoped_refptr<net::GrowableIOBuffer> TakeChunkedReceiveBuffer();
+
+  void SendNextChunk();
+  void OnSendChunk(int chunk_size, Status s);
+  void ReceiveNextChunk();
+  void OnReceiveChunk(Status s);
   void OnSend(Status s);
   void OnReceive(Status s);
 
@@ -101,6 +133,13 @@ class FEL_EXPORT Channel {
   StatusOnceCallback send_callback_;
   ChannelBuffer receive_buffer_;
   StatusOnceCallback receive_callback_;
+  bool is_chunked_transfer_ = false;
+  int max_chunked_message_size_ = kDefaultMaxChunkedMessageSize;
+  // Remaining bytes to send by SendChunked().
+  scoped_refptr<net::DrainableIOBuffer> chunked_send_buffer_;
+  // Bytes received so far by ReceiveChunked(), up to its offset.
+  scoped_refptr<net::GrowableIOBuffer> chunked_receive_buffer_;
+  int chunked_receive_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(Channel);
 };
@@ -29,6 +29,19 @@ char* ChannelBuffer::StartOfBuffer() { return buffer_->StartOfBuffer(); }
 
 scoped_refptr<net::GrowableIOBuffer> ChannelBuffer::buffer() { return buffer_; }
 
+scoped_refptr<net::GrowableIOBuffer> ChannelBuffer::TakeBuffer() {
+  scoped_refptr<net::GrowableIOBuffer> buffer = std::move(buffer_);
+  if (taken_buffer_ && taken_buffer_->HasOneRef()) {
+    buffer_ = std::move(taken_buffer_);
+  } else {
+    buffer_ = base::MakeRefCounted<net::GrowableIOBuffer>();
+  }
+  if (buffer_->capacity() != buffer->capacity())
+    buffer_->SetCapacity(buffer->capacity());
+  taken_buffer_ = buffer;
+  return buffer;
+}
+
 void ChannelBuffer::SetDynamicBuffer(bool is_dynamic) { is_dynamic_ = true; }
 
 void ChannelBuffer::Reset() {
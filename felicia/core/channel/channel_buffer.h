@@ -39,8 +39,15 @@ class FEL_EXPORT ChannelBuffer {
 
   scoped_refptr<net::GrowableIOBuffer> buffer();
 
+  // Hands the buffer over to the caller, who keeps what is received in it
+  // without copying, and continues with another buffer of the same capacity.
+  // The buffer taken before is reused if the caller has released it.
+  scoped_refptr<net::GrowableIOBuffer> TakeBuffer();
+
  private:
   scoped_refptr<net::GrowableIOBuffer> buffer_;
+  // The buffer taken last by TakeBuffer().
+  scoped_refptr<net::GrowableIOBuffer> taken_buffer_;
   bool is_dynamic_ = false;
 };
 
@@ -5,8 +5,11 @@
 #ifndef FELICIA_CORE_CHANNEL_MESSAGE_RECEIVER_H_
 #define FELICIA_CORE_CHANNEL_MESSAGE_RECEIVER_H_
 
+#include <type_traits>
+
 #include "third_party/chromium/base/bind.h"
 #include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
 
 #include "felicia/core/channel/channel.h"
 #include "felicia/core/lib/error/errors.h"
@@ -83,8 +86,7 @@ class MessageReceiver {
     const char* buffer = channel_->receive_buffer_.StartOfBuffer();
     MessageIOError err = ParseHeader(buffer, &message_offset, &message_size);
     if (err == MessageIOError::OK) {
-      err = MessageIO<T>::Deserialize(buffer + message_offset, message_size,
-                                      &message_);
+      err = DeserializeReceived(buffer + message_offset, message_size);
     }
 
     if (err != MessageIOError::OK) {
@@ -115,6 +117,25 @@ class MessageReceiver {
       std::move(receive_callback_)
           .Run(errors::Aborted("message_size is negative"));
     } else if (message_size > 0) {
+      if (channel_->is_chunked_transfer() &&
+          !channel_->TrySetEnoughReceiveBufferSize(message_size)) {
+        // |message_size| comes from the wire, so it isn't reserved up front.
+        // The buffer for it grows as the chunks arrive.
+        int max_message_size =
+            static_cast<int>(channel_->max_chunked_message_size().bytes());
+        if (message_size > max_message_size) {
+          std::move(receive_callback_)
+              .Run(errors::ResourceExhausted(
+                  base::StringPrintf("message_size %d exceeds the maximum %d.",
+                                     message_size, max_message_size)));
+          return;
+        }
+        channel_->ReceiveChunked(
+            message_size,
+            base::BindOnce(&MessageReceiver<T>::OnReceiveChunked,
+                           base::Unretained(this), message_size));
+        return;
+      }
       channel_->ReceiveInternalBuffer(
           message_size, base::BindOnce(&MessageReceiver<T>::OnReceiveMessage,
                                        base::Unretained(this), message_size));
@@ -129,8 +150,26 @@ class MessageReceiver {
       return;
     }
     const char* buffer = channel_->receive_buffer_.StartOfBuffer();
+    MessageIOError err = DeserializeReceived(buffer, message_size);
+    if (err != MessageIOError::OK) {
+      std::move(receive_callback_)
+          .Run(errors::Aborted(MessageIOErrorToString(err)));
+    } else {
+      std::move(receive_callback_).Run(Status::OK());
+    }
+  }
+
+  void OnReceiveChunked(int message_size, Status s) {
+    if (!s.ok()) {
+      std::move(receive_callback_).Run(std::move(s));
+      return;
+    }
+    // The buffer is released after it is deserialized, unless the message
+    // keeps it, so it doesn't hold as much as the largest message like a
+    // dynamic buffer does.
     MessageIOError err =
-        MessageIO<T>::Deserialize(buffer, message_size, &message_);
+        DeserializeChunked(channel_->TakeChunkedReceiveBuffer(), message_size,
+                           IsLazyProtobufMessage<T>());
     if (err != MessageIOError::OK) {
       std::move(receive_callback_)
           .Run(errors::Aborted(MessageIOErrorToString(err)));
@@ -148,6 +187,37 @@ class MessageReceiver {
     }
   }
 
+  MessageIOError DeserializeReceived(const char* start, int size) {
+    return DeserializeReceived(start, size, IsLazyProtobufMessage<T>());
+  }
+
+  MessageIOError DeserializeReceived(const char* start, int size,
+                                     std::false_type) {
+    return MessageIO<T>::Deserialize(start, size, &message_);
+  }
+
+  // LazyProtobufMessage takes the receive buffer instead of copying the
+  // message out of it.
+  MessageIOError DeserializeReceived(const char* start, int size,
+                                     std::true_type) {
+    return MessageIO<T>::Deserialize(channel_->receive_buffer_.TakeBuffer(),
+                                     start, size, &message_);
+  }
+
+  MessageIOError DeserializeChunked(scoped_refptr<net::GrowableIOBuffer> buffer,
+                                    int size, std::false_type) {
+    return MessageIO<T>::Deserialize(buffer->StartOfBuffer(), size,
+                                     &message_);
+  }
+
+  // LazyProtobufMessage takes the buffer instead of copying it.
+  MessageIOError DeserializeChunked(scoped_refptr<net::GrowableIOBuffer> buffer,
+                                    int size, std::true_type) {
+    const char* start = buffer->StartOfBuffer();
+    return MessageIO<T>::Deserialize(std::move(buffer), start,
+                                     static_cast<size_t>(size), &message_);
+  }
+
   MessageIOError ParseHeader(const char* buffer, int* message_offset,
                              int* message_size) {
     if (parse_header_callback_.is_null()) {
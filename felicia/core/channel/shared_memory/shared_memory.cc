@@ -74,16 +74,27 @@ ChannelDef SharedMemory::ToChannelDef() const {
   WritableSharedBuffer* writable_buffer = buffer_->ToWritableSharedBuffer();
   ChannelDef channel_def;
   channel_def.set_type(ChannelDef::CHANNEL_TYPE_SHM);
-  base::subtle::PlatformSharedMemoryRegion region =
-      base::ReadOnlySharedMemoryRegion::TakeHandleForSerialization(
-          writable_buffer->DuplicateSharedMemoryRegion());
+  ToShmEndPoint(base::ReadOnlySharedMemoryRegion::TakeHandleForSerialization(
+                    writable_buffer->DuplicateSharedMemoryRegion()),
+                channel_def.mutable_shm_endpoint());
+  return channel_def;
+}
+
+// static
+std::unique_ptr<SharedMemory> SharedMemory::FromChannelDef(
+    ChannelDef channel_def) {
+  return std::make_unique<SharedMemory>(
+      FromShmEndPoint(channel_def.shm_endpoint()));
+}
+
+void ToShmEndPoint(base::subtle::PlatformSharedMemoryRegion region,
+                   ShmEndPoint* endpoint) {
   base::subtle::PlatformSharedMemoryRegion::ScopedPlatformHandle
       platform_handle = region.PassPlatformHandle();
   base::UnguessableToken guid = region.GetGUID();
   base::subtle::PlatformSharedMemoryRegion::Mode mode = region.GetMode();
   size_t size = region.GetSize();
 
-  ShmEndPoint* endpoint = channel_def.mutable_shm_endpoint();
 #if defined(OS_MACOSX) && !defined(OS_IOS)
   endpoint->mutable_platform_handle()->set_mach_port(
       static_cast<uint64_t>(platform_handle.release()));
@@ -104,16 +115,12 @@ ChannelDef SharedMemory::ToChannelDef() const {
   UngeussableToken* token = endpoint->mutable_guid();
   token->set_high(guid.GetHighForSerialization());
   token->set_low(guid.GetLowForSerialization());
-
-  return channel_def;
 }
 
-// static
-std::unique_ptr<SharedMemory> SharedMemory::FromChannelDef(
-    ChannelDef channel_def) {
+base::subtle::PlatformSharedMemoryRegion FromShmEndPoint(
+    const ShmEndPoint& endpoint) {
   base::subtle::PlatformSharedMemoryRegion::ScopedPlatformHandle
       scoped_platform_handle;
-  const ShmEndPoint& endpoint = channel_def.shm_endpoint();
   auto mode = static_cast<base::subtle::PlatformSharedMemoryRegion::Mode>(
       endpoint.mode());
   auto guid = base::UnguessableToken::Deserialize(endpoint.guid().high(),
@@ -145,9 +152,8 @@ std::unique_ptr<SharedMemory> SharedMemory::FromChannelDef(
       base::ScopedFD{fd_pair.fd()}, base::ScopedFD{fd_pair.readonly_fd()}};
 #endif
 
-  return std::make_unique<SharedMemory>(
-      base::subtle::PlatformSharedMemoryRegion::Take(
-          std::move(scoped_platform_handle), mode, size, guid));
+  return base::subtle::PlatformSharedMemoryRegion::Take(
+      std::move(scoped_platform_handle), mode, size, guid);
 }
 
 }  // namespace felicia
\ No newline at end of file
@@ -35,6 +35,15 @@ class SharedMemory : public ChannelImpl {
   base::subtle::Atomic32 last_version_;  // Used when read the data
 };
 
+// Moves the handle of |region| into |endpoint|, so that it can be handed to
+// another process through PlatformHandleBroker.
+void ToShmEndPoint(base::subtle::PlatformSharedMemoryRegion region,
+                   ShmEndPoint* endpoint);
+
+// Takes the handle of |endpoint| received from another process.
+base::subtle::PlatformSharedMemoryRegion FromShmEndPoint(
+    const ShmEndPoint& endpoint);
+
 }  // namespace felicia
 
 #endif  // FELICIA_CORE_CHANNEL_SHARED_MEMORY_SHARED_MEMORY_H_
\ No newline at end of file
@@ -0,0 +1,186 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
+
+#include "third_party/chromium/base/bits.h"
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/process/process_metrics.h"
+
+#include "felicia/core/channel/shared_memory/shared_memory.h"
+
+namespace felicia {
+
+WritableSharedSlotBuffer::WritableSharedSlotBuffer(size_t slot_count,
+                                                   size_t slot_size)
+    : slot_sequences_(slot_count, 0) {
+  DCHECK_GT(slot_count, 0u);
+  size_t page_size = base::GetPageSize();
+  size_t data_offset = base::bits::Align(
+      sizeof(internal::SharedSlotBufferHeader) +
+          slot_count * sizeof(internal::SharedSlotHeader),
+      page_size);
+  size_t slot_stride = base::bits::Align(slot_size, page_size);
+
+  base::MappedReadOnlyRegion mapped_region =
+      base::ReadOnlySharedMemoryRegion::Create(data_offset +
+                                               slot_count * slot_stride);
+  CHECK(mapped_region.IsValid());
+  shared_memory_region_ = std::move(mapped_region.region);
+  shared_memory_mapping_ = std::move(mapped_region.mapping);
+
+  char* mem = reinterpret_cast<char*>(shared_memory_mapping_.memory());
+  DCHECK(mem);
+  header_ = new (mem) internal::SharedSlotBufferHeader();
+  header_->slot_count = slot_count;
+  header_->slot_size = slot_size;
+  header_->data_offset = data_offset;
+  header_->slot_stride = slot_stride;
+  for (size_t i = 0; i < slot_count; ++i) {
+    new (slot_header(i)) internal::SharedSlotHeader();
+  }
+}
+
+WritableSharedSlotBuffer::~WritableSharedSlotBuffer() = default;
+
+size_t WritableSharedSlotBuffer::slot_count() const {
+  return header_->slot_count;
+}
+
+size_t WritableSharedSlotBuffer::slot_size() const {
+  return header_->slot_size;
+}
+
+char* WritableSharedSlotBuffer::slot_data(size_t index) {
+  DCHECK_LT(index, slot_count());
+  return reinterpret_cast<char*>(header_) + header_->data_offset +
+         index * header_->slot_stride;
+}
+
+int WritableSharedSlotBuffer::AcquireSlot() {
+  int index = -1;
+  for (size_t i = 0; i < slot_sequences_.size(); ++i) {
+    if (slot_sequences_[i] < 0) continue;
+    if (index == -1 || slot_sequences_[i] < slot_sequences_[index]) {
+      index = i;
+    }
+  }
+  if (index == -1) return -1;
+
+  slot_sequences_[index] = -1;
+  // Increment the version to odd to indicate the beginning of a write.
+  base::subtle::Barrier_AtomicIncrement(&slot_header(index)->version, 1);
+  return index;
+}
+
+int64_t WritableSharedSlotBuffer::CommitSlot(size_t index, size_t length,
+                                             base::TimeDelta timestamp) {
+  DCHECK_LT(index, slot_count());
+  DCHECK_EQ(slot_sequences_[index], -1);
+  DCHECK_LE(length, slot_size());
+
+  internal::SharedSlotHeader* header = slot_header(index);
+  header->length = length;
+  header->sequence = ++last_sequence_;
+  header->timestamp_in_us = timestamp.InMicroseconds();
+  // Increment the version to even to indicate the completion of the write.
+  base::subtle::Barrier_AtomicIncrement(&header->version, 1);
+
+  slot_sequences_[index] = last_sequence_;
+  return last_sequence_;
+}
+
+ShmEndPoint WritableSharedSlotBuffer::ToShmEndPoint() const {
+  ShmEndPoint endpoint;
+  felicia::ToShmEndPoint(
+      base::ReadOnlySharedMemoryRegion::TakeHandleForSerialization(
+          shared_memory_region_.Duplicate()),
+      &endpoint);
+  return endpoint;
+}
+
+internal::SharedSlotHeader* WritableSharedSlotBuffer::slot_header(
+    size_t index) {
+  return reinterpret_cast<internal::SharedSlotHeader*>(header_ + 1) + index;
+}
+
+ReadOnlySharedSlotBuffer::ReadOnlySharedSlotBuffer(
+    const ShmEndPoint& endpoint) {
+  shared_memory_region_ =
+      base::ReadOnlySharedMemoryRegion::Deserialize(FromShmEndPoint(endpoint));
+  shared_memory_mapping_ = shared_memory_region_.Map();
+  if (shared_memory_mapping_.IsValid() &&
+      shared_memory_mapping_.size() >=
+          sizeof(internal::SharedSlotBufferHeader)) {
+    header_ = reinterpret_cast<const internal::SharedSlotBufferHeader*>(
+        shared_memory_mapping_.memory());
+  }
+}
+
+ReadOnlySharedSlotBuffer::~ReadOnlySharedSlotBuffer() = default;
+
+bool ReadOnlySharedSlotBuffer::IsValid() const {
+  if (!header_) return false;
+
+  size_t slot_count = header_->slot_count;
+  size_t headers_size = sizeof(internal::SharedSlotBufferHeader) +
+                        slot_count * sizeof(internal::SharedSlotHeader);
+  size_t size = header_->data_offset + slot_count * header_->slot_stride;
+  return slot_count > 0 && header_->slot_size <= header_->slot_stride &&
+         headers_size <= header_->data_offset &&
+         size <= shared_memory_mapping_.size();
+}
+
+size_t ReadOnlySharedSlotBuffer::slot_count() const {
+  return header_->slot_count;
+}
+
+size_t ReadOnlySharedSlotBuffer::slot_size() const {
+  return header_->slot_size;
+}
+
+bool ReadOnlySharedSlotBuffer::ReadLatest(int64_t sequence, Slot* slot) const {
+  DCHECK(IsValid());
+  bool found = false;
+  for (size_t i = 0; i < slot_count(); ++i) {
+    const internal::SharedSlotHeader* header = slot_header(i);
+    base::subtle::Atomic32 version =
+        base::subtle::Acquire_Load(&header->version);
+    // The slot is being written.
+    if (version & 1) continue;
+
+    int64_t slot_sequence = header->sequence;
+    size_t length = header->length;
+    int64_t timestamp_in_us = header->timestamp_in_us;
+    // -- Load fence, read membarrier
+    if (base::subtle::Release_Load(&header->version) != version) continue;
+
+    if (slot_sequence <= sequence || length > slot_size()) continue;
+    if (found && slot_sequence <= slot->sequence) continue;
+
+    slot->data = reinterpret_cast<const char*>(header_) +
+                 header_->data_offset + i * header_->slot_stride;
+    slot->length = length;
+    slot->sequence = slot_sequence;
+    slot->timestamp = base::TimeDelta::FromMicroseconds(timestamp_in_us);
+    slot->index = i;
+    slot->version = version;
+    found = true;
+  }
+  return found;
+}
+
+bool ReadOnlySharedSlotBuffer::ReadRetry(const Slot& slot) const {
+  // -- Load fence, read membarrier
+  return base::subtle::Release_Load(&slot_header(slot.index)->version) !=
+         slot.version;
+}
+
+const internal::SharedSlotHeader* ReadOnlySharedSlotBuffer::slot_header(
+    size_t index) const {
+  return reinterpret_cast<const internal::SharedSlotHeader*>(header_ + 1) +
+         index;
+}
+
+}  // namespace felicia
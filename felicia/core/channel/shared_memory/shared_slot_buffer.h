@@ -0,0 +1,138 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_CHANNEL_SHARED_MEMORY_SHARED_SLOT_BUFFER_H_
+#define FELICIA_CORE_CHANNEL_SHARED_MEMORY_SHARED_SLOT_BUFFER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "third_party/chromium/base/atomicops.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/memory/read_only_shared_memory_region.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/protobuf/channel.pb.h"
+
+namespace felicia {
+
+namespace internal {
+
+// Laid out at the start of the shared memory, followed by a SharedSlotHeader
+// for each slot. The data of the slots start at |data_offset| and are
+// |slot_stride| apart, both of which are page aligned.
+struct SharedSlotBufferHeader {
+  uint32_t slot_count;
+  uint32_t slot_size;
+  uint64_t data_offset;
+  uint64_t slot_stride;
+};
+
+// |version| is odd while the slot is being written, and the other fields are
+// valid only if it is the same before and after they are read.
+struct SharedSlotHeader {
+  base::subtle::Atomic32 version;
+  uint32_t length;
+  int64_t sequence;
+  int64_t timestamp_in_us;
+};
+
+}  // namespace internal
+
+// WritableSharedSlotBuffer is a shared memory split into slots of the same
+// size, so that a producer can write the data, e.g, the camera frames, right
+// into the shared memory and the readers in other processes can read them in
+// place, with no copy in between.
+//
+// Unlike SharedMemory, the slots are written one after another, and the
+// readers get the latest slot written. A slot handed out by AcquireSlot() is
+// the least recently written one, so the newer slots stay readable while the
+// producer holds some of the slots at a time, e.g, the buffers queued to a
+// V4L2 driver. It is not thread-safe.
+class FEL_EXPORT WritableSharedSlotBuffer {
+ public:
+  WritableSharedSlotBuffer(size_t slot_count, size_t slot_size);
+  ~WritableSharedSlotBuffer();
+
+  size_t slot_count() const;
+  size_t slot_size() const;
+
+  // Returns the data of the slot at |index|, which is page aligned.
+  char* slot_data(size_t index);
+
+  // Returns the index of the slot to write next and marks it as being
+  // written, or -1 if all of the slots are being written.
+  int AcquireSlot();
+  // Marks the slot at |index| as written with |length| bytes captured at
+  // |timestamp|, and returns its sequence, which starts from 1.
+  int64_t CommitSlot(size_t index, size_t length, base::TimeDelta timestamp);
+
+  // Returns the endpoint to hand to the readers, with a read-only handle.
+  ShmEndPoint ToShmEndPoint() const;
+
+ private:
+  internal::SharedSlotHeader* slot_header(size_t index);
+
+  base::ReadOnlySharedMemoryRegion shared_memory_region_;
+  base::WritableSharedMemoryMapping shared_memory_mapping_;
+
+  internal::SharedSlotBufferHeader* header_ = nullptr;
+  // The sequence of the last commit of each slot, 0 if it has never been
+  // committed, or -1 while it is being written.
+  std::vector<int64_t> slot_sequences_;
+  int64_t last_sequence_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(WritableSharedSlotBuffer);
+};
+
+// ReadOnlySharedSlotBuffer reads the slots of a WritableSharedSlotBuffer from
+// another process. It is thread-safe.
+class FEL_EXPORT ReadOnlySharedSlotBuffer {
+ public:
+  struct Slot {
+    // Points to the shared memory, which can be overwritten at any time.
+    const char* data = nullptr;
+    size_t length = 0;
+    int64_t sequence = 0;
+    base::TimeDelta timestamp;
+
+    size_t index = 0;
+    base::subtle::Atomic32 version = 0;
+  };
+
+  explicit ReadOnlySharedSlotBuffer(const ShmEndPoint& endpoint);
+  ~ReadOnlySharedSlotBuffer();
+
+  // Returns false if the shared memory isn't mapped or it isn't laid out by
+  // WritableSharedSlotBuffer.
+  bool IsValid() const;
+
+  size_t slot_count() const;
+  size_t slot_size() const;
+
+  // Finds the latest slot committed after |sequence|, and returns false if
+  // there is none.
+  bool ReadLatest(int64_t sequence, Slot* slot) const;
+
+  // Returns true if |slot| has been overwritten since ReadLatest(), then
+  // whatever is read from its data should be discarded. Call this after
+  // reading the data, e.g, copying it out or processing it in place.
+  bool ReadRetry(const Slot& slot) const;
+
+ private:
+  const internal::SharedSlotHeader* slot_header(size_t index) const;
+
+  base::ReadOnlySharedMemoryRegion shared_memory_region_;
+  base::ReadOnlySharedMemoryMapping shared_memory_mapping_;
+
+  const internal::SharedSlotBufferHeader* header_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadOnlySharedSlotBuffer);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_CHANNEL_SHARED_MEMORY_SHARED_SLOT_BUFFER_H_
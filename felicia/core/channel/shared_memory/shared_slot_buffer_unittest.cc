@@ -0,0 +1,118 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
+
+#include <string.h>
+
+#include <deque>
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr size_t kSlotSize = 640 * 480 * 2;
+
+// Hands the slots to a fake driver the way V4l2Camera does: |queue_size|
+// slots are queued at a time, and a slot is replaced by a new one as soon as
+// it is dequeued.
+class SyntheticCaptureQueue {
+ public:
+  SyntheticCaptureQueue(WritableSharedSlotBuffer* slot_buffer,
+                        size_t queue_size)
+      : slot_buffer_(slot_buffer) {
+    for (size_t i = 0; i < queue_size; ++i) {
+      queued_.push_back(slot_buffer_->AcquireSlot());
+    }
+  }
+
+  // Fills the oldest queued slot with |value|, as if a driver captured a
+  // frame into it, and queues another slot in its place.
+  int64_t Capture(char value) {
+    int index = queued_.front();
+    queued_.pop_front();
+    memset(slot_buffer_->slot_data(index), value, kSlotSize);
+    int64_t sequence = slot_buffer_->CommitSlot(
+        index, kSlotSize, base::TimeDelta::FromMilliseconds(value));
+    queued_.push_back(slot_buffer_->AcquireSlot());
+    return sequence;
+  }
+
+  int next_index() const { return queued_.front(); }
+
+ private:
+  WritableSharedSlotBuffer* slot_buffer_;
+  std::deque<int> queued_;
+};
+
+bool IsFilledWith(const ReadOnlySharedSlotBuffer::Slot& slot, char value) {
+  for (size_t i = 0; i < slot.length; ++i) {
+    if (slot.data[i] != value) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(SharedSlotBufferTest, ReadLatestInPlace) {
+  WritableSharedSlotBuffer slot_buffer(6, kSlotSize);
+  ReadOnlySharedSlotBuffer reader(slot_buffer.ToShmEndPoint());
+  ASSERT_TRUE(reader.IsValid());
+  EXPECT_EQ(6u, reader.slot_count());
+  EXPECT_EQ(kSlotSize, reader.slot_size());
+
+  ReadOnlySharedSlotBuffer::Slot slot;
+  EXPECT_FALSE(reader.ReadLatest(0, &slot));
+
+  SyntheticCaptureQueue queue(&slot_buffer, 4);
+  int64_t last_sequence = 0;
+  for (char value = 1; value <= 10; ++value) {
+    int64_t sequence = queue.Capture(value);
+    ASSERT_TRUE(reader.ReadLatest(last_sequence, &slot));
+    EXPECT_EQ(sequence, slot.sequence);
+    EXPECT_EQ(base::TimeDelta::FromMilliseconds(value), slot.timestamp);
+    EXPECT_EQ(kSlotSize, slot.length);
+    EXPECT_TRUE(IsFilledWith(slot, value));
+    EXPECT_FALSE(reader.ReadRetry(slot));
+    last_sequence = slot.sequence;
+  }
+  EXPECT_FALSE(reader.ReadLatest(last_sequence, &slot));
+}
+
+TEST(SharedSlotBufferTest, DetectOverwrite) {
+  WritableSharedSlotBuffer slot_buffer(5, kSlotSize);
+  ReadOnlySharedSlotBuffer reader(slot_buffer.ToShmEndPoint());
+  SyntheticCaptureQueue queue(&slot_buffer, 4);
+
+  queue.Capture(1);
+  ReadOnlySharedSlotBuffer::Slot slot;
+  ASSERT_TRUE(reader.ReadLatest(0, &slot));
+  EXPECT_FALSE(reader.ReadRetry(slot));
+
+  // The slot read above is the only one not queued, so it is queued again as
+  // soon as the next frame is captured.
+  queue.Capture(2);
+  EXPECT_TRUE(reader.ReadRetry(slot));
+
+  ASSERT_TRUE(reader.ReadLatest(slot.sequence, &slot));
+  EXPECT_TRUE(IsFilledWith(slot, 2));
+}
+
+TEST(SharedSlotBufferTest, AcquireLeastRecentlyWritten) {
+  WritableSharedSlotBuffer slot_buffer(3, kSlotSize);
+  int first = slot_buffer.AcquireSlot();
+  int second = slot_buffer.AcquireSlot();
+  int third = slot_buffer.AcquireSlot();
+  EXPECT_EQ(-1, slot_buffer.AcquireSlot());
+
+  slot_buffer.CommitSlot(second, 0, base::TimeDelta());
+  slot_buffer.CommitSlot(first, 0, base::TimeDelta());
+  EXPECT_EQ(second, slot_buffer.AcquireSlot());
+  slot_buffer.CommitSlot(third, 0, base::TimeDelta());
+  EXPECT_EQ(first, slot_buffer.AcquireSlot());
+}
+
+}  // namespace felicia
@@ -7,13 +7,17 @@
 
 #include "felicia/core/communication/subscriber.h"
 #include "felicia/core/message/dynamic_protobuf_message.h"
+#include "felicia/core/message/protobuf_json_message.h"
 
 namespace felicia {
 
-class DynamicSubscriber : public Subscriber<DynamicProtobufMessage> {
+namespace internal {
+
+// Subscribes a topic whose type isn't known until its TopicInfo is found.
+template <typename MessageTy>
+class DynamicSubscriberBase : public Subscriber<MessageTy> {
  public:
-  DynamicSubscriber();
-  ~DynamicSubscriber();
+  using typename Subscriber<MessageTy>::OnMessageCallback;
 
   void Subscribe(const communication::Settings& settings,
                  OnMessageCallback on_message_callback,
@@ -24,7 +28,73 @@ class DynamicSubscriber : public Subscriber<DynamicProtobufMessage> {
   void Unsubscribe(const std::string& topic,
                    StatusOnceCallback callback = StatusCallback());
 
-  const TopicInfo& topic_info() const { return topic_info_; }
+  const TopicInfo& topic_info() const { return this->topic_info_; }
+};
+
+template <typename MessageTy>
+void DynamicSubscriberBase<MessageTy>::Subscribe(
+    const communication::Settings& settings,
+    OnMessageCallback on_message_callback, StatusCallback on_error_callback) {
+#if DCHECK_IS_ON()
+  MainThread& main_thread = MainThread::GetInstance();
+  DCHECK(main_thread.IsBoundToCurrentThread());
+#endif
+  DLOG(INFO) << FROM_HERE.ToString();
+  DCHECK(this->IsUnregistered()) << this->register_state_.ToString();
+
+  this->register_state_.ToRegistered(FROM_HERE);
+
+  this->channel_types_ = AllChannelTypes();
+  this->on_message_callback_ = on_message_callback;
+  this->on_error_callback_ = on_error_callback;
+  this->settings_ = settings;
+
+  this->subscriber_state_.ToStopped(FROM_HERE);
+}
+
+template <typename MessageTy>
+void DynamicSubscriberBase<MessageTy>::OnFindPublisher(
+    const TopicInfo& topic_info) {
+#if DCHECK_IS_ON()
+  MainThread& main_thread = MainThread::GetInstance();
+  DCHECK(main_thread.IsBoundToCurrentThread());
+#endif
+  DLOG(INFO) << FROM_HERE.ToString();
+  Subscriber<MessageTy>::OnFindPublisher(topic_info);
+}
+
+template <typename MessageTy>
+void DynamicSubscriberBase<MessageTy>::Unsubscribe(
+    const std::string& topic, StatusOnceCallback callback) {
+#if DCHECK_IS_ON()
+  MainThread& main_thread = MainThread::GetInstance();
+  DCHECK(main_thread.IsBoundToCurrentThread());
+#endif
+  DLOG(INFO) << FROM_HERE.ToString();
+  // Unsubscribe function can be called either when topic info is updated to
+  // UNREGISTERED state or manually unregistration from the js side. If both
+  // cases happens almost same time, one of them should be ignored.
+  if (this->IsUnregistered()) {
+    DCHECK(this->IsStopping() || this->IsStopped())
+        << this->subscriber_state_.ToString();
+    std::move(callback).Run(errors::Aborted("Already unsubscribed"));
+    return;
+  }
+
+  DCHECK(this->IsRegistered()) << this->register_state_.ToString();
+
+  this->register_state_.ToUnregistered(FROM_HERE);
+
+  this->StopMessageLoop(std::move(callback));
+}
+
+}  // namespace internal
+
+class DynamicSubscriber
+    : public internal::DynamicSubscriberBase<DynamicProtobufMessage> {
+ public:
+  DynamicSubscriber();
+  ~DynamicSubscriber();
 
  private:
   bool MaybeResolveMessgaeType(const TopicInfo& topic_info) override;
@@ -32,6 +102,22 @@ class DynamicSubscriber : public Subscriber<DynamicProtobufMessage> {
   DISALLOW_COPY_AND_ASSIGN(DynamicSubscriber);
 };
 
+// DynamicJsonSubscriber receives the messages as JSON, which is written
+// straight from the received bytes, so the messages are never parsed. Use it
+// when the messages are only to be written as JSON, e.g, to be sent to a
+// browser.
+class DynamicJsonSubscriber
+    : public internal::DynamicSubscriberBase<ProtobufJsonMessage> {
+ public:
+  DynamicJsonSubscriber();
+  ~DynamicJsonSubscriber();
+
+ private:
+  bool MaybeResolveMessgaeType(const TopicInfo& topic_info) override;
+
+  DISALLOW_COPY_AND_ASSIGN(DynamicJsonSubscriber);
+};
+
 }  // namespace felicia
 
-#endif  // FELICIA_CORE_COMMUNICATION_DYNAMIC_SUBSCRIBIER_H_
\ No newline at end of file
+#endif  // FELICIA_CORE_COMMUNICATION_DYNAMIC_SUBSCRIBIER_H_
@@ -123,6 +123,9 @@ class Publisher {
   }
 
   virtual TopicInfo::ImplType GetMessageImplType() const {
+    if (PodMessageTraits<MessageTy>::value) {
+      return TopicInfo::POD;
+    }
 #if defined(HAS_ROS)
     if (ros::message_traits::IsMessage<MessageTy>::value) {
       return TopicInfo::ROS;
@@ -183,6 +186,7 @@ void Publisher<MessageTy>::RequestPublish(
   topic_info_.set_topic(topic);
   topic_info_.set_type_name(GetMessageTypeName());
   topic_info_.set_impl_type(GetMessageImplType());
+  topic_info_.set_type_hash(PodMessageTraits<MessageTy>::kTypeHash);
   *request->mutable_topic_info() = topic_info_;
   PublishTopicResponse* response = new PublishTopicResponse();
 
@@ -275,6 +279,7 @@ void Publisher<MessageTy>::RequestPublishForTesting(
   topic_info_.set_topic(topic);
   topic_info_.set_type_name(GetMessageTypeName());
   topic_info_.set_impl_type(GetMessageImplType());
+  topic_info_.set_type_hash(PodMessageTraits<MessageTy>::kTypeHash);
 
   OnPublishTopicAsync(nullptr, nullptr, settings, StatusOnceCallback(),
                       Status::OK());
@@ -398,6 +403,9 @@ void Publisher<MessageTy>::OnPublishTopicAsync(
   for (auto& channel : channels_) {
     if (!channel->HasNativeHeader()) {
       channel->SetSendBuffer(send_buffer_);
+      if (!settings.is_dynamic_buffer) {
+        channel->SetChunkedTransfer(settings.is_chunked_transfer);
+      }
     } else {
       if (settings.is_dynamic_buffer) {
         channel->SetDynamicSendBuffer(true);
@@ -468,12 +476,26 @@ void Publisher<MessageTy>::SendMessage(SendMessageCallback callback) {
 
   Header header;
   int to_send = header.header_size() + serialized.length();
+  // If the message doesn't fit in |send_buffer_|, channels which support
+  // chunked transfer send the header from |send_buffer_| and the message
+  // from |chunked_buffer|, which takes |serialized| without copying it.
+  scoped_refptr<net::StringIOBuffer> chunked_buffer;
   if (err == MessageIOError::OK) {
     if (send_buffer_.SetEnoughCapacityIfDynamic(to_send)) {
       err = header.AttachHeaderInternally(serialized,
                                           send_buffer_.StartOfBuffer());
     } else {
       err = MessageIOError::ERR_NOT_ENOUGH_BUFFER;
+      for (auto& channel : channels_) {
+        if (channel->is_chunked_transfer()) {
+          header.set_size(serialized.length());
+          err = header.WriteHeaderInternally(send_buffer_.StartOfBuffer());
+          chunked_buffer = base::MakeRefCounted<net::StringIOBuffer>(
+              std::make_unique<std::string>(std::move(serialized)));
+          serialized.clear();
+          break;
+        }
+      }
     }
   }
 
@@ -481,10 +503,26 @@ void Publisher<MessageTy>::SendMessage(SendMessageCallback callback) {
     for (auto& channel : channels_) {
       if (!channel->IsSending() && channel->HasReceivers()) {
         if (channel->HasNativeHeader()) {
+          // |serialized| is taken by |chunked_buffer| if any.
+          if (chunked_buffer && serialized.empty()) {
+            serialized.assign(chunked_buffer->data(), chunked_buffer->size());
+          }
           channel->Send(serialized,
                         base::BindOnce(&Publisher<MessageTy>::OnSendMessage,
                                        base::Unretained(this), callback,
                                        channel->type()));
+        } else if (chunked_buffer) {
+          if (channel->is_chunked_transfer()) {
+            channel->SendChunked(
+                header.header_size(), chunked_buffer, chunked_buffer->size(),
+                base::BindOnce(&Publisher<MessageTy>::OnSendMessage,
+                               base::Unretained(this), callback,
+                               channel->type()));
+          } else {
+            OnSendMessage(callback, channel->type(),
+                          errors::Aborted(MessageIOErrorToString(
+                              MessageIOError::ERR_NOT_ENOUGH_BUFFER)));
+          }
         } else {
           channel->SendInternalBuffer(
               to_send, base::BindOnce(&Publisher<MessageTy>::OnSendMessage,
@@ -87,13 +87,18 @@ class PubSubTest : public testing::Test {
   MessageGenerator generator_;
 };
 
-void SetupPubSub(PubSubTest* test, int channel_type, MessageChecker* checker) {
+communication::Settings DefaultSettings() {
   communication::Settings settings;
   Bytes size = Bytes::FromBytes(512);
   settings.buffer_size = size;
   settings.channel_settings.shm_settings.shm_size = size;
   settings.period = base::TimeDelta::FromMilliseconds(30);
+  return settings;
+}
 
+void SetupPubSub(PubSubTest* test, int channel_type,
+                 const communication::Settings& settings,
+                 MessageChecker* checker) {
   test->RequestPublish(channel_type, settings);
   test->RequestSubscribe(channel_type, settings,
                          base::BindRepeating(&MessageChecker::CheckMessage,
@@ -105,7 +110,9 @@ void PublishMessage(PubSubTest* test, const SimpleMessage& message) {
   test->Publish(message);
 }
 
-void PublishAndSubscribeTopic(PubSubTest* test, int channel_type) {
+void PublishAndSubscribeTopic(
+    PubSubTest* test, int channel_type,
+    const communication::Settings& settings = DefaultSettings()) {
   MessageChecker checker;
   checker.set_test_num(1);
   checker.set_on_test_done(
@@ -113,7 +120,8 @@ void PublishAndSubscribeTopic(PubSubTest* test, int channel_type) {
   MainThread& main_thread = MainThread::GetInstance();
   main_thread.PostTask(FROM_HERE,
                        base::BindOnce(&SetupPubSub, test,
-                                      ChannelDef::CHANNEL_TYPE_TCP, &checker));
+                                      ChannelDef::CHANNEL_TYPE_TCP, settings,
+                                      &checker));
   SimpleMessage message = test->GenerateMessage();
   checker.set_expected(message);
   main_thread.PostDelayedTask(FROM_HERE,
@@ -131,4 +139,13 @@ TEST_F(PubSubTest, PublishAndSubscribeTopic) {
   PublishAndSubscribeTopic(this, ChannelDef::CHANNEL_TYPE_SHM);
 }
 
+TEST_F(PubSubTest, PublishAndSubscribeTopicInChunks) {
+  // SimpleMessage with a header is larger than 8 bytes, so it should be sent
+  // and received in chunks.
+  communication::Settings settings = DefaultSettings();
+  settings.buffer_size = Bytes::FromBytes(8);
+  settings.is_chunked_transfer = true;
+  PublishAndSubscribeTopic(this, ChannelDef::CHANNEL_TYPE_TCP, settings);
+}
+
 }  // namespace felicia
\ No newline at end of file
@@ -5,17 +5,24 @@
 #ifndef FELICIA_CORE_COMMUNICATION_SERVICE_CLIENT_H_
 #define FELICIA_CORE_COMMUNICATION_SERVICE_CLIENT_H_
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "third_party/chromium/base/bind.h"
 #include "third_party/chromium/base/callback.h"
 #include "third_party/chromium/base/compiler_specific.h"
 #include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
 
+#include "felicia/core/channel/channel.h"
 #include "felicia/core/communication/register_state.h"
 #include "felicia/core/master/master_proxy.h"
 #include "felicia/core/rpc/client.h"
+#include "felicia/core/rpc/load_balancer.h"
 #include "felicia/core/thread/main_thread.h"
 
 namespace felicia {
@@ -23,10 +30,17 @@ namespace felicia {
 using OnServiceConnectCallback =
     base::RepeatingCallback<void(ServiceInfo::Status)>;
 
+// ServiceClient connects to every server of the service, and spreads the
+// calls among them according to the load balancing policy. A server is taken
+// out when it is unregistered, or when a call to it fails with
+// error::UNAVAILABLE. |on_connect_callback| is called with
+// ServiceInfo::REGISTERED when the first server is connected, and with
+// ServiceInfo::UNREGISTERED when the last one is gone.
 template <typename ClientTy>
 class ServiceClient {
  public:
   ServiceClient() = default;
+  virtual ~ServiceClient() = default;
 
   ALWAYS_INLINE bool IsRegistering() const {
     return register_state_.IsRegistering();
@@ -41,7 +55,32 @@ class ServiceClient {
     return register_state_.IsUnregistered();
   }
 
-  ClientTy* operator->() { return &client_; }
+  // Returns the client connected to the server for the next call, or nullptr
+  // if no server is available, e.g, while the servers are failing over. It
+  // can be called on any thread. The client is neither shut down nor deleted
+  // while the returned handle is held, even if its server is gone meanwhile,
+  // so release the handle once the call is made.
+  // e.g,
+  // std::shared_ptr<ClientTy> client = service_client.PickClient();
+  // if (!client) {
+  //   std::move(callback).Run(errors::Unavailable("No server is connected."));
+  //   return;
+  // }
+  // client->AddAsync(&request, &response, std::move(callback));
+  std::shared_ptr<ClientTy> PickClient();
+
+  // Same as PickClient(), but it's a fatal error if no server is available.
+  // So it's only for the callers which know there is, e.g, in
+  // |on_connect_callback| with ServiceInfo::REGISTERED. The client is kept
+  // until the end of the expression, e.g, service_client->AddAsync(...).
+  std::shared_ptr<ClientTy> operator->();
+
+  // ROUND_ROBIN by default.
+  void set_load_balancing_policy(rpc::LoadBalancingPolicy policy);
+
+  // Connects to |max_providers| servers at most, which applies to the servers
+  // notified afterwards. There's no limit by default.
+  void set_max_providers(size_t max_providers);
 
   void RequestRegister(const NodeInfo& node_info, const std::string& service,
                        OnServiceConnectCallback on_connect_callback,
@@ -69,16 +108,96 @@ class ServiceClient {
       const UnregisterServiceClientResponse* response,
       StatusOnceCallback callback, Status s);
 
+  struct Provider {
+    uint32_t id;
+    ServiceInfo service_info;
+    // Shared with the handles returned by PickClient(), and shut down by
+    // ShutdownClient() when the last of them is released.
+    std::shared_ptr<ClientTy> client;
+    bool connected = false;
+  };
+
+  // Returns a client to connect to another server.
+  virtual std::unique_ptr<ClientTy> NewClient() {
+    return std::make_unique<ClientTy>();
+  }
+
+  // Shuts down and deletes |client| on the main thread, since the last handle
+  // to it can be released on any thread, including its own RPC thread.
+  static void ShutdownClient(ClientTy* client);
+
   void OnFindServiceServer(const ServiceInfo& service_info);
 
-  void OnConnect(Status s);
+  void OnConnect(uint32_t id, Status s);
+
+  // Removes the providers which are connected but not available.
+  void RemoveUnavailableProviders();
+  // Releases |providers|, and calls |on_connect_callback_| if there's no
+  // connected provider left.
+  void ShutdownProviders(std::vector<std::unique_ptr<Provider>> providers);
+  void ShutdownAllProviders();
+
+  bool HasConnectedProviderLocked() const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  base::Lock lock_;
+  // The servers which this connects to at most.
+  size_t max_providers_ GUARDED_BY(lock_) = std::numeric_limits<size_t>::max();
+  std::vector<std::unique_ptr<Provider>> providers_ GUARDED_BY(lock_);
+  rpc::LoadBalancer load_balancer_ GUARDED_BY(lock_);
+  bool remove_unavailable_providers_scheduled_ GUARDED_BY(lock_) = false;
+  uint32_t next_provider_id_ = 0;
 
-  ClientTy client_;
   OnServiceConnectCallback on_connect_callback_;
 
   communication::RegisterState register_state_;
 };
 
+template <typename ClientTy>
+std::shared_ptr<ClientTy> ServiceClient<ClientTy>::PickClient() {
+  base::AutoLock l(lock_);
+  std::vector<rpc::LoadBalancer::Candidate> candidates;
+  candidates.reserve(providers_.size());
+  bool has_unavailable = false;
+  for (auto& provider : providers_) {
+    bool available = provider->connected && provider->client->IsAvailable();
+    if (provider->connected && !available) has_unavailable = true;
+    candidates.push_back({available, provider->client->outstanding_calls()});
+  }
+
+  if (has_unavailable && !remove_unavailable_providers_scheduled_) {
+    remove_unavailable_providers_scheduled_ = true;
+    MainThread::GetInstance().PostTask(
+        FROM_HERE,
+        base::BindOnce(&ServiceClient<ClientTy>::RemoveUnavailableProviders,
+                       base::Unretained(this)));
+  }
+
+  int index = load_balancer_.Pick(candidates);
+  if (index < 0) return nullptr;
+  return providers_[index]->client;
+}
+
+template <typename ClientTy>
+std::shared_ptr<ClientTy> ServiceClient<ClientTy>::operator->() {
+  std::shared_ptr<ClientTy> client = PickClient();
+  CHECK(client) << "No server is available, use PickClient() to check it.";
+  return client;
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::set_load_balancing_policy(
+    rpc::LoadBalancingPolicy policy) {
+  base::AutoLock l(lock_);
+  load_balancer_.set_policy(policy);
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::set_max_providers(size_t max_providers) {
+  DCHECK_GT(max_providers, 0u);
+  base::AutoLock l(lock_);
+  max_providers_ = max_providers;
+}
+
 template <typename ClientTy>
 void ServiceClient<ClientTy>::RequestRegister(
     const NodeInfo& node_info, const std::string& service,
@@ -242,7 +361,7 @@ void ServiceClient<ClientTy>::OnUnregisterServiceClientAsync(
   register_state_.ToUnregistered(FROM_HERE);
   internal::LogOrCallback(std::move(callback), std::move(s));
 
-  client_.Shutdown();
+  ShutdownAllProviders();
 }
 
 template <typename ClientTy>
@@ -261,25 +380,147 @@ void ServiceClient<ClientTy>::OnFindServiceServer(
 
   DCHECK(IsRegistered()) << register_state_.ToString();
 
-  if (service_info.status() == ServiceInfo::UNREGISTERED) {
-    client_.Shutdown();
-    on_connect_callback_.Run(ServiceInfo::UNREGISTERED);
+  // A server notified again, e.g, after it is restarted, is connected anew
+  // unless it is still available.
+  std::vector<std::unique_ptr<Provider>> removed_providers;
+  Provider* new_provider = nullptr;
+  {
+    base::AutoLock l(lock_);
+    for (auto it = providers_.begin(); it != providers_.end(); ++it) {
+      if (!IsSameChannelSource((*it)->service_info.service_source(),
+                               service_info.service_source())) {
+        continue;
+      }
+      if (service_info.status() == ServiceInfo::REGISTERED &&
+          (*it)->client->IsAvailable()) {
+        return;
+      }
+      removed_providers.push_back(std::move(*it));
+      providers_.erase(it);
+      break;
+    }
+
+    if (service_info.status() == ServiceInfo::REGISTERED &&
+        providers_.size() < max_providers_) {
+      auto provider = std::make_unique<Provider>();
+      provider->id = next_provider_id_++;
+      provider->service_info = service_info;
+      provider->client = std::shared_ptr<ClientTy>(
+          NewClient().release(), &ServiceClient<ClientTy>::ShutdownClient);
+      provider->client->set_service_info(service_info);
+      new_provider = provider.get();
+      providers_.push_back(std::move(provider));
+    }
+  }
+  ShutdownProviders(std::move(removed_providers));
+
+  if (new_provider) {
+    const IPEndPoint& ip_endpoint =
+        service_info.service_source().channel_defs(0).ip_endpoint();
+    new_provider->client->Connect(
+        ip_endpoint, base::BindOnce(&ServiceClient<ClientTy>::OnConnect,
+                                    base::Unretained(this), new_provider->id));
+  }
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::OnConnect(uint32_t id, Status s) {
+  bool first_connected = false;
+  std::vector<std::unique_ptr<Provider>> removed_providers;
+  {
+    base::AutoLock l(lock_);
+    auto it = std::find_if(providers_.begin(), providers_.end(),
+                           [id](const std::unique_ptr<Provider>& provider) {
+                             return provider->id == id;
+                           });
+    if (it == providers_.end()) return;
+
+    if (s.ok()) s = (*it)->client->Run();
+    if (s.ok()) {
+      first_connected = !HasConnectedProviderLocked();
+      (*it)->connected = true;
+    } else {
+      LOG(ERROR) << s;
+      removed_providers.push_back(std::move(*it));
+      providers_.erase(it);
+    }
+  }
+  ShutdownProviders(std::move(removed_providers));
+
+  if (first_connected) on_connect_callback_.Run(ServiceInfo::REGISTERED);
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::RemoveUnavailableProviders() {
+  std::vector<std::unique_ptr<Provider>> removed_providers;
+  {
+    base::AutoLock l(lock_);
+    remove_unavailable_providers_scheduled_ = false;
+    for (auto it = providers_.begin(); it != providers_.end();) {
+      if ((*it)->connected && !(*it)->client->IsAvailable()) {
+        removed_providers.push_back(std::move(*it));
+        it = providers_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  ShutdownProviders(std::move(removed_providers));
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::ShutdownClient(ClientTy* client) {
+  MainThread& main_thread = MainThread::GetInstance();
+  if (!main_thread.IsBoundToCurrentThread() &&
+      main_thread.PostTask(
+          FROM_HERE, base::BindOnce(&ServiceClient<ClientTy>::ShutdownClient,
+                                    base::Unretained(client)))) {
     return;
   }
 
-  const IPEndPoint& ip_endpoint =
-      service_info.service_source().channel_defs(0).ip_endpoint();
-  client_.set_service_info(service_info);
-  client_.Connect(ip_endpoint,
-                  base::BindOnce(&ServiceClient<ClientTy>::OnConnect,
-                                 base::Unretained(this)));
+  client->Shutdown();
+  delete client;
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::ShutdownProviders(
+    std::vector<std::unique_ptr<Provider>> providers) {
+  if (providers.empty()) return;
+
+  bool was_connected = false;
+  for (auto& provider : providers) {
+    if (provider->connected) was_connected = true;
+  }
+  // The clients are shut down unless they are still in use.
+  providers.clear();
+
+  bool has_connected;
+  {
+    base::AutoLock l(lock_);
+    has_connected = HasConnectedProviderLocked();
+  }
+  if (was_connected && !has_connected && IsRegistered()) {
+    on_connect_callback_.Run(ServiceInfo::UNREGISTERED);
+  }
+}
+
+template <typename ClientTy>
+void ServiceClient<ClientTy>::ShutdownAllProviders() {
+  std::vector<std::unique_ptr<Provider>> providers;
+  {
+    base::AutoLock l(lock_);
+    providers.swap(providers_);
+  }
+  // The clients are shut down as |providers| goes out of scope, unless they
+  // are still in use.
 }
 
 template <typename ClientTy>
-void ServiceClient<ClientTy>::OnConnect(Status s) {
-  if (s.ok()) {
-    if (client_.Run().ok()) on_connect_callback_.Run(ServiceInfo::REGISTERED);
+bool ServiceClient<ClientTy>::HasConnectedProviderLocked() const {
+  for (auto& provider : providers_) {
+    if (provider->connected) return true;
   }
+  return false;
 }
 
 }  // namespace felicia
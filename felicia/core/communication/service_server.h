@@ -76,6 +76,10 @@ class ServiceServer {
     return register_state_.IsUnregistered();
   }
 
+  // e.g, server->set_rpc_thread_num(4) before RequestRegister() to handle up
+  // to 4 requests concurrently.
+  ServerTy* operator->() { return &server_; }
+
   void RequestRegister(const NodeInfo& node_info, const std::string& service,
                        StatusOnceCallback callback = StatusOnceCallback());
 
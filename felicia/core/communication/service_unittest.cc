@@ -4,6 +4,8 @@
 
 #include "gtest/gtest.h"
 #include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
 #include "third_party/chromium/base/threading/platform_thread.h"
 
 #include "felicia/core/communication/service_client.h"
@@ -28,12 +30,113 @@ class ServiceChecker : public AsyncChecker {
   AddResponse expected_;
 };
 
+class StreamChecker : public AsyncChecker {
+ public:
+  void set_expected_values(const std::vector<int>& expected_values) {
+    expected_values_ = expected_values;
+  }
+
+  void AddValue(int value) { values_.push_back(value); }
+
+  void CheckValues() {
+    EXPECT_EQ(expected_values_, values_);
+    CountDownTest();
+  }
+
+ private:
+  std::vector<int> expected_values_;
+  std::vector<int> values_;
+};
+
+// Holds the calls of Add in the handler until |count| of them are held at
+// once, or |timeout| passes.
+class AddHold {
+ public:
+  AddHold(int count, base::TimeDelta timeout)
+      : count_(count), timeout_(timeout) {}
+
+  void Wait() {
+    {
+      base::AutoLock l(lock_);
+      if (++held_ == count_) event_.Signal();
+    }
+    if (!event_.TimedWait(timeout_)) {
+      base::AutoLock l(lock_);
+      timed_out_++;
+    }
+  }
+
+  int timed_out() {
+    base::AutoLock l(lock_);
+    return timed_out_;
+  }
+
+ private:
+  const int count_;
+  const base::TimeDelta timeout_;
+  base::WaitableEvent event_{base::WaitableEvent::ResetPolicy::MANUAL,
+                             base::WaitableEvent::InitialState::NOT_SIGNALED};
+  base::Lock lock_;
+  int held_ = 0;
+  int timed_out_ = 0;
+};
+
+AddHold* g_add_hold = nullptr;
+
 class GrpcSimpleClient : public rpc::Client<grpc::SimpleService> {
  public:
   FEL_GRPC_CLIENT_METHOD_DECLARE(Add);
+  FEL_GRPC_CLIENT_SERVER_STREAMING_METHOD_DECLARE(Count);
+  FEL_GRPC_CLIENT_BIDI_STREAMING_METHOD_DECLARE(Accumulate);
 };
 
 FEL_GRPC_CLIENT_METHOD_DEFINE(GrpcSimpleClient, Add)
+FEL_GRPC_CLIENT_SERVER_STREAMING_METHOD_DEFINE(GrpcSimpleClient, Count)
+FEL_GRPC_CLIENT_BIDI_STREAMING_METHOD_DEFINE(GrpcSimpleClient, Accumulate)
+
+// Writes the counts from |count| to |n| one by one.
+void WriteCount(ServerStreamWriter<CountResponse>* writer, int count, int n,
+                Status s) {
+  if (!s.ok() || count > n) {
+    writer->Finish(s);
+    return;
+  }
+  CountResponse response;
+  response.set_count(count);
+  writer->Write(response, base::BindOnce(&WriteCount, writer, count + 1, n));
+}
+
+struct Accumulator {
+  ServerStream<AccumulateRequest, AccumulateResponse>* stream;
+  AccumulateRequest request;
+  int sum = 0;
+};
+
+void OnReadValue(Accumulator* accumulator, Status s);
+
+void ReadValue(Accumulator* accumulator, Status s) {
+  if (!s.ok()) {
+    accumulator->stream->Finish(s);
+    delete accumulator;
+    return;
+  }
+  accumulator->stream->Read(&accumulator->request,
+                            base::BindOnce(&OnReadValue, accumulator));
+}
+
+void OnReadValue(Accumulator* accumulator, Status s) {
+  if (!s.ok()) {
+    // The client has finished writing.
+    accumulator->stream->Finish(errors::IsOutOfRange(s) ? Status::OK() : s);
+    delete accumulator;
+    return;
+  }
+  accumulator->sum += accumulator->request.value();
+  AccumulateResponse response;
+  response.set_sum(accumulator->sum);
+  accumulator->stream->Write(response,
+                             base::BindOnce(&ReadValue, accumulator));
+}
 
 class GrpcSimpleService : public rpc::Service<grpc::SimpleService> {
  public:
@@ -43,19 +146,30 @@ class GrpcSimpleService : public rpc::Service<grpc::SimpleService> {
   void EnqueueRequests() override;
 
   FEL_GRPC_SERVICE_METHOD_DECLARE(GrpcSimpleService, Add);
+  FEL_GRPC_SERVER_STREAMING_METHOD_DECLARE(GrpcSimpleService, Count);
+  FEL_GRPC_BIDI_STREAMING_METHOD_DECLARE(GrpcSimpleService, Accumulate);
 
   void Add(const AddRequest* request, AddResponse* response,
            StatusOnceCallback callback);
+  void Count(const CountRequest* request,
+             ServerStreamWriter<CountResponse>* writer);
+  void Accumulate(ServerStream<AccumulateRequest, AccumulateResponse>* stream);
 };
 
 void GrpcSimpleService::EnqueueRequests() {
   FEL_ENQUEUE_REQUEST(GrpcSimpleService, Add, false);
+  FEL_ENQUEUE_SERVER_STREAMING_REQUEST(GrpcSimpleService, Count);
+  FEL_ENQUEUE_BIDI_STREAMING_REQUEST(GrpcSimpleService, Accumulate);
 }
 
 FEL_GRPC_SERVICE_METHOD_DEFINE(GrpcSimpleService, this, Add, false)
+FEL_GRPC_SERVER_STREAMING_METHOD_DEFINE(GrpcSimpleService, this, Count)
+FEL_GRPC_BIDI_STREAMING_METHOD_DEFINE(GrpcSimpleService, this, Accumulate)
 
 void GrpcSimpleService::Add(const AddRequest* request, AddResponse* response,
                             StatusOnceCallback callback) {
+  if (g_add_hold) g_add_hold->Wait();
+
   int a = request->a();
   int b = request->b();
 
@@ -63,6 +177,16 @@ void GrpcSimpleService::Add(const AddRequest* request, AddResponse* response,
   std::move(callback).Run(Status::OK());
 }
 
+void GrpcSimpleService::Count(const CountRequest* request,
+                              ServerStreamWriter<CountResponse>* writer) {
+  WriteCount(writer, 1, request->n(), Status::OK());
+}
+
+void GrpcSimpleService::Accumulate(
+    ServerStream<AccumulateRequest, AccumulateResponse>* stream) {
+  ReadValue(new Accumulator{stream}, Status::OK());
+}
+
 }  // namespace
 
 class ServiceTest : public testing::Test {
@@ -80,8 +204,13 @@ class ServiceTest : public testing::Test {
   }
 
   void Call(const AddRequest* request, AddResponse* response,
-            StatusOnceCallback callback) {
-    client_->AddAsync(request, response, std::move(callback));
+            StatusOnceCallback callback, CallOptions* call_opts = nullptr) {
+    std::shared_ptr<GrpcSimpleClient> client = client_.PickClient();
+    if (!client) {
+      std::move(callback).Run(errors::Unavailable("No server is connected."));
+      return;
+    }
+    client->AddAsync(request, response, std::move(callback), call_opts);
   }
 
   void Release() {
@@ -89,6 +218,60 @@ class ServiceTest : public testing::Test {
     client_.RequestUnregisterForTesting(service_);
   }
 
+  void RequestRegisterServers() {
+    server_.RequestRegisterForTesting(service_);
+    server2_.RequestRegisterForTesting(service_);
+  }
+
+  void NotifyClientOfServers() {
+    client_.OnFindServiceServer(server_.server_.service_info());
+    client_.OnFindServiceServer(server2_.server_.service_info());
+  }
+
+  std::shared_ptr<GrpcSimpleClient> PickClient() {
+    return client_.PickClient();
+  }
+
+  void CallCount(
+      const CountRequest* request,
+      base::RepeatingCallback<void(const CountResponse&)> on_response,
+      StatusOnceCallback done) {
+    std::shared_ptr<GrpcSimpleClient> client = client_.PickClient();
+    if (!client) {
+      std::move(done).Run(errors::Unavailable("No server is connected."));
+      return;
+    }
+    client->CountAsync(request, std::move(on_response), std::move(done));
+  }
+
+  scoped_refptr<ClientStreamWriter<AccumulateRequest>> CallAccumulate(
+      base::RepeatingCallback<void(const AccumulateResponse&)> on_response,
+      StatusOnceCallback done) {
+    std::shared_ptr<GrpcSimpleClient> client = client_.PickClient();
+    if (!client) {
+      std::move(done).Run(errors::Unavailable("No server is connected."));
+      return nullptr;
+    }
+    return client->AccumulateAsync(std::move(on_response), std::move(done));
+  }
+
+  void ReleaseServers() {
+    Release();
+    server2_.RequestUnregisterForTesting(service_);
+  }
+
+  void ReleaseServer() { server_.RequestUnregisterForTesting(service_); }
+
+  void ReleaseClient() { client_.RequestUnregisterForTesting(service_); }
+
+  void set_rpc_thread_num(int rpc_thread_num) {
+    server_->set_rpc_thread_num(rpc_thread_num);
+  }
+
+  void set_max_providers(size_t max_providers) {
+    client_.set_max_providers(max_providers);
+  }
+
  protected:
   void SetUp() override {
     MainThread::SetBackground();
@@ -97,6 +280,7 @@ class ServiceTest : public testing::Test {
 
   std::string service_;
   ServiceServer<GrpcSimpleService> server_;
+  ServiceServer<GrpcSimpleService> server2_;
   ServiceClient<GrpcSimpleClient> client_;
 };
 
@@ -148,4 +332,428 @@ TEST_F(ServiceTest, RequestAndResponseService) {
   RequestAndResponseService(this);
 }
 
+void OnRequestAddCancelled(ServiceChecker* checker, Status s) {
+  EXPECT_EQ(error::CANCELLED, s.error_code());
+  checker->CountDownTest();
+}
+
+void OnConnectAndCancel(ServiceTest* test, const AddRequest* request,
+                        AddResponse* response, CallOptions* call_opts,
+                        ServiceChecker* checker, ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  call_opts->StartCancel();
+  test->Call(request, response,
+             base::BindOnce(&OnRequestAddCancelled, checker), call_opts);
+}
+
+void SetupClientAndServerToCancel(ServiceTest* test, const AddRequest* request,
+                                  AddResponse* response, CallOptions* call_opts,
+                                  ServiceChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(base::BindRepeating(
+      &OnConnectAndCancel, test, request, response, call_opts, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, CancelRequest) {
+  ServiceChecker checker;
+  AddRequest request;
+  AddResponse response;
+  CallOptions call_opts;
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToCancel, this, &request,
+                                &response, &call_opts, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+void OnRequestAddAgain(AddResponse* response, ServiceChecker* checker,
+                       Status s) {
+  EXPECT_TRUE(s.ok()) << s;
+  checker->CheckResponse(*response);
+}
+
+void OnRequestAddCancelledAndCallAgain(ServiceTest* test,
+                                       const AddRequest* request,
+                                       AddResponse* response,
+                                       CallOptions* call_opts,
+                                       ServiceChecker* checker, Status s) {
+  EXPECT_EQ(error::CANCELLED, s.error_code());
+  // The cancel of the finished call doesn't carry over to the next one.
+  test->Call(request, response,
+             base::BindOnce(&OnRequestAddAgain, response, checker), call_opts);
+}
+
+void OnConnectAndCancelOnce(ServiceTest* test, const AddRequest* request,
+                            AddResponse* response, CallOptions* call_opts,
+                            ServiceChecker* checker, ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  call_opts->StartCancel();
+  test->Call(request, response,
+             base::BindOnce(&OnRequestAddCancelledAndCallAgain, test, request,
+                            response, call_opts, checker),
+             call_opts);
+}
+
+void SetupClientAndServerToCancelOnce(ServiceTest* test,
+                                      const AddRequest* request,
+                                      AddResponse* response,
+                                      CallOptions* call_opts,
+                                      ServiceChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(base::BindRepeating(
+      &OnConnectAndCancelOnce, test, request, response, call_opts, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, ReuseCallOptions) {
+  ServiceChecker checker;
+  AddRequest request;
+  request.set_a(1);
+  request.set_b(2);
+  AddResponse response;
+  AddResponse expected;
+  expected.set_sum(3);
+  checker.set_expected(expected);
+  CallOptions call_opts;
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToCancelOnce, this,
+                                &request, &response, &call_opts, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+void OnRequestAddExpired(ServiceChecker* checker, Status s) {
+  EXPECT_EQ(error::DEADLINE_EXCEEDED, s.error_code());
+  checker->CountDownTest();
+}
+
+void OnConnectAndExpire(ServiceTest* test, const AddRequest* request,
+                        AddResponse* response, CallOptions* call_opts,
+                        ServiceChecker* checker, ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  test->Call(request, response, base::BindOnce(&OnRequestAddExpired, checker),
+             call_opts);
+}
+
+void SetupClientAndServerToExpire(ServiceTest* test, const AddRequest* request,
+                                  AddResponse* response,
+                                  CallOptions* call_opts,
+                                  ServiceChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(base::BindRepeating(
+      &OnConnectAndExpire, test, request, response, call_opts, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, DeadlineExceeded) {
+  // The server holds the call longer than the deadline.
+  AddHold add_hold(2, base::TimeDelta::FromMilliseconds(200));
+  g_add_hold = &add_hold;
+
+  ServiceChecker checker;
+  AddRequest request;
+  AddResponse response;
+  CallOptions call_opts;
+  call_opts.set_timeout(base::TimeDelta::FromMilliseconds(50));
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToExpire, this, &request,
+                                &response, &call_opts, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+  g_add_hold = nullptr;
+}
+
+void OnConnectToServers(ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+}
+
+void CallServers(ServiceTest* test, const AddRequest* request,
+                 AddResponse* responses, ServiceChecker* checker) {
+  // The calls go to the servers in turn.
+  std::shared_ptr<GrpcSimpleClient> client = test->PickClient();
+  ASSERT_NE(nullptr, client);
+  EXPECT_NE(client, test->PickClient());
+
+  for (int i = 0; i < 2; ++i) {
+    test->Call(request, &responses[i],
+               base::BindOnce(&OnRequestAdd, &responses[i], checker));
+  }
+}
+
+void SetupClientAndServers(ServiceTest* test, const AddRequest* request,
+                           AddResponse* responses, ServiceChecker* checker) {
+  test->RequestRegisterServers();
+  test->RequestRegisterClient(base::BindRepeating(&OnConnectToServers));
+  test->NotifyClientOfServers();
+  CallServers(test, request, responses, checker);
+}
+
+TEST_F(ServiceTest, BalanceCallsAmongServers) {
+  ServiceChecker checker;
+  AddRequest request;
+  request.set_a(1);
+  request.set_b(2);
+  AddResponse responses[2];
+  AddResponse expected;
+  expected.set_sum(3);
+  checker.set_expected(expected);
+  checker.set_test_num(2);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::ReleaseServers, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(FROM_HERE,
+                       base::BindOnce(&SetupClientAndServers, this, &request,
+                                      responses, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+void OnConnectAndCallConcurrently(ServiceTest* test, int calls,
+                                  const AddRequest* request,
+                                  AddResponse* responses,
+                                  ServiceChecker* checker,
+                                  ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  for (int i = 0; i < calls; ++i) {
+    test->Call(request, &responses[i],
+               base::BindOnce(&OnRequestAdd, &responses[i], checker));
+  }
+}
+
+void SetupClientAndServerToCallConcurrently(ServiceTest* test, int calls,
+                                            const AddRequest* request,
+                                            AddResponse* responses,
+                                            ServiceChecker* checker) {
+  test->set_rpc_thread_num(calls);
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(
+      base::BindRepeating(&OnConnectAndCallConcurrently, test, calls, request,
+                          responses, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, HandleCallsConcurrently) {
+  // Each call is held until all of them are in the handler, which happens
+  // only if the rpc threads handle them at once.
+  constexpr int kCalls = 4;
+  AddHold add_hold(kCalls, base::TimeDelta::FromMilliseconds(100));
+  g_add_hold = &add_hold;
+
+  ServiceChecker checker;
+  AddRequest request;
+  request.set_a(1);
+  request.set_b(2);
+  AddResponse responses[kCalls];
+  AddResponse expected;
+  expected.set_sum(3);
+  checker.set_expected(expected);
+  checker.set_test_num(kCalls);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToCallConcurrently, this,
+                                kCalls, &request, responses, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+  EXPECT_EQ(0, add_hold.timed_out());
+  g_add_hold = nullptr;
+}
+
+void ConnectToOneOfServers(ServiceTest* test, base::WaitableEvent* event) {
+  test->RequestRegisterServers();
+  test->RequestRegisterClient(base::BindRepeating(&OnConnectToServers));
+  test->set_max_providers(1);
+  test->NotifyClientOfServers();
+
+  // Only the first server is connected, so the calls go to it only.
+  std::shared_ptr<GrpcSimpleClient> client = test->PickClient();
+  EXPECT_NE(nullptr, client);
+  EXPECT_EQ(client, test->PickClient());
+  test->ReleaseServers();
+  event->Signal();
+}
+
+TEST_F(ServiceTest, MaxProviders) {
+  base::WaitableEvent event;
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(FROM_HERE,
+                       base::BindOnce(&ConnectToOneOfServers, this, &event));
+  event.Wait();
+}
+
+void OnConnectAndUnregister(ServiceTest* test, const AddRequest* request,
+                            AddResponse* response, ServiceChecker* checker,
+                            ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  std::shared_ptr<GrpcSimpleClient> client = test->PickClient();
+  ASSERT_NE(nullptr, client);
+
+  // The picked client is kept, and isn't shut down, until it is released.
+  test->ReleaseClient();
+  EXPECT_EQ(nullptr, test->PickClient());
+  client->AddAsync(request, response,
+                   base::BindOnce(&OnRequestAdd, response, checker));
+}
+
+void SetupClientAndServerToUnregister(ServiceTest* test,
+                                      const AddRequest* request,
+                                      AddResponse* response,
+                                      ServiceChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(base::BindRepeating(
+      &OnConnectAndUnregister, test, request, response, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, KeepPickedClient) {
+  ServiceChecker checker;
+  AddRequest request;
+  request.set_a(1);
+  request.set_b(2);
+  AddResponse response;
+  AddResponse expected;
+  expected.set_sum(3);
+  checker.set_expected(expected);
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::ReleaseServer, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToUnregister, this,
+                                &request, &response, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+void OnCountResponse(StreamChecker* checker, const CountResponse& response) {
+  checker->AddValue(response.count());
+}
+
+void OnStreamDone(StreamChecker* checker, Status s) {
+  EXPECT_TRUE(s.ok());
+  checker->CheckValues();
+}
+
+void OnConnectAndCount(ServiceTest* test, const CountRequest* request,
+                       StreamChecker* checker, ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  test->CallCount(request, base::BindRepeating(&OnCountResponse, checker),
+                  base::BindOnce(&OnStreamDone, checker));
+}
+
+void SetupClientAndServerToCount(ServiceTest* test, const CountRequest* request,
+                                 StreamChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(
+      base::BindRepeating(&OnConnectAndCount, test, request, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, StreamResponses) {
+  StreamChecker checker;
+  CountRequest request;
+  request.set_n(3);
+  checker.set_expected_values({1, 2, 3});
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(FROM_HERE, base::BindOnce(&SetupClientAndServerToCount,
+                                                 this, &request, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+void OnAccumulateResponse(StreamChecker* checker,
+                          const AccumulateResponse& response) {
+  checker->AddValue(response.sum());
+}
+
+// Writes |values| from |index| one by one, and then finishes writing.
+void WriteValues(scoped_refptr<ClientStreamWriter<AccumulateRequest>> writer,
+                 const std::vector<int>* values, size_t index, Status s) {
+  EXPECT_TRUE(s.ok());
+  if (index == values->size()) {
+    writer->WritesDone();
+    return;
+  }
+  AccumulateRequest request;
+  request.set_value((*values)[index]);
+  writer->Write(request,
+                base::BindOnce(&WriteValues, writer, values, index + 1));
+}
+
+void OnConnectAndAccumulate(ServiceTest* test, const std::vector<int>* values,
+                            StreamChecker* checker, ServiceInfo::Status s) {
+  EXPECT_TRUE(s == ServiceInfo::REGISTERED);
+  scoped_refptr<ClientStreamWriter<AccumulateRequest>> writer =
+      test->CallAccumulate(base::BindRepeating(&OnAccumulateResponse, checker),
+                           base::BindOnce(&OnStreamDone, checker));
+  WriteValues(writer, values, 0, Status::OK());
+}
+
+void SetupClientAndServerToAccumulate(ServiceTest* test,
+                                      const std::vector<int>* values,
+                                      StreamChecker* checker) {
+  test->RequestRegisterServer();
+  test->RequestRegisterClient(
+      base::BindRepeating(&OnConnectAndAccumulate, test, values, checker));
+  test->NotifyClient();
+}
+
+TEST_F(ServiceTest, StreamRequestsAndResponses) {
+  StreamChecker checker;
+  std::vector<int> values = {1, 2, 3};
+  checker.set_expected_values({1, 3, 6});
+  checker.set_test_num(1);
+  checker.set_on_test_done(
+      base::BindOnce(&ServiceTest::Release, base::Unretained(this)));
+  MainThread& main_thread = MainThread::GetInstance();
+  main_thread.PostTask(
+      FROM_HERE, base::BindOnce(&SetupClientAndServerToAccumulate, this,
+                                &values, &checker));
+
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(500));
+  checker.ExpectTestCompleted();
+}
+
+namespace {
+
+void OnCallWithoutServer(Status* status, Status s) { *status = s; }
+
+}  // namespace
+
+TEST_F(ServiceTest, CallWithoutServer) {
+  // No server is connected, so the call fails instead of going to a null
+  // client.
+  EXPECT_EQ(nullptr, PickClient());
+
+  AddRequest request;
+  AddResponse response;
+  Status status;
+  Call(&request, &response, base::BindOnce(&OnCallWithoutServer, &status));
+  EXPECT_TRUE(errors::IsUnavailable(status));
+}
+
 }  // namespace felicia
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "third_party/chromium/base/time/time.h"
 
+#include "felicia/core/channel/channel.h"
 #include "felicia/core/channel/settings.h"
 #include "felicia/core/lib/unit/bytes.h"
 
@@ -23,6 +24,17 @@ struct Settings {
   base::TimeDelta period = base::TimeDelta::FromMilliseconds(kDefaultPeriod);
   Bytes buffer_size = Bytes::FromBytes(kDefaultMessageSize);
   bool is_dynamic_buffer = false;
+  // If true, a message larger than |buffer_size| is sent and received in
+  // chunks of |buffer_size| on stream channels, which are TCP and UDS,
+  // instead of failing with ERR_NOT_ENOUGH_BUFFER. Unlike |is_dynamic_buffer|,
+  // the channel buffer never grows. This is ignored if |is_dynamic_buffer| is
+  // true.
+  bool is_chunked_transfer = false;
+  // With |is_chunked_transfer|, a message whose header says it is larger than
+  // this is rejected, and the subscriber stops receiving from the publisher,
+  // since the rest of the stream can't be trusted.
+  Bytes max_chunked_message_size =
+      Bytes::FromBytes(Channel::kDefaultMaxChunkedMessageSize);
   uint8_t queue_size = kDefaultQueueSize;
   channel::Settings channel_settings;
 };
@@ -364,6 +364,18 @@ void Subscriber<MessageTy>::OnFindPublisher(const TopicInfo& topic_info) {
   // using |type_name| inside |topic_info|.
   if (!MaybeResolveMessgaeType(topic_info)) return;
 
+  // POD message is copied as it is in memory, so the layout of publisher's
+  // should be the same as the one of subscriber's.
+  if (PodMessageTraits<MessageTy>::value &&
+      topic_info.type_hash() != PodMessageTraits<MessageTy>::kTypeHash) {
+    internal::LogOrCallback(
+        on_error_callback_,
+        errors::InvalidArgument(base::StringPrintf(
+            "Type hash of %s is mismatched with publisher's.",
+            MessageIO<MessageTy>::TypeName().c_str())));
+    return;
+  }
+
   // Subscriber holds this in case of data corruption. If it happens, subscriber
   // connects to publisher again using |topic_info_|.
   topic_info_ = topic_info;
@@ -412,6 +424,8 @@ void Subscriber<MessageTy>::OnConnectToPublisher(Status s) {
       channel_->SetDynamicReceiveBuffer(true);
     } else {
       channel_->SetReceiveBufferSize(settings_.buffer_size);
+      channel_->SetChunkedTransfer(settings_.is_chunked_transfer);
+      channel_->SetMaxChunkedMessageSize(settings_.max_chunked_message_size);
     }
     message_receiver_.set_channel(channel_.get());
 
@@ -521,6 +535,12 @@ void Subscriber<MessageTy>::OnReceiveMessage(Status s) {
       StopMessageLoop();
       return;
     }
+    // The rejected message is still on the stream, so the next header can't
+    // be found.
+    if (errors::IsResourceExhausted(s)) {
+      StopMessageLoop();
+      return;
+    }
     receive_message_failed_cnt_++;
     if (receive_message_failed_cnt_ >= kMaximumReceiveMessageFailedAllowed) {
       StopMessageLoop();
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/lib/containers/data_pool.h"
+
+namespace felicia {
+
+namespace {
+
+size_t RoundUpToPowerOf2(size_t size) {
+  size_t power = 1;
+  while (power < size) power <<= 1;
+  return power;
+}
+
+size_t RoundDownToPowerOf2(size_t size) {
+  size_t power = 1;
+  while (power <= size / 2) power <<= 1;
+  return power;
+}
+
+}  // namespace
+
+double DataPool::Stats::HitRate() const {
+  size_t total = hits + misses;
+  if (total == 0) return 0;
+  return static_cast<double>(hits) / total;
+}
+
+DataPool::DataPool(size_t max_buffers_per_size, SizeClass size_class)
+    : max_buffers_per_size_(max_buffers_per_size), size_class_(size_class) {}
+
+DataPool::~DataPool() = default;
+
+Data DataPool::Acquire(size_t size) {
+  size_t key = size;
+  if (size_class_ == SIZE_CLASS_POWER_OF_2) key = RoundUpToPowerOf2(size);
+
+  std::string buffer;
+  {
+    base::AutoLock l(lock_);
+    auto it = buffers_.find(key);
+    if (it != buffers_.end() && !it->second.empty()) {
+      buffer = std::move(it->second.back());
+      it->second.pop_back();
+      stats_.hits++;
+    } else {
+      stats_.misses++;
+    }
+  }
+  if (buffer.empty()) buffer.reserve(key);
+  buffer.resize(size);
+  return Data{std::move(buffer)};
+}
+
+void DataPool::Recycle(Data data) {
+  std::string buffer = std::move(data).data();
+  if (buffer.empty()) return;
+  size_t key = buffer.size();
+  if (size_class_ == SIZE_CLASS_POWER_OF_2) {
+    key = RoundDownToPowerOf2(buffer.capacity());
+  }
+
+  base::AutoLock l(lock_);
+  std::vector<std::string>& buffers = buffers_[key];
+  if (buffers.size() < max_buffers_per_size_) {
+    buffers.push_back(std::move(buffer));
+  }
+}
+
+DataPool::Stats DataPool::stats() const {
+  base::AutoLock l(lock_);
+  return stats_;
+}
+
+}  // namespace felicia
@@ -0,0 +1,84 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_LIB_CONTAINERS_DATA_POOL_H_
+#define FELICIA_CORE_LIB_CONTAINERS_DATA_POOL_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/memory/ref_counted.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/containers/data.h"
+
+namespace felicia {
+
+// DataPool recycles the buffers of Data by their sizes, so that the data
+// produced continuously in the same size, e.g, the camera frames of a
+// format, doesn't allocate each time. For the data whose sizes vary from one
+// to the next, e.g, the compressed frames, the buffers can be recycled by
+// their capacities instead. It is thread-safe.
+//
+// scoped_refptr<DataPool> pool = base::MakeRefCounted<DataPool>();
+// Data data = pool->Acquire(camera_format.AllocationSize());
+// ...
+// pool->Recycle(std::move(data));
+class FEL_EXPORT DataPool : public base::RefCountedThreadSafe<DataPool> {
+ public:
+  struct Stats {
+    // The number of Acquire() calls which reused a buffer.
+    size_t hits = 0;
+    // The number of Acquire() calls which allocated a buffer.
+    size_t misses = 0;
+
+    double HitRate() const;
+  };
+
+  enum SizeClass {
+    // A buffer is reused only for the same size.
+    SIZE_CLASS_EXACT,
+    // The buffers are kept by their capacities rounded down to a power of 2,
+    // and a buffer is reused for any size up to it.
+    SIZE_CLASS_POWER_OF_2,
+  };
+
+  static constexpr size_t kDefaultMaxBuffersPerSize = 8;
+
+  explicit DataPool(size_t max_buffers_per_size = kDefaultMaxBuffersPerSize,
+                    SizeClass size_class = SIZE_CLASS_EXACT);
+
+  // Returns a Data of |size| bytes, whose contents are undefined. With
+  // SIZE_CLASS_POWER_OF_2, it can grow up to |size| rounded up to a power of
+  // 2 without reallocation.
+  Data Acquire(size_t size);
+
+  // Keeps the buffer of |data| for Acquire(), unless it is empty or there are
+  // already |max_buffers_per_size| buffers of its size class.
+  void Recycle(Data data);
+
+  Stats stats() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<DataPool>;
+  ~DataPool();
+
+  const size_t max_buffers_per_size_;
+  const SizeClass size_class_;
+
+  mutable base::Lock lock_;
+  std::unordered_map<size_t, std::vector<std::string>> buffers_
+      GUARDED_BY(lock_);
+  Stats stats_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(DataPool);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_LIB_CONTAINERS_DATA_POOL_H_
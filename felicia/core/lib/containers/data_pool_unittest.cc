@@ -0,0 +1,71 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/lib/containers/data_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+
+TEST(DataPoolTest, ReuseBuffer) {
+  scoped_refptr<DataPool> pool = base::MakeRefCounted<DataPool>();
+  Data data = pool->Acquire(16);
+  EXPECT_EQ(16u, data.size());
+  const char* buffer = data.cast<const char*>();
+  pool->Recycle(std::move(data));
+
+  Data data2 = pool->Acquire(8);
+  EXPECT_EQ(8u, data2.size());
+  EXPECT_NE(buffer, data2.cast<const char*>());
+
+  Data data3 = pool->Acquire(16);
+  EXPECT_EQ(16u, data3.size());
+  EXPECT_EQ(buffer, data3.cast<const char*>());
+
+  DataPool::Stats stats = pool->stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_DOUBLE_EQ(1.0 / 3, stats.HitRate());
+}
+
+TEST(DataPoolTest, LimitBuffersPerSize) {
+  scoped_refptr<DataPool> pool = base::MakeRefCounted<DataPool>(1);
+  Data data = pool->Acquire(16);
+  Data data2 = pool->Acquire(16);
+  pool->Recycle(std::move(data));
+  pool->Recycle(std::move(data2));
+  pool->Recycle(Data());
+
+  pool->Acquire(16);
+  pool->Acquire(16);
+  DataPool::Stats stats = pool->stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(3u, stats.misses);
+}
+
+TEST(DataPoolTest, ReuseBufferByCapacity) {
+  scoped_refptr<DataPool> pool = base::MakeRefCounted<DataPool>(
+      DataPool::kDefaultMaxBuffersPerSize, DataPool::SIZE_CLASS_POWER_OF_2);
+  Data data = pool->Acquire(1000);
+  EXPECT_EQ(1000u, data.size());
+  const char* buffer = data.cast<const char*>();
+  // It grows up to the power of 2 in place.
+  data.resize(1024);
+  EXPECT_EQ(buffer, data.cast<const char*>());
+  data.resize(10);
+  pool->Recycle(std::move(data));
+
+  Data data2 = pool->Acquire(2000);
+  EXPECT_NE(buffer, data2.cast<const char*>());
+
+  Data data3 = pool->Acquire(600);
+  EXPECT_EQ(600u, data3.size());
+  EXPECT_EQ(buffer, data3.cast<const char*>());
+
+  DataPool::Stats stats = pool->stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+}
+
+}  // namespace felicia
@@ -7,6 +7,9 @@
 #include "felicia/core/lib/image/jpeg_codec.h"
 
 #include <setjmp.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "jpeglib.h"
 
@@ -37,10 +40,22 @@ void ErrorExit(jpeg_common_struct* cinfo) {
 
 namespace {
 
+unsigned char* GetBuffer(std::vector<unsigned char>* destination) {
+  return destination->data();
+}
+
+unsigned char* GetBuffer(Data* destination) {
+  return destination->cast<unsigned char*>();
+}
+
+constexpr size_t kMinBufferSize = 1024;
+
+// The compressed data are written right into |destination|, which is grown
+// twice as large whenever it is full.
+template <typename T>
 struct JpegDestinationMgr : jpeg_destination_mgr {
-  static constexpr size_t kBufferSize = 1024;
-  std::vector<unsigned char>* destination;
-  unsigned char buffer[kBufferSize];
+  T* destination;
+  size_t size_hint;
 };
 
 // Callback to initialize to the destination.
@@ -49,10 +64,13 @@ struct JpegDestinationMgr : jpeg_destination_mgr {
 // "Initialize destination. This is called by jpeg_start_compress() before any
 //  data is actually written. It must initialize next_output_byte and
 //  free_in_buffer. free_in_buffer must be initialized to a positive value."
+template <typename T>
 void InitDestination(j_compress_ptr cinfo) {
-  JpegDestinationMgr* dest = static_cast<JpegDestinationMgr*>(cinfo->dest);
-  dest->next_output_byte = dest->buffer;
-  dest->free_in_buffer = JpegDestinationMgr::kBufferSize;
+  auto* dest = static_cast<JpegDestinationMgr<T>*>(cinfo->dest);
+  size_t size = std::max(dest->size_hint, kMinBufferSize);
+  dest->destination->resize(size);
+  dest->next_output_byte = GetBuffer(dest->destination);
+  dest->free_in_buffer = size;
 }
 
 // Callback to empty the buffer.
@@ -66,34 +84,29 @@ void InitDestination(j_compress_ptr cinfo) {
 //  dumped. free_in_buffer must be set to a positive value when TRUE is
 //  returned. A FALSE return should only be used when I/O suspension is desired
 //  (this operating mode is discussed in the next section)."
+template <typename T>
 boolean EmptyOutputBuffer(j_compress_ptr cinfo) {
-  JpegDestinationMgr* dest = static_cast<JpegDestinationMgr*>(cinfo->dest);
+  auto* dest = static_cast<JpegDestinationMgr<T>*>(cinfo->dest);
   size_t cur_size = dest->destination->size();
-  dest->destination->resize(cur_size + JpegDestinationMgr::kBufferSize);
-  memcpy(dest->destination->data() + cur_size, dest->buffer,
-         JpegDestinationMgr::kBufferSize);
+  dest->destination->resize(cur_size * 2);
 
-  dest->next_output_byte = dest->buffer;
-  dest->free_in_buffer = JpegDestinationMgr::kBufferSize;
+  dest->next_output_byte = GetBuffer(dest->destination) + cur_size;
+  dest->free_in_buffer = cur_size;
   return TRUE;
 }
 
-// Compression is finished, so we finally move the output buffer to the
-// destinatino buffer.
+// Compression is finished, so we finally cut the unused tail of the
+// destination buffer.
 //
 // From the JPEG library:
 // "Terminate destination --- called by jpeg_finish_compress() after all data
 //  has been written. In most applications, this must flush any data remaining
 //  in the buffer. Use either next_output_byte or free_in_buffer to determine
 //  how much data is in the buffer."
+template <typename T>
 void TermDestination(j_compress_ptr cinfo) {
-  JpegDestinationMgr* dest = static_cast<JpegDestinationMgr*>(cinfo->dest);
-  size_t size = JpegDestinationMgr::kBufferSize - dest->free_in_buffer;
-  if (size > 0) {
-    size_t cur_size = dest->destination->size();
-    dest->destination->resize(cur_size + size);
-    memcpy(dest->destination->data() + cur_size, dest->buffer, size);
-  }
+  auto* dest = static_cast<JpegDestinationMgr<T>*>(cinfo->dest);
+  dest->destination->resize(dest->destination->size() - dest->free_in_buffer);
 }
 
 // jpeg_compress_struct Deleter.
@@ -104,11 +117,11 @@ struct JpegCompressStructDeleter {
   }
 };
 
-}  // namespace
-
-// static
-Status JpegCodec::Encode(const Image& image, const Options& options,
-                         std::vector<unsigned char>* output) {
+// Encodes |rows| rows of |image| from |top|. If |stripe| is true, they are
+// encoded as a single restart interval with the standard Huffman tables.
+template <typename T>
+Status EncodeRows(const Image& image, int top, int rows,
+                  const JpegCodec::Options& options, bool stripe, T* output) {
   std::unique_ptr<jpeg_compress_struct, JpegCompressStructDeleter> cinfo(
       new jpeg_compress_struct);
   output->clear();
@@ -131,15 +144,16 @@ Status JpegCodec::Encode(const Image& image, const Options& options,
   jpeg_create_compress(cinfo.get());
 
   // set up the destination manager
-  JpegDestinationMgr dstmgr;
+  JpegDestinationMgr<T> dstmgr;
   dstmgr.destination = output;
-  dstmgr.init_destination = InitDestination;
-  dstmgr.empty_output_buffer = EmptyOutputBuffer;
-  dstmgr.term_destination = TermDestination;
+  dstmgr.size_hint = options.size_hint;
+  dstmgr.init_destination = InitDestination<T>;
+  dstmgr.empty_output_buffer = EmptyOutputBuffer<T>;
+  dstmgr.term_destination = TermDestination<T>;
   cinfo->dest = &dstmgr;
 
   cinfo->image_width = static_cast<JDIMENSION>(image.width());
-  cinfo->image_height = static_cast<JDIMENSION>(image.height());
+  cinfo->image_height = static_cast<JDIMENSION>(rows);
 
   switch (image.pixel_format()) {
     case PIXEL_FORMAT_BGRA:
@@ -179,14 +193,27 @@ Status JpegCodec::Encode(const Image& image, const Options& options,
   }
 
   jpeg_set_defaults(cinfo.get());
-  cinfo->optimize_coding = TRUE;
+  cinfo->optimize_coding = options.optimize_coding && !stripe ? TRUE : FALSE;
+  if (stripe) {
+    // libjpeg writes the DRI marker the joined image needs, and no RST
+    // marker, since the stripe ends before the interval does.
+    int max_v_samp_factor = 1;
+    for (int i = 0; i < cinfo->num_components; ++i) {
+      max_v_samp_factor =
+          std::max(max_v_samp_factor, cinfo->comp_info[i].v_samp_factor);
+    }
+    int mcu_height =
+        cinfo->num_components == 1 ? DCTSIZE : DCTSIZE * max_v_samp_factor;
+    cinfo->restart_in_rows = (rows + mcu_height - 1) / mcu_height;
+  }
 
   jpeg_set_quality(cinfo.get(), options.quality, TRUE);
   jpeg_start_compress(cinfo.get(), TRUE);
 
   int row_read_stride = cinfo->image_width * cinfo->input_components;
 
-  const unsigned char* rowptr = image.data().cast<const unsigned char*>();
+  const unsigned char* rowptr =
+      image.data().cast<const unsigned char*>() + top * row_read_stride;
   for (int row = 0; row < static_cast<int>(cinfo->image_height);
        row++, rowptr += row_read_stride) {
     if (!jpeg_write_scanlines(cinfo.get(), const_cast<unsigned char**>(&rowptr),
@@ -198,6 +225,157 @@ Status JpegCodec::Encode(const Image& image, const Options& options,
   return Status::OK();
 }
 
+// Where the segments of a baseline JPEG are, and what its frame header says.
+struct JpegLayout {
+  // The offsets of the SOF0 and the SOS markers.
+  size_t sof = 0;
+  size_t sos = 0;
+  // The offset of the entropy-coded data, which run until the EOI marker.
+  size_t scan = 0;
+  // The MCUs per restart interval of the DRI marker, or 0 if there is none.
+  int restart_interval = 0;
+  int width = 0;
+  int height = 0;
+  int mcu_width = 0;
+  int mcu_height = 0;
+};
+
+uint16_t ReadUint16(const uint8_t* data) { return (data[0] << 8) | data[1]; }
+
+void WriteUint16(uint16_t value, uint8_t* data) {
+  data[0] = value >> 8;
+  data[1] = value & 0xFF;
+}
+
+bool ParseJpegLayout(const Data& jpeg, JpegLayout* layout) {
+  const uint8_t* data = jpeg.cast<const uint8_t*>();
+  size_t size = jpeg.size();
+  if (size < 4 || data[0] != 0xFF || data[1] != 0xD8 ||
+      data[size - 2] != 0xFF || data[size - 1] != 0xD9) {
+    return false;
+  }
+
+  size_t pos = 2;
+  while (pos + 4 <= size && data[pos] == 0xFF) {
+    uint8_t marker = data[pos + 1];
+    size_t length = ReadUint16(data + pos + 2);
+    if (pos + 2 + length > size - 2) return false;
+
+    if (marker == 0xC0) {
+      // Lf(2), P(1), Y(2), X(2), Nf(1) and Nf * (C(1), HV(1), Tq(1))
+      if (length < 8) return false;
+      const uint8_t* sof = data + pos + 4;
+      int components = sof[5];
+      if (length < 8u + 3 * components) return false;
+      int max_h = 1;
+      int max_v = 1;
+      for (int i = 0; i < components; ++i) {
+        max_h = std::max(max_h, sof[7 + 3 * i] >> 4);
+        max_v = std::max(max_v, sof[7 + 3 * i] & 0xF);
+      }
+      layout->sof = pos;
+      layout->height = ReadUint16(sof + 1);
+      layout->width = ReadUint16(sof + 3);
+      // A scan of a single component isn't interleaved, whose MCU is a block.
+      layout->mcu_width = components == 1 ? DCTSIZE : DCTSIZE * max_h;
+      layout->mcu_height = components == 1 ? DCTSIZE : DCTSIZE * max_v;
+    } else if (marker == 0xDD) {
+      if (length != 4) return false;
+      layout->restart_interval = ReadUint16(data + pos + 4);
+    } else if (marker == 0xDA) {
+      layout->sos = pos;
+      layout->scan = pos + 2 + length;
+      return layout->sof != 0;
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+}  // namespace
+
+// static
+Status JpegCodec::Encode(const Image& image, const Options& options,
+                         std::vector<unsigned char>* output) {
+  return EncodeRows(image, 0, image.height(), options, false, output);
+}
+
+// static
+Status JpegCodec::Encode(const Image& image, const Options& options,
+                         Data* output) {
+  return EncodeRows(image, 0, image.height(), options, false, output);
+}
+
+// static
+Status JpegCodec::EncodeStripe(const Image& image, int top, int rows,
+                               const Options& options, Data* output) {
+  if (top < 0 || rows <= 0 || top + rows > image.height()) {
+    return errors::InvalidArgument("Invalid stripe.");
+  }
+  return EncodeRows(image, top, rows, options, true, output);
+}
+
+// static
+Status JpegCodec::AppendStripes(const std::vector<Data>& stripes,
+                                Data* image) {
+  JpegLayout first;
+  if (!ParseJpegLayout(*image, &first)) {
+    return errors::InvalidArgument("Invalid stripe.");
+  }
+  if (stripes.empty()) return Status::OK();
+
+  // Each stripe is a restart interval, so it should be whole rows of MCUs.
+  if (first.height % first.mcu_height != 0) {
+    return errors::InvalidArgument("Stripes aren't aligned to MCUs.");
+  }
+  int mcus_per_row = (first.width + first.mcu_width - 1) / first.mcu_width;
+  int restart_interval = first.height / first.mcu_height * mcus_per_row;
+  if (first.restart_interval != restart_interval) {
+    return errors::InvalidArgument("Stripes aren't restart intervals.");
+  }
+
+  std::vector<JpegLayout> layouts(stripes.size());
+  int height = first.height;
+  size_t size = image->size();
+  for (size_t i = 0; i < stripes.size(); ++i) {
+    if (!ParseJpegLayout(stripes[i], &layouts[i])) {
+      return errors::InvalidArgument("Invalid stripe.");
+    }
+    // The stripes should be as high as the first one but the last.
+    if (layouts[i].width != first.width ||
+        layouts[i].height > first.height ||
+        (i + 1 < stripes.size() && layouts[i].height != first.height)) {
+      return errors::InvalidArgument("Stripes don't match.");
+    }
+    height += layouts[i].height;
+    // RSTm(2) and the entropy-coded data
+    size += 2 + stripes[i].size() - 2 - layouts[i].scan;
+  }
+  if (height > 0xFFFF) {
+    return errors::InvalidArgument("Stripes are too large.");
+  }
+
+  // Only the entropy-coded data of |stripes| are copied, over the EOI of
+  // |image|.
+  size_t pos = image->size() - 2;
+  image->resize(size);
+  uint8_t* out = image->cast<uint8_t*>();
+  WriteUint16(height, out + first.sof + 5);
+  for (size_t i = 0; i < stripes.size(); ++i) {
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD0 + i % 8;
+    size_t length = stripes[i].size() - 2 - layouts[i].scan;
+    memcpy(out + pos, stripes[i].cast<const uint8_t*>() + layouts[i].scan,
+           length);
+    pos += length;
+  }
+  out[pos++] = 0xFF;
+  out[pos++] = 0xD9;
+  DCHECK_EQ(pos, size);
+
+  return Status::OK();
+}
+
 // Decoder --------------------------------------------------------------------
 
 namespace {
@@ -284,6 +462,17 @@ struct JpegDecompressStructDeleter {
 // static
 Status JpegCodec::Decode(const unsigned char* input, size_t input_size,
                          Image* image) {
+  return Decode(input, input_size, 1, image);
+}
+
+// static
+Status JpegCodec::Decode(const unsigned char* input, size_t input_size,
+                         int scale_denominator, Image* image) {
+  if (scale_denominator != 1 && scale_denominator != 2 &&
+      scale_denominator != 4 && scale_denominator != 8) {
+    return errors::InvalidArgument("Invalid scale denominator.");
+  }
+
   std::unique_ptr<jpeg_decompress_struct, JpegDecompressStructDeleter> cinfo(
       new jpeg_decompress_struct);
   image->data().clear();
@@ -376,6 +565,10 @@ Status JpegCodec::Decode(const unsigned char* input, size_t input_size,
       return errors::InvalidArgument("Invalid jpeg color space.");
   }
 
+  // The scaled inverse DCT skips the coefficients which don't make it to the
+  // output, e.g, 1/8 takes only the DC of each block.
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = scale_denominator;
   jpeg_calc_output_dimensions(cinfo.get());
   image->set_size(Sizei{static_cast<int>(cinfo->output_width),
                         static_cast<int>(cinfo->output_height)});
@@ -18,16 +18,50 @@ namespace felicia {
 
 class JpegCodec {
  public:
+  // The output of EncodeStripe() can be joined if the stripes are as high as
+  // a multiple of this, which is the MCU height of 4:2:0 JPEG.
+  static constexpr int kStripeAlignment = 16;
+
   struct Options {
     // quality should be between 0 and 100
     int quality = 100;
+    // If true, the Huffman tables are made for each image, which makes the
+    // output a few percent smaller at the cost of another pass.
+    bool optimize_coding = true;
+    // The output is allocated as large as this up front, e.g, the size of the
+    // previous frame, so that it isn't grown while encoding.
+    size_t size_hint = 0;
   };
 
   static Status Encode(const Image& image, const Options& options,
                        std::vector<unsigned char>* output);
+  // Unlike the above, the capacity of |output| is reused, so the frames can
+  // be encoded into the same Data without allocation once it is large enough.
+  static Status Encode(const Image& image, const Options& options,
+                       Data* output);
+
+  // Encodes |rows| rows of |image| from |top| as a JPEG of its own with the
+  // standard Huffman tables, ignoring |options.optimize_coding|, so that the
+  // stripes of an image can be encoded in parallel and joined by
+  // AppendStripes(). The stripe is a single restart interval.
+  static Status EncodeStripe(const Image& image, int top, int rows,
+                             const Options& options, Data* output);
+
+  // Appends |stripes|, which are encoded by EncodeStripe() with the same
+  // options in order, to |image|, the top stripe of an image, so that it
+  // becomes a JPEG of the rows of all of them. Each stripe is a restart
+  // interval, so the stripes but the last should be as high as |image|, which
+  // should be a multiple of kStripeAlignment. Only the entropy-coded data of
+  // |stripes| are copied.
+  static Status AppendStripes(const std::vector<Data>& stripes, Data* image);
 
   static Status Decode(const unsigned char* input, size_t input_size,
                        Image* image);
+  // Decodes |input| scaled down by |scale_denominator|, which is 1, 2, 4 or
+  // 8. It is much cheaper than decoding in full and scaling, because the
+  // image is scaled in the inverse DCT. The size of |image| is rounded up.
+  static Status Decode(const unsigned char* input, size_t input_size,
+                       int scale_denominator, Image* image);
 };
 
 }  // namespace felicia
@@ -0,0 +1,149 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/lib/image/jpeg_codec.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+
+namespace {
+
+Image NewGradientImage(int width, int height, PixelFormat pixel_format) {
+  int channels = pixel_format == PIXEL_FORMAT_Y8 ? 1 : 3;
+  int stride = width * channels;
+  Data data;
+  data.resize(stride * height);
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < stride; ++x) {
+      pixels[y * stride + x] = (x * 7 + y * 3 + (x * y) % 31) & 0xFF;
+    }
+  }
+  return Image(Sizei(width, height), pixel_format, std::move(data));
+}
+
+std::vector<Data> EncodeStripes(const Image& image, int stripe_rows,
+                                const JpegCodec::Options& options) {
+  std::vector<Data> stripes;
+  for (int top = 0; top < image.height(); top += stripe_rows) {
+    Data stripe;
+    EXPECT_TRUE(JpegCodec::EncodeStripe(
+                    image, top, std::min(stripe_rows, image.height() - top),
+                    options, &stripe)
+                    .ok());
+    stripes.push_back(std::move(stripe));
+  }
+  return stripes;
+}
+
+void ExpectSameDecoded(const Data& expected, const Data& jpeg,
+                       PixelFormat pixel_format) {
+  Image expected_image;
+  expected_image.set_pixel_format(pixel_format);
+  ASSERT_TRUE(JpegCodec::Decode(expected.cast<const unsigned char*>(),
+                                expected.size(), &expected_image)
+                  .ok());
+  Image image;
+  image.set_pixel_format(pixel_format);
+  ASSERT_TRUE(
+      JpegCodec::Decode(jpeg.cast<const unsigned char*>(), jpeg.size(), &image)
+          .ok());
+  EXPECT_EQ(expected_image.size(), image.size());
+  ASSERT_EQ(expected_image.data().size(), image.data().size());
+  EXPECT_EQ(0, memcmp(expected_image.data().cast<const char*>(),
+                      image.data().cast<const char*>(), image.data().size()));
+}
+
+}  // namespace
+
+TEST(JpegCodecTest, EncodeWithSizeHint) {
+  Image image = NewGradientImage(320, 240, PIXEL_FORMAT_BGR);
+  JpegCodec::Options options;
+  std::vector<unsigned char> expected;
+  ASSERT_TRUE(JpegCodec::Encode(image, options, &expected).ok());
+
+  Data output;
+  options.size_hint = expected.size();
+  ASSERT_TRUE(JpegCodec::Encode(image, options, &output).ok());
+  ASSERT_EQ(expected.size(), output.size());
+  EXPECT_EQ(0, memcmp(expected.data(), output.cast<const char*>(),
+                      output.size()));
+}
+
+TEST(JpegCodecTest, AppendStripes) {
+  JpegCodec::Options options;
+  options.quality = 90;
+  options.optimize_coding = false;
+  for (PixelFormat pixel_format : {PIXEL_FORMAT_BGR, PIXEL_FORMAT_Y8}) {
+    // The last stripe of 999 rows isn't aligned to MCUs.
+    Image image = NewGradientImage(1000, 999, pixel_format);
+    Data expected;
+    ASSERT_TRUE(JpegCodec::Encode(image, options, &expected).ok());
+
+    std::vector<Data> stripes = EncodeStripes(
+        image, JpegCodec::kStripeAlignment * 13, options);
+    ASSERT_EQ(5u, stripes.size());
+    Data joined = std::move(stripes[0]);
+    stripes.erase(stripes.begin());
+    // The stripes are appended in place if the first one has room for them.
+    joined.reserve(expected.size() * 2);
+    const char* buffer = joined.cast<const char*>();
+    ASSERT_TRUE(JpegCodec::AppendStripes(stripes, &joined).ok());
+    EXPECT_EQ(buffer, joined.cast<const char*>());
+    ExpectSameDecoded(expected, joined, pixel_format);
+  }
+}
+
+TEST(JpegCodecTest, AppendUnalignedStripes) {
+  Image image = NewGradientImage(64, 64, PIXEL_FORMAT_BGR);
+  std::vector<Data> stripes =
+      EncodeStripes(image, JpegCodec::kStripeAlignment + 8,
+                    JpegCodec::Options());
+  Data joined = std::move(stripes[0]);
+  stripes.erase(stripes.begin());
+  EXPECT_FALSE(JpegCodec::AppendStripes(stripes, &joined).ok());
+}
+
+TEST(JpegCodecTest, AppendToWholeImage) {
+  // A JPEG encoded by Encode() isn't a restart interval.
+  Image image = NewGradientImage(64, 64, PIXEL_FORMAT_BGR);
+  Data jpeg;
+  ASSERT_TRUE(JpegCodec::Encode(image, JpegCodec::Options(), &jpeg).ok());
+  std::vector<Data> stripes =
+      EncodeStripes(image, JpegCodec::kStripeAlignment * 2,
+                    JpegCodec::Options());
+  EXPECT_FALSE(JpegCodec::AppendStripes(stripes, &jpeg).ok());
+}
+
+TEST(JpegCodecTest, DecodeScaled) {
+  Image image = NewGradientImage(1000, 999, PIXEL_FORMAT_BGR);
+  Data jpeg;
+  ASSERT_TRUE(JpegCodec::Encode(image, JpegCodec::Options(), &jpeg).ok());
+
+  const Sizei kExpectedSizes[] = {
+      {1000, 999}, {500, 500}, {250, 250}, {125, 125}};
+  for (int i = 0; i < 4; ++i) {
+    Image decoded;
+    decoded.set_pixel_format(PIXEL_FORMAT_BGRA);
+    ASSERT_TRUE(JpegCodec::Decode(jpeg.cast<const unsigned char*>(),
+                                  jpeg.size(), 1 << i, &decoded)
+                    .ok());
+    EXPECT_EQ(kExpectedSizes[i], decoded.size());
+    EXPECT_EQ(static_cast<size_t>(kExpectedSizes[i].area() * 4),
+              decoded.data().size());
+  }
+
+  Image decoded;
+  decoded.set_pixel_format(PIXEL_FORMAT_BGRA);
+  EXPECT_FALSE(JpegCodec::Decode(jpeg.cast<const unsigned char*>(),
+                                 jpeg.size(), 3, &decoded)
+                   .ok());
+}
+
+}  // namespace felicia
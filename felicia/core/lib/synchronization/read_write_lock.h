@@ -0,0 +1,64 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_LIB_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#define FELICIA_CORE_LIB_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+
+#include <shared_mutex>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/thread_annotations.h"
+
+namespace felicia {
+
+// A lock which can be held by multiple readers at a time, or by a single
+// writer. This is not recursive, so don't acquire it again on the thread
+// which already holds it, in either mode.
+class LOCKABLE ReadWriteLock {
+ public:
+  ReadWriteLock() = default;
+
+  void ReadAcquire() SHARED_LOCK_FUNCTION() { mutex_.lock_shared(); }
+  void ReadRelease() UNLOCK_FUNCTION() { mutex_.unlock_shared(); }
+
+  void WriteAcquire() EXCLUSIVE_LOCK_FUNCTION() { mutex_.lock(); }
+  void WriteRelease() UNLOCK_FUNCTION() { mutex_.unlock(); }
+
+ private:
+  std::shared_timed_mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLock);
+};
+
+class SCOPED_LOCKABLE AutoReadLock {
+ public:
+  explicit AutoReadLock(ReadWriteLock& lock) SHARED_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.ReadAcquire();
+  }
+  ~AutoReadLock() UNLOCK_FUNCTION() { lock_.ReadRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoReadLock);
+};
+
+class SCOPED_LOCKABLE AutoWriteLock {
+ public:
+  explicit AutoWriteLock(ReadWriteLock& lock) EXCLUSIVE_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    lock_.WriteAcquire();
+  }
+  ~AutoWriteLock() UNLOCK_FUNCTION() { lock_.WriteRelease(); }
+
+ private:
+  ReadWriteLock& lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(AutoWriteLock);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_LIB_SYNCHRONIZATION_READ_WRITE_LOCK_H_
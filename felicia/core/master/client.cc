@@ -48,6 +48,17 @@ std::unique_ptr<Client> Client::NewClient(const ClientInfo& client_info) {
   return base::WrapUnique(new Client(new_client_info));
 }
 
+// static
+std::unique_ptr<Client> Client::RestoreClient(const ClientInfo& client_info) {
+  if (GetIDGenerator().In(client_info.id())) {
+    LOG(ERROR) << "Failed to restore client " << client_info.id();
+    return nullptr;
+  }
+
+  GetIDGenerator().Add(client_info.id());
+  return base::WrapUnique(new Client(client_info));
+}
+
 Client::Client(const ClientInfo& client_info) : client_info_(client_info) {}
 
 Client::~Client() { GetIDGenerator().Return(client_info().id()); }
@@ -67,13 +78,11 @@ void Client::RemoveNode(const NodeInfo& node_info) {
 }
 
 bool Client::HasNode(const NodeInfo& node_info) const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   return std::find_if(nodes_.begin(), nodes_.end(),
                       NodeNameChecker{node_info}) != nodes_.end();
 }
 
 base::WeakPtr<Node> Client::FindNode(const NodeInfo& node_info) const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   auto it =
       std::find_if(nodes_.begin(), nodes_.end(), NodeNameChecker{node_info});
   if (it == nodes_.end()) {
@@ -85,7 +94,6 @@ base::WeakPtr<Node> Client::FindNode(const NodeInfo& node_info) const {
 
 std::vector<base::WeakPtr<Node>> Client::FindNodes(
     const NodeFilter& node_filter) const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   std::vector<base::WeakPtr<Node>> nodes;
   if (node_filter.all()) {
     for (auto& node : nodes_) {
@@ -136,7 +144,6 @@ std::vector<base::WeakPtr<Node>> Client::FindNodes(
 
 std::vector<TopicInfo> Client::FindTopicInfos(
     const TopicFilter& topic_filter) const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   std::vector<TopicInfo> topic_infos;
   if (topic_filter.all()) {
     for (auto& node : nodes_) {
@@ -158,7 +165,6 @@ std::vector<TopicInfo> Client::FindTopicInfos(
 
 std::vector<ServiceInfo> Client::FindServiceInfos(
     const ServiceFilter& service_filter) const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   std::vector<ServiceInfo> service_infos;
   if (service_filter.all()) {
     for (auto& node : nodes_) {
@@ -180,7 +186,6 @@ std::vector<ServiceInfo> Client::FindServiceInfos(
 }
 
 std::vector<std::string> Client::FindAllSubscribingTopics() const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   std::vector<std::string> topics;
   for (auto& node : nodes_) {
     std::vector<std::string> tmp_topics = node->AllSubscribingTopics();
@@ -191,7 +196,6 @@ std::vector<std::string> Client::FindAllSubscribingTopics() const {
 }
 
 std::vector<std::string> Client::FindAllRequestingServices() const {
-  DFAKE_SCOPED_LOCK(add_remove_);
   std::vector<std::string> services;
   for (auto& node : nodes_) {
     std::vector<std::string> tmp_services = node->AllRequestingServices();
@@ -21,6 +21,10 @@ class Client {
   // Return client unless there is a unique id for client. If so,
   // return nullptr.
   static std::unique_ptr<Client> NewClient(const ClientInfo& client_info);
+  // Return client whose id is |client_info.id()|, which was given by
+  // NewClient() before the master restarted. If the id is already in use,
+  // return nullptr.
+  static std::unique_ptr<Client> RestoreClient(const ClientInfo& client_info);
 
   ~Client();
 
@@ -52,6 +56,8 @@ class Client {
 
   ClientInfo client_info_;
   std::vector<std::unique_ptr<Node>> nodes_;
+  // AddNode() and RemoveNode() should not run concurrently. Lookups may run
+  // concurrently with each other under the shared lock of Master.
   DFAKE_MUTEX(add_remove_);
 
   DISALLOW_COPY_AND_ASSIGN(Client);
@@ -0,0 +1,122 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/failure_detector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
+
+namespace felicia {
+
+namespace {
+
+// Weight of a new interval on the moving average and variance.
+constexpr double kAlpha = 0.1;
+
+// Phi of the logistic approximation of the normal distribution, for the
+// interval which is |y| standard deviations away from the mean.
+double PhiOfDeviation(double y) {
+  double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+  if (y > 0) return -std::log10(e / (1.0 + e));
+  return -std::log10(1.0 - 1.0 / (1.0 + e));
+}
+
+// Returns the deviation at which phi reaches |threshold|. Phi increases with
+// the deviation, so it is found by bisection.
+double DeviationOfPhi(double threshold) {
+  double lower = -100;
+  double upper = 100;
+  for (int i = 0; i < 64; ++i) {
+    double middle = (lower + upper) / 2;
+    if (PhiOfDeviation(middle) < threshold) {
+      lower = middle;
+    } else {
+      upper = middle;
+    }
+  }
+  return upper;
+}
+
+}  // namespace
+
+MissedCountFailureDetector::MissedCountFailureDetector(
+    base::TimeDelta heart_beat_duration, base::TimeTicks now)
+    : heart_beat_duration_(heart_beat_duration), last_heart_beat_(now) {}
+
+void MissedCountFailureDetector::OnHeartBeat(base::TimeTicks now) {
+  last_heart_beat_ = now;
+}
+
+base::TimeTicks MissedCountFailureDetector::SuspectedAt() const {
+  return last_heart_beat_ + kMaxMissedCount * heart_beat_duration_;
+}
+
+PhiAccrualFailureDetector::PhiAccrualFailureDetector(
+    base::TimeDelta heart_beat_duration, base::TimeTicks now, double threshold)
+    : heart_beat_duration_(heart_beat_duration),
+      last_heart_beat_(now),
+      mean_(heart_beat_duration.InMillisecondsF()),
+      variance_(mean_ * mean_ / 16),
+      threshold_deviation_(DeviationOfPhi(threshold)) {}
+
+void PhiAccrualFailureDetector::OnHeartBeat(base::TimeTicks now) {
+  double interval = (now - last_heart_beat_).InMillisecondsF();
+  last_heart_beat_ = now;
+
+  double diff = interval - mean_;
+  mean_ += kAlpha * diff;
+  variance_ = (1 - kAlpha) * (variance_ + kAlpha * diff * diff);
+}
+
+base::TimeTicks PhiAccrualFailureDetector::SuspectedAt() const {
+  double suspected_interval =
+      std::max(mean_ + threshold_deviation_ * StandardDeviation(), 0.0);
+  return last_heart_beat_ +
+         base::TimeDelta::FromMillisecondsD(suspected_interval);
+}
+
+double PhiAccrualFailureDetector::Phi(base::TimeTicks now) const {
+  double interval = (now - last_heart_beat_).InMillisecondsF();
+  return PhiOfDeviation((interval - mean_) / StandardDeviation());
+}
+
+double PhiAccrualFailureDetector::StandardDeviation() const {
+  // Heart beats arriving like clockwork would make the deviation almost 0,
+  // and then a single delayed one would be fatal.
+  double min_standard_deviation = heart_beat_duration_.InMillisecondsF() / 4;
+  return std::max(std::sqrt(variance_), min_standard_deviation);
+}
+
+std::unique_ptr<FailureDetector> NewFailureDetector(
+    base::TimeDelta heart_beat_duration, base::TimeTicks now) {
+  const char* failure_detector = getenv("FEL_HEART_BEAT_FAILURE_DETECTOR");
+  if (failure_detector && strcmp(failure_detector, "phi_accrual") == 0) {
+    double threshold = PhiAccrualFailureDetector::kDefaultThreshold;
+    const char* threshold_str = getenv("FEL_HEART_BEAT_PHI_THRESHOLD");
+    if (threshold_str) {
+      if (!base::StringToDouble(threshold_str, &threshold) || threshold <= 0) {
+        LOG(WARNING) << "Threshold should be positive " << threshold_str
+                     << ", set to default value "
+                     << PhiAccrualFailureDetector::kDefaultThreshold;
+        threshold = PhiAccrualFailureDetector::kDefaultThreshold;
+      }
+    }
+    return std::make_unique<PhiAccrualFailureDetector>(heart_beat_duration,
+                                                       now, threshold);
+  }
+
+  LOG_IF(WARNING, failure_detector && strcmp(failure_detector, "missed_count"))
+      << "Unknown failure detector " << failure_detector
+      << ", set to missed_count";
+  return std::make_unique<MissedCountFailureDetector>(heart_beat_duration,
+                                                      now);
+}
+
+}  // namespace felicia
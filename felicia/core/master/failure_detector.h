@@ -0,0 +1,92 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_FAILURE_DETECTOR_H_
+#define FELICIA_CORE_MASTER_FAILURE_DETECTOR_H_
+
+#include <memory>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/time/time.h"
+
+namespace felicia {
+
+// FailureDetector decides when a client is regarded as dead from the arrival
+// times of its heart beats. Both methods should be O(1), because they are
+// called for every heart beat of every client.
+class FailureDetector {
+ public:
+  virtual ~FailureDetector() = default;
+
+  // Records a heart beat which arrived at |now|.
+  virtual void OnHeartBeat(base::TimeTicks now) = 0;
+
+  // Returns the time when the client is regarded as dead unless another heart
+  // beat arrives until then.
+  virtual base::TimeTicks SuspectedAt() const = 0;
+};
+
+// Regards the client as dead when |kMaxMissedCount| heart beats are missed in
+// a row.
+class MissedCountFailureDetector : public FailureDetector {
+ public:
+  static constexpr int kMaxMissedCount = 5;
+
+  MissedCountFailureDetector(base::TimeDelta heart_beat_duration,
+                             base::TimeTicks now);
+
+  void OnHeartBeat(base::TimeTicks now) override;
+  base::TimeTicks SuspectedAt() const override;
+
+ private:
+  base::TimeDelta heart_beat_duration_;
+  base::TimeTicks last_heart_beat_;
+
+  DISALLOW_COPY_AND_ASSIGN(MissedCountFailureDetector);
+};
+
+// The phi accrual failure detector, which regards the client as dead when
+// phi, the suspicion level computed from the distribution of the intervals
+// between heart beats, exceeds |threshold|. Phi of 1 means the chance that
+// the next heart beat still arrives is 10%, 2 means 1%, and so on. So this
+// adapts to clients whose heart beats are jittery, e.g, over a busy network.
+// See https://doi.org/10.1109/RELDIS.2004.1353004
+class PhiAccrualFailureDetector : public FailureDetector {
+ public:
+  static constexpr double kDefaultThreshold = 8;
+
+  PhiAccrualFailureDetector(base::TimeDelta heart_beat_duration,
+                            base::TimeTicks now,
+                            double threshold = kDefaultThreshold);
+
+  void OnHeartBeat(base::TimeTicks now) override;
+  base::TimeTicks SuspectedAt() const override;
+
+  // Returns phi at |now|.
+  double Phi(base::TimeTicks now) const;
+
+ private:
+  double StandardDeviation() const;
+
+  base::TimeDelta heart_beat_duration_;
+  base::TimeTicks last_heart_beat_;
+  // Moving average and variance of the intervals in milliseconds.
+  double mean_;
+  double variance_;
+  // The deviation from |mean_| in standard deviations, at which phi reaches
+  // the threshold.
+  double threshold_deviation_;
+
+  DISALLOW_COPY_AND_ASSIGN(PhiAccrualFailureDetector);
+};
+
+// Creates the FailureDetector chosen by FEL_HEART_BEAT_FAILURE_DETECTOR,
+// which is either "missed_count" or "phi_accrual". The threshold of
+// PhiAccrualFailureDetector is read from FEL_HEART_BEAT_PHI_THRESHOLD.
+std::unique_ptr<FailureDetector> NewFailureDetector(
+    base::TimeDelta heart_beat_duration, base::TimeTicks now);
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_FAILURE_DETECTOR_H_
@@ -4,7 +4,6 @@
 
 #include "felicia/core/master/heart_beat_listener.h"
 
-#include "third_party/chromium/base/strings/string_number_conversions.h"
 #include "third_party/chromium/base/threading/thread_task_runner_handle.h"
 
 #include "felicia/core/channel/channel_factory.h"
@@ -12,87 +11,120 @@
 
 namespace felicia {
 
-HeartBeatListener::HeartBeatListener(const ClientInfo& client_info,
-                                     OnDisconnectCallback callback)
-    : client_info_(client_info),
-      heart_beat_duration_(GetHeartBeatDuration(client_info)),
-      callback_(std::move(callback)) {
+HeartBeatListener::HeartBeatListener(OnDisconnectCallback callback)
+    : callback_(callback), liveness_tracker_(base::TimeTicks::Now()) {
   DCHECK(!callback_.is_null());
 }
 
-HeartBeatListener::~HeartBeatListener() {
-  std::move(callback_).Run(client_info_);
-}
+HeartBeatListener::~HeartBeatListener() = default;
 
-void HeartBeatListener::StartCheckHeartBeat() {
-  DCHECK_EQ(client_info_.heart_beat_signaller_source().channel_defs_size(), 1);
-  DCHECK_EQ(client_info_.heart_beat_signaller_source().channel_defs(0).type(),
+void HeartBeatListener::StartCheckHeartBeat(const ClientInfo& client_info) {
+  DCHECK_EQ(client_info.heart_beat_signaller_source().channel_defs_size(), 1);
+  DCHECK_EQ(client_info.heart_beat_signaller_source().channel_defs(0).type(),
             ChannelDef::CHANNEL_TYPE_TCP);
 
-  channel_ = ChannelFactory::NewChannel(
-      client_info_.heart_beat_signaller_source().channel_defs(0).type());
+  uint32_t id = client_info.id();
+  auto connection = std::make_unique<Connection>();
+  connection->client_info = client_info;
+  connection->channel = ChannelFactory::NewChannel(
+      client_info.heart_beat_signaller_source().channel_defs(0).type());
+  connection->channel->SetReceiveBufferSize(kHeartBeatBytes);
+  Channel* channel = connection->channel.get();
+  connections_[id] = std::move(connection);
+
+  base::TimeTicks now = base::TimeTicks::Now();
+  liveness_tracker_.Track(
+      id, NewFailureDetector(GetHeartBeatDuration(client_info), now), now);
+  if (tick_.IsCancelled()) ScheduleTick();
+
+  channel->Connect(client_info.heart_beat_signaller_source().channel_defs(0),
+                   base::BindOnce(&HeartBeatListener::OnConnect,
+                                  base::Unretained(this), id, channel));
+}
 
-  channel_->SetReceiveBufferSize(kHeartBeatBytes);
+void HeartBeatListener::StopCheckHeartBeat(uint32_t id) {
+  connections_.erase(id);
+  liveness_tracker_.Untrack(id);
+}
 
-  channel_->Connect(client_info_.heart_beat_signaller_source().channel_defs(0),
-                    base::BindOnce(&HeartBeatListener::DoCheckHeartBeat,
-                                   base::Unretained(this)));
+void HeartBeatListener::CheckNow() {
+  for (uint32_t id : liveness_tracker_.Advance(base::TimeTicks::Now())) {
+    Disconnect(id);
+  }
 }
 
-void HeartBeatListener::DoCheckHeartBeat(Status s) {
+void HeartBeatListener::OnConnect(uint32_t id, Channel* channel, Status s) {
+  auto it = connections_.find(id);
+  // The client has been replaced or stopped in the meantime.
+  if (it == connections_.end() || it->second->channel.get() != channel) return;
+
+  Connection* connection = it->second.get();
   if (!s.ok()) {
     LOG(ERROR) << "Failed to Connect "
-               << client_info_.heart_beat_signaller_source().DebugString();
-    KillSelf();
+               << connection->client_info.heart_beat_signaller_source()
+                      .DebugString();
+    Disconnect(id);
     return;
   }
 
-  receiver_.set_channel(channel_.get());
-  TryReceiveHeartBeat();
+  connection->receiver.set_channel(channel);
+  TryReceiveHeartBeat(connection);
 }
 
-void HeartBeatListener::TryReceiveHeartBeat() {
-  if (stopped_) {
-    return;
-  }
-  if (timeout_.IsCancelled()) {
-    timeout_.Reset(base::BindOnce(&HeartBeatListener::StopCheckHeartBeat,
-                                  base::Unretained(this)));
-    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
-        FROM_HERE, timeout_.callback(), kMultiplier * heart_beat_duration_);
-  }
-  receiver_.ReceiveMessage(
-      base::BindOnce(&HeartBeatListener::OnAlive, base::Unretained(this)));
+void HeartBeatListener::TryReceiveHeartBeat(Connection* connection) {
+  connection->receiver.ReceiveMessage(
+      base::BindOnce(&HeartBeatListener::OnHeartBeat, base::Unretained(this),
+                     connection->client_info.id()));
 }
 
-void HeartBeatListener::OnAlive(Status s) {
-  if (s.ok()) {
-    timeout_.Cancel();
-  } else if (channel_->IsTCPChannel() &&
-             !channel_->ToTCPChannel()->IsConnected()) {
-    KillSelf();
+void HeartBeatListener::OnHeartBeat(uint32_t id, Status s) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) return;
+
+  Connection* connection = it->second.get();
+  if (!s.ok()) {
+    if (connection->channel->IsTCPChannel() &&
+        !connection->channel->ToTCPChannel()->IsConnected()) {
+      Disconnect(id);
+    } else {
+      ScheduleRetry(connection);
+    }
     return;
   }
 
-  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
-      FROM_HERE,
+  liveness_tracker_.OnHeartBeat(id, base::TimeTicks::Now());
+  TryReceiveHeartBeat(connection);
+}
+
+void HeartBeatListener::ScheduleRetry(Connection* connection) {
+  connection->retry.Reset(
       base::BindOnce(&HeartBeatListener::TryReceiveHeartBeat,
-                     base::Unretained(this)),
-      heart_beat_duration_);
+                     base::Unretained(this), connection));
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, connection->retry.callback(),
+      GetHeartBeatDuration(connection->client_info));
+}
+
+void HeartBeatListener::OnTick() {
+  CheckNow();
+  if (!liveness_tracker_.IsEmpty()) ScheduleTick();
 }
 
-void HeartBeatListener::StopCheckHeartBeat() {
-  stopped_ = true;
+void HeartBeatListener::ScheduleTick() {
+  tick_.Reset(
+      base::BindOnce(&HeartBeatListener::OnTick, base::Unretained(this)));
   base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
-      FROM_HERE,
-      base::BindOnce(&HeartBeatListener::KillSelf, base::Unretained(this)),
-      heart_beat_duration_);
+      FROM_HERE, tick_.callback(),
+      base::TimeDelta::FromMilliseconds(LivenessTracker::kTickInMilliseconds));
 }
 
-void HeartBeatListener::KillSelf() {
-  timeout_.Cancel();
-  channel_.reset();
-  delete this;
+void HeartBeatListener::Disconnect(uint32_t id) {
+  auto it = connections_.find(id);
+  if (it == connections_.end()) return;
+  ClientInfo client_info = it->second->client_info;
+  connections_.erase(it);
+  liveness_tracker_.Untrack(id);
+  callback_.Run(client_info);
 }
 
-}  // namespace felicia
\ No newline at end of file
+}  // namespace felicia
@@ -6,6 +6,7 @@
 #define FELICIA_CORE_MASTER_HEART_BEAT_LISTENER_H_
 
 #include <memory>
+#include <unordered_map>
 
 #include "third_party/chromium/base/cancelable_callback.h"
 #include "third_party/chromium/base/macros.h"
@@ -14,50 +15,70 @@
 #include "felicia/core/channel/channel.h"
 #include "felicia/core/channel/message_receiver.h"
 #include "felicia/core/master/bytes_constants.h"
+#include "felicia/core/master/liveness_tracker.h"
 #include "felicia/core/protobuf/master_data.pb.h"
 
 namespace felicia {
 
+// HeartBeatListener reads |HeartBeat| from every client, and tells when a
+// client is dead. Instead of a timer for each client, the arrivals are
+// recorded to a single LivenessTracker, and it is checked once a tick. This
+// should be used on a single thread.
 class HeartBeatListener {
  public:
   using OnDisconnectCallback =
-      base::OnceCallback<void(const ClientInfo& client_info)>;
+      base::RepeatingCallback<void(const ClientInfo& client_info)>;
 
-  explicit HeartBeatListener(const ClientInfo& client_info,
-                             OnDisconnectCallback callback);
+  explicit HeartBeatListener(OnDisconnectCallback callback);
+  ~HeartBeatListener();
+
+  // Connect to client and read the |HeartBeat| whenever it arrives. If the
+  // client with the same id is already checked, it is replaced.
+  void StartCheckHeartBeat(const ClientInfo& client_info);
 
-  // Connect to client and read the |HeartBeat| periodically.
-  void StartCheckHeartBeat();
+  // Stop checking the client |id| without calling back.
+  void StopCheckHeartBeat(uint32_t id);
+
+  // Disconnects the clients which are suspected to be dead by now, without
+  // waiting for the next tick.
+  void CheckNow();
 
  private:
-  ~HeartBeatListener();
+  struct Connection {
+    ClientInfo client_info;
+    std::unique_ptr<Channel> channel;
+    MessageReceiver<HeartBeat> receiver;
+    // Set while it waits to receive again after an error.
+    base::CancelableOnceClosure retry;
+  };
 
-  void DoCheckHeartBeat(Status s);
+  void OnConnect(uint32_t id, Channel* channel, Status s);
 
-  void TryReceiveHeartBeat();
+  void TryReceiveHeartBeat(Connection* connection);
 
-  // If |HeartBeat| is arrived right at the time, then it repeats to call
-  // |DoCheckHeart| method. During a certain amount of duration, if heart
-  // beat message can't be reached, then listener regard it as a dead one.
-  void OnAlive(Status s);
+  void OnHeartBeat(uint32_t id, Status s);
 
-  void StopCheckHeartBeat();
+  // Receives again after a heart beat duration, not to spin on an error
+  // which doesn't go away by itself.
+  void ScheduleRetry(Connection* connection);
 
-  void KillSelf();
+  // Checks the clients which haven't sent |HeartBeat| for a while. This runs
+  // every tick of |liveness_tracker_| while any client is checked.
+  void OnTick();
 
-  ClientInfo client_info_;
-  base::TimeDelta heart_beat_duration_;
-  OnDisconnectCallback callback_;
-  std::unique_ptr<Channel> channel_;
-  MessageReceiver<HeartBeat> receiver_;
+  void ScheduleTick();
+
+  // Drops the connection to the client |id| and calls back.
+  void Disconnect(uint32_t id);
 
-  base::CancelableOnceClosure timeout_;
-  bool stopped_ = false;
-  static constexpr uint8_t kMultiplier = 5;
+  OnDisconnectCallback callback_;
+  std::unordered_map<uint32_t, std::unique_ptr<Connection>> connections_;
+  LivenessTracker liveness_tracker_;
+  base::CancelableOnceClosure tick_;
 
   DISALLOW_COPY_AND_ASSIGN(HeartBeatListener);
 };
 
 }  // namespace felicia
 
-#endif  // FELICIA_CORE_MASTER_HEART_BEAT_LISTENER_H_
\ No newline at end of file
+#endif  // FELICIA_CORE_MASTER_HEART_BEAT_LISTENER_H_
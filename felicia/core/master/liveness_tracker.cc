@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/liveness_tracker.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "third_party/chromium/base/logging.h"
+
+namespace felicia {
+
+LivenessTracker::Entry::Entry() = default;
+
+LivenessTracker::Entry::~Entry() = default;
+
+LivenessTracker::LivenessTracker(base::TimeTicks now)
+    : current_(now), slots_(kSlotNum) {}
+
+LivenessTracker::~LivenessTracker() = default;
+
+bool LivenessTracker::IsTracking(uint32_t id) const {
+  return entries_.find(id) != entries_.end();
+}
+
+void LivenessTracker::Track(uint32_t id,
+                            std::unique_ptr<FailureDetector> failure_detector,
+                            base::TimeTicks now) {
+  Untrack(id);
+  // The wheel may have stood still while nothing was tracked.
+  if (entries_.empty()) current_ = now;
+
+  Entry& entry = entries_[id];
+  entry.failure_detector = std::move(failure_detector);
+  std::list<uint32_t> list;
+  list.push_back(id);
+  Schedule(&entry, &list, list.begin());
+}
+
+void LivenessTracker::Untrack(uint32_t id) {
+  auto it = entries_.find(id);
+  if (it == entries_.end()) return;
+  slots_[it->second.slot].erase(it->second.it);
+  entries_.erase(it);
+}
+
+void LivenessTracker::OnHeartBeat(uint32_t id, base::TimeTicks now) {
+  auto it = entries_.find(id);
+  if (it == entries_.end()) return;
+  Entry& entry = it->second;
+  entry.failure_detector->OnHeartBeat(now);
+  Schedule(&entry, &slots_[entry.slot], entry.it);
+}
+
+std::vector<uint32_t> LivenessTracker::Advance(base::TimeTicks now) {
+  std::vector<uint32_t> suspected_ids;
+  while (current_ + tick() <= now) {
+    current_ += tick();
+    cursor_ = (cursor_ + 1) % kSlotNum;
+
+    std::list<uint32_t> list;
+    list.swap(slots_[cursor_]);
+    while (!list.empty()) {
+      uint32_t id = list.front();
+      Entry& entry = entries_[id];
+      if (entry.rounds > 0) {
+        entry.rounds--;
+        slots_[cursor_].splice(slots_[cursor_].end(), list, list.begin());
+      } else if (entry.failure_detector->SuspectedAt() <= current_) {
+        list.pop_front();
+        entries_.erase(id);
+        suspected_ids.push_back(id);
+      } else {
+        Schedule(&entry, &list, list.begin());
+      }
+    }
+  }
+  return suspected_ids;
+}
+
+void LivenessTracker::Schedule(Entry* entry, std::list<uint32_t>* list,
+                               std::list<uint32_t>::iterator it) {
+  base::TimeDelta delay = entry->failure_detector->SuspectedAt() - current_;
+  int64_t ticks = std::max<int64_t>(
+      (delay.InMilliseconds() + kTickInMilliseconds - 1) / kTickInMilliseconds,
+      1);
+  entry->slot = (cursor_ + ticks) % kSlotNum;
+  entry->rounds = (ticks - 1) / kSlotNum;
+  entry->it = it;
+  // This keeps |it| valid, so moving a client costs O(1).
+  slots_[entry->slot].splice(slots_[entry->slot].end(), *list, it);
+}
+
+// static
+base::TimeDelta LivenessTracker::tick() {
+  return base::TimeDelta::FromMilliseconds(kTickInMilliseconds);
+}
+
+}  // namespace felicia
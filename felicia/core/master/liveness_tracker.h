@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_LIVENESS_TRACKER_H_
+#define FELICIA_CORE_MASTER_LIVENESS_TRACKER_H_
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/master/failure_detector.h"
+
+namespace felicia {
+
+// LivenessTracker tracks when each client is suspected by its
+// FailureDetector on a hashed timer wheel, so that a single timer checks all
+// the clients. The wheel has |kSlotNum| slots of |kTickInMilliseconds|, and
+// a client is put on the slot of the tick when it will be suspected, with the
+// number of rounds left if it is further than a revolution. Both a heart beat
+// and a tick cost O(1) for each client, regardless of how many clients are
+// tracked. This is not thread-safe.
+class LivenessTracker {
+ public:
+  static constexpr int64_t kTickInMilliseconds = 100;
+  static constexpr size_t kSlotNum = 512;
+
+  explicit LivenessTracker(base::TimeTicks now);
+  ~LivenessTracker();
+
+  bool IsEmpty() const { return entries_.empty(); }
+  bool IsTracking(uint32_t id) const;
+
+  // Starts to track the client |id|, replacing the one tracked with the same
+  // |id| if any.
+  void Track(uint32_t id, std::unique_ptr<FailureDetector> failure_detector,
+             base::TimeTicks now);
+  void Untrack(uint32_t id);
+
+  // Records a heart beat of the client |id| which arrived at |now|.
+  void OnHeartBeat(uint32_t id, base::TimeTicks now);
+
+  // Advances the wheel up to |now|, and returns the ids of the clients which
+  // are suspected to be dead. They are no longer tracked.
+  std::vector<uint32_t> Advance(base::TimeTicks now);
+
+ private:
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    std::unique_ptr<FailureDetector> failure_detector;
+    size_t slot;
+    size_t rounds;
+    std::list<uint32_t>::iterator it;
+  };
+
+  // Moves |entry|, whose node is |it| of |list|, to the slot of the tick when
+  // its client is suspected.
+  void Schedule(Entry* entry, std::list<uint32_t>* list,
+                std::list<uint32_t>::iterator it);
+
+  static base::TimeDelta tick();
+
+  base::TimeTicks current_;
+  size_t cursor_ = 0;
+  std::vector<std::list<uint32_t>> slots_;
+  std::unordered_map<uint32_t, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(LivenessTracker);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_LIVENESS_TRACKER_H_
@@ -0,0 +1,107 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/liveness_tracker.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr uint32_t kId = 1;
+constexpr uint32_t kOtherId = 2;
+
+base::TimeDelta Seconds(double seconds) {
+  return base::TimeDelta::FromSecondsD(seconds);
+}
+
+std::unique_ptr<FailureDetector> NewMissedCountFailureDetector(
+    base::TimeDelta heart_beat_duration, base::TimeTicks now) {
+  return std::make_unique<MissedCountFailureDetector>(heart_beat_duration,
+                                                      now);
+}
+
+}  // namespace
+
+class LivenessTrackerTest : public testing::Test {
+ public:
+  LivenessTrackerTest() : now_(base::TimeTicks::Now()), tracker_(now_) {}
+
+ protected:
+  std::vector<uint32_t> AdvanceTo(base::TimeDelta delta) {
+    return tracker_.Advance(now_ + delta);
+  }
+
+  base::TimeTicks now_;
+  LivenessTracker tracker_;
+};
+
+TEST_F(LivenessTrackerTest, SuspectAfterMissedHeartBeats) {
+  tracker_.Track(kId, NewMissedCountFailureDetector(Seconds(1), now_), now_);
+  tracker_.Track(kOtherId, NewMissedCountFailureDetector(Seconds(2), now_),
+                 now_);
+
+  EXPECT_TRUE(AdvanceTo(Seconds(4.9)).empty());
+  EXPECT_EQ(std::vector<uint32_t>{kId}, AdvanceTo(Seconds(5.1)));
+  EXPECT_FALSE(tracker_.IsTracking(kId));
+  EXPECT_TRUE(tracker_.IsTracking(kOtherId));
+  EXPECT_EQ(std::vector<uint32_t>{kOtherId}, AdvanceTo(Seconds(10.1)));
+  EXPECT_TRUE(tracker_.IsEmpty());
+}
+
+TEST_F(LivenessTrackerTest, HeartBeatPostponesSuspicion) {
+  tracker_.Track(kId, NewMissedCountFailureDetector(Seconds(1), now_), now_);
+
+  EXPECT_TRUE(AdvanceTo(Seconds(3)).empty());
+  tracker_.OnHeartBeat(kId, now_ + Seconds(3));
+  EXPECT_TRUE(AdvanceTo(Seconds(7.9)).empty());
+  EXPECT_EQ(std::vector<uint32_t>{kId}, AdvanceTo(Seconds(8.1)));
+}
+
+TEST_F(LivenessTrackerTest, SuspectLaterThanRevolution) {
+  // 5 missed heart beats of 20 seconds are longer than a revolution of the
+  // wheel.
+  tracker_.Track(kId, NewMissedCountFailureDetector(Seconds(20), now_), now_);
+
+  EXPECT_TRUE(AdvanceTo(Seconds(60)).empty());
+  EXPECT_TRUE(AdvanceTo(Seconds(99.9)).empty());
+  EXPECT_EQ(std::vector<uint32_t>{kId}, AdvanceTo(Seconds(100.1)));
+}
+
+TEST_F(LivenessTrackerTest, Untrack) {
+  tracker_.Track(kId, NewMissedCountFailureDetector(Seconds(1), now_), now_);
+  tracker_.Untrack(kId);
+
+  EXPECT_FALSE(tracker_.IsTracking(kId));
+  EXPECT_TRUE(AdvanceTo(Seconds(10)).empty());
+}
+
+TEST(PhiAccrualFailureDetectorTest, AdaptToJitter) {
+  base::TimeTicks now = base::TimeTicks::Now();
+  PhiAccrualFailureDetector regular(Seconds(1), now);
+  PhiAccrualFailureDetector jittery(Seconds(1), now);
+  base::TimeTicks regular_now = now;
+  base::TimeTicks jittery_now = now;
+  for (int i = 0; i < 100; ++i) {
+    regular_now += Seconds(1);
+    regular.OnHeartBeat(regular_now);
+    jittery_now += Seconds(i % 2 == 0 ? 0.2 : 1.8);
+    jittery.OnHeartBeat(jittery_now);
+  }
+
+  EXPECT_LT(regular.Phi(regular_now + Seconds(1)), 1);
+  base::TimeDelta regular_timeout = regular.SuspectedAt() - regular_now;
+  EXPECT_GT(regular_timeout, Seconds(1));
+  EXPECT_LT(regular_timeout, Seconds(5));
+  EXPECT_NEAR(PhiAccrualFailureDetector::kDefaultThreshold,
+              regular.Phi(regular.SuspectedAt()), 0.01);
+
+  base::TimeDelta jittery_timeout = jittery.SuspectedAt() - jittery_now;
+  EXPECT_GT(jittery_timeout, regular_timeout);
+}
+
+}  // namespace felicia
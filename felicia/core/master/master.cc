@@ -4,7 +4,11 @@
 
 #include "felicia/core/master/master.h"
 
+#include <algorithm>
+
 #include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/bind_helpers.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
 #include "third_party/chromium/base/strings/stringprintf.h"
 
 #include "felicia/core/channel/channel_factory.h"
@@ -12,10 +16,101 @@
 #include "felicia/core/lib/strings/str_util.h"
 #include "felicia/core/master/heart_beat_listener.h"
 #include "felicia/core/master/ros_master_proxy.h"
+#include "felicia/core/master/service_server_key.h"
 #include "felicia/core/message/ros_protocol.h"
 
 namespace felicia {
 
+namespace {
+
+constexpr int64_t kDefaultGcInterval = 10000;
+
+constexpr int64_t kDefaultNotificationWindow = 20;
+
+// The number of clients which Gc() checks at a time, before yielding
+// |thread_| to the other requests.
+constexpr size_t kGcSliceSize = 32;
+
+// How long Gc() waits for a client to accept, before it regards the client
+// as unreachable. Without this, a hung host which neither accepts nor
+// refuses holds the slice until the OS gives up connecting.
+constexpr base::TimeDelta kGcProbeTimeout = base::TimeDelta::FromSeconds(1);
+
+base::TimeDelta GetGcInterval() {
+  int64_t interval = kDefaultGcInterval;
+  const char* interval_str = getenv("FEL_MASTER_GC_INTERVAL");
+  if (interval_str) {
+    if (base::StringToInt64(interval_str, &interval)) {
+      if (interval < 0) {
+        LOG(WARNING) << "Interval cannot be negative " << interval
+                     << ", set to default value " << kDefaultGcInterval;
+        interval = kDefaultGcInterval;
+      }
+    }
+  }
+  return base::TimeDelta::FromMilliseconds(interval);
+}
+
+base::TimeDelta GetNotificationWindow() {
+  int64_t window = kDefaultNotificationWindow;
+  const char* window_str = getenv("FEL_MASTER_NOTIFICATION_WINDOW");
+  if (window_str) {
+    if (base::StringToInt64(window_str, &window)) {
+      if (window < 0) {
+        LOG(WARNING) << "Window cannot be negative " << window
+                     << ", set to default value " << kDefaultNotificationWindow;
+        window = kDefaultNotificationWindow;
+      }
+    }
+  }
+  return base::TimeDelta::FromMilliseconds(window);
+}
+
+// Adds |info| to |infos|, or replaces the one with the same |key| there, so
+// that only the latest change of each is kept.
+template <typename T>
+void CoalesceInfo(std::vector<T>* infos,
+                  std::unordered_map<std::string, size_t>* indexes,
+                  const std::string& key, const T& info) {
+  auto it = indexes->find(key);
+  if (it == indexes->end()) {
+    indexes->emplace(key, infos->size());
+    infos->push_back(info);
+  } else {
+    (*infos)[it->second] = info;
+  }
+}
+
+bool IsSameClient(const ClientInfo& a, const ClientInfo& b) {
+  return a.id() == b.id() &&
+         a.heart_beat_signaller_source().SerializeAsString() ==
+             b.heart_beat_signaller_source().SerializeAsString() &&
+         a.master_notification_watcher_source().SerializeAsString() ==
+             b.master_notification_watcher_source().SerializeAsString();
+}
+
+void RemoveFromIndex(
+    std::unordered_map<std::string, std::vector<Node*>>* index,
+    const std::string& key, Node* node) {
+  auto it = index->find(key);
+  if (it == index->end()) return;
+  std::vector<Node*>& nodes = it->second;
+  nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+  if (nodes.empty()) index->erase(it);
+}
+
+MasterJournalEntry NewJournalEntry(
+    MasterJournalEntry::Type type, const NodeInfo& node_info,
+    const std::string& name = base::EmptyString()) {
+  MasterJournalEntry entry;
+  entry.set_type(type);
+  *entry.mutable_node_info() = node_info;
+  entry.set_name(name);
+  return entry;
+}
+
+}  // namespace
+
 Master::~Master() = default;
 
 #define CHECK_CLIENT_EXISTS(node_info)                        \
@@ -37,14 +132,58 @@ Master::~Master() = default;
     }                                                                \
   } while (false)
 
-Master::Master() : thread_(std::make_unique<base::Thread>("Master")) {}
+Master::Master()
+    : thread_(std::make_unique<base::Thread>("Master")),
+      state_store_thread_(
+          std::make_unique<base::Thread>("MasterStateStore")) {}
+
+Status Master::LoadState(const base::FilePath& dir) {
+  DCHECK(!thread_->IsRunning());
+  auto state_store = std::make_unique<MasterStateStore>(dir);
+  MasterSnapshot snapshot;
+  Status s = state_store->Load(&snapshot);
+  if (!s.ok()) return s;
+
+  RestoreSnapshot(snapshot);
+  state_store_ = std::move(state_store);
+  return Status::OK();
+}
 
 void Master::Run() {
   thread_->StartWithOptions(
       base::Thread::Options{base::MessageLoop::TYPE_IO, 0});
+  if (state_store_) state_store_thread_->Start();
+
+  // Clients restored by LoadState() are kept only if they are still alive.
+  std::vector<ClientInfo> client_infos;
+  {
+    AutoReadLock l(lock_);
+    for (auto& it : client_map_) {
+      client_infos.push_back(it.second->client_info());
+    }
+  }
+  for (auto& client_info : client_infos) {
+    thread_->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&Master::DoCheckHeartBeat,
+                                  base::Unretained(this), client_info));
+  }
+
+  notification_window_ = GetNotificationWindow();
+  gc_interval_ = GetGcInterval();
+  if (!gc_interval_.is_zero()) ScheduleGc();
 }
 
-void Master::Stop() { thread_->Stop(); }
+void Master::Stop() {
+  if (!thread_->IsRunning()) return;
+  // |heart_beat_listener_| should be destroyed on |thread_|, where its
+  // channels run.
+  thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&Master::StopCheckHeartBeat, base::Unretained(this)));
+  thread_->Stop();
+  // Writes the journal and the snapshot which are posted before it stops.
+  state_store_thread_->Stop();
+}
 
 void Master::RegisterClient(const RegisterClientRequest* arg,
                             RegisterClientResponse* result,
@@ -81,7 +220,7 @@ void Master::ListClients(const ListClientsRequest* arg,
                          StatusOnceCallback callback) {
   const ClientFilter& client_filter = arg->client_filter();
   {
-    base::AutoLock l(lock_);
+    AutoReadLock l(lock_);
     if (client_filter.all()) {
       for (auto& it : client_map_) {
         *result->add_client_infos() = it.second->client_info();
@@ -288,7 +427,11 @@ void Master::ListServices(const ListServicesRequest* arg,
   std::move(callback).Run(Status::OK());
 }
 
-void Master::Gc() { LOG(ERROR) << "Not implemented"; }
+void Master::Gc(base::OnceClosure callback) {
+  thread_->task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&Master::DoGc, base::Unretained(this),
+                                std::move(callback)));
+}
 
 void Master::DoRegisterClient(std::unique_ptr<Client> client,
                               StatusOnceCallback callback) {
@@ -333,7 +476,7 @@ void Master::DoListNodes(const ListNodesRequest* arg, ListNodesResponse* result,
   std::vector<base::WeakPtr<Node>> nodes = FindNodes(node_filter);
   if (!node_filter.name().empty()) {
     auto pub_sub_topics = result->mutable_pub_sub_topics();
-    base::AutoLock l(lock_);
+    AutoReadLock l(lock_);
     if (nodes.size() > 0) {
       auto node = nodes[0];
       if (node) {
@@ -350,7 +493,7 @@ void Master::DoListNodes(const ListNodesRequest* arg, ListNodesResponse* result,
       }
     }
   } else {
-    base::AutoLock l(lock_);
+    AutoReadLock l(lock_);
     for (auto node : nodes) {
       if (node) *result->add_node_infos() = node->node_info();
     }
@@ -363,18 +506,17 @@ void Master::DoPublishTopic(const NodeInfo& node_info,
                             const TopicInfo& topic_info,
                             StatusOnceCallback callback) {
   DCHECK(thread_->task_runner()->BelongsToCurrentThread());
-  NodeFilter node_filter;
-  node_filter.set_publishing_topic(topic_info.topic());
-  std::vector<base::WeakPtr<Node>> publishing_nodes = FindNodes(node_filter);
   Reason reason;
-  if (publishing_nodes.size() > 0) {
-    reason = Reason::TopicAlreadyPublishingOnNode;
-  } else {
-    base::WeakPtr<Node> node = FindNode(node_info);
-    base::AutoLock l(lock_);
-    {
+  {
+    AutoWriteLock l(lock_);
+    if (publishing_nodes_.find(topic_info.topic()) !=
+        publishing_nodes_.end()) {
+      reason = Reason::TopicAlreadyPublishingOnNode;
+    } else {
+      Node* node = FindNodeLocked(node_info);
       if (node) {
         node->RegisterPublishingTopic(topic_info);
+        publishing_nodes_[topic_info.topic()] = node;
         reason = Reason::None;
       } else {
         reason = Reason::UnknownFailed;
@@ -383,6 +525,10 @@ void Master::DoPublishTopic(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    MasterJournalEntry entry =
+        NewJournalEntry(MasterJournalEntry::PUBLISH_TOPIC, node_info);
+    *entry.mutable_topic_info() = topic_info;
+    AppendJournal(entry);
     DLOG(INFO) << "[PublishTopic]: "
                << base::StringPrintf("topic(%s) from node(%s)",
                                      topic_info.topic().c_str(),
@@ -430,13 +576,14 @@ void Master::DoUnpublishTopic(const NodeInfo& node_info,
   TopicInfo topic_info;
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (!node->IsPublishingTopic(topic)) {
         reason = Reason::TopicNotPublishingOnNode;
       } else {
         topic_info = node->GetTopicInfo(topic);  // intend to copy
         node->UnregisterPublishingTopic(topic);
+        publishing_nodes_.erase(topic);
         reason = Reason::None;
       }
     } else {
@@ -445,6 +592,8 @@ void Master::DoUnpublishTopic(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::UNPUBLISH_TOPIC,
+                                  node_info, topic));
     DLOG(INFO) << "[UnpublishTopic]: "
                << base::StringPrintf("topic(%s) from node(%s)", topic.c_str(),
                                      node_info.name().c_str());
@@ -476,12 +625,13 @@ void Master::DoSubscribeTopic(const NodeInfo& node_info,
   base::WeakPtr<Node> node = FindNode(node_info);
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (node->IsSubsribingTopic(topic)) {
         reason = Reason::TopicAlreadySubscribingOnNode;
       } else {
         node->RegisterSubscribingTopic(topic);
+        subscribing_nodes_[topic].push_back(node.get());
         reason = Reason::None;
       }
     } else {
@@ -490,6 +640,8 @@ void Master::DoSubscribeTopic(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::SUBSCRIBE_TOPIC,
+                                  node_info, topic));
     DLOG(INFO) << "[SubscribeTopic]: "
                << base::StringPrintf("topic(%s) from node(%s)", topic.c_str(),
                                      node_info.name().c_str());
@@ -521,10 +673,11 @@ void Master::DoUnsubscribeTopic(const NodeInfo& node_info,
   base::WeakPtr<Node> node = FindNode(node_info);
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (node->IsSubsribingTopic(topic)) {
         node->UnregisterSubscribingTopic(topic);
+        RemoveFromIndex(&subscribing_nodes_, topic, node.get());
         reason = Reason::None;
       } else {
         reason = Reason::TopicNotSubscribingOnNode;
@@ -535,6 +688,8 @@ void Master::DoUnsubscribeTopic(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::UNSUBSCRIBE_TOPIC,
+                                  node_info, topic));
     DLOG(INFO) << "[UnsubscribeTopic]: "
                << base::StringPrintf("topic(%s) from node(%s)", topic.c_str(),
                                      node_info.name().c_str());
@@ -564,12 +719,13 @@ void Master::DoRegisterServiceClient(const NodeInfo& node_info,
   base::WeakPtr<Node> node = FindNode(node_info);
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (node->IsRequestingService(service)) {
         reason = Reason::ServiceAlreadyRequestingOnNode;
       } else {
         node->RegisterRequestingService(service);
+        requesting_nodes_[service].push_back(node.get());
         reason = Reason::None;
       }
     } else {
@@ -578,6 +734,8 @@ void Master::DoRegisterServiceClient(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::REGISTER_SERVICE_CLIENT,
+                                  node_info, service));
     DLOG(INFO) << "[RegisterServiceClient]: "
                << base::StringPrintf("service(%s) from node(%s)",
                                      service.c_str(), node_info.name().c_str());
@@ -589,14 +747,13 @@ void Master::DoRegisterServiceClient(const NodeInfo& node_info,
       Status s = ros_master_proxy.LookupService(ros_service, &ip_endpoint);
       std::move(callback).Run(s);
       if (s.ok()) {
-        MasterNotification master_notification;
-        ServiceInfo* service_info = master_notification.mutable_service_info();
-        service_info->set_service(service);
+        ServiceInfo service_info;
+        service_info.set_service(service);
         ChannelDef* channel_def =
-            service_info->mutable_service_source()->add_channel_defs();
+            service_info.mutable_service_source()->add_channel_defs();
         channel_def->set_type(ChannelDef::CHANNEL_TYPE_TCP);
         *channel_def->mutable_ip_endpoint() = ip_endpoint;
-        DoNotifyClient(node_info, master_notification);
+        QueueNotification(node_info.client_id(), service_info);
       }
     } else {
 #endif  // defined(HAS_ROS)
@@ -620,10 +777,11 @@ void Master::DoUnregisterServiceClient(const NodeInfo& node_info,
   base::WeakPtr<Node> node = FindNode(node_info);
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (node->IsRequestingService(service)) {
         node->UnregisterRequestingService(service);
+        RemoveFromIndex(&requesting_nodes_, service, node.get());
         reason = Reason::None;
       } else {
         reason = Reason::ServiceNotRequestingOnNode;
@@ -634,6 +792,8 @@ void Master::DoUnregisterServiceClient(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::UNREGISTER_SERVICE_CLIENT,
+                                  node_info, service));
     DLOG(INFO) << "[UnregisterServiceClient]: "
                << base::StringPrintf("service(%s) from node(%s)",
                                      service.c_str(), node_info.name().c_str());
@@ -650,26 +810,28 @@ void Master::DoRegisterServiceServer(const NodeInfo& node_info,
                                      const ServiceInfo& service_info,
                                      StatusOnceCallback callback) {
   DCHECK(thread_->task_runner()->BelongsToCurrentThread());
-  NodeFilter node_filter;
-  node_filter.set_serving_service(service_info.service());
-  std::vector<base::WeakPtr<Node>> server_nodes = FindNodes(node_filter);
   Reason reason;
-  if (server_nodes.size() > 0) {
-    reason = Reason::ServiceAlreadyServingOnNode;
-  } else {
-    base::WeakPtr<Node> node = FindNode(node_info);
-    base::AutoLock l(lock_);
-    {
-      if (node) {
-        node->RegisterServingService(service_info);
-        reason = Reason::None;
-      } else {
-        reason = Reason::UnknownFailed;
-      }
+  {
+    AutoWriteLock l(lock_);
+    Node* node = FindNodeLocked(node_info);
+    if (!node) {
+      reason = Reason::UnknownFailed;
+    } else if (node->IsServingService(service_info.service())) {
+      reason = Reason::ServiceAlreadyServingOnNode;
+    } else {
+      // Other nodes may serve the same service, and then the service clients
+      // balance the calls among them.
+      node->RegisterServingService(service_info);
+      serving_nodes_[service_info.service()].push_back(node);
+      reason = Reason::None;
     }
   }
 
   if (reason == Reason::None) {
+    MasterJournalEntry entry =
+        NewJournalEntry(MasterJournalEntry::REGISTER_SERVICE_SERVER, node_info);
+    *entry.mutable_service_info() = service_info;
+    AppendJournal(entry);
     DLOG(INFO) << "[RegisterServiceServer]: "
                << base::StringPrintf("service(%s) from node(%s)",
                                      service_info.service().c_str(),
@@ -705,13 +867,14 @@ void Master::DoUnregisterServiceServer(const NodeInfo& node_info,
   ServiceInfo service_info;
   Reason reason;
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     if (node) {
       if (!node->IsServingService(service)) {
         reason = Reason::ServiceNotServingOnNode;
       } else {
         service_info = node->GetServiceInfo(service);  // intend to copy
         node->UnregisterServingService(service);
+        RemoveFromIndex(&serving_nodes_, service, node.get());
         reason = Reason::None;
       }
     } else {
@@ -720,6 +883,8 @@ void Master::DoUnregisterServiceServer(const NodeInfo& node_info,
   }
 
   if (reason == Reason::None) {
+    AppendJournal(NewJournalEntry(MasterJournalEntry::UNREGISTER_SERVICE_SERVER,
+                                  node_info, service));
     DLOG(INFO) << "[UnregisterServiceServer]: "
                << base::StringPrintf("service(%s) from node(%s)",
                                      service.c_str(), node_info.name().c_str());
@@ -778,119 +943,172 @@ void Master::UnregisterRosTopicsAndServices(
 #endif  // defined(HAS_ROS)
 
 base::WeakPtr<Node> Master::FindNode(const NodeInfo& node_info) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
+  Node* node = FindNodeLocked(node_info);
+  if (!node) return nullptr;
+  return node->AsWeakPtr();
+}
+
+Node* Master::FindNodeLocked(const NodeInfo& node_info) {
   auto it = client_map_.find(node_info.client_id());
   if (it == client_map_.end()) return nullptr;
-  return it->second->FindNode(node_info);
+  return it->second->FindNode(node_info).get();
 }
 
 std::vector<base::WeakPtr<Node>> Master::FindNodes(
     const NodeFilter& node_filter) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
   std::vector<base::WeakPtr<Node>> nodes;
-  auto it = client_map_.begin();
-  if (!node_filter.publishing_topic().empty() ||
-      !node_filter.serving_service().empty()) {
-    while (it != client_map_.end()) {
-      std::vector<base::WeakPtr<Node>> tmp_nodes =
-          it->second->FindNodes(node_filter);
-      nodes.insert(nodes.end(), tmp_nodes.begin(), tmp_nodes.end());
-      // Because there can be only one publishing node or server node.
-      if (nodes.size() > 0) return nodes;
-      it++;
-    }
-  } else {
-    while (it != client_map_.end()) {
-      std::vector<base::WeakPtr<Node>> tmp_nodes =
-          it->second->FindNodes(node_filter);
-      nodes.insert(nodes.end(), tmp_nodes.begin(), tmp_nodes.end());
-      it++;
+  if (!node_filter.all()) {
+    if (!node_filter.publishing_topic().empty()) {
+      auto it = publishing_nodes_.find(node_filter.publishing_topic());
+      if (it != publishing_nodes_.end())
+        nodes.push_back(it->second->AsWeakPtr());
+      return nodes;
+    } else if (!node_filter.subscribing_topic().empty()) {
+      auto it = subscribing_nodes_.find(node_filter.subscribing_topic());
+      if (it != subscribing_nodes_.end()) {
+        for (Node* node : it->second) nodes.push_back(node->AsWeakPtr());
+      }
+      return nodes;
+    } else if (!node_filter.requesting_service().empty()) {
+      auto it = requesting_nodes_.find(node_filter.requesting_service());
+      if (it != requesting_nodes_.end()) {
+        for (Node* node : it->second) nodes.push_back(node->AsWeakPtr());
+      }
+      return nodes;
+    } else if (!node_filter.serving_service().empty()) {
+      auto it = serving_nodes_.find(node_filter.serving_service());
+      if (it != serving_nodes_.end()) {
+        for (Node* node : it->second) nodes.push_back(node->AsWeakPtr());
+      }
+      return nodes;
+    } else if (node_filter.name().empty() && node_filter.watcher()) {
+      if (watcher_node_) nodes.push_back(watcher_node_->AsWeakPtr());
+      return nodes;
     }
   }
+
+  for (auto it = client_map_.begin(); it != client_map_.end(); ++it) {
+    std::vector<base::WeakPtr<Node>> tmp_nodes =
+        it->second->FindNodes(node_filter);
+    nodes.insert(nodes.end(), tmp_nodes.begin(), tmp_nodes.end());
+  }
   return nodes;
 }
 
 std::vector<TopicInfo> Master::FindTopicInfos(const TopicFilter& topic_filter) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
   std::vector<TopicInfo> topic_infos;
-  auto it = client_map_.begin();
-  if (!topic_filter.topic().empty()) {
-    while (it != client_map_.end()) {
-      std::vector<TopicInfo> tmp_topic_infos =
-          it->second->FindTopicInfos(topic_filter);
-      topic_infos.insert(topic_infos.begin(), tmp_topic_infos.begin(),
-                         tmp_topic_infos.end());
-      if (topic_infos.size() > 0) return topic_infos;
-      it++;
-    }
-  } else {
-    while (it != client_map_.end()) {
-      std::vector<TopicInfo> tmp_topic_infos =
-          it->second->FindTopicInfos(topic_filter);
-      topic_infos.insert(topic_infos.begin(), tmp_topic_infos.begin(),
-                         tmp_topic_infos.end());
-      it++;
+  if (topic_filter.all()) {
+    topic_infos.reserve(publishing_nodes_.size());
+    for (auto& publishing_node : publishing_nodes_) {
+      topic_infos.push_back(
+          publishing_node.second->GetTopicInfo(publishing_node.first));
     }
+  } else if (!topic_filter.topic().empty()) {
+    auto it = publishing_nodes_.find(topic_filter.topic());
+    if (it != publishing_nodes_.end())
+      topic_infos.push_back(it->second->GetTopicInfo(it->first));
   }
   return topic_infos;
 }
 
 std::vector<ServiceInfo> Master::FindServiceInfos(
     const ServiceFilter& service_filter) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
   std::vector<ServiceInfo> service_infos;
-  auto it = client_map_.begin();
-  if (!service_filter.service().empty()) {
-    while (it != client_map_.end()) {
-      std::vector<ServiceInfo> tmp_service_infos =
-          it->second->FindServiceInfos(service_filter);
-      service_infos.insert(service_infos.begin(), tmp_service_infos.begin(),
-                           tmp_service_infos.end());
-      if (service_infos.size() > 0) return service_infos;
-      it++;
+  if (service_filter.all()) {
+    service_infos.reserve(serving_nodes_.size());
+    for (auto& serving_node : serving_nodes_) {
+      for (Node* node : serving_node.second) {
+        service_infos.push_back(node->GetServiceInfo(serving_node.first));
+      }
     }
-  } else {
-    while (it != client_map_.end()) {
-      std::vector<ServiceInfo> tmp_service_infos =
-          it->second->FindServiceInfos(service_filter);
-      service_infos.insert(service_infos.begin(), tmp_service_infos.begin(),
-                           tmp_service_infos.end());
-      it++;
+  } else if (!service_filter.service().empty()) {
+    auto it = serving_nodes_.find(service_filter.service());
+    if (it != serving_nodes_.end()) {
+      for (Node* node : it->second) {
+        service_infos.push_back(node->GetServiceInfo(it->first));
+      }
     }
   }
   return service_infos;
 }
 
 void Master::AddClient(uint32_t id, std::unique_ptr<Client> client) {
+  MasterJournalEntry entry;
+  entry.set_type(MasterJournalEntry::ADD_CLIENT);
+  *entry.mutable_client_info() = client->client_info();
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
+    auto it = client_map_.find(id);
+    if (it != client_map_.end()) {
+      NodeFilter node_filter;
+      node_filter.set_all(true);
+      for (auto& node : it->second->FindNodes(node_filter)) {
+        UnindexNodeLocked(node.get());
+      }
+    }
     client_map_.insert_or_assign(id, std::move(client));
     DLOG(INFO) << "Master::AddClient() " << id;
   }
+  AppendJournal(entry);
 }
 
 void Master::RemoveClient(const ClientInfo& client_info) {
-  uint32_t id = client_info.id();
+  RemoveClients({client_info});
+}
 
+void Master::RemoveClients(const std::vector<ClientInfo>& client_infos) {
+  std::vector<ClientInfo> removed_client_infos;
   std::vector<TopicInfo> publishing_topic_infos;
   std::vector<ServiceInfo> serving_service_infos;
 #if defined(HAS_ROS)
   std::vector<std::string> subscribing_topics;
 #endif
   {
-    base::AutoLock l(lock_);
-    auto it = client_map_.find(id);
+    AutoWriteLock l(lock_);
+    NodeFilter node_filter;
+    node_filter.set_all(true);
     TopicFilter topic_filter;
     topic_filter.set_all(true);
-    publishing_topic_infos = it->second->FindTopicInfos(topic_filter);
     ServiceFilter service_filter;
     service_filter.set_all(true);
-    serving_service_infos = it->second->FindServiceInfos(service_filter);
+    for (auto& client_info : client_infos) {
+      auto it = client_map_.find(client_info.id());
+      // The client could be removed already by either Gc() or its heart beat
+      // listener, and even its id could be given to a new client since then.
+      if (it == client_map_.end() ||
+          !IsSameClient(it->second->client_info(), client_info)) {
+        continue;
+      }
+      for (auto& node : it->second->FindNodes(node_filter)) {
+        UnindexNodeLocked(node.get());
+      }
+      std::vector<TopicInfo> topic_infos =
+          it->second->FindTopicInfos(topic_filter);
+      publishing_topic_infos.insert(publishing_topic_infos.end(),
+                                    topic_infos.begin(), topic_infos.end());
+      std::vector<ServiceInfo> service_infos =
+          it->second->FindServiceInfos(service_filter);
+      serving_service_infos.insert(serving_service_infos.end(),
+                                   service_infos.begin(), service_infos.end());
 #if defined(HAS_ROS)
-    subscribing_topics = it->second->FindAllSubscribingTopics();
+      std::vector<std::string> topics = it->second->FindAllSubscribingTopics();
+      subscribing_topics.insert(subscribing_topics.end(), topics.begin(),
+                                topics.end());
 #endif
-    client_map_.erase(it);
-    DLOG(INFO) << "Master::RemoveClient() " << id;
+      client_map_.erase(it);
+      removed_client_infos.push_back(client_info);
+      DLOG(INFO) << "Master::RemoveClient() " << client_info.id();
+    }
+  }
+  for (auto& client_info : removed_client_infos) {
+    MasterJournalEntry entry;
+    entry.set_type(MasterJournalEntry::REMOVE_CLIENT);
+    *entry.mutable_client_info() = client_info;
+    AppendJournal(entry);
   }
 
   for (auto& publishing_topic_info : publishing_topic_infos) {
@@ -901,8 +1119,7 @@ void Master::RemoveClient(const ClientInfo& client_info) {
     serving_service_info.set_status(ServiceInfo::UNREGISTERED);
   }
 
-  NotifyAllSubscribers(publishing_topic_infos);
-  NotifyAllServiceClients(serving_service_infos);
+  NotifyUnregistered(publishing_topic_infos, serving_service_infos);
 
 #if defined(HAS_ROS)
   UnregisterRosTopicsAndServices(publishing_topic_infos, subscribing_topics,
@@ -911,15 +1128,18 @@ void Master::RemoveClient(const ClientInfo& client_info) {
 }
 
 void Master::AddNode(std::unique_ptr<Node> node) {
+  MasterJournalEntry entry =
+      NewJournalEntry(MasterJournalEntry::ADD_NODE, node->node_info());
   uint32_t id = node->node_info().client_id();
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     auto it = client_map_.find(id);
-    if (it != client_map_.end()) {
-      DLOG(INFO) << "Master::AddNode() " << node->node_info().name();
-      it->second->AddNode(std::move(node));
-    }
+    if (it == client_map_.end()) return;
+    DLOG(INFO) << "Master::AddNode() " << node->node_info().name();
+    if (node->node_info().watcher()) watcher_node_ = node.get();
+    it->second->AddNode(std::move(node));
   }
+  AppendJournal(entry);
 }
 
 void Master::RemoveNode(const NodeInfo& node_info) {
@@ -930,7 +1150,7 @@ void Master::RemoveNode(const NodeInfo& node_info) {
   std::vector<std::string> subscribing_topics;
 #endif  // defined(HAS_ROS)
   {
-    base::AutoLock l(lock_);
+    AutoWriteLock l(lock_);
     auto it = client_map_.find(id);
     if (it != client_map_.end()) {
       base::WeakPtr<Node> node = it->second->FindNode(node_info);
@@ -940,11 +1160,13 @@ void Master::RemoveNode(const NodeInfo& node_info) {
 #if defined(HAS_ROS)
         subscribing_topics = node->AllSubscribingTopics();
 #endif  // defined(HAS_ROS)
+        UnindexNodeLocked(node.get());
       }
       it->second->RemoveNode(node_info);
       DLOG(INFO) << "Master::RemoveNode() " << node_info.name();
     }
   }
+  AppendJournal(NewJournalEntry(MasterJournalEntry::REMOVE_NODE, node_info));
 
   for (auto& publishing_topic_info : publishing_topic_infos) {
     publishing_topic_info.set_status(TopicInfo::UNREGISTERED);
@@ -954,8 +1176,7 @@ void Master::RemoveNode(const NodeInfo& node_info) {
     serving_service_info.set_status(ServiceInfo::UNREGISTERED);
   }
 
-  NotifyAllSubscribers(publishing_topic_infos);
-  NotifyAllServiceClients(serving_service_infos);
+  NotifyUnregistered(publishing_topic_infos, serving_service_infos);
 
 #if defined(HAS_ROS)
   UnregisterRosTopicsAndServices(publishing_topic_infos, subscribing_topics,
@@ -963,13 +1184,132 @@ void Master::RemoveNode(const NodeInfo& node_info) {
 #endif  // defined(HAS_ROS)
 }
 
+void Master::UnindexNodeLocked(Node* node) {
+  for (auto& topic_info : node->AllPublishingTopicInfos()) {
+    publishing_nodes_.erase(topic_info.topic());
+  }
+  for (auto& topic : node->AllSubscribingTopics()) {
+    RemoveFromIndex(&subscribing_nodes_, topic, node);
+  }
+  for (auto& service_info : node->AllServingServiceInfos()) {
+    RemoveFromIndex(&serving_nodes_, service_info.service(), node);
+  }
+  for (auto& service : node->AllRequestingServices()) {
+    RemoveFromIndex(&requesting_nodes_, service, node);
+  }
+  if (watcher_node_ == node) watcher_node_ = nullptr;
+}
+
+void Master::AppendJournal(const MasterJournalEntry& entry) {
+  if (!state_store_) return;
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  state_store_thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&Master::DoAppendJournal, base::Unretained(this), entry));
+}
+
+void Master::DoAppendJournal(const MasterJournalEntry& entry) {
+  DCHECK(state_store_thread_->task_runner()->BelongsToCurrentThread());
+  Status s = state_store_->Append(entry);
+  LOG_IF(ERROR, !s.ok()) << "Failed to persist the state of master: " << s;
+  if (!s.ok() || snapshot_requested_ || !state_store_->ShouldWriteSnapshot())
+    return;
+
+  // The snapshot is taken on |thread_|, which has made every change journaled
+  // so far, and the changes made after it are journaled after the snapshot is
+  // written, since both are posted to this thread in order.
+  snapshot_requested_ = true;
+  thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&Master::WriteSnapshot, base::Unretained(this)));
+}
+
+void Master::DoWriteSnapshot(const MasterSnapshot& snapshot) {
+  DCHECK(state_store_thread_->task_runner()->BelongsToCurrentThread());
+  Status s = state_store_->WriteSnapshot(snapshot);
+  LOG_IF(ERROR, !s.ok()) << "Failed to persist the state of master: " << s;
+  snapshot_requested_ = false;
+}
+
+void Master::WriteSnapshot() {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  state_store_thread_->task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&Master::DoWriteSnapshot,
+                                base::Unretained(this), TakeSnapshot()));
+}
+
+MasterSnapshot Master::TakeSnapshot() {
+  AutoReadLock l(lock_);
+  MasterSnapshot snapshot;
+  NodeFilter node_filter;
+  node_filter.set_all(true);
+  for (auto& it : client_map_) {
+    ClientState* client_state = snapshot.add_client_states();
+    *client_state->mutable_client_info() = it.second->client_info();
+    for (auto& node : it.second->FindNodes(node_filter)) {
+      NodeState* node_state = client_state->add_node_states();
+      *node_state->mutable_node_info() = node->node_info();
+      for (auto& topic_info : node->AllPublishingTopicInfos()) {
+        *node_state->add_publishing_topic_infos() = topic_info;
+      }
+      for (auto& topic : node->AllSubscribingTopics()) {
+        node_state->add_subscribing_topics(topic);
+      }
+      for (auto& service_info : node->AllServingServiceInfos()) {
+        *node_state->add_serving_service_infos() = service_info;
+      }
+      for (auto& service : node->AllRequestingServices()) {
+        node_state->add_requesting_services(service);
+      }
+    }
+  }
+  return snapshot;
+}
+
+void Master::RestoreSnapshot(const MasterSnapshot& snapshot) {
+  AutoWriteLock l(lock_);
+  for (const ClientState& client_state : snapshot.client_states()) {
+    std::unique_ptr<Client> client =
+        Client::RestoreClient(client_state.client_info());
+    if (!client) continue;
+
+    for (const NodeState& node_state : client_state.node_states()) {
+      std::unique_ptr<Node> node = Node::NewNode(node_state.node_info());
+      if (!node) continue;
+
+      for (const TopicInfo& topic_info : node_state.publishing_topic_infos()) {
+        node->RegisterPublishingTopic(topic_info);
+        publishing_nodes_[topic_info.topic()] = node.get();
+      }
+      for (const std::string& topic : node_state.subscribing_topics()) {
+        node->RegisterSubscribingTopic(topic);
+        subscribing_nodes_[topic].push_back(node.get());
+      }
+      for (const ServiceInfo& service_info :
+           node_state.serving_service_infos()) {
+        node->RegisterServingService(service_info);
+        serving_nodes_[service_info.service()].push_back(node.get());
+      }
+      for (const std::string& service : node_state.requesting_services()) {
+        node->RegisterRequestingService(service);
+        requesting_nodes_[service].push_back(node.get());
+      }
+      if (node->node_info().watcher()) watcher_node_ = node.get();
+      client->AddNode(std::move(node));
+    }
+    DLOG(INFO) << "Master::RestoreSnapshot() " << client->client_info().id();
+    client_map_.insert_or_assign(client->client_info().id(),
+                                 std::move(client));
+  }
+}
+
 bool Master::CheckIfClientExists(uint32_t id) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
   return client_map_.find(id) != client_map_.end();
 }
 
 bool Master::CheckIfNodeExists(const NodeInfo& node_info) {
-  base::AutoLock l(lock_);
+  AutoReadLock l(lock_);
   auto it = client_map_.find(node_info.client_id());
   if (it == client_map_.end()) return false;
   return it->second->HasNode(node_info);
@@ -980,11 +1320,14 @@ void Master::DoNotifyClient(const NodeInfo& node_info,
   // TODO(chokobole): Try not make one channel for each |master_notification|.
   auto channel = ChannelFactory::NewChannel(ChannelDef::CHANNEL_TYPE_TCP);
 
+  // A notification can hold any number of infos, so the buffer grows to fit
+  // it.
   channel->SetSendBufferSize(kMasterNotificationBytes);
+  channel->SetDynamicSendBuffer(true);
 
   ChannelSource channel_source;
   {
-    base::AutoLock l(lock_);
+    AutoReadLock l(lock_);
     auto it = client_map_.find(node_info.client_id());
     if (it == client_map_.end()) return;
     channel_source =
@@ -1015,10 +1358,8 @@ void Master::NotifySubscriber(const std::string& topic,
   if (publishing_nodes.size() > 0) {
     base::WeakPtr<Node> publishing_node = publishing_nodes[0];
     if (publishing_node) {
-      MasterNotification master_notification;
-      *master_notification.mutable_topic_info() =
-          publishing_node->GetTopicInfo(topic);
-      DoNotifyClient(subscribing_node_info, master_notification);
+      QueueNotification(subscribing_node_info.client_id(),
+                        publishing_node->GetTopicInfo(topic));
     }
   }
 }
@@ -1040,17 +1381,9 @@ void Master::NotifyAllSubscribers(const TopicInfo& topic_info) {
   subscribing_nodes.insert(subscribing_nodes.end(), watcher_nodes.begin(),
                            watcher_nodes.end());
 
-  MasterNotification master_notification;
-  *master_notification.mutable_topic_info() = topic_info;
   for (auto& subscribing_node : subscribing_nodes) {
     if (subscribing_node)
-      DoNotifyClient(subscribing_node->node_info(), master_notification);
-  }
-}
-
-void Master::NotifyAllSubscribers(const std::vector<TopicInfo>& topic_infos) {
-  for (auto& topic_info : topic_infos) {
-    NotifyAllSubscribers(topic_info);
+      QueueNotification(subscribing_node->node_info().client_id(), topic_info);
   }
 }
 
@@ -1066,13 +1399,10 @@ void Master::NotifyServiceClient(const std::string& service,
   NodeFilter node_filter;
   node_filter.set_serving_service(service);
   std::vector<base::WeakPtr<Node>> server_nodes = FindNodes(node_filter);
-  if (server_nodes.size() > 0) {
-    base::WeakPtr<Node> server_node = server_nodes[0];
+  for (auto& server_node : server_nodes) {
     if (server_node) {
-      MasterNotification master_notification;
-      *master_notification.mutable_service_info() =
-          server_node->GetServiceInfo(service);
-      DoNotifyClient(client_node_info, master_notification);
+      QueueNotification(client_node_info.client_id(),
+                        server_node->GetServiceInfo(service));
     }
   }
 }
@@ -1088,20 +1418,56 @@ void Master::NotifyAllServiceClients(const ServiceInfo& service_info) {
   NodeFilter node_filter;
   node_filter.set_requesting_service(service_info.service());
   std::vector<base::WeakPtr<Node>> client_nodes = FindNodes(node_filter);
-  node_filter.Clear();
 
-  MasterNotification master_notification;
-  *master_notification.mutable_service_info() = service_info;
   for (auto& client_node : client_nodes) {
     if (client_node)
-      DoNotifyClient(client_node->node_info(), master_notification);
+      QueueNotification(client_node->node_info().client_id(), service_info);
   }
 }
 
-void Master::NotifyAllServiceClients(
-    const std::vector<ServiceInfo>& service_infos) {
-  for (auto& service_info : service_infos) {
-    NotifyAllServiceClients(service_info);
+void Master::NotifyUnregistered(const std::vector<TopicInfo>& topic_infos,
+                                const std::vector<ServiceInfo>& service_infos) {
+  if (topic_infos.empty() && service_infos.empty()) return;
+  if (!thread_->task_runner()->BelongsToCurrentThread()) {
+    thread_->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&Master::NotifyUnregistered,
+                                  base::Unretained(this), topic_infos,
+                                  service_infos));
+    return;
+  }
+  std::vector<std::pair<uint32_t, const TopicInfo*>> topic_notifications;
+  std::vector<std::pair<uint32_t, const ServiceInfo*>> service_notifications;
+  {
+    AutoReadLock l(lock_);
+    for (auto& topic_info : topic_infos) {
+      auto it = subscribing_nodes_.find(topic_info.topic());
+      if (it != subscribing_nodes_.end()) {
+        for (Node* node : it->second) {
+          topic_notifications.emplace_back(node->node_info().client_id(),
+                                           &topic_info);
+        }
+      }
+      if (watcher_node_) {
+        topic_notifications.emplace_back(
+            watcher_node_->node_info().client_id(), &topic_info);
+      }
+    }
+    for (auto& service_info : service_infos) {
+      auto it = requesting_nodes_.find(service_info.service());
+      if (it == requesting_nodes_.end()) continue;
+      for (Node* node : it->second) {
+        service_notifications.emplace_back(node->node_info().client_id(),
+                                           &service_info);
+      }
+    }
+  }
+
+  for (auto& topic_notification : topic_notifications) {
+    QueueNotification(topic_notification.first, *topic_notification.second);
+  }
+  for (auto& service_notification : service_notifications) {
+    QueueNotification(service_notification.first,
+                      *service_notification.second);
   }
 }
 
@@ -1116,41 +1482,212 @@ void Master::NotifyWatcher() {
     base::WeakPtr<Node> watcher_node = watcher_nodes[0];
     if (watcher_node) {
       for (TopicInfo& topic_info : topic_infos) {
-        MasterNotification master_notification;
-        *master_notification.mutable_topic_info() = topic_info;
-        DoNotifyClient(watcher_node->node_info(), master_notification);
+        QueueNotification(watcher_node->node_info().client_id(), topic_info);
       }
     }
   }
 }
 
+Master::PendingNotification::PendingNotification() = default;
+
+Master::PendingNotification::~PendingNotification() = default;
+
+void Master::QueueNotification(uint32_t client_id,
+                               const TopicInfo& topic_info) {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  PendingNotification& pending_notification =
+      pending_notifications_[client_id];
+  CoalesceInfo(&pending_notification.topic_infos,
+               &pending_notification.topic_indexes, topic_info.topic(),
+               topic_info);
+  ScheduleFlushNotifications();
+}
+
+void Master::QueueNotification(uint32_t client_id,
+                               const ServiceInfo& service_info) {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  PendingNotification& pending_notification =
+      pending_notifications_[client_id];
+  CoalesceInfo(&pending_notification.service_infos,
+               &pending_notification.service_indexes,
+               ServiceServerKey(service_info), service_info);
+  ScheduleFlushNotifications();
+}
+
+void Master::ScheduleFlushNotifications() {
+  if (flush_notifications_scheduled_) return;
+  flush_notifications_scheduled_ = true;
+  thread_->task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&Master::FlushNotifications, base::Unretained(this)),
+      notification_window_);
+}
+
+void Master::FlushNotifications() {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  flush_notifications_scheduled_ = false;
+  base::flat_map<uint32_t, PendingNotification> pending_notifications;
+  pending_notifications.swap(pending_notifications_);
+  for (auto& it : pending_notifications) {
+    MasterNotification master_notification;
+    for (auto& topic_info : it.second.topic_infos) {
+      *master_notification.add_topic_infos() = std::move(topic_info);
+    }
+    for (auto& service_info : it.second.service_infos) {
+      *master_notification.add_service_infos() = std::move(service_info);
+    }
+    NodeInfo node_info;
+    node_info.set_client_id(it.first);
+    DoNotifyClient(node_info, master_notification);
+  }
+}
+
 void Master::OnConnetToMasterNotificationWatcher(
     std::unique_ptr<Channel> channel,
     const MasterNotification& master_notification, Status s) {
   if (s.ok()) {
     MessageSender<MasterNotification> sender(channel.get());
-    sender.SendMessage(master_notification, base::BindOnce([](Status s) {
-                         LOG_IF(ERROR, !s.ok())
-                             << "Failed to send message: " << s;
-                       }));
+    // |channel| is kept until the message is sent.
+    sender.SendMessage(
+        master_notification,
+        base::BindOnce(
+            [](std::unique_ptr<Channel> channel, Status s) {
+              LOG_IF(ERROR, !s.ok()) << "Failed to send message: " << s;
+            },
+            base::Passed(&channel)));
   } else {
     LOG(ERROR) << "Failed to connect master notification channel: " << s;
   }
 }
 
+void Master::ScheduleGc() {
+  thread_->task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&Master::DoScheduledGc, base::Unretained(this)),
+      gc_interval_);
+}
+
+void Master::DoScheduledGc() {
+  // |heart_beat_listener_| checks the heart beats every tick by itself.
+  if (!check_heart_beat_) DoGc(base::DoNothing());
+  ScheduleGc();
+}
+
+void Master::DoGc(base::OnceClosure callback) {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  if (check_heart_beat_) {
+    // Every client is tracked by its heart beats, so there is no need to
+    // connect to each of them.
+    if (heart_beat_listener_) heart_beat_listener_->CheckNow();
+    std::move(callback).Run();
+    return;
+  }
+
+  gc_callbacks_.push_back(std::move(callback));
+  // The pass in progress will run |callback| as well.
+  if (gc_callbacks_.size() > 1) return;
+
+  {
+    AutoReadLock l(lock_);
+    for (auto& it : client_map_) {
+      gc_client_infos_.push_back(it.second->client_info());
+    }
+  }
+  gc_offset_ = 0;
+  DoGcSlice();
+}
+
+void Master::DoGcSlice() {
+  DCHECK(thread_->task_runner()->BelongsToCurrentThread());
+  // Hold the slice open until every probe of it is started, in case a probe
+  // fails right away.
+  gc_probes_++;
+  size_t end = std::min(gc_offset_ + kGcSliceSize, gc_client_infos_.size());
+  for (; gc_offset_ < end; ++gc_offset_) {
+    ProbeClient(gc_client_infos_[gc_offset_]);
+  }
+  OnProbeClientDone();
+}
+
+void Master::ProbeClient(const ClientInfo& client_info) {
+  const ChannelSource& channel_source =
+      client_info.master_notification_watcher_source();
+  if (channel_source.channel_defs_size() != 1) return;
+
+  // The client is reachable if the master can connect to it to notify. The
+  // watcher on the client just accepts again once the channel is closed
+  // without any message.
+  std::unique_ptr<Channel> channel =
+      ChannelFactory::NewChannel(ChannelDef::CHANNEL_TYPE_TCP);
+  Channel* channel_ptr = channel.get();
+  uint64_t probe_id = next_gc_probe_id_++;
+  gc_probe_channels_[probe_id] = std::move(channel);
+  gc_probes_++;
+  thread_->task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&Master::OnProbeClient, base::Unretained(this), probe_id,
+                     client_info,
+                     errors::DeadlineExceeded("Timed out to connect.")),
+      kGcProbeTimeout);
+  channel_ptr->Connect(
+      channel_source.channel_defs(0),
+      base::BindOnce(&Master::OnProbeClient, base::Unretained(this), probe_id,
+                     client_info));
+}
+
+void Master::OnProbeClient(uint64_t probe_id, const ClientInfo& client_info,
+                           Status s) {
+  // Either the connection or the timeout comes first, and the other is
+  // ignored.
+  auto it = gc_probe_channels_.find(probe_id);
+  if (it == gc_probe_channels_.end()) return;
+  // This can be called back from the channel, so it is deleted later. Once
+  // it is deleted, a pending connection is cancelled.
+  thread_->task_runner()->DeleteSoon(FROM_HERE, std::move(it->second));
+  gc_probe_channels_.erase(it);
+
+  if (!s.ok()) {
+    DLOG(INFO) << "Master::Gc() unreachable client " << client_info.id();
+    gc_unreachable_client_infos_.push_back(client_info);
+  }
+  OnProbeClientDone();
+}
+
+void Master::OnProbeClientDone() {
+  DCHECK_GT(gc_probes_, 0u);
+  if (--gc_probes_ > 0) return;
+
+  if (gc_offset_ < gc_client_infos_.size()) {
+    thread_->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&Master::DoGcSlice, base::Unretained(this)));
+    return;
+  }
+
+  std::vector<ClientInfo> unreachable_client_infos;
+  unreachable_client_infos.swap(gc_unreachable_client_infos_);
+  gc_client_infos_.clear();
+  RemoveClients(unreachable_client_infos);
+
+  std::vector<base::OnceClosure> callbacks;
+  callbacks.swap(gc_callbacks_);
+  for (auto& callback : callbacks) std::move(callback).Run();
+}
+
 void Master::SetCheckHeartBeatForTesting(bool check_heart_beat) {
   check_heart_beat_ = check_heart_beat;
 }
 
 void Master::DoCheckHeartBeat(const ClientInfo& client_info) {
   if (!check_heart_beat_) return;
-  // |listner| is released inside.
-  HeartBeatListener* listener = new HeartBeatListener(
-      client_info,
-      base::BindOnce(&Master::RemoveClient, base::Unretained(this)));
-  listener->StartCheckHeartBeat();
+  if (!heart_beat_listener_) {
+    heart_beat_listener_ = std::make_unique<HeartBeatListener>(
+        base::BindRepeating(&Master::RemoveClient, base::Unretained(this)));
+  }
+  heart_beat_listener_->StartCheckHeartBeat(client_info);
 }
 
+void Master::StopCheckHeartBeat() { heart_beat_listener_.reset(); }
+
 #undef CHECK_CLIENT_EXISTS
 #undef CHECK_NODE_EXISTS
 
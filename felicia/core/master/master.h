@@ -6,27 +6,39 @@
 #define FELICIA_CORE_MASTER_MASTER_H_
 
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "third_party/chromium/base/callback.h"
 #include "third_party/chromium/base/containers/flat_map.h"
 #include "third_party/chromium/base/macros.h"
-#include "third_party/chromium/base/synchronization/lock.h"
 #include "third_party/chromium/base/thread_annotations.h"
 #include "third_party/chromium/base/threading/thread.h"
 #include "third_party/chromium/base/time/time.h"
 
 #include "felicia/core/channel/channel.h"
+#include "felicia/core/lib/synchronization/read_write_lock.h"
 #include "felicia/core/master/bytes_constants.h"
 #include "felicia/core/master/client.h"
 #include "felicia/core/master/errors.h"
+#include "felicia/core/master/master_state_store.h"
 #include "felicia/core/protobuf/master.pb.h"
 
 namespace felicia {
 
+class HeartBeatListener;
+
 class Master {
  public:
   ~Master();
 
+  // Persists the registry under |dir| from now on. If it was persisted there
+  // before, it is restored, and then the restored clients are checked by
+  // heart beat once Run() is called, so that clients don't have to register
+  // again after the master restarts. This should be called before Run().
+  Status LoadState(const base::FilePath& dir);
+
   void Run();
   void Stop();
 
@@ -36,9 +48,18 @@ class Master {
 #include "felicia/core/master/rpc/master_method_list.h"
 #undef MASTER_METHOD
 
-  void Gc();
+  // Removes the clients which are no longer alive, along with their nodes,
+  // topics and services, and notifies the others of them. While heart beats
+  // are checked, the clients whose heart beats are overdue are removed
+  // without waiting for the next tick of |heart_beat_listener_|. Otherwise,
+  // the clients are probed in slices on the master thread, so that other
+  // requests aren't blocked while it runs, and the unreachable ones are
+  // removed. |callback| is called when the pass is done. Without heart beats,
+  // this also runs every FEL_MASTER_GC_INTERVAL milliseconds.
+  void Gc(base::OnceClosure callback);
 
  private:
+  friend class MasterBenchmark;
   friend class MasterServer;
   friend class MasterTest;
   friend class RosMasterProxy;
@@ -93,6 +114,8 @@ class Master {
   // Find the node whose |node_info| is same with a given |node_info|. This is
   // thread-safe.
   base::WeakPtr<Node> FindNode(const NodeInfo& node_info);
+  Node* FindNodeLocked(const NodeInfo& node_info)
+      SHARED_LOCKS_REQUIRED(lock_);
   // Find the nodes which meet the given condition |node_filter|. This is
   // thread-safe.
   std::vector<base::WeakPtr<Node>> FindNodes(const NodeFilter& node_filter);
@@ -109,11 +132,28 @@ class Master {
   // Remove the Client whose client_info is same with |client_info|. This is
   // thread-safe.
   void RemoveClient(const ClientInfo& client_info);
+  // Remove the Clients in |client_infos| at once. This is thread-safe.
+  void RemoveClients(const std::vector<ClientInfo>& client_infos);
   // Add the Node to the appropriate Client. This is thread-safe.
   void AddNode(std::unique_ptr<Node> node);
   // Remove the Node from the appropriate Client, which is recored at
   // |node_info|. This is thread-safe.
   void RemoveNode(const NodeInfo& node_info);
+  // Append |entry| to |state_store_| if any, and write a snapshot when the
+  // journal is long enough. This should be called on |thread_| after the
+  // change of |entry| is made, without holding |lock_|. The files are
+  // written on |state_store_thread_|, not to block |thread_|.
+  void AppendJournal(const MasterJournalEntry& entry) LOCKS_EXCLUDED(lock_);
+  // These run on |state_store_thread_|.
+  void DoAppendJournal(const MasterJournalEntry& entry);
+  void DoWriteSnapshot(const MasterSnapshot& snapshot);
+  // Copies the registry into a snapshot on |thread_| and hands it to
+  // |state_store_thread_| to write.
+  void WriteSnapshot();
+  MasterSnapshot TakeSnapshot() LOCKS_EXCLUDED(lock_);
+  void RestoreSnapshot(const MasterSnapshot& snapshot) LOCKS_EXCLUDED(lock_);
+  // Remove every topic and service of |node| from the indexes below.
+  void UnindexNodeLocked(Node* node) EXCLUSIVE_LOCKS_REQUIRED(lock_);
   // Returns true when a client exists with a given |id|. This is thread-safe.
   bool CheckIfClientExists(uint32_t id);
   // Returns true when node whose |node_info| is same with a given |node_info|.
@@ -123,20 +163,30 @@ class Master {
   void DoNotifyClient(const NodeInfo& node_info,
                       const MasterNotification& master_notification);
 
+  // Changes are not sent to a client right away, but queued for
+  // FEL_MASTER_NOTIFICATION_WINDOW milliseconds and then sent in a single
+  // notification. If a topic or a server of a service changes more than once
+  // in the meantime, only the latest change is sent.
+  void QueueNotification(uint32_t client_id, const TopicInfo& topic_info);
+  void QueueNotification(uint32_t client_id, const ServiceInfo& service_info);
+  void ScheduleFlushNotifications();
+  void FlushNotifications();
+
   // Notify subscriber about TopicInfo which publishes |topic|.
   void NotifySubscriber(const std::string& topic,
                         const NodeInfo& subscribing_node_info);
   // Notify all the subscribers about TopicInfo |topic_info|.
   void NotifyAllSubscribers(const TopicInfo& topic_info);
-  // Notify all the subscribers about TopicInfo in |topic_infos|.
-  void NotifyAllSubscribers(const std::vector<TopicInfo>& topic_infos);
-  // Notify ServiceClient about ServiceInfo which serves |service|.
+  // Notify ServiceClient about ServiceInfos of all the servers which serve
+  // |service|.
   void NotifyServiceClient(const std::string& service,
                            const NodeInfo& client_node_info);
   // Notify all the ServiceClients about ServiceInfo |service_info|.
   void NotifyAllServiceClients(const ServiceInfo& service_info);
-  // Notify all the ServiceClients about ServiceInfo in |service_infos|.
-  void NotifyAllServiceClients(const std::vector<ServiceInfo>& service_infos);
+  // Notify the subscribers and the ServiceClients about |topic_infos| and
+  // |service_infos| which are unregistered.
+  void NotifyUnregistered(const std::vector<TopicInfo>& topic_infos,
+                          const std::vector<ServiceInfo>& service_infos);
   // Notify watcher about TopicInfos which are currently being published.
   void NotifyWatcher();
 
@@ -146,20 +196,85 @@ class Master {
 
   void SetCheckHeartBeatForTesting(bool check_heart_beat);
 
-  // Every time a new client is registered, invoke an appropriate
-  // heart beat listener for this client.
+  // Every time a new client is registered, start to check its heart beat
+  // with |heart_beat_listener_|.
   void DoCheckHeartBeat(const ClientInfo& client_info);
+  void StopCheckHeartBeat();
+
+  void ScheduleGc();
+  void DoScheduledGc();
+  void DoGc(base::OnceClosure callback);
+  void DoGcSlice();
+  // Checks if the client can be connected to, and collects it if it can't.
+  void ProbeClient(const ClientInfo& client_info);
+  // Called back when the client accepts or refuses to connect, or it doesn't
+  // in time.
+  void OnProbeClient(uint64_t probe_id, const ClientInfo& client_info,
+                     Status s);
+  void OnProbeClientDone();
 
   Master();
 
   std::unique_ptr<base::Thread> thread_;
 
-  base::Lock lock_;
+  // Read-only requests like ListTopics() are served on the rpc threads
+  // concurrently under a shared lock, while registrations and removals, which
+  // are serialized on |thread_|, take it exclusively.
+  ReadWriteLock lock_;
   base::flat_map<uint32_t, std::unique_ptr<Client>> client_map_
       GUARDED_BY(lock_);
+  // Indexes from a topic or a service to the nodes, so that a lookup doesn't
+  // scan every node of every client. These are updated whenever a node
+  // registers or unregisters a topic or a service, or is removed. Nodes are
+  // owned by |client_map_|.
+  std::unordered_map<std::string, Node*> publishing_nodes_ GUARDED_BY(lock_);
+  std::unordered_map<std::string, std::vector<Node*>> subscribing_nodes_
+      GUARDED_BY(lock_);
+  std::unordered_map<std::string, std::vector<Node*>> serving_nodes_
+      GUARDED_BY(lock_);
+  std::unordered_map<std::string, std::vector<Node*>> requesting_nodes_
+      GUARDED_BY(lock_);
+  Node* watcher_node_ GUARDED_BY(lock_) = nullptr;
 
+  // |state_store_| is used only on |state_store_thread_| once Run() is called.
+  std::unique_ptr<MasterStateStore> state_store_;
+  std::unique_ptr<base::Thread> state_store_thread_;
+  // Set while a snapshot is taken and written, which is accessed only on
+  // |state_store_thread_|.
+  bool snapshot_requested_ = false;
+
+  struct PendingNotification {
+    PendingNotification();
+    ~PendingNotification();
+
+    std::vector<TopicInfo> topic_infos;
+    std::unordered_map<std::string, size_t> topic_indexes;
+    std::vector<ServiceInfo> service_infos;
+    std::unordered_map<std::string, size_t> service_indexes;
+  };
+
+  // Notifications queued for each client, which are accessed only on
+  // |thread_|.
+  base::flat_map<uint32_t, PendingNotification> pending_notifications_;
+  bool flush_notifications_scheduled_ = false;
+  base::TimeDelta notification_window_;
+
+  // Checks the heart beats of all the clients. This lives on |thread_|.
+  std::unique_ptr<HeartBeatListener> heart_beat_listener_;
   bool check_heart_beat_ = true;
 
+  // States of Gc(), which are accessed only on |thread_|.
+  base::TimeDelta gc_interval_;
+  std::vector<ClientInfo> gc_client_infos_;
+  size_t gc_offset_ = 0;
+  size_t gc_probes_ = 0;
+  // The channels of the probes which are connecting, keyed by the ids of the
+  // probes, so that a timeout of a past probe doesn't end a later one.
+  base::flat_map<uint64_t, std::unique_ptr<Channel>> gc_probe_channels_;
+  uint64_t next_gc_probe_id_ = 0;
+  std::vector<ClientInfo> gc_unreachable_client_infos_;
+  std::vector<base::OnceClosure> gc_callbacks_;
+
   DISALLOW_COPY_AND_ASSIGN(Master);
 };
 
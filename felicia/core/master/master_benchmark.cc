@@ -0,0 +1,242 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/master.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/bind_helpers.h"
+#include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/strings/string_util.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+
+#include "felicia/core/master/liveness_tracker.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr size_t kNodeNum = 100;
+
+std::string TopicName(size_t i) { return base::StringPrintf("topic%zu", i); }
+
+void RunAndSignal(base::OnceClosure closure, base::WaitableEvent* event) {
+  std::move(closure).Run();
+  event->Signal();
+}
+
+}  // namespace
+
+class MasterBenchmark {
+ public:
+  MasterBenchmark() : master_(new Master()) {
+    master_->SetCheckHeartBeatForTesting(false);
+    master_->Run();
+  }
+
+  ~MasterBenchmark() { master_->Stop(); }
+
+  // Adds a client which has |kNodeNum| nodes.
+  void AddClient() {
+    std::unique_ptr<Client> client = Client::NewClient(ClientInfo());
+    client_info_ = client->client_info();
+    master_->AddClient(client_info_.id(), std::move(client));
+    for (size_t i = 0; i < kNodeNum; ++i) {
+      NodeInfo node_info;
+      node_info.set_client_id(client_info_.id());
+      std::unique_ptr<Node> node = Node::NewNode(node_info);
+      node_infos_.push_back(node->node_info());
+      master_->AddNode(std::move(node));
+    }
+  }
+
+  void RemoveClient() {
+    master_->RemoveClient(client_info_);
+    node_infos_.clear();
+  }
+
+  // Publishes |topic_num| topics over the nodes and subscribes each of them
+  // from another node. This blocks until they are registered on the master
+  // thread.
+  void PublishAndSubscribeTopics(size_t topic_num) {
+    RunOnMasterThread(base::BindOnce(
+        &MasterBenchmark::DoPublishAndSubscribeTopics, base::Unretained(this),
+        topic_num));
+  }
+
+  // Publishes and unpublishes |topic| on the master thread, which is what a
+  // node pays for a registration while others are listing.
+  void PublishAndUnpublishTopic(const std::string& topic) {
+    RunOnMasterThread(
+        base::BindOnce(&MasterBenchmark::DoPublishAndUnpublishTopic,
+                       base::Unretained(this), topic));
+  }
+
+  std::vector<TopicInfo> FindTopicInfos(const TopicFilter& topic_filter) {
+    return master_->FindTopicInfos(topic_filter);
+  }
+
+  std::vector<base::WeakPtr<Node>> FindNodes(const NodeFilter& node_filter) {
+    return master_->FindNodes(node_filter);
+  }
+
+ private:
+  void RunOnMasterThread(base::OnceClosure closure) {
+    base::WaitableEvent event;
+    master_->thread_->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&RunAndSignal, std::move(closure), &event));
+    event.Wait();
+  }
+
+  void DoPublishAndSubscribeTopics(size_t topic_num) {
+    for (size_t i = 0; i < topic_num; ++i) {
+      TopicInfo topic_info;
+      topic_info.set_topic(TopicName(i));
+      master_->DoPublishTopic(node_infos_[i % kNodeNum], topic_info,
+                              base::DoNothing());
+      master_->DoSubscribeTopic(node_infos_[(i + 1) % kNodeNum],
+                                topic_info.topic(), base::EmptyString(),
+                                base::DoNothing());
+    }
+  }
+
+  void DoPublishAndUnpublishTopic(const std::string& topic) {
+    TopicInfo topic_info;
+    topic_info.set_topic(topic);
+    master_->DoPublishTopic(node_infos_[0], topic_info, base::DoNothing());
+    master_->DoUnpublishTopic(node_infos_[0], topic, base::DoNothing());
+  }
+
+  std::unique_ptr<Master> master_;
+  ClientInfo client_info_;
+  std::vector<NodeInfo> node_infos_;
+
+  DISALLOW_COPY_AND_ASSIGN(MasterBenchmark);
+};
+
+// Measures registering |state.range(0)| topics, a publisher and a subscriber
+// for each of them.
+static void BM_PublishAndSubscribeTopics(benchmark::State& state) {
+  MasterBenchmark master_benchmark;
+  master_benchmark.AddClient();
+  for (auto _ : state) {
+    master_benchmark.PublishAndSubscribeTopics(state.range(0));
+
+    state.PauseTiming();
+    master_benchmark.RemoveClient();
+    master_benchmark.AddClient();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_FindTopicInfos(benchmark::State& state) {
+  MasterBenchmark master_benchmark;
+  master_benchmark.AddClient();
+  master_benchmark.PublishAndSubscribeTopics(state.range(0));
+  TopicFilter topic_filter;
+  for (auto _ : state) {
+    topic_filter.set_topic(TopicName(base::RandGenerator(state.range(0))));
+    std::vector<TopicInfo> topic_infos =
+        master_benchmark.FindTopicInfos(topic_filter);
+    benchmark::DoNotOptimize(topic_infos);
+  }
+}
+
+static void BM_FindPublishingNode(benchmark::State& state) {
+  MasterBenchmark master_benchmark;
+  master_benchmark.AddClient();
+  master_benchmark.PublishAndSubscribeTopics(state.range(0));
+  NodeFilter node_filter;
+  for (auto _ : state) {
+    node_filter.set_publishing_topic(
+        TopicName(base::RandGenerator(state.range(0))));
+    std::vector<base::WeakPtr<Node>> nodes =
+        master_benchmark.FindNodes(node_filter);
+    benchmark::DoNotOptimize(nodes);
+  }
+}
+
+static void BM_FindSubscribingNodes(benchmark::State& state) {
+  MasterBenchmark master_benchmark;
+  master_benchmark.AddClient();
+  master_benchmark.PublishAndSubscribeTopics(state.range(0));
+  NodeFilter node_filter;
+  for (auto _ : state) {
+    node_filter.set_subscribing_topic(
+        TopicName(base::RandGenerator(state.range(0))));
+    std::vector<base::WeakPtr<Node>> nodes =
+        master_benchmark.FindNodes(node_filter);
+    benchmark::DoNotOptimize(nodes);
+  }
+}
+
+MasterBenchmark* g_master_benchmark = nullptr;
+
+// Every thread lists a topic, and registers one at every tenth iteration, like
+// rpc threads of the master server do under load.
+static void BM_ConcurrentListAndPublishTopics(benchmark::State& state) {
+  constexpr size_t kTopicNum = 10000;
+  if (state.thread_index == 0) {
+    g_master_benchmark = new MasterBenchmark();
+    g_master_benchmark->AddClient();
+    g_master_benchmark->PublishAndSubscribeTopics(kTopicNum);
+  }
+  std::string topic = base::StringPrintf("thread%d", state.thread_index);
+  TopicFilter topic_filter;
+  size_t i = 0;
+  for (auto _ : state) {
+    if (++i % 10 == 0) {
+      g_master_benchmark->PublishAndUnpublishTopic(topic);
+    } else {
+      topic_filter.set_topic(TopicName(base::RandGenerator(kTopicNum)));
+      std::vector<TopicInfo> topic_infos =
+          g_master_benchmark->FindTopicInfos(topic_filter);
+      benchmark::DoNotOptimize(topic_infos);
+    }
+  }
+  if (state.thread_index == 0) {
+    delete g_master_benchmark;
+    g_master_benchmark = nullptr;
+  }
+}
+
+// Measures recording a heart beat while |state.range(0)| clients are tracked,
+// along with the ticks of the wheel.
+static void BM_LivenessTrackerHeartBeat(benchmark::State& state) {
+  base::TimeTicks now = base::TimeTicks::Now();
+  LivenessTracker liveness_tracker(now);
+  base::TimeDelta heart_beat_duration = base::TimeDelta::FromSeconds(1);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    liveness_tracker.Track(i, NewFailureDetector(heart_beat_duration, now),
+                           now);
+  }
+  base::TimeDelta interval = heart_beat_duration / state.range(0);
+  uint32_t id = 0;
+  for (auto _ : state) {
+    now += interval;
+    liveness_tracker.OnHeartBeat(id, now);
+    id = (id + 1) % state.range(0);
+    std::vector<uint32_t> suspected_ids = liveness_tracker.Advance(now);
+    benchmark::DoNotOptimize(suspected_ids);
+  }
+}
+
+BENCHMARK(BM_PublishAndSubscribeTopics)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FindTopicInfos)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_FindPublishingNode)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_FindSubscribingNodes)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_ConcurrentListAndPublishTopics)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_LivenessTrackerHeartBeat)->Arg(100)->Arg(1000)->Arg(10000);
+
+}  // namespace felicia
@@ -35,7 +35,7 @@ void MasterNotificationWatcher::UnregisterServiceInfoCallback(
 }
 
 void MasterNotificationWatcher::RegisterAllTopicInfoCallback(
-    NewTopicInfoCallback callback) {
+    NewTopicInfosCallback callback) {
   all_topic_info_callback_ = callback;
 }
 
@@ -72,7 +72,10 @@ void MasterNotificationWatcher::OnAccept(
 
 void MasterNotificationWatcher::WatchNewMasterNotification() {
   DCHECK(channel_);
+  // A notification can hold any number of infos, so the buffer grows to fit
+  // it.
   channel_->SetReceiveBufferSize(kMasterNotificationBytes);
+  channel_->SetDynamicReceiveBuffer(true);
 
   receiver_.ReceiveMessage(
       base::BindOnce(&MasterNotificationWatcher::OnNewMasterNotification,
@@ -82,25 +85,34 @@ void MasterNotificationWatcher::WatchNewMasterNotification() {
 void MasterNotificationWatcher::OnNewMasterNotification(Status s) {
   if (s.ok()) {
     const MasterNotification& master_notification = receiver_.message();
-    if (master_notification.has_topic_info()) {
-      const TopicInfo& topic_info = master_notification.topic_info();
+    std::vector<TopicInfo> topic_infos(
+        master_notification.topic_infos().begin(),
+        master_notification.topic_infos().end());
+    if (master_notification.has_topic_info())
+      topic_infos.push_back(master_notification.topic_info());
+    for (auto& topic_info : topic_infos) {
       auto it = topic_info_callback_map_.find(topic_info.topic());
       if (it != topic_info_callback_map_.end()) {
         it->second.Run(topic_info);
       }
-      if (!all_topic_info_callback_.is_null())
-        all_topic_info_callback_.Run(topic_info);
     }
+    if (!topic_infos.empty() && !all_topic_info_callback_.is_null())
+      all_topic_info_callback_.Run(topic_infos);
 
-    if (master_notification.has_service_info()) {
-      const ServiceInfo& service_info = master_notification.service_info();
-      auto it = service_info_callback_map_.find(service_info.service());
-      if (it != service_info_callback_map_.end()) {
-        it->second.Run(service_info);
-      }
-    }
+    if (master_notification.has_service_info())
+      OnNewServiceInfo(master_notification.service_info());
+    for (auto& service_info : master_notification.service_infos())
+      OnNewServiceInfo(service_info);
   }
   DoAccept();
 }
 
+void MasterNotificationWatcher::OnNewServiceInfo(
+    const ServiceInfo& service_info) {
+  auto it = service_info_callback_map_.find(service_info.service());
+  if (it != service_info_callback_map_.end()) {
+    it->second.Run(service_info);
+  }
+}
+
 }  // namespace felicia
\ No newline at end of file
@@ -6,6 +6,7 @@
 #define FELICIA_CORE_MASTER_MASTER_NOTIFICATION_WATCHER_H_
 
 #include <memory>
+#include <vector>
 
 #include "third_party/chromium/base/callback.h"
 #include "third_party/chromium/base/containers/flat_map.h"
@@ -20,6 +21,8 @@ namespace felicia {
 class MasterNotificationWatcher {
  public:
   using NewTopicInfoCallback = base::RepeatingCallback<void(const TopicInfo&)>;
+  using NewTopicInfosCallback =
+      base::RepeatingCallback<void(const std::vector<TopicInfo>&)>;
   using NewServiceInfoCallback =
       base::RepeatingCallback<void(const ServiceInfo&)>;
 
@@ -37,7 +40,9 @@ class MasterNotificationWatcher {
 
   void UnregisterServiceInfoCallback(const std::string& service);
 
-  void RegisterAllTopicInfoCallback(NewTopicInfoCallback callback);
+  // |callback| is called with all the TopicInfos which arrive in a single
+  // notification at once.
+  void RegisterAllTopicInfoCallback(NewTopicInfosCallback callback);
 
   void UnregisterAllTopicInfoCallback();
 
@@ -49,6 +54,7 @@ class MasterNotificationWatcher {
 
   void WatchNewMasterNotification();
   void OnNewMasterNotification(Status s);
+  void OnNewServiceInfo(const ServiceInfo& service_info);
 
   ChannelSource channel_source_;
   MessageReceiver<MasterNotification> receiver_;
@@ -57,7 +63,7 @@ class MasterNotificationWatcher {
   base::flat_map<std::string, NewTopicInfoCallback> topic_info_callback_map_;
   base::flat_map<std::string, NewServiceInfoCallback>
       service_info_callback_map_;
-  NewTopicInfoCallback all_topic_info_callback_;
+  NewTopicInfosCallback all_topic_info_callback_;
 
   DISALLOW_COPY_AND_ASSIGN(MasterNotificationWatcher);
 };
@@ -16,6 +16,7 @@ namespace felicia {
 extern std::unique_ptr<MasterClientInterface> NewMasterClient();
 }  // namespace felicia
 #else
+#include "felicia/core/master/peer_master_client.h"
 #include "felicia/core/master/rpc/master_client.h"
 #include "felicia/core/master/rpc/master_server_info.h"
 #include "felicia/core/rpc/grpc_util.h"
@@ -50,10 +51,14 @@ bool MasterProxy::is_client_info_set() const { return is_client_info_set_; }
 
 Status MasterProxy::Start() {
 #if !defined(FEL_WIN_NODE_BINDING)
-  std::string ip = ResolveMasterServerIp().ToString();
-  uint16_t port = ResolveMasterServerPort();
-  auto channel = ConnectToGrpcServer(ip, port);
-  master_client_interface_ = std::make_unique<MasterClient>(channel);
+  if (IsPeerDiscoveryEnabled()) {
+    master_client_interface_ = std::make_unique<PeerMasterClient>();
+  } else {
+    std::string ip = ResolveMasterServerIp().ToString();
+    uint16_t port = ResolveMasterServerPort();
+    auto channel = ConnectToGrpcServer(ip, port);
+    master_client_interface_ = std::make_unique<MasterClient>(channel);
+  }
   Status s = master_client_interface_->Start();
   if (!s.ok()) return s;
 #endif  // !defined(FEL_WIN_NODE_BINDING)
@@ -0,0 +1,251 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/master_state_store.h"
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "third_party/chromium/base/files/file_util.h"
+#include "third_party/chromium/base/logging.h"
+
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/lib/file/file_util.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr const char* kSnapshotFileName = "master_snapshot";
+constexpr const char* kJournalFileName = "master_journal";
+constexpr const char* kTemporarySuffix = ".tmp";
+
+// Each entry of the journal is written after its size in 4 bytes.
+constexpr size_t kEntryHeaderSize = sizeof(uint32_t);
+
+template <typename T, typename Predicate>
+void EraseIf(google::protobuf::RepeatedPtrField<T>* field,
+             Predicate predicate) {
+  for (int i = field->size() - 1; i >= 0; --i) {
+    if (predicate(field->Get(i))) field->DeleteSubrange(i, 1);
+  }
+}
+
+ClientState* FindClientState(MasterSnapshot* snapshot, uint32_t id) {
+  for (ClientState& client_state : *snapshot->mutable_client_states()) {
+    if (client_state.client_info().id() == id) return &client_state;
+  }
+  return nullptr;
+}
+
+NodeState* FindNodeState(MasterSnapshot* snapshot, const NodeInfo& node_info) {
+  ClientState* client_state =
+      FindClientState(snapshot, node_info.client_id());
+  if (!client_state) return nullptr;
+  for (NodeState& node_state : *client_state->mutable_node_states()) {
+    if (node_state.node_info().name() == node_info.name()) return &node_state;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+MasterStateStore::MasterStateStore(const base::FilePath& dir) : dir_(dir) {}
+
+MasterStateStore::~MasterStateStore() = default;
+
+Status MasterStateStore::Load(MasterSnapshot* snapshot) {
+  if (!base::DirectoryExists(dir_) && !base::CreateDirectory(dir_)) {
+    return errors::InvalidArgument("Failed to create " + dir_.AsUTF8Unsafe());
+  }
+
+  snapshot->Clear();
+  std::unique_ptr<char[]> buffer;
+  size_t length;
+  if (base::PathExists(snapshot_path())) {
+    if (!ReadFile(snapshot_path(), &buffer, &length) ||
+        !snapshot->ParseFromArray(buffer.get(), length)) {
+      return errors::DataLoss("Failed to read " +
+                              snapshot_path().AsUTF8Unsafe());
+    }
+  }
+
+  if (base::PathExists(journal_path())) {
+    if (!ReadFile(journal_path(), &buffer, &length)) {
+      return errors::DataLoss("Failed to read " +
+                              journal_path().AsUTF8Unsafe());
+    }
+
+    size_t offset = 0;
+    MasterJournalEntry entry;
+    while (offset + kEntryHeaderSize <= length) {
+      uint32_t size;
+      memcpy(&size, buffer.get() + offset, kEntryHeaderSize);
+      if (offset + kEntryHeaderSize + size > length ||
+          !entry.ParseFromArray(buffer.get() + offset + kEntryHeaderSize,
+                                size)) {
+        break;
+      }
+      ApplyJournalEntry(entry, snapshot);
+      offset += kEntryHeaderSize + size;
+    }
+    LOG_IF(WARNING, offset != length)
+        << "Dropped a truncated entry at the end of "
+        << journal_path().AsUTF8Unsafe();
+  }
+
+  return WriteSnapshot(*snapshot);
+}
+
+Status MasterStateStore::Append(const MasterJournalEntry& entry) {
+  DCHECK(journal_.IsValid());
+  std::string record(kEntryHeaderSize, 0);
+  if (!entry.AppendToString(&record)) {
+    return errors::InvalidArgument("Failed to serialize journal entry.");
+  }
+  uint32_t size = static_cast<uint32_t>(record.length() - kEntryHeaderSize);
+  memcpy(&record[0], &size, kEntryHeaderSize);
+
+  int rv = journal_.WriteAtCurrentPos(record.data(), record.length());
+  if (rv != static_cast<int>(record.length())) {
+    return errors::Unavailable(base::File::ErrorToString(
+        base::File::GetLastFileError()));
+  }
+  journal_entries_++;
+  return Status::OK();
+}
+
+bool MasterStateStore::ShouldWriteSnapshot() const {
+  return journal_entries_ > kMaxJournalEntries;
+}
+
+Status MasterStateStore::WriteSnapshot(const MasterSnapshot& snapshot) {
+  std::string serialized;
+  if (!snapshot.SerializeToString(&serialized)) {
+    return errors::InvalidArgument("Failed to serialize snapshot.");
+  }
+
+  base::FilePath temporary_path =
+      snapshot_path().AddExtensionASCII(kTemporarySuffix);
+  if (!WriteFile(temporary_path, serialized.data(), serialized.length()) ||
+      !base::ReplaceFile(temporary_path, snapshot_path(), nullptr)) {
+    return errors::Unavailable("Failed to write " +
+                               snapshot_path().AsUTF8Unsafe());
+  }
+
+  // Entries in the journal are in the snapshot now.
+  journal_.Close();
+  journal_ = base::File(journal_path(), base::File::FLAG_CREATE_ALWAYS |
+                                            base::File::FLAG_WRITE);
+  if (!journal_.IsValid()) {
+    return errors::Unavailable(
+        base::File::ErrorToString(journal_.error_details()));
+  }
+  journal_entries_ = 0;
+  return Status::OK();
+}
+
+// static
+void MasterStateStore::ApplyJournalEntry(const MasterJournalEntry& entry,
+                                         MasterSnapshot* snapshot) {
+  const NodeInfo& node_info = entry.node_info();
+  switch (entry.type()) {
+    case MasterJournalEntry::NONE:
+      return;
+    case MasterJournalEntry::ADD_CLIENT: {
+      uint32_t id = entry.client_info().id();
+      EraseIf(snapshot->mutable_client_states(),
+              [id](const ClientState& client_state) {
+                return client_state.client_info().id() == id;
+              });
+      *snapshot->add_client_states()->mutable_client_info() =
+          entry.client_info();
+      return;
+    }
+    case MasterJournalEntry::REMOVE_CLIENT: {
+      uint32_t id = entry.client_info().id();
+      EraseIf(snapshot->mutable_client_states(),
+              [id](const ClientState& client_state) {
+                return client_state.client_info().id() == id;
+              });
+      return;
+    }
+    case MasterJournalEntry::ADD_NODE: {
+      ClientState* client_state =
+          FindClientState(snapshot, node_info.client_id());
+      if (client_state) {
+        *client_state->add_node_states()->mutable_node_info() = node_info;
+      }
+      return;
+    }
+    case MasterJournalEntry::REMOVE_NODE: {
+      ClientState* client_state =
+          FindClientState(snapshot, node_info.client_id());
+      if (client_state) {
+        EraseIf(client_state->mutable_node_states(),
+                [&node_info](const NodeState& node_state) {
+                  return node_state.node_info().name() == node_info.name();
+                });
+      }
+      return;
+    }
+    default:
+      break;
+  }
+
+  NodeState* node_state = FindNodeState(snapshot, node_info);
+  if (!node_state) return;
+
+  const std::string& name = entry.name();
+  auto equals_name = [&name](const std::string& value) {
+    return value == name;
+  };
+  switch (entry.type()) {
+    case MasterJournalEntry::PUBLISH_TOPIC:
+      *node_state->add_publishing_topic_infos() = entry.topic_info();
+      break;
+    case MasterJournalEntry::UNPUBLISH_TOPIC:
+      EraseIf(node_state->mutable_publishing_topic_infos(),
+              [&name](const TopicInfo& topic_info) {
+                return topic_info.topic() == name;
+              });
+      break;
+    case MasterJournalEntry::SUBSCRIBE_TOPIC:
+      node_state->add_subscribing_topics(name);
+      break;
+    case MasterJournalEntry::UNSUBSCRIBE_TOPIC:
+      EraseIf(node_state->mutable_subscribing_topics(), equals_name);
+      break;
+    case MasterJournalEntry::REGISTER_SERVICE_SERVER:
+      *node_state->add_serving_service_infos() = entry.service_info();
+      break;
+    case MasterJournalEntry::UNREGISTER_SERVICE_SERVER:
+      EraseIf(node_state->mutable_serving_service_infos(),
+              [&name](const ServiceInfo& service_info) {
+                return service_info.service() == name;
+              });
+      break;
+    case MasterJournalEntry::REGISTER_SERVICE_CLIENT:
+      node_state->add_requesting_services(name);
+      break;
+    case MasterJournalEntry::UNREGISTER_SERVICE_CLIENT:
+      EraseIf(node_state->mutable_requesting_services(), equals_name);
+      break;
+    default:
+      NOTREACHED();
+      break;
+  }
+}
+
+base::FilePath MasterStateStore::snapshot_path() const {
+  return dir_.AppendASCII(kSnapshotFileName);
+}
+
+base::FilePath MasterStateStore::journal_path() const {
+  return dir_.AppendASCII(kJournalFileName);
+}
+
+}  // namespace felicia
@@ -0,0 +1,63 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_MASTER_STATE_STORE_H_
+#define FELICIA_CORE_MASTER_MASTER_STATE_STORE_H_
+
+#include "third_party/chromium/base/files/file.h"
+#include "third_party/chromium/base/files/file_path.h"
+#include "third_party/chromium/base/macros.h"
+
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/protobuf/master_state.pb.h"
+
+namespace felicia {
+
+// MasterStateStore persists the registry of the master under a directory, as
+// a snapshot and a journal of the changes after it. Every change is appended
+// to the journal, and the journal is compacted into a new snapshot once it has
+// more than |kMaxJournalEntries| entries. The journal isn't synced to the disk
+// on every change, because it is meant to survive a restart of the master,
+// not a crash of the host.
+class MasterStateStore {
+ public:
+  static constexpr size_t kMaxJournalEntries = 1024;
+
+  explicit MasterStateStore(const base::FilePath& dir);
+  ~MasterStateStore();
+
+  // Reads the snapshot and replays the journal on it into |snapshot|, and then
+  // compacts them. A truncated entry at the end of the journal, which is left
+  // when the master is killed while writing it, is dropped. This should be
+  // called before any other methods.
+  Status Load(MasterSnapshot* snapshot);
+
+  // Appends |entry| to the journal.
+  Status Append(const MasterJournalEntry& entry);
+
+  // Returns true if the journal is long enough to be compacted by
+  // WriteSnapshot().
+  bool ShouldWriteSnapshot() const;
+
+  // Replaces the snapshot with |snapshot| atomically and empties the journal.
+  Status WriteSnapshot(const MasterSnapshot& snapshot);
+
+  // Applies the change of |entry| to |snapshot|.
+  static void ApplyJournalEntry(const MasterJournalEntry& entry,
+                                MasterSnapshot* snapshot);
+
+ private:
+  base::FilePath snapshot_path() const;
+  base::FilePath journal_path() const;
+
+  base::FilePath dir_;
+  base::File journal_;
+  size_t journal_entries_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(MasterStateStore);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_MASTER_STATE_STORE_H_
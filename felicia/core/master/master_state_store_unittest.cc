@@ -0,0 +1,161 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/master_state_store.h"
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/files/file.h"
+#include "third_party/chromium/base/files/scoped_temp_dir.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr uint32_t kClientId = 1;
+constexpr const char* kNodeName = "node";
+
+MasterJournalEntry ClientEntry(MasterJournalEntry::Type type) {
+  MasterJournalEntry entry;
+  entry.set_type(type);
+  entry.mutable_client_info()->set_id(kClientId);
+  return entry;
+}
+
+MasterJournalEntry NodeEntry(MasterJournalEntry::Type type,
+                             const std::string& name = std::string()) {
+  MasterJournalEntry entry;
+  entry.set_type(type);
+  entry.mutable_node_info()->set_client_id(kClientId);
+  entry.mutable_node_info()->set_name(kNodeName);
+  entry.set_name(name);
+  return entry;
+}
+
+MasterJournalEntry PublishTopicEntry(const std::string& topic) {
+  MasterJournalEntry entry = NodeEntry(MasterJournalEntry::PUBLISH_TOPIC);
+  entry.mutable_topic_info()->set_topic(topic);
+  return entry;
+}
+
+}  // namespace
+
+class MasterStateStoreTest : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(MasterStateStoreTest, LoadEmpty) {
+  MasterStateStore state_store(temp_dir_.GetPath());
+  MasterSnapshot snapshot;
+  EXPECT_TRUE(state_store.Load(&snapshot).ok());
+  EXPECT_EQ(0, snapshot.client_states_size());
+}
+
+TEST_F(MasterStateStoreTest, AppendAndLoad) {
+  {
+    MasterStateStore state_store(temp_dir_.GetPath());
+    MasterSnapshot snapshot;
+    ASSERT_TRUE(state_store.Load(&snapshot).ok());
+    EXPECT_TRUE(
+        state_store.Append(ClientEntry(MasterJournalEntry::ADD_CLIENT)).ok());
+    EXPECT_TRUE(
+        state_store.Append(NodeEntry(MasterJournalEntry::ADD_NODE)).ok());
+    EXPECT_TRUE(state_store.Append(PublishTopicEntry("topic")).ok());
+    EXPECT_TRUE(state_store.Append(PublishTopicEntry("topic2")).ok());
+    EXPECT_TRUE(state_store
+                    .Append(NodeEntry(MasterJournalEntry::UNPUBLISH_TOPIC,
+                                      "topic"))
+                    .ok());
+    EXPECT_TRUE(state_store
+                    .Append(NodeEntry(MasterJournalEntry::SUBSCRIBE_TOPIC,
+                                      "topic3"))
+                    .ok());
+    EXPECT_TRUE(
+        state_store
+            .Append(NodeEntry(MasterJournalEntry::REGISTER_SERVICE_CLIENT,
+                              "service"))
+            .ok());
+  }
+
+  MasterStateStore state_store(temp_dir_.GetPath());
+  MasterSnapshot snapshot;
+  ASSERT_TRUE(state_store.Load(&snapshot).ok());
+  ASSERT_EQ(1, snapshot.client_states_size());
+  const ClientState& client_state = snapshot.client_states(0);
+  EXPECT_EQ(kClientId, client_state.client_info().id());
+  ASSERT_EQ(1, client_state.node_states_size());
+  const NodeState& node_state = client_state.node_states(0);
+  EXPECT_EQ(kNodeName, node_state.node_info().name());
+  ASSERT_EQ(1, node_state.publishing_topic_infos_size());
+  EXPECT_EQ("topic2", node_state.publishing_topic_infos(0).topic());
+  ASSERT_EQ(1, node_state.subscribing_topics_size());
+  EXPECT_EQ("topic3", node_state.subscribing_topics(0));
+  ASSERT_EQ(1, node_state.requesting_services_size());
+  EXPECT_EQ("service", node_state.requesting_services(0));
+
+  // Removing the client removes everything under it.
+  EXPECT_TRUE(
+      state_store.Append(ClientEntry(MasterJournalEntry::REMOVE_CLIENT)).ok());
+  MasterStateStore state_store2(temp_dir_.GetPath());
+  ASSERT_TRUE(state_store2.Load(&snapshot).ok());
+  EXPECT_EQ(0, snapshot.client_states_size());
+}
+
+TEST_F(MasterStateStoreTest, DropTruncatedEntry) {
+  {
+    MasterStateStore state_store(temp_dir_.GetPath());
+    MasterSnapshot snapshot;
+    ASSERT_TRUE(state_store.Load(&snapshot).ok());
+    EXPECT_TRUE(
+        state_store.Append(ClientEntry(MasterJournalEntry::ADD_CLIENT)).ok());
+    EXPECT_TRUE(
+        state_store.Append(NodeEntry(MasterJournalEntry::ADD_NODE)).ok());
+  }
+
+  // Cuts the last entry as if the master was killed while writing it.
+  base::File journal(temp_dir_.GetPath().AppendASCII("master_journal"),
+                     base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+  ASSERT_TRUE(journal.IsValid());
+  ASSERT_TRUE(journal.SetLength(journal.GetLength() - 1));
+  journal.Close();
+
+  MasterStateStore state_store(temp_dir_.GetPath());
+  MasterSnapshot snapshot;
+  ASSERT_TRUE(state_store.Load(&snapshot).ok());
+  ASSERT_EQ(1, snapshot.client_states_size());
+  EXPECT_EQ(0, snapshot.client_states(0).node_states_size());
+
+  // The truncated entry is gone, so that new entries can follow.
+  EXPECT_TRUE(state_store.Append(NodeEntry(MasterJournalEntry::ADD_NODE)).ok());
+  MasterStateStore state_store2(temp_dir_.GetPath());
+  ASSERT_TRUE(state_store2.Load(&snapshot).ok());
+  ASSERT_EQ(1, snapshot.client_states_size());
+  EXPECT_EQ(1, snapshot.client_states(0).node_states_size());
+}
+
+TEST_F(MasterStateStoreTest, WriteSnapshot) {
+  MasterStateStore state_store(temp_dir_.GetPath());
+  MasterSnapshot snapshot;
+  ASSERT_TRUE(state_store.Load(&snapshot).ok());
+  for (size_t i = 0; i <= MasterStateStore::kMaxJournalEntries; ++i) {
+    EXPECT_FALSE(state_store.ShouldWriteSnapshot());
+    EXPECT_TRUE(
+        state_store.Append(ClientEntry(MasterJournalEntry::ADD_CLIENT)).ok());
+  }
+  EXPECT_TRUE(state_store.ShouldWriteSnapshot());
+
+  MasterStateStore::ApplyJournalEntry(
+      ClientEntry(MasterJournalEntry::ADD_CLIENT), &snapshot);
+  EXPECT_TRUE(state_store.WriteSnapshot(snapshot).ok());
+  EXPECT_FALSE(state_store.ShouldWriteSnapshot());
+
+  MasterStateStore state_store2(temp_dir_.GetPath());
+  MasterSnapshot snapshot2;
+  ASSERT_TRUE(state_store2.Load(&snapshot2).ok());
+  EXPECT_EQ(snapshot.SerializeAsString(), snapshot2.SerializeAsString());
+}
+
+}  // namespace felicia
@@ -5,15 +5,20 @@
 #include "felicia/core/master/master.h"
 
 #include <memory>
+#include <set>
 
 #include "gtest/gtest.h"
 #include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/files/scoped_temp_dir.h"
 #include "third_party/chromium/base/memory/ptr_util.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
 #include "third_party/chromium/base/synchronization/waitable_event.h"
+#include "third_party/chromium/base/threading/thread.h"
 
 #include "felicia/core/channel/channel.h"
 #include "felicia/core/lib/net/net_util.h"
 #include "felicia/core/master/errors.h"
+#include "felicia/core/master/master_notification_watcher.h"
 
 namespace felicia {
 
@@ -189,6 +194,21 @@ class MasterTest : public testing::Test {
     master_->SetCheckHeartBeatForTesting(check_heart_beat);
   }
 
+  // Replaces |master_| with a new one, which loads the state from |dir|.
+  void RestartWithState(const base::FilePath& dir) {
+    master_->Stop();
+    master_.reset(new Master());
+    master_->SetCheckHeartBeatForTesting(false);
+    ASSERT_TRUE(master_->LoadState(dir).ok());
+    master_->Run();
+  }
+
+  void Gc() {
+    master_->Gc(base::BindOnce(&base::WaitableEvent::Signal,
+                               base::Unretained(event_.get())));
+    event_->Wait();
+  }
+
   void RegisterRandomClientForTesting(RegisterClientRequest* request,
                                       RegisterClientResponse* response) {
     ClientInfo client_info;
@@ -704,6 +724,231 @@ TEST_F(MasterTest, ListServices) {
       base::BindOnce(&OnListService, event_, response.get(), service_info));
 }
 
+namespace {
+
+void OnListServiceServers(std::shared_ptr<base::WaitableEvent> event,
+                          ListServicesResponse* response, Status s) {
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(2, response->service_infos_size());
+  event->Signal();
+}
+
+}  // namespace
+
+TEST_F(MasterTest, ServeServiceOnMultipleNodes) {
+  {
+    DECLARE_REQUEST_AND_RESPONSE(RegisterServiceServer);
+    ServiceInfo service_info;
+    PrepareRegisterServiceServer(request.get(), response.get(), pub_node_info_,
+                                 service_, &service_info);
+    RegisterServiceServer(request.get(), response.get(),
+                          base::BindOnce(&ExpectOK, event_));
+  }
+
+  DECLARE_REQUEST_AND_RESPONSE(ListServices);
+  request->mutable_service_filter()->set_service(service_);
+  ListServices(request.get(), response.get(),
+               base::BindOnce(&OnListServiceServers, event_, response.get()));
+}
+
+namespace {
+
+void OnListNoClients(std::shared_ptr<base::WaitableEvent> event,
+                     ListClientsResponse* response, Status s) {
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(0, response->client_infos_size());
+  event->Signal();
+}
+
+void OnListNoTopics(std::shared_ptr<base::WaitableEvent> event,
+                    ListTopicsResponse* response, Status s) {
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(0, response->topic_infos_size());
+  event->Signal();
+}
+
+}  // namespace
+
+namespace {
+
+class TopicInfoCollector {
+ public:
+  explicit TopicInfoCollector(size_t expected_count)
+      : expected_count_(expected_count),
+        event_(base::WaitableEvent::ResetPolicy::MANUAL,
+               base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+  void OnNewTopicInfos(const std::vector<TopicInfo>& topic_infos) {
+    for (auto& topic_info : topic_infos) topics_.insert(topic_info.topic());
+    if (topics_.size() == expected_count_) event_.Signal();
+  }
+
+  bool TimedWait(base::TimeDelta timeout) { return event_.TimedWait(timeout); }
+
+ private:
+  size_t expected_count_;
+  std::set<std::string> topics_;
+  base::WaitableEvent event_;
+};
+
+void StartMasterNotificationWatcher(MasterNotificationWatcher* watcher,
+                                    TopicInfoCollector* collector,
+                                    base::WaitableEvent* event) {
+  watcher->RegisterAllTopicInfoCallback(base::BindRepeating(
+      &TopicInfoCollector::OnNewTopicInfos, base::Unretained(collector)));
+  watcher->Start();
+  event->Signal();
+}
+
+}  // namespace
+
+TEST_F(MasterTest, CoalesceNotifications) {
+  // Far more than fit in |kMasterNotificationBytes| at once.
+  constexpr size_t kTopicCount = 64;
+
+  base::Thread watcher_thread("MasterNotificationWatcherThread");
+  watcher_thread.StartWithOptions(
+      base::Thread::Options{base::MessageLoop::TYPE_IO, 0});
+  auto watcher = std::make_unique<MasterNotificationWatcher>();
+  TopicInfoCollector collector(kTopicCount);
+  {
+    base::WaitableEvent event;
+    watcher_thread.task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&StartMasterNotificationWatcher,
+                                  watcher.get(), &collector, &event));
+    event.Wait();
+  }
+
+  uint32_t client_id;
+  {
+    DECLARE_REQUEST_AND_RESPONSE(RegisterClient);
+    ClientInfo* client_info = request->mutable_client_info();
+    *client_info->mutable_master_notification_watcher_source() =
+        watcher->channel_source();
+    RegisterClient(request.get(), response.get(),
+                   base::BindOnce(&ExpectOK, event_));
+    client_id = response->id();
+  }
+  NodeInfo watcher_node_info;
+  watcher_node_info.set_client_id(client_id);
+  watcher_node_info.set_watcher(true);
+  {
+    DECLARE_REQUEST_AND_RESPONSE(RegisterNode);
+    *request->mutable_node_info() = watcher_node_info;
+    RegisterNode(request.get(), response.get(),
+                 base::BindOnce(&ExpectOK, event_));
+    watcher_node_info = response->node_info();
+  }
+
+  // The watcher is notified of |topic_| as it's registered, and of the others
+  // as they are published. The ones published within a notification window
+  // are sent to it together.
+  for (size_t i = 1; i < kTopicCount; ++i) {
+    DECLARE_REQUEST_AND_RESPONSE(PublishTopic);
+    TopicInfo topic_info;
+    PreparePublishTopic(request.get(), response.get(), pub_node_info_,
+                        base::StringPrintf("coalesced_topic%zu", i),
+                        &topic_info);
+    PublishTopic(request.get(), response.get(),
+                 base::BindOnce(&ExpectOK, event_));
+  }
+
+  EXPECT_TRUE(collector.TimedWait(base::TimeDelta::FromSeconds(5)));
+
+  {
+    DECLARE_REQUEST_AND_RESPONSE(UnregisterNode);
+    *request->mutable_node_info() = watcher_node_info;
+    UnregisterNode(request.get(), response.get(),
+                   base::BindOnce(&ExpectOK, event_));
+  }
+  watcher_thread.task_runner()->DeleteSoon(FROM_HERE, std::move(watcher));
+  watcher_thread.Stop();
+}
+
+TEST_F(MasterTest, Gc) {
+  // Nothing listens on the master notification watcher source of the client
+  // registered at SetUp(), so it is unreachable.
+  Gc();
+
+  {
+    DECLARE_REQUEST_AND_RESPONSE(ListClients);
+    request->mutable_client_filter()->set_all(true);
+    ListClients(request.get(), response.get(),
+                base::BindOnce(&OnListNoClients, event_, response.get()));
+  }
+  {
+    DECLARE_REQUEST_AND_RESPONSE(ListTopics);
+    request->mutable_topic_filter()->set_all(true);
+    ListTopics(request.get(), response.get(),
+               base::BindOnce(&OnListNoTopics, event_, response.get()));
+  }
+
+  // Register them again to be unregistered at TearDown().
+  SetUp();
+}
+
+TEST_F(MasterTest, GcWithHeartBeat) {
+  // With heart beats, Gc() doesn't probe the clients. The client registered
+  // at SetUp() isn't tracked by heart beats, so it is kept although it is
+  // unreachable.
+  SetCheckHeartBeatForTesting(true);
+  Gc();
+  SetCheckHeartBeatForTesting(false);
+
+  DECLARE_REQUEST_AND_RESPONSE(ListClients);
+  request->mutable_client_filter()->set_all(true);
+  ListClients(
+      request.get(), response.get(),
+      base::BindOnce(&OnListAllClients, event_, client_id_, response.get()));
+}
+
+TEST_F(MasterTest, PersistState) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+
+  // Restart with a state store, and change it enough times for the journal to
+  // be compacted into a snapshot.
+  RestartWithState(temp_dir.GetPath());
+  SetUp();
+  for (size_t i = 0; i < MasterStateStore::kMaxJournalEntries / 2 + 1; ++i) {
+    {
+      DECLARE_REQUEST_AND_RESPONSE(UnsubscribeTopic);
+      *request->mutable_node_info() = sub_node_info_;
+      *request->mutable_topic() = topic_;
+      UnsubscribeTopic(request.get(), response.get(),
+                       base::BindOnce(&ExpectOK, event_));
+    }
+    {
+      DECLARE_REQUEST_AND_RESPONSE(SubscribeTopic);
+      *request->mutable_node_info() = sub_node_info_;
+      *request->mutable_topic() = topic_;
+      SubscribeTopic(request.get(), response.get(),
+                     base::BindOnce(&ExpectOK, event_));
+    }
+  }
+
+  // Every change is written by the time it stops.
+  RestartWithState(temp_dir.GetPath());
+
+  {
+    DECLARE_REQUEST_AND_RESPONSE(ListNodes);
+    request->mutable_node_filter()->set_all(true);
+    ListNodes(request.get(), response.get(),
+              base::BindOnce(&OnListAllNodes, event_, client_id_,
+                             std::vector<std::string>{
+                                 publishing_node_name_, subscribing_node_name_,
+                                 client_node_name_, server_node_name_},
+                             response.get()));
+  }
+  {
+    DECLARE_REQUEST_AND_RESPONSE(ListNodes);
+    request->mutable_node_filter()->set_subscribing_topic(topic_);
+    ListNodes(request.get(), response.get(),
+              base::BindOnce(&OnListSubscribingNodes, event_, client_id_,
+                             subscribing_node_name_, response.get()));
+  }
+}
+
 #undef EXPECT_CHECK_NODE_EXISTS
 #undef DECLARE_REQUEST_AND_RESPONSE
 
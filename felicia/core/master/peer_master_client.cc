@@ -0,0 +1,736 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/peer_master_client.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
+#include "third_party/chromium/base/threading/thread_task_runner_handle.h"
+#include "third_party/chromium/net/base/net_errors.h"
+
+#include "felicia/core/channel/channel_factory.h"
+#include "felicia/core/channel/message_sender.h"
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/master/bytes_constants.h"
+#include "felicia/core/master/errors.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr uint16_t kDefaultMulticastPort = 8882;
+constexpr const char* kDefaultMulticastIp = "239.255.88.82";
+// The largest payload of a UDP datagram.
+constexpr size_t kMaxAnnouncementBytes = 65507;
+
+net::IPEndPoint ResolveMulticastIPEndPoint() {
+  net::IPAddress address;
+  const char* ip_env = getenv("FEL_PEER_DISCOVERY_IP");
+  bool ret = address.AssignFromIPLiteral(ip_env ? ip_env : kDefaultMulticastIp);
+  CHECK(ret && address.IsIPv4());
+
+  uint16_t port = kDefaultMulticastPort;
+  const char* port_env = getenv("FEL_PEER_DISCOVERY_PORT");
+  if (port_env) {
+    int value;
+    if (base::StringToInt(port_env, &value) && 1023 < value &&
+        value <= 65535) {
+      port = value;
+    }
+  }
+  return net::IPEndPoint(address, port);
+}
+
+base::TimeDelta GetAnnounceInterval() {
+  int64_t interval = PeerMasterClient::kDefaultAnnounceInterval;
+  const char* interval_env = getenv("FEL_PEER_DISCOVERY_INTERVAL");
+  if (interval_env) {
+    int64_t value;
+    if (base::StringToInt64(interval_env, &value) && value > 0) {
+      interval = value;
+    }
+  }
+  return base::TimeDelta::FromMilliseconds(interval);
+}
+
+std::string GenerateNodeName() {
+  std::string bytes = base::RandBytesAsString(6);
+  return base::HexEncode(bytes.data(), bytes.length());
+}
+
+bool RemoveName(google::protobuf::RepeatedPtrField<std::string>* names,
+                const std::string& name) {
+  auto it = std::find(names->begin(), names->end(), name);
+  if (it == names->end()) return false;
+  names->erase(it);
+  return true;
+}
+
+bool Contains(const google::protobuf::RepeatedPtrField<std::string>& names,
+              const std::string& name) {
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+}  // namespace
+
+bool IsPeerDiscoveryEnabled() {
+  const char* env = getenv("FEL_PEER_DISCOVERY");
+  return env && strlen(env) > 0 && strcmp(env, "0") != 0;
+}
+
+PeerMasterClient::PeerMasterClient()
+    : thread_(std::make_unique<base::Thread>("PeerMasterClient")),
+      interval_(GetAnnounceInterval()) {}
+
+PeerMasterClient::~PeerMasterClient() { Stop(); }
+
+Status PeerMasterClient::Start() {
+  if (thread_->IsRunning()) return Status::OK();
+  thread_->StartWithOptions(
+      base::Thread::Options{base::MessageLoop::TYPE_IO, 0});
+
+  base::WaitableEvent event;
+  Status s;
+  thread_->task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&PeerMasterClient::DoStart,
+                                base::Unretained(this), &event, &s));
+  event.Wait();
+  return s;
+}
+
+Status PeerMasterClient::Stop() {
+  if (!thread_->IsRunning()) return Status::OK();
+  base::WaitableEvent event;
+  thread_->task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&PeerMasterClient::DoStop,
+                                base::Unretained(this), &event));
+  event.Wait();
+  thread_->Stop();
+  return Status::OK();
+}
+
+#define CLIENT_METHOD(Method)                                                \
+  void PeerMasterClient::Method##Async(const Method##Request* request,       \
+                                       Method##Response* response,           \
+                                       StatusOnceCallback done) {            \
+    thread_->task_runner()->PostTask(                                        \
+        FROM_HERE,                                                           \
+        base::BindOnce(&PeerMasterClient::Do##Method, base::Unretained(this), \
+                       request, response, std::move(done)));                 \
+  }
+
+#define MASTER_METHOD(Method, method, cancelable) CLIENT_METHOD(Method)
+#include "felicia/core/master/rpc/master_method_list.h"
+#undef MASTER_METHOD
+
+#undef CLIENT_METHOD
+
+void PeerMasterClient::DoStart(base::WaitableEvent* event, Status* status) {
+  multicast_ip_endpoint_ = ResolveMulticastIPEndPoint();
+  registry_ = std::make_unique<PeerRegistry>(base::TimeTicks::Now());
+
+  // Several clients on the same host share |multicast_ip_endpoint_|, and each
+  // of them receives its own announcement as well.
+  auto socket = std::make_unique<net::UDPSocket>(
+      net::DatagramSocket::BindType::DEFAULT_BIND);
+  int rv = socket->Open(multicast_ip_endpoint_.GetFamily());
+  if (rv == net::OK) rv = socket->SetMulticastLoopbackMode(true);
+  if (rv == net::OK) rv = socket->AllowAddressSharingForMulticast();
+  if (rv == net::OK) {
+    rv = socket->Bind(net::IPEndPoint(net::IPAddress(0, 0, 0, 0),
+                                      multicast_ip_endpoint_.port()));
+  }
+  if (rv == net::OK) rv = socket->JoinGroup(multicast_ip_endpoint_.address());
+  if (rv != net::OK) {
+    *status = errors::NetworkError(net::ErrorToString(rv));
+    event->Signal();
+    return;
+  }
+
+  socket_ = std::move(socket);
+  read_buffer_ = base::MakeRefCounted<net::IOBuffer>(kMaxAnnouncementBytes);
+  ReadAnnouncement();
+  ScheduleTick();
+  event->Signal();
+}
+
+void PeerMasterClient::DoStop(base::WaitableEvent* event) {
+  tick_.Cancel();
+  // Lets the peers forget this client without waiting for it to be
+  // suspected. If an announcement is being sent, the leaving one follows it
+  // instead of being dropped.
+  stop_event_ = event;
+  if (write_buffer_) {
+    announce_again_ = true;
+    return;
+  }
+  AnnounceToLeave();
+}
+
+void PeerMasterClient::AnnounceToLeave() {
+  Announce();
+  // Nothing is sent if there's no client to announce or it fails to send.
+  if (!write_buffer_ && stop_event_) OnLeft();
+}
+
+void PeerMasterClient::OnLeft() {
+  if (socket_) {
+    socket_->Close();
+    socket_.reset();
+  }
+  registry_.reset();
+  base::WaitableEvent* event = stop_event_;
+  stop_event_ = nullptr;
+  event->Signal();
+}
+
+void PeerMasterClient::DoRegisterClient(const RegisterClientRequest* request,
+                                        RegisterClientResponse* response,
+                                        StatusOnceCallback done) {
+  ClientInfo client_info = request->client_info();
+  if (!IsValidChannelSource(
+          client_info.master_notification_watcher_source())) {
+    std::move(done).Run(errors::ChannelSourceNotValid(
+        "master notification watcher source",
+        client_info.master_notification_watcher_source()));
+    return;
+  }
+
+  uint32_t id;
+  do {
+    id = static_cast<uint32_t>(base::RandUint64());
+  } while (id == 0 || registry_->HasClient(id));
+  client_info.set_id(id);
+  client_state_.Clear();
+  *client_state_.mutable_client_info() = client_info;
+  response->set_id(id);
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoListClients(const ListClientsRequest* request,
+                                     ListClientsResponse* response,
+                                     StatusOnceCallback done) {
+  for (auto& client_info :
+       registry_->FindClientInfos(request->client_filter())) {
+    *response->add_client_infos() = client_info;
+  }
+  std::move(done).Run(Status::OK());
+}
+
+void PeerMasterClient::DoRegisterNode(const RegisterNodeRequest* request,
+                                      RegisterNodeResponse* response,
+                                      StatusOnceCallback done) {
+  NodeInfo node_info = request->node_info();
+  if (!client_state_.has_client_info() ||
+      node_info.client_id() != client_state_.client_info().id()) {
+    std::move(done).Run(errors::ClientNotRegistered());
+    return;
+  }
+  if (node_info.watcher() && HasWatcher()) {
+    std::move(done).Run(errors::WatcherNodeAlreadyRegistered());
+    return;
+  }
+
+  // Two peers may take the same name at the same time, since there's no one
+  // to arbitrate it. Leaving the name empty avoids that.
+  if (node_info.name().empty()) {
+    do {
+      node_info.set_name(GenerateNodeName());
+    } while (registry_->FindNodeState(node_info.name()));
+  } else if (registry_->FindNodeState(node_info.name())) {
+    std::move(done).Run(errors::NodeAlreadyRegistered(node_info));
+    return;
+  }
+
+  *client_state_.add_node_states()->mutable_node_info() = node_info;
+  *response->mutable_node_info() = node_info;
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+  if (node_info.watcher()) {
+    TopicFilter topic_filter;
+    topic_filter.set_all(true);
+    MasterNotification master_notification;
+    for (auto& topic_info : registry_->FindTopicInfos(topic_filter)) {
+      *master_notification.add_topic_infos() = topic_info;
+    }
+    if (master_notification.topic_infos_size() > 0)
+      NotifyClient(master_notification);
+  }
+}
+
+void PeerMasterClient::DoUnregisterNode(const UnregisterNodeRequest* request,
+                                        UnregisterNodeResponse* response,
+                                        StatusOnceCallback done) {
+  auto* node_states = client_state_.mutable_node_states();
+  auto it = std::find_if(
+      node_states->begin(), node_states->end(),
+      [&request](const NodeState& node_state) {
+        return node_state.node_info().name() == request->node_info().name();
+      });
+  if (it == node_states->end()) {
+    std::move(done).Run(errors::NodeNotRegistered(request->node_info()));
+    return;
+  }
+  node_states->erase(it);
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoListNodes(const ListNodesRequest* request,
+                                   ListNodesResponse* response,
+                                   StatusOnceCallback done) {
+  const NodeFilter& node_filter = request->node_filter();
+  if (!node_filter.name().empty()) {
+    const NodeState* node_state = registry_->FindNodeState(node_filter.name());
+    auto pub_sub_topics = response->mutable_pub_sub_topics();
+    if (node_state) {
+      for (auto& topic_info : node_state->publishing_topic_infos()) {
+        *pub_sub_topics->add_publishing_topics() = topic_info.topic();
+      }
+      for (auto& topic : node_state->subscribing_topics()) {
+        *pub_sub_topics->add_subscribing_topics() = topic;
+      }
+    }
+  } else {
+    for (auto& node_info : registry_->FindNodeInfos(node_filter)) {
+      *response->add_node_infos() = node_info;
+    }
+  }
+  std::move(done).Run(Status::OK());
+}
+
+void PeerMasterClient::DoPublishTopic(const PublishTopicRequest* request,
+                                      PublishTopicResponse* response,
+                                      StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  const TopicInfo& topic_info = request->topic_info();
+  if (!IsValidChannelSource(topic_info.topic_source())) {
+    std::move(done).Run(errors::ChannelSourceNotValid(
+        "topic source", topic_info.topic_source()));
+    return;
+  }
+
+  TopicFilter topic_filter;
+  topic_filter.set_topic(topic_info.topic());
+  if (!registry_->FindTopicInfos(topic_filter).empty()) {
+    std::move(done).Run(
+        errors::TopicAlreadyPublishingOnNode(node_info, topic_info));
+    return;
+  }
+
+  *node_state->add_publishing_topic_infos() = topic_info;
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoUnpublishTopic(const UnpublishTopicRequest* request,
+                                        UnpublishTopicResponse* response,
+                                        StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  auto* topic_infos = node_state->mutable_publishing_topic_infos();
+  auto it = std::find_if(topic_infos->begin(), topic_infos->end(),
+                         [&request](const TopicInfo& topic_info) {
+                           return topic_info.topic() == request->topic();
+                         });
+  if (it == topic_infos->end()) {
+    std::move(done).Run(
+        errors::TopicNotPublishingOnNode(node_info, request->topic()));
+    return;
+  }
+  topic_infos->erase(it);
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoSubscribeTopic(const SubscribeTopicRequest* request,
+                                        SubscribeTopicResponse* response,
+                                        StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  const std::string& topic = request->topic();
+  if (Contains(node_state->subscribing_topics(), topic)) {
+    std::move(done).Run(
+        errors::TopicAlreadySubscribingOnNode(node_info, topic));
+    return;
+  }
+
+  *node_state->add_subscribing_topics() = topic;
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+  TopicFilter topic_filter;
+  topic_filter.set_topic(topic);
+  std::vector<TopicInfo> topic_infos = registry_->FindTopicInfos(topic_filter);
+  if (!topic_infos.empty()) {
+    MasterNotification master_notification;
+    *master_notification.mutable_topic_info() = topic_infos[0];
+    NotifyClient(master_notification);
+  }
+}
+
+void PeerMasterClient::DoUnsubscribeTopic(
+    const UnsubscribeTopicRequest* request, UnsubscribeTopicResponse* response,
+    StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  if (!RemoveName(node_state->mutable_subscribing_topics(), request->topic())) {
+    std::move(done).Run(
+        errors::TopicNotSubscribingOnNode(node_info, request->topic()));
+    return;
+  }
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoListTopics(const ListTopicsRequest* request,
+                                    ListTopicsResponse* response,
+                                    StatusOnceCallback done) {
+  for (auto& topic_info : registry_->FindTopicInfos(request->topic_filter())) {
+    *response->add_topic_infos() = topic_info;
+  }
+  std::move(done).Run(Status::OK());
+}
+
+void PeerMasterClient::DoRegisterServiceClient(
+    const RegisterServiceClientRequest* request,
+    RegisterServiceClientResponse* response, StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  const std::string& service = request->service();
+  if (Contains(node_state->requesting_services(), service)) {
+    std::move(done).Run(
+        errors::ServiceAlreadyRequestingOnNode(node_info, service));
+    return;
+  }
+
+  *node_state->add_requesting_services() = service;
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+  ServiceFilter service_filter;
+  service_filter.set_service(service);
+  std::vector<ServiceInfo> service_infos =
+      registry_->FindServiceInfos(service_filter);
+  if (!service_infos.empty()) {
+    MasterNotification master_notification;
+    for (auto& service_info : service_infos) {
+      *master_notification.add_service_infos() = service_info;
+    }
+    NotifyClient(master_notification);
+  }
+}
+
+void PeerMasterClient::DoUnregisterServiceClient(
+    const UnregisterServiceClientRequest* request,
+    UnregisterServiceClientResponse* response, StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  if (!RemoveName(node_state->mutable_requesting_services(),
+                  request->service())) {
+    std::move(done).Run(
+        errors::ServiceNotRequestingOnNode(node_info, request->service()));
+    return;
+  }
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoRegisterServiceServer(
+    const RegisterServiceServerRequest* request,
+    RegisterServiceServerResponse* response, StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  const ServiceInfo& service_info = request->service_info();
+  if (!IsValidChannelSource(service_info.service_source())) {
+    std::move(done).Run(errors::ChannelSourceNotValid(
+        "service source", service_info.service_source()));
+    return;
+  }
+
+  for (auto& serving_service_info : node_state->serving_service_infos()) {
+    if (serving_service_info.service() == service_info.service()) {
+      std::move(done).Run(
+          errors::ServiceAlreadyServingOnNode(node_info, service_info));
+      return;
+    }
+  }
+
+  *node_state->add_serving_service_infos() = service_info;
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoUnregisterServiceServer(
+    const UnregisterServiceServerRequest* request,
+    UnregisterServiceServerResponse* response, StatusOnceCallback done) {
+  const NodeInfo& node_info = request->node_info();
+  NodeState* node_state = FindOwnNodeState(node_info);
+  if (!node_state) {
+    std::move(done).Run(errors::NodeNotRegistered(node_info));
+    return;
+  }
+
+  auto* service_infos = node_state->mutable_serving_service_infos();
+  auto it = std::find_if(service_infos->begin(), service_infos->end(),
+                         [&request](const ServiceInfo& service_info) {
+                           return service_info.service() == request->service();
+                         });
+  if (it == service_infos->end()) {
+    std::move(done).Run(
+        errors::ServiceNotServingOnNode(node_info, request->service()));
+    return;
+  }
+  service_infos->erase(it);
+  std::move(done).Run(Status::OK());
+
+  OnOwnStateChanged();
+}
+
+void PeerMasterClient::DoListServices(const ListServicesRequest* request,
+                                      ListServicesResponse* response,
+                                      StatusOnceCallback done) {
+  for (auto& service_info :
+       registry_->FindServiceInfos(request->service_filter())) {
+    *response->add_service_infos() = service_info;
+  }
+  std::move(done).Run(Status::OK());
+}
+
+NodeState* PeerMasterClient::FindOwnNodeState(const NodeInfo& node_info) {
+  if (node_info.client_id() != client_state_.client_info().id())
+    return nullptr;
+  for (auto& node_state : *client_state_.mutable_node_states()) {
+    if (node_state.node_info().name() == node_info.name()) return &node_state;
+  }
+  return nullptr;
+}
+
+bool PeerMasterClient::HasWatcher() const {
+  for (auto& node_state : client_state_.node_states()) {
+    if (node_state.node_info().watcher()) return true;
+  }
+  return false;
+}
+
+void PeerMasterClient::OnOwnStateChanged() {
+  sequence_++;
+  registry_->SetOwnState(client_state_);
+  Announce();
+  NotifyChanges();
+}
+
+void PeerMasterClient::NotifyChanges() {
+  std::vector<TopicInfo> topic_infos;
+  std::vector<ServiceInfo> service_infos;
+  registry_->TakeChanges(&topic_infos, &service_infos);
+
+  bool has_watcher = HasWatcher();
+  MasterNotification master_notification;
+  for (auto& topic_info : topic_infos) {
+    bool subscribing = false;
+    for (auto& node_state : client_state_.node_states()) {
+      if (Contains(node_state.subscribing_topics(), topic_info.topic())) {
+        subscribing = true;
+        break;
+      }
+    }
+    if (subscribing || has_watcher)
+      *master_notification.add_topic_infos() = topic_info;
+  }
+  for (auto& service_info : service_infos) {
+    for (auto& node_state : client_state_.node_states()) {
+      if (Contains(node_state.requesting_services(), service_info.service())) {
+        *master_notification.add_service_infos() = service_info;
+        break;
+      }
+    }
+  }
+
+  if (master_notification.topic_infos_size() > 0 ||
+      master_notification.service_infos_size() > 0) {
+    NotifyClient(master_notification);
+  }
+}
+
+void PeerMasterClient::NotifyClient(
+    const MasterNotification& master_notification) {
+  const ChannelSource& channel_source =
+      client_state_.client_info().master_notification_watcher_source();
+  DCHECK_EQ(channel_source.channel_defs_size(), 1);
+  DCHECK_EQ(channel_source.channel_defs(0).type(),
+            ChannelDef::CHANNEL_TYPE_TCP);
+
+  auto channel = ChannelFactory::NewChannel(ChannelDef::CHANNEL_TYPE_TCP);
+  // A notification can hold any number of infos, so the buffer grows to fit
+  // it.
+  channel->SetSendBufferSize(kMasterNotificationBytes);
+  channel->SetDynamicSendBuffer(true);
+  Channel* channel_ptr = channel.get();
+  channel_ptr->Connect(
+      channel_source.channel_defs(0),
+      base::BindOnce(&PeerMasterClient::OnConnectToMasterNotificationWatcher,
+                     base::Unretained(this), base::Passed(&channel),
+                     master_notification));
+}
+
+void PeerMasterClient::OnConnectToMasterNotificationWatcher(
+    std::unique_ptr<Channel> channel,
+    const MasterNotification& master_notification, Status s) {
+  if (s.ok()) {
+    MessageSender<MasterNotification> sender(channel.get());
+    // |channel| is kept until the message is sent.
+    sender.SendMessage(
+        master_notification,
+        base::BindOnce(
+            [](std::unique_ptr<Channel> channel, Status s) {
+              LOG_IF(ERROR, !s.ok()) << "Failed to send message: " << s;
+            },
+            base::Passed(&channel)));
+  } else {
+    LOG(ERROR) << "Failed to connect master notification channel: " << s;
+  }
+}
+
+void PeerMasterClient::Announce() {
+  if (!socket_ || !client_state_.has_client_info()) return;
+  if (write_buffer_) {
+    announce_again_ = true;
+    return;
+  }
+  bool leaving = stop_event_ != nullptr;
+
+  PeerAnnouncement announcement;
+  *announcement.mutable_client_state() = client_state_;
+  announcement.set_sequence(sequence_);
+  announcement.set_announce_interval(interval_.InMilliseconds());
+  announcement.set_leaving(leaving);
+  std::string text;
+  announcement.SerializeToString(&text);
+  if (text.length() > kMaxAnnouncementBytes) {
+    LOG(ERROR) << "Announcement is too big to send: " << text.length();
+    return;
+  }
+
+  size_t length = text.length();
+  write_buffer_ = base::MakeRefCounted<net::StringIOBuffer>(text);
+  int rv = socket_->SendTo(
+      write_buffer_.get(), length, multicast_ip_endpoint_,
+      base::BindOnce(&PeerMasterClient::OnAnnounce, base::Unretained(this),
+                     leaving));
+  if (rv != net::ERR_IO_PENDING) OnAnnounce(leaving, rv);
+}
+
+void PeerMasterClient::OnAnnounce(bool leaving, int result) {
+  LOG_IF(ERROR, result < 0)
+      << "Failed to announce: " << net::ErrorToString(result);
+  write_buffer_ = nullptr;
+  if (leaving) {
+    OnLeft();
+    return;
+  }
+  if (announce_again_) {
+    announce_again_ = false;
+    if (stop_event_) {
+      AnnounceToLeave();
+    } else {
+      Announce();
+    }
+  }
+}
+
+void PeerMasterClient::ReadAnnouncement() {
+  if (!socket_) return;
+  int rv = socket_->Read(read_buffer_.get(), kMaxAnnouncementBytes,
+                         base::BindOnce(&PeerMasterClient::OnReadAnnouncement,
+                                        base::Unretained(this)));
+  if (rv != net::ERR_IO_PENDING) {
+    // Posts rather than loops, not to starve the other tasks.
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::BindOnce(&PeerMasterClient::OnReadAnnouncement,
+                                  base::Unretained(this), rv));
+  }
+}
+
+void PeerMasterClient::OnReadAnnouncement(int result) {
+  if (!socket_) return;
+  if (result < 0) {
+    LOG(ERROR) << "Failed to read announcement: " << net::ErrorToString(result);
+  } else {
+    PeerAnnouncement announcement;
+    if (announcement.ParseFromArray(read_buffer_->data(), result) &&
+        registry_->OnAnnouncement(announcement, base::TimeTicks::Now())) {
+      NotifyChanges();
+    }
+  }
+  ReadAnnouncement();
+}
+
+void PeerMasterClient::OnTick() {
+  if (!registry_->RemoveDeadPeers(base::TimeTicks::Now()).empty())
+    NotifyChanges();
+  Announce();
+  ScheduleTick();
+}
+
+void PeerMasterClient::ScheduleTick() {
+  tick_.Reset(
+      base::BindOnce(&PeerMasterClient::OnTick, base::Unretained(this)));
+  base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+      FROM_HERE, tick_.callback(), interval_);
+}
+
+}  // namespace felicia
@@ -0,0 +1,116 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_PEER_MASTER_CLIENT_H_
+#define FELICIA_CORE_MASTER_PEER_MASTER_CLIENT_H_
+
+#include <memory>
+
+#include "third_party/chromium/base/cancelable_callback.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+#include "third_party/chromium/base/threading/thread.h"
+#include "third_party/chromium/net/base/io_buffer.h"
+#include "third_party/chromium/net/base/ip_endpoint.h"
+#include "third_party/chromium/net/socket/udp_socket.h"
+
+#include "felicia/core/channel/channel.h"
+#include "felicia/core/master/master_client_interface.h"
+#include "felicia/core/master/peer_registry.h"
+
+namespace felicia {
+
+// Returns true if FEL_PEER_DISCOVERY is set, where clients find each other
+// without a master.
+bool IsPeerDiscoveryEnabled();
+
+// PeerMasterClient serves the requests of MasterClientInterface by itself
+// instead of a master. The state of its own client is multicast to the peers
+// periodically and whenever it changes, and the routing table is built out
+// of the announcements of the peers in PeerRegistry. The changes of the
+// topics and the services are delivered to its own MasterNotificationWatcher,
+// as the master does.
+//
+// Since the peers are found by UDP multicast, more than one process on the
+// same host can join, as well as the processes over the local network.
+class PeerMasterClient : public MasterClientInterface {
+ public:
+  static constexpr int64_t kDefaultAnnounceInterval = 1000;  // in ms
+
+  PeerMasterClient();
+  ~PeerMasterClient() override;
+
+  Status Start() override;
+  Status Stop() override;
+
+#define MASTER_METHOD(Method, method, cancelable)                         \
+  void Method##Async(const Method##Request* request,                      \
+                     Method##Response* response, StatusOnceCallback done) \
+      override;
+#include "felicia/core/master/rpc/master_method_list.h"
+#undef MASTER_METHOD
+
+ private:
+  void DoStart(base::WaitableEvent* event, Status* status);
+  void DoStop(base::WaitableEvent* event);
+
+#define MASTER_METHOD(Method, method, cancelable)                    \
+  void Do##Method(const Method##Request* request,                    \
+                  Method##Response* response, StatusOnceCallback done);
+#include "felicia/core/master/rpc/master_method_list.h"
+#undef MASTER_METHOD
+
+  NodeState* FindOwnNodeState(const NodeInfo& node_info);
+  bool HasWatcher() const;
+
+  // Applies the change of the own state, announces it and notifies.
+  void OnOwnStateChanged();
+
+  // Notifies the changes of the registry to the own subscribers, the own
+  // service clients and the own watcher.
+  void NotifyChanges();
+  void NotifyClient(const MasterNotification& master_notification);
+  void OnConnectToMasterNotificationWatcher(
+      std::unique_ptr<Channel> channel,
+      const MasterNotification& master_notification, Status s);
+
+  // Announces the own state, which is leaving if it's stopping.
+  void Announce();
+  void OnAnnounce(bool leaving, int result);
+  // Announces to leave, and closes |socket_| once it's sent.
+  void AnnounceToLeave();
+  void OnLeft();
+
+  void ReadAnnouncement();
+  void OnReadAnnouncement(int result);
+
+  // Removes the dead peers and announces. This runs every |interval_|.
+  void OnTick();
+  void ScheduleTick();
+
+  std::unique_ptr<base::Thread> thread_;
+  base::TimeDelta interval_;
+
+  net::IPEndPoint multicast_ip_endpoint_;
+  std::unique_ptr<net::UDPSocket> socket_;
+  scoped_refptr<net::IOBuffer> read_buffer_;
+  // Set while an announcement is being sent, and |announce_again_| is set if
+  // the state changes in the meantime.
+  scoped_refptr<net::IOBuffer> write_buffer_;
+  bool announce_again_ = false;
+  // Set while it's stopping, and signaled once the leaving announcement is
+  // sent.
+  base::WaitableEvent* stop_event_ = nullptr;
+
+  ClientState client_state_;
+  uint64_t sequence_ = 0;
+  std::unique_ptr<PeerRegistry> registry_;
+  base::CancelableOnceClosure tick_;
+
+  DISALLOW_COPY_AND_ASSIGN(PeerMasterClient);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_PEER_MASTER_CLIENT_H_
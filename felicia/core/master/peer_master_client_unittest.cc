@@ -0,0 +1,131 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/peer_master_client.h"
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
+#include "third_party/chromium/base/threading/platform_thread.h"
+
+#include "felicia/core/lib/net/net_util.h"
+
+namespace felicia {
+
+namespace {
+
+void Signal(base::WaitableEvent* event, Status* status, Status s) {
+  *status = s;
+  event->Signal();
+}
+
+#define CALL_METHOD(client, Method, request, response)                   \
+  [&]() {                                                                \
+    base::WaitableEvent event;                                           \
+    Status s;                                                            \
+    (client)->Method##Async(request, response,                           \
+                            base::BindOnce(&Signal, &event, &s));        \
+    event.Wait();                                                        \
+    return s;                                                            \
+  }()
+
+ChannelSource NewRandomTCPChannelSource() {
+  ChannelSource channel_source;
+  ChannelDef* channel_def = channel_source.add_channel_defs();
+  channel_def->set_type(ChannelDef::CHANNEL_TYPE_TCP);
+  IPEndPoint* ip_endpoint = channel_def->mutable_ip_endpoint();
+  ip_endpoint->set_ip(HostIPAddress(HOST_IP_ONLY_ALLOW_IPV4).ToString());
+  ip_endpoint->set_port(PickRandomPort(true));
+  return channel_source;
+}
+
+}  // namespace
+
+// Two clients, each with its own socket, find each other over the multicast
+// group as the clients in different processes do.
+class PeerMasterClientTest : public testing::Test {
+ public:
+  void SetUp() override {
+    setenv("FEL_PEER_DISCOVERY_PORT",
+           base::NumberToString(PickRandomPort(false)).c_str(), 1);
+    publishing_client_ = std::make_unique<PeerMasterClient>();
+    listing_client_ = std::make_unique<PeerMasterClient>();
+    ASSERT_TRUE(publishing_client_->Start().ok());
+    ASSERT_TRUE(listing_client_->Start().ok());
+  }
+
+  void TearDown() override {
+    listing_client_.reset();
+    publishing_client_.reset();
+    unsetenv("FEL_PEER_DISCOVERY_PORT");
+  }
+
+  // Polls |listing_client_| until it lists |topic_count| topics.
+  bool WaitForTopics(int topic_count, base::TimeDelta timeout) {
+    base::TimeTicks deadline = base::TimeTicks::Now() + timeout;
+    while (base::TimeTicks::Now() < deadline) {
+      ListTopicsRequest request;
+      ListTopicsResponse response;
+      request.mutable_topic_filter()->set_all(true);
+      Status s = CALL_METHOD(listing_client_, ListTopics, &request, &response);
+      if (s.ok() && response.topic_infos_size() == topic_count) return true;
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+    }
+    return false;
+  }
+
+ protected:
+  std::unique_ptr<PeerMasterClient> publishing_client_;
+  std::unique_ptr<PeerMasterClient> listing_client_;
+};
+
+TEST_F(PeerMasterClientTest, DiscoverAndLeave) {
+  uint32_t client_id;
+  {
+    RegisterClientRequest request;
+    RegisterClientResponse response;
+    ClientInfo* client_info = request.mutable_client_info();
+    *client_info->mutable_master_notification_watcher_source() =
+        NewRandomTCPChannelSource();
+    ASSERT_TRUE(
+        CALL_METHOD(publishing_client_, RegisterClient, &request, &response)
+            .ok());
+    client_id = response.id();
+  }
+  NodeInfo node_info;
+  {
+    RegisterNodeRequest request;
+    RegisterNodeResponse response;
+    request.mutable_node_info()->set_client_id(client_id);
+    ASSERT_TRUE(
+        CALL_METHOD(publishing_client_, RegisterNode, &request, &response)
+            .ok());
+    node_info = response.node_info();
+  }
+  {
+    PublishTopicRequest request;
+    PublishTopicResponse response;
+    *request.mutable_node_info() = node_info;
+    TopicInfo* topic_info = request.mutable_topic_info();
+    topic_info->set_topic("topic");
+    *topic_info->mutable_topic_source() = NewRandomTCPChannelSource();
+    ASSERT_TRUE(
+        CALL_METHOD(publishing_client_, PublishTopic, &request, &response)
+            .ok());
+  }
+
+  // A change is announced at once, not at the next interval.
+  EXPECT_TRUE(WaitForTopics(1, base::TimeDelta::FromSeconds(1)));
+
+  // The leaving announcement lets the peer forget the topic well before the
+  // publishing client is suspected after 5 missed intervals.
+  publishing_client_->Stop();
+  EXPECT_TRUE(WaitForTopics(0, base::TimeDelta::FromSeconds(1)));
+}
+
+#undef CALL_METHOD
+
+}  // namespace felicia
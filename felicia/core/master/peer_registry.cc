@@ -0,0 +1,235 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/peer_registry.h"
+
+#include <algorithm>
+
+#include "felicia/core/master/failure_detector.h"
+#include "felicia/core/master/service_server_key.h"
+
+namespace felicia {
+
+namespace {
+
+bool Contains(const google::protobuf::RepeatedPtrField<std::string>& names,
+              const std::string& name) {
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+bool IsPublishingTopic(const NodeState& node_state, const std::string& topic) {
+  for (auto& topic_info : node_state.publishing_topic_infos()) {
+    if (topic_info.topic() == topic) return true;
+  }
+  return false;
+}
+
+bool IsServingService(const NodeState& node_state,
+                      const std::string& service) {
+  for (auto& service_info : node_state.serving_service_infos()) {
+    if (service_info.service() == service) return true;
+  }
+  return false;
+}
+
+bool MatchNodeFilter(const NodeState& node_state,
+                     const NodeFilter& node_filter) {
+  if (node_filter.all()) return true;
+  if (!node_filter.publishing_topic().empty())
+    return IsPublishingTopic(node_state, node_filter.publishing_topic());
+  if (!node_filter.subscribing_topic().empty())
+    return Contains(node_state.subscribing_topics(),
+                    node_filter.subscribing_topic());
+  if (!node_filter.requesting_service().empty())
+    return Contains(node_state.requesting_services(),
+                    node_filter.requesting_service());
+  if (!node_filter.serving_service().empty())
+    return IsServingService(node_state, node_filter.serving_service());
+  if (!node_filter.name().empty())
+    return node_state.node_info().name() == node_filter.name();
+  if (node_filter.watcher()) return node_state.node_info().watcher();
+  return false;
+}
+
+// Compares the entries of |old_infos| and |new_infos| and appends the ones
+// changed to |changes|.
+template <typename InfoTy>
+void Diff(const std::map<std::string, InfoTy>& old_infos,
+          const std::map<std::string, InfoTy>& new_infos,
+          std::vector<InfoTy>* changes) {
+  for (auto& new_info : new_infos) {
+    auto it = old_infos.find(new_info.first);
+    if (it == old_infos.end() || it->second.SerializeAsString() !=
+                                     new_info.second.SerializeAsString()) {
+      changes->push_back(new_info.second);
+    }
+  }
+  for (auto& old_info : old_infos) {
+    if (new_infos.find(old_info.first) != new_infos.end()) continue;
+    InfoTy info = old_info.second;
+    info.set_status(InfoTy::UNREGISTERED);
+    changes->push_back(info);
+  }
+}
+
+}  // namespace
+
+PeerRegistry::PeerRegistry(base::TimeTicks now) : liveness_tracker_(now) {}
+
+PeerRegistry::~PeerRegistry() = default;
+
+void PeerRegistry::SetOwnState(const ClientState& client_state) {
+  own_state_ = client_state;
+}
+
+bool PeerRegistry::OnAnnouncement(const PeerAnnouncement& announcement,
+                                  base::TimeTicks now) {
+  uint32_t id = announcement.client_state().client_info().id();
+  if (id == own_state_.client_info().id()) return false;
+
+  auto it = peers_.find(id);
+  if (it != peers_.end() && it->second.sequence > announcement.sequence())
+    return false;
+
+  if (announcement.leaving()) {
+    peers_.erase(id);
+    liveness_tracker_.Untrack(id);
+    return true;
+  }
+
+  if (it == peers_.end()) {
+    liveness_tracker_.Track(
+        id,
+        NewFailureDetector(base::TimeDelta::FromMilliseconds(
+                               announcement.announce_interval()),
+                           now),
+        now);
+  } else {
+    liveness_tracker_.OnHeartBeat(id, now);
+  }
+  Peer& peer = peers_[id];
+  peer.client_state = announcement.client_state();
+  peer.sequence = announcement.sequence();
+  return true;
+}
+
+std::vector<uint32_t> PeerRegistry::RemoveDeadPeers(base::TimeTicks now) {
+  std::vector<uint32_t> ids = liveness_tracker_.Advance(now);
+  for (uint32_t id : ids) {
+    peers_.erase(id);
+  }
+  return ids;
+}
+
+bool PeerRegistry::HasClient(uint32_t id) const {
+  return id == own_state_.client_info().id() ||
+         peers_.find(id) != peers_.end();
+}
+
+const NodeState* PeerRegistry::FindNodeState(const std::string& name) const {
+  for (const ClientState* client_state : AllClientStates()) {
+    for (auto& node_state : client_state->node_states()) {
+      if (node_state.node_info().name() == name) return &node_state;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<ClientInfo> PeerRegistry::FindClientInfos(
+    const ClientFilter& client_filter) const {
+  std::vector<ClientInfo> client_infos;
+  for (const ClientState* client_state : AllClientStates()) {
+    if (client_filter.all() ||
+        client_state->client_info().id() == client_filter.id()) {
+      client_infos.push_back(client_state->client_info());
+    }
+  }
+  return client_infos;
+}
+
+std::vector<NodeInfo> PeerRegistry::FindNodeInfos(
+    const NodeFilter& node_filter) const {
+  std::vector<NodeInfo> node_infos;
+  for (const ClientState* client_state : AllClientStates()) {
+    for (auto& node_state : client_state->node_states()) {
+      if (MatchNodeFilter(node_state, node_filter))
+        node_infos.push_back(node_state.node_info());
+    }
+  }
+  return node_infos;
+}
+
+std::vector<TopicInfo> PeerRegistry::FindTopicInfos(
+    const TopicFilter& topic_filter) const {
+  std::vector<TopicInfo> topic_infos;
+  for (auto& topic_info : CurrentTopicInfos()) {
+    if (topic_filter.all() || topic_filter.topic() == topic_info.first)
+      topic_infos.push_back(topic_info.second);
+  }
+  return topic_infos;
+}
+
+std::vector<ServiceInfo> PeerRegistry::FindServiceInfos(
+    const ServiceFilter& service_filter) const {
+  std::vector<ServiceInfo> service_infos;
+  for (auto& service_info : CurrentServiceInfos()) {
+    if (service_filter.all() ||
+        service_filter.service() == service_info.second.service())
+      service_infos.push_back(service_info.second);
+  }
+  return service_infos;
+}
+
+void PeerRegistry::TakeChanges(std::vector<TopicInfo>* topic_infos,
+                               std::vector<ServiceInfo>* service_infos) {
+  std::map<std::string, TopicInfo> new_topic_infos = CurrentTopicInfos();
+  std::map<std::string, ServiceInfo> new_service_infos = CurrentServiceInfos();
+  Diff(topic_infos_, new_topic_infos, topic_infos);
+  Diff(service_infos_, new_service_infos, service_infos);
+  topic_infos_ = std::move(new_topic_infos);
+  service_infos_ = std::move(new_service_infos);
+}
+
+std::vector<const ClientState*> PeerRegistry::AllClientStates() const {
+  std::vector<const ClientState*> client_states;
+  client_states.reserve(peers_.size() + 1);
+  bool own_added = !own_state_.has_client_info();
+  uint32_t own_id = own_state_.client_info().id();
+  for (auto& peer : peers_) {
+    if (!own_added && own_id < peer.first) {
+      client_states.push_back(&own_state_);
+      own_added = true;
+    }
+    client_states.push_back(&peer.second.client_state);
+  }
+  if (!own_added) client_states.push_back(&own_state_);
+  return client_states;
+}
+
+std::map<std::string, TopicInfo> PeerRegistry::CurrentTopicInfos() const {
+  std::map<std::string, TopicInfo> topic_infos;
+  for (const ClientState* client_state : AllClientStates()) {
+    for (auto& node_state : client_state->node_states()) {
+      for (auto& topic_info : node_state.publishing_topic_infos()) {
+        // Keeps the one of the smallest client id.
+        topic_infos.emplace(topic_info.topic(), topic_info);
+      }
+    }
+  }
+  return topic_infos;
+}
+
+std::map<std::string, ServiceInfo> PeerRegistry::CurrentServiceInfos() const {
+  std::map<std::string, ServiceInfo> service_infos;
+  for (const ClientState* client_state : AllClientStates()) {
+    for (auto& node_state : client_state->node_states()) {
+      for (auto& service_info : node_state.serving_service_infos()) {
+        service_infos.emplace(ServiceServerKey(service_info), service_info);
+      }
+    }
+  }
+  return service_infos;
+}
+
+}  // namespace felicia
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_PEER_REGISTRY_H_
+#define FELICIA_CORE_MASTER_PEER_REGISTRY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/master/liveness_tracker.h"
+#include "felicia/core/protobuf/master_data.pb.h"
+#include "felicia/core/protobuf/master_state.pb.h"
+
+namespace felicia {
+
+// PeerRegistry is the registry which each client holds for itself in the peer
+// discovery mode. It consists of the state of its own client and the states
+// announced by the peers. A peer is removed if it leaves, or if it misses
+// its announcements, which is checked by a LivenessTracker.
+//
+// If more than one client publishes the same topic, the one with the smallest
+// client id is taken, so that every client agrees on it without a master.
+// Every server of the same service is taken, and the service clients balance
+// the calls among them. This is not thread-safe.
+class PeerRegistry {
+ public:
+  explicit PeerRegistry(base::TimeTicks now);
+  ~PeerRegistry();
+
+  const ClientState& own_state() const { return own_state_; }
+  void SetOwnState(const ClientState& client_state);
+
+  // Applies |announcement| of a peer which arrived at |now|. Returns false if
+  // it is the own one, or it is older than the one applied before.
+  bool OnAnnouncement(const PeerAnnouncement& announcement,
+                      base::TimeTicks now);
+
+  // Removes the peers which are suspected to be dead at |now|, and returns
+  // their ids.
+  std::vector<uint32_t> RemoveDeadPeers(base::TimeTicks now);
+
+  bool HasClient(uint32_t id) const;
+  // Returns nullptr if there's no node named |name|.
+  const NodeState* FindNodeState(const std::string& name) const;
+
+  std::vector<ClientInfo> FindClientInfos(
+      const ClientFilter& client_filter) const;
+  std::vector<NodeInfo> FindNodeInfos(const NodeFilter& node_filter) const;
+  std::vector<TopicInfo> FindTopicInfos(const TopicFilter& topic_filter) const;
+  std::vector<ServiceInfo> FindServiceInfos(
+      const ServiceFilter& service_filter) const;
+
+  // Returns the published topics and the served services which have changed
+  // since the last call. The ones gone are returned with the status
+  // UNREGISTERED.
+  void TakeChanges(std::vector<TopicInfo>* topic_infos,
+                   std::vector<ServiceInfo>* service_infos);
+
+ private:
+  struct Peer {
+    ClientState client_state;
+    uint64_t sequence;
+  };
+
+  // Returns the states of all the clients, sorted by the client id.
+  std::vector<const ClientState*> AllClientStates() const;
+
+  std::map<std::string, TopicInfo> CurrentTopicInfos() const;
+  // Keyed by the service and the service source.
+  std::map<std::string, ServiceInfo> CurrentServiceInfos() const;
+
+  ClientState own_state_;
+  std::map<uint32_t, Peer> peers_;
+  LivenessTracker liveness_tracker_;
+
+  // The topics and the services as of the last TakeChanges().
+  std::map<std::string, TopicInfo> topic_infos_;
+  std::map<std::string, ServiceInfo> service_infos_;
+
+  DISALLOW_COPY_AND_ASSIGN(PeerRegistry);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_PEER_REGISTRY_H_
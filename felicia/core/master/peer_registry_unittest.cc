@@ -0,0 +1,177 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/peer_registry.h"
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr uint32_t kOwnId = 5;
+constexpr uint32_t kPeerId = 3;
+constexpr uint32_t kAnnounceInterval = 1000;
+
+ClientState MakeClientState(uint32_t id, const std::string& node,
+                            const std::string& topic,
+                            const std::string& type_name) {
+  ClientState client_state;
+  client_state.mutable_client_info()->set_id(id);
+  NodeState* node_state = client_state.add_node_states();
+  node_state->mutable_node_info()->set_name(node);
+  node_state->mutable_node_info()->set_client_id(id);
+  TopicInfo* topic_info = node_state->add_publishing_topic_infos();
+  topic_info->set_topic(topic);
+  topic_info->set_type_name(type_name);
+  return client_state;
+}
+
+ClientState MakeServingClientState(uint32_t id, const std::string& node,
+                                   const std::string& service,
+                                   uint16_t port) {
+  ClientState client_state;
+  client_state.mutable_client_info()->set_id(id);
+  NodeState* node_state = client_state.add_node_states();
+  node_state->mutable_node_info()->set_name(node);
+  node_state->mutable_node_info()->set_client_id(id);
+  ServiceInfo* service_info = node_state->add_serving_service_infos();
+  service_info->set_service(service);
+  ChannelDef* channel_def =
+      service_info->mutable_service_source()->add_channel_defs();
+  channel_def->set_type(ChannelDef::CHANNEL_TYPE_TCP);
+  channel_def->mutable_ip_endpoint()->set_ip("127.0.0.1");
+  channel_def->mutable_ip_endpoint()->set_port(port);
+  return client_state;
+}
+
+PeerAnnouncement MakeAnnouncement(const ClientState& client_state,
+                                  uint64_t sequence) {
+  PeerAnnouncement announcement;
+  *announcement.mutable_client_state() = client_state;
+  announcement.set_sequence(sequence);
+  announcement.set_announce_interval(kAnnounceInterval);
+  return announcement;
+}
+
+}  // namespace
+
+class PeerRegistryTest : public testing::Test {
+ public:
+  PeerRegistryTest() : now_(base::TimeTicks::Now()), registry_(now_) {}
+
+ protected:
+  void TakeChanges(std::vector<TopicInfo>* topic_infos) {
+    std::vector<ServiceInfo> service_infos;
+    registry_.TakeChanges(topic_infos, &service_infos);
+    EXPECT_TRUE(service_infos.empty());
+  }
+
+  base::TimeTicks now_;
+  PeerRegistry registry_;
+};
+
+TEST_F(PeerRegistryTest, TakeChanges) {
+  registry_.SetOwnState(MakeClientState(kOwnId, "own", "a", "A"));
+  PeerAnnouncement announcement =
+      MakeAnnouncement(MakeClientState(kPeerId, "peer", "b", "B"), 1);
+  EXPECT_TRUE(registry_.OnAnnouncement(announcement, now_));
+
+  std::vector<TopicInfo> topic_infos;
+  TakeChanges(&topic_infos);
+  ASSERT_EQ(2u, topic_infos.size());
+  EXPECT_EQ("a", topic_infos[0].topic());
+  EXPECT_EQ("b", topic_infos[1].topic());
+  EXPECT_EQ(TopicInfo::REGISTERED, topic_infos[1].status());
+
+  topic_infos.clear();
+  TakeChanges(&topic_infos);
+  EXPECT_TRUE(topic_infos.empty());
+
+  announcement.set_sequence(2);
+  announcement.set_leaving(true);
+  EXPECT_TRUE(registry_.OnAnnouncement(announcement, now_));
+  TakeChanges(&topic_infos);
+  ASSERT_EQ(1u, topic_infos.size());
+  EXPECT_EQ("b", topic_infos[0].topic());
+  EXPECT_EQ(TopicInfo::UNREGISTERED, topic_infos[0].status());
+  EXPECT_FALSE(registry_.HasClient(kPeerId));
+}
+
+TEST_F(PeerRegistryTest, SmallestClientIdPublishes) {
+  registry_.SetOwnState(MakeClientState(kOwnId, "own", "a", "Own"));
+  registry_.OnAnnouncement(
+      MakeAnnouncement(MakeClientState(kPeerId, "peer", "a", "Peer"), 1),
+      now_);
+
+  TopicFilter topic_filter;
+  topic_filter.set_topic("a");
+  std::vector<TopicInfo> topic_infos = registry_.FindTopicInfos(topic_filter);
+  ASSERT_EQ(1u, topic_infos.size());
+  EXPECT_EQ("Peer", topic_infos[0].type_name());
+
+  NodeFilter node_filter;
+  node_filter.set_publishing_topic("a");
+  EXPECT_EQ(2u, registry_.FindNodeInfos(node_filter).size());
+}
+
+TEST_F(PeerRegistryTest, EveryServerServes) {
+  registry_.SetOwnState(MakeServingClientState(kOwnId, "own", "s", 8000));
+  PeerAnnouncement announcement =
+      MakeAnnouncement(MakeServingClientState(kPeerId, "peer", "s", 8001), 1);
+  registry_.OnAnnouncement(announcement, now_);
+
+  ServiceFilter service_filter;
+  service_filter.set_service("s");
+  EXPECT_EQ(2u, registry_.FindServiceInfos(service_filter).size());
+
+  std::vector<TopicInfo> topic_infos;
+  std::vector<ServiceInfo> service_infos;
+  registry_.TakeChanges(&topic_infos, &service_infos);
+  EXPECT_EQ(2u, service_infos.size());
+
+  announcement.set_sequence(2);
+  announcement.set_leaving(true);
+  registry_.OnAnnouncement(announcement, now_);
+  service_infos.clear();
+  registry_.TakeChanges(&topic_infos, &service_infos);
+  ASSERT_EQ(1u, service_infos.size());
+  EXPECT_EQ(ServiceInfo::UNREGISTERED, service_infos[0].status());
+  EXPECT_EQ(8001, service_infos[0]
+                      .service_source()
+                      .channel_defs(0)
+                      .ip_endpoint()
+                      .port());
+  EXPECT_EQ(1u, registry_.FindServiceInfos(service_filter).size());
+}
+
+TEST_F(PeerRegistryTest, IgnoreOwnAndStaleAnnouncements) {
+  ClientState own_state = MakeClientState(kOwnId, "own", "a", "A");
+  registry_.SetOwnState(own_state);
+  EXPECT_FALSE(registry_.OnAnnouncement(MakeAnnouncement(own_state, 1), now_));
+
+  EXPECT_TRUE(registry_.OnAnnouncement(
+      MakeAnnouncement(MakeClientState(kPeerId, "peer", "b", "B"), 2), now_));
+  EXPECT_FALSE(registry_.OnAnnouncement(
+      MakeAnnouncement(MakeClientState(kPeerId, "peer", "c", "C"), 1), now_));
+  EXPECT_NE(nullptr, registry_.FindNodeState("peer"));
+  EXPECT_EQ("b",
+            registry_.FindNodeState("peer")->publishing_topic_infos(0).topic());
+}
+
+TEST_F(PeerRegistryTest, RemoveDeadPeers) {
+  registry_.OnAnnouncement(
+      MakeAnnouncement(MakeClientState(kPeerId, "peer", "b", "B"), 1), now_);
+
+  // A peer is suspected after 5 missed announcements by default.
+  EXPECT_TRUE(
+      registry_.RemoveDeadPeers(now_ + base::TimeDelta::FromSeconds(3))
+          .empty());
+  EXPECT_EQ(std::vector<uint32_t>{kPeerId},
+            registry_.RemoveDeadPeers(now_ + base::TimeDelta::FromSeconds(6)));
+  EXPECT_FALSE(registry_.HasClient(kPeerId));
+  EXPECT_EQ(nullptr, registry_.FindNodeState("peer"));
+}
+
+}  // namespace felicia
@@ -6,8 +6,10 @@
 
 #include <csignal>
 
+#include "third_party/chromium/base/strings/string_number_conversions.h"
 #include "third_party/chromium/base/strings/stringprintf.h"
 
+#include "felicia/core/lib/file/file_util.h"
 #include "felicia/core/lib/net/net_util.h"
 #include "felicia/core/master/rpc/master_server_info.h"
 
@@ -17,6 +19,20 @@ namespace {
 
 MasterServer* g_master_server = nullptr;
 
+constexpr int kDefaultRpcThreadNum = 2;
+
+int ResolveRpcThreadNum() {
+  const char* thread_num_env = getenv("FEL_MASTER_SERVER_RPC_THREADS");
+  if (thread_num_env) {
+    int value;
+    if (base::StringToInt(thread_num_env, &value) && value > 0) {
+      return value;
+    }
+  }
+
+  return kDefaultRpcThreadNum;
+}
+
 void ShutdownMasterServer(int signal) {
   if (g_master_server) {
     g_master_server->Shutdown();
@@ -42,9 +58,14 @@ Status MasterServer::RegisterService(::grpc::ServerBuilder* builder) {
 
 Status MasterServer::Run() {
   RegisterSignals();
+  const char* state_dir_env = getenv("FEL_MASTER_STATE_DIR");
+  if (state_dir_env) {
+    Status s = master_->LoadState(ToFilePath(state_dir_env));
+    LOG_IF(ERROR, !s.ok()) << "Failed to load the state of master: " << s;
+  }
   master_->Run();
 
-  RunRpcsLoops(2);
+  RunRpcsLoops(ResolveRpcThreadNum());
 
   return Status::OK();
 }
@@ -0,0 +1,14 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/master/service_server_key.h"
+
+namespace felicia {
+
+std::string ServiceServerKey(const ServiceInfo& service_info) {
+  return service_info.service() +
+         service_info.service_source().SerializeAsString();
+}
+
+}  // namespace felicia
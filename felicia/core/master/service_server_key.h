@@ -0,0 +1,21 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MASTER_SERVICE_SERVER_KEY_H_
+#define FELICIA_CORE_MASTER_SERVICE_SERVER_KEY_H_
+
+#include <string>
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/protobuf/master_data.pb.h"
+
+namespace felicia {
+
+// Returns the key of |service_info|, which tells the servers of the same
+// service apart.
+FEL_EXPORT std::string ServiceServerKey(const ServiceInfo& service_info);
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MASTER_SERVICE_SERVER_KEY_H_
@@ -42,6 +42,11 @@ MessageIOError Header::AttachHeaderInternally(const std::string& content,
   return MessageIOError::OK;
 }
 
+MessageIOError Header::WriteHeaderInternally(char* buffer) {
+  memcpy(buffer, &size_, sizeof(int));
+  return MessageIOError::OK;
+}
+
 int Header::size() const { return size_; }
 
 void Header::set_size(int size) { size_ = size; }
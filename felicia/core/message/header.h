@@ -27,6 +27,9 @@ class FEL_EXPORT Header {
 
   MessageIOError AttachHeaderInternally(const std::string& content,
                                         char* buffer);
+  // Writes only the header of a content of size() bytes to |buffer|, for the
+  // content which is sent on its own, e.g, in chunks.
+  MessageIOError WriteHeaderInternally(char* buffer);
 
   int size() const;
   void set_size(int size);
@@ -0,0 +1,201 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/lazy_protobuf_message.h"
+
+#include <memory>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "third_party/chromium/base/logging.h"
+
+#include "felicia/core/protobuf/data.pb.h"
+
+namespace felicia {
+
+namespace {
+
+typedef ProtobufWireReader::WireFormatLite WireFormatLite;
+
+// Merges the fields in [|start|, |end|) into |message| without copying them
+// into a std::string first, as MergeFromString() would need.
+bool MergeFromArray(const char* start, const char* end,
+                    google::protobuf::Message* message) {
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t*>(start), static_cast<int>(end - start));
+  return message->MergeFromCodedStream(&input) &&
+         input.ConsumedEntireMessage();
+}
+
+}  // namespace
+
+LazyProtobufMessageBase::LazyProtobufMessageBase() = default;
+
+// The buffer is never written once it is kept, so |fields_| pointing to it
+// stays valid in the copy.
+LazyProtobufMessageBase::LazyProtobufMessageBase(
+    const LazyProtobufMessageBase& other) = default;
+
+LazyProtobufMessageBase& LazyProtobufMessageBase::operator=(
+    const LazyProtobufMessageBase& other) = default;
+
+LazyProtobufMessageBase::LazyProtobufMessageBase(
+    LazyProtobufMessageBase&& other) noexcept
+    : buffer_(std::move(other.buffer_)),
+      serialized_(other.serialized_),
+      fields_(std::move(other.fields_)),
+      indexed_(other.indexed_),
+      valid_(other.valid_) {
+  other.Reset(nullptr, 0);
+}
+
+LazyProtobufMessageBase& LazyProtobufMessageBase::operator=(
+    LazyProtobufMessageBase&& other) {
+  buffer_ = std::move(other.buffer_);
+  serialized_ = other.serialized_;
+  fields_ = std::move(other.fields_);
+  indexed_ = other.indexed_;
+  valid_ = other.valid_;
+  other.Reset(nullptr, 0);
+  return *this;
+}
+
+LazyProtobufMessageBase::~LazyProtobufMessageBase() = default;
+
+void LazyProtobufMessageBase::Reset(const char* start, size_t size) {
+  if (size > 0) {
+    Reset(std::string(start, size));
+  } else {
+    Reset(nullptr, nullptr, 0);
+  }
+}
+
+void LazyProtobufMessageBase::Reset(std::string&& serialized) {
+  if (serialized.empty()) {
+    Reset(nullptr, nullptr, 0);
+    return;
+  }
+  size_t size = serialized.length();
+  auto buffer = base::MakeRefCounted<net::StringIOBuffer>(
+      std::make_unique<std::string>(std::move(serialized)));
+  const char* start = buffer->data();
+  Reset(std::move(buffer), start, size);
+}
+
+void LazyProtobufMessageBase::Reset(scoped_refptr<net::IOBuffer> buffer,
+                                    const char* start, size_t size) {
+  buffer_ = std::move(buffer);
+  serialized_ = base::StringPiece(start, size);
+  fields_.clear();
+  indexed_ = false;
+}
+
+bool LazyProtobufMessageBase::IsValid() const {
+  MaybeIndex();
+  return valid_;
+}
+
+bool LazyProtobufMessageBase::HasField(int number) const {
+  return !!FindField(number);
+}
+
+bool LazyProtobufMessageBase::GetVarint(int number, uint64_t* value) const {
+  const FieldSpan* span = FindField(number);
+  if (!span || span->field.wire_type != WireFormatLite::WIRETYPE_VARINT)
+    return false;
+  *value = span->field.value;
+  return true;
+}
+
+bool LazyProtobufMessageBase::GetFixed(int number, uint64_t* value) const {
+  const FieldSpan* span = FindField(number);
+  if (!span || (span->field.wire_type != WireFormatLite::WIRETYPE_FIXED32 &&
+                span->field.wire_type != WireFormatLite::WIRETYPE_FIXED64))
+    return false;
+  *value = span->field.value;
+  return true;
+}
+
+bool LazyProtobufMessageBase::GetBytes(int number,
+                                       base::StringPiece* bytes) const {
+  const FieldSpan* span = FindField(number);
+  if (!span ||
+      span->field.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+    return false;
+  *bytes = span->field.bytes;
+  return true;
+}
+
+bool LazyProtobufMessageBase::GetData(int number, uint32_t* type,
+                                      base::StringPiece* data) const {
+  base::StringPiece data_message;
+  if (!GetBytes(number, &data_message)) return false;
+
+  *type = 0;
+  *data = base::StringPiece();
+  ProtobufWireReader reader(data_message.data(), data_message.length());
+  ProtobufWireReader::Field field;
+  while (reader.ReadField(&field)) {
+    if (field.number == DataMessage::kTypeFieldNumber &&
+        field.wire_type == WireFormatLite::WIRETYPE_VARINT) {
+      *type = static_cast<uint32_t>(field.value);
+    } else if (field.number == DataMessage::kDataFieldNumber &&
+               field.wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      *data = field.bytes;
+    }
+  }
+  return reader.ok();
+}
+
+bool LazyProtobufMessageBase::ParsePartiallyInternal(
+    google::protobuf::Message* message, size_t threshold) const {
+  MaybeIndex();
+  if (!valid_) return false;
+
+  message->Clear();
+  // Each field on the wire is a valid serialized message by itself, so
+  // consecutive fields to parse are merged at once.
+  const char* start = nullptr;
+  const char* end = nullptr;
+  for (const FieldSpan& span : fields_) {
+    bool skip =
+        span.field.wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED &&
+        span.field.bytes.length() > threshold;
+    if (!skip && start && end == span.start) {
+      end = span.end;
+      continue;
+    }
+    if (start && !MergeFromArray(start, end, message)) return false;
+    start = skip ? nullptr : span.start;
+    end = skip ? nullptr : span.end;
+  }
+  return !start || MergeFromArray(start, end, message);
+}
+
+void LazyProtobufMessageBase::MaybeIndex() const {
+  if (indexed_) return;
+  indexed_ = true;
+
+  fields_.clear();
+  ProtobufWireReader reader(serialized_.data(), serialized_.length());
+  FieldSpan span;
+  span.start = reader.position();
+  while (reader.ReadField(&span.field)) {
+    span.end = reader.position();
+    fields_.push_back(span);
+    span.start = span.end;
+  }
+  valid_ = reader.ok();
+  DLOG_IF(ERROR, !valid_) << "Corrupted protobuf message.";
+}
+
+const LazyProtobufMessageBase::FieldSpan* LazyProtobufMessageBase::FindField(
+    int number) const {
+  MaybeIndex();
+  for (auto it = fields_.rbegin(); it != fields_.rend(); ++it) {
+    if (it->field.number == number) return &(*it);
+  }
+  return nullptr;
+}
+
+}  // namespace felicia
@@ -0,0 +1,133 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_LAZY_PROTOBUF_MESSAGE_H_
+#define FELICIA_CORE_MESSAGE_LAZY_PROTOBUF_MESSAGE_H_
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "third_party/chromium/base/memory/scoped_refptr.h"
+#include "third_party/chromium/base/strings/string_piece.h"
+#include "third_party/chromium/net/base/io_buffer.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/message/protobuf_wire_reader.h"
+
+namespace felicia {
+
+// LazyProtobufMessageBase keeps a serialized protobuf message as it is and
+// parses tags of fields only when one of them is accessed for the first time.
+// Length delimited fields are returned as views into the kept buffer, so
+// reading the timestamp of a CameraFrameMessage costs as much as reading
+// its tags, not its megabytes of data. The buffer is shared, not copied, by
+// copies of this.
+class FEL_EXPORT LazyProtobufMessageBase {
+ public:
+  // Default threshold for ParsePartially(). Length delimited fields larger than
+  // this are left in the buffer.
+  static constexpr size_t kDefaultLazyFieldThreshold = 1024;
+
+  LazyProtobufMessageBase();
+  LazyProtobufMessageBase(const LazyProtobufMessageBase& other);
+  LazyProtobufMessageBase& operator=(const LazyProtobufMessageBase& other);
+  LazyProtobufMessageBase(LazyProtobufMessageBase&& other) noexcept;
+  LazyProtobufMessageBase& operator=(LazyProtobufMessageBase&& other);
+  ~LazyProtobufMessageBase();
+
+  // Keeps a copy of the serialized message in |start| with |size|. Nothing is
+  // parsed at this time.
+  void Reset(const char* start, size_t size);
+  // Takes |serialized| without copying it.
+  void Reset(std::string&& serialized);
+  // Keeps a reference to |buffer|, which holds the serialized message in
+  // |start| with |size|, e.g, the buffer a channel received it into, without
+  // copying it.
+  void Reset(scoped_refptr<net::IOBuffer> buffer, const char* start,
+             size_t size);
+
+  base::StringPiece serialized() const { return serialized_; }
+
+  // Returns false if the buffer is corrupted.
+  bool IsValid() const;
+
+  // Returns true if field |number| exists on the wire. For a singular field,
+  // the last one on the wire wins like protobuf does. Note that proto3
+  // doesn't write fields with default values.
+  bool HasField(int number) const;
+
+  // Reads field |number| whose wire type is VARINT, e.g, int64, uint32, bool
+  // and enum. For sint32 and sint64, use ZigZagDecode in WireFormatLite.
+  bool GetVarint(int number, uint64_t* value) const;
+  // Reads field |number| whose wire type is FIXED32 or FIXED64, e.g, float,
+  // double and fixed64. Use bit_cast to get a floating point.
+  bool GetFixed(int number, uint64_t* value) const;
+  // Returns a view of field |number| whose wire type is LENGTH_DELIMITED,
+  // e.g, bytes, string and message. The view is valid until this is reset or
+  // destroyed.
+  bool GetBytes(int number, base::StringPiece* bytes) const;
+  // Returns a view of the data of the DataMessage in field |number|, along
+  // with its type, without copying.
+  bool GetData(int number, uint32_t* type, base::StringPiece* data) const;
+
+ protected:
+  // Merges every field into |message| except length delimited fields larger
+  // than |threshold|.
+  bool ParsePartiallyInternal(google::protobuf::Message* message,
+                              size_t threshold) const;
+
+ private:
+  struct FieldSpan {
+    ProtobufWireReader::Field field;
+    // Range of the whole field including the tag.
+    const char* start;
+    const char* end;
+  };
+
+  void MaybeIndex() const;
+  const FieldSpan* FindField(int number) const;
+
+  // Owns the memory |serialized_| points to.
+  scoped_refptr<net::IOBuffer> buffer_;
+  base::StringPiece serialized_;
+  // Built by MaybeIndex() from |serialized_| at the first access.
+  mutable std::vector<FieldSpan> fields_;
+  mutable bool indexed_ = false;
+  mutable bool valid_ = false;
+};
+
+template <typename T>
+class LazyProtobufMessage : public LazyProtobufMessageBase {
+ public:
+  static_assert(std::is_base_of<google::protobuf::Message, T>::value,
+                "T should be a protobuf message.");
+
+  typedef T MessageType;
+
+  // Parses every field into |message| except length delimited fields larger
+  // than |threshold|, which can be read by GetBytes() or GetData().
+  bool ParsePartially(T* message,
+                      size_t threshold = kDefaultLazyFieldThreshold) const {
+    return ParsePartiallyInternal(message, threshold);
+  }
+
+  // Parses every field into |message|.
+  bool Parse(T* message) const {
+    base::StringPiece serialized = this->serialized();
+    return message->ParseFromArray(serialized.data(),
+                                   static_cast<int>(serialized.length()));
+  }
+};
+
+template <typename T>
+struct IsLazyProtobufMessage : std::false_type {};
+
+template <typename T>
+struct IsLazyProtobufMessage<LazyProtobufMessage<T>> : std::true_type {};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_LAZY_PROTOBUF_MESSAGE_H_
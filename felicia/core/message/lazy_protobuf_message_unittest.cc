@@ -0,0 +1,181 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/lazy_protobuf_message.h"
+
+#include <string.h>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "gtest/gtest.h"
+
+#include "felicia/core/lib/containers/data_constants.h"
+#include "felicia/core/message/message_io.h"
+#include "felicia/core/message/test/simple_message.pb.h"
+#include "felicia/core/protobuf/data.pb.h"
+
+namespace felicia {
+
+namespace {
+
+typedef ProtobufWireReader::WireFormatLite WireFormatLite;
+
+DataMessage MakeDataMessage(size_t size) {
+  DataMessage data_message;
+  data_message.set_type(DATA_TYPE_8U_C1);
+  data_message.set_data(std::string(size, 'a'));
+  return data_message;
+}
+
+}  // namespace
+
+TEST(LazyProtobufMessageTest, MessageIO) {
+  EXPECT_EQ(MessageIO<DataMessage>::TypeName(),
+            MessageIO<LazyProtobufMessage<DataMessage>>::TypeName());
+
+  DataMessage data_message = MakeDataMessage(10);
+  std::string serialized;
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<DataMessage>::Serialize(&data_message, &serialized));
+
+  LazyProtobufMessage<DataMessage> lazy_message;
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<LazyProtobufMessage<DataMessage>>::Deserialize(
+                serialized.data(), serialized.length(), &lazy_message));
+  std::string serialized2;
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<LazyProtobufMessage<DataMessage>>::Serialize(
+                &lazy_message, &serialized2));
+  EXPECT_EQ(serialized, serialized2);
+
+  DataMessage data_message2;
+  EXPECT_TRUE(lazy_message.Parse(&data_message2));
+  EXPECT_EQ(data_message.data(), data_message2.data());
+}
+
+TEST(LazyProtobufMessageTest, GetFields) {
+  DataMessage data_message = MakeDataMessage(10);
+  std::string serialized;
+  ASSERT_TRUE(data_message.SerializeToString(&serialized));
+
+  LazyProtobufMessage<DataMessage> lazy_message;
+  lazy_message.Reset(serialized.data(), serialized.length());
+  EXPECT_TRUE(lazy_message.IsValid());
+
+  uint64_t type;
+  EXPECT_TRUE(lazy_message.GetVarint(DataMessage::kTypeFieldNumber, &type));
+  EXPECT_EQ(DATA_TYPE_8U_C1, type);
+  base::StringPiece data;
+  EXPECT_TRUE(lazy_message.GetBytes(DataMessage::kDataFieldNumber, &data));
+  EXPECT_EQ(data_message.data(), data);
+  // The view should point into the kept buffer, not a copy.
+  EXPECT_GE(data.data(), lazy_message.serialized().data());
+  EXPECT_LT(data.data(), lazy_message.serialized().data() +
+                             lazy_message.serialized().length());
+
+  // Mismatched wire types and missing fields.
+  EXPECT_FALSE(lazy_message.GetBytes(DataMessage::kTypeFieldNumber, &data));
+  EXPECT_FALSE(lazy_message.GetVarint(DataMessage::kDataFieldNumber, &type));
+  EXPECT_FALSE(lazy_message.HasField(3));
+}
+
+TEST(LazyProtobufMessageTest, KeepBufferWithoutCopy) {
+  DataMessage data_message = MakeDataMessage(2048);
+  std::string serialized;
+  ASSERT_TRUE(data_message.SerializeToString(&serialized));
+  auto buffer = base::MakeRefCounted<net::IOBuffer>(serialized.length());
+  memcpy(buffer->data(), serialized.data(), serialized.length());
+
+  LazyProtobufMessage<DataMessage> lazy_message;
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<LazyProtobufMessage<DataMessage>>::Deserialize(
+                buffer, buffer->data(), serialized.length(), &lazy_message));
+  EXPECT_EQ(buffer->data(), lazy_message.serialized().data());
+  EXPECT_FALSE(buffer->HasOneRef());
+
+  // Copies and moves share the buffer, and the fields indexed over it.
+  base::StringPiece data;
+  EXPECT_TRUE(lazy_message.GetBytes(DataMessage::kDataFieldNumber, &data));
+  LazyProtobufMessage<DataMessage> lazy_message2 = lazy_message;
+  LazyProtobufMessage<DataMessage> lazy_message3 = std::move(lazy_message);
+  base::StringPiece data2;
+  EXPECT_TRUE(lazy_message2.GetBytes(DataMessage::kDataFieldNumber, &data2));
+  EXPECT_EQ(data.data(), data2.data());
+  EXPECT_TRUE(lazy_message3.GetBytes(DataMessage::kDataFieldNumber, &data2));
+  EXPECT_EQ(data.data(), data2.data());
+  EXPECT_FALSE(lazy_message.HasField(DataMessage::kDataFieldNumber));
+
+  lazy_message2.Reset(nullptr, 0);
+  lazy_message3.Reset(nullptr, 0);
+  EXPECT_TRUE(buffer->HasOneRef());
+
+  // A moved std::string is kept as it is.
+  const char* start = serialized.data();
+  lazy_message.Reset(std::move(serialized));
+  EXPECT_EQ(start, lazy_message.serialized().data());
+  DataMessage data_message2;
+  EXPECT_TRUE(lazy_message.Parse(&data_message2));
+  EXPECT_EQ(data_message.data(), data_message2.data());
+}
+
+TEST(LazyProtobufMessageTest, GetData) {
+  // Writes a message which has a DataMessage in field 1 and a varint in field
+  // 2, e.g, PointcloudMessage.
+  DataMessage data_message = MakeDataMessage(100);
+  std::string serialized;
+  {
+    google::protobuf::io::StringOutputStream stream(&serialized);
+    google::protobuf::io::CodedOutputStream coded_stream(&stream);
+    coded_stream.WriteTag(
+        WireFormatLite::MakeTag(1, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+    coded_stream.WriteVarint32(data_message.ByteSizeLong());
+    data_message.SerializeWithCachedSizes(&coded_stream);
+    coded_stream.WriteTag(
+        WireFormatLite::MakeTag(2, WireFormatLite::WIRETYPE_VARINT));
+    coded_stream.WriteVarint64(12345);
+  }
+
+  LazyProtobufMessage<SimpleMessage> lazy_message;
+  lazy_message.Reset(serialized.data(), serialized.length());
+  uint32_t type;
+  base::StringPiece data;
+  EXPECT_TRUE(lazy_message.GetData(1, &type, &data));
+  EXPECT_EQ(static_cast<uint32_t>(DATA_TYPE_8U_C1), type);
+  EXPECT_EQ(data_message.data(), data);
+  uint64_t value;
+  EXPECT_TRUE(lazy_message.GetVarint(2, &value));
+  EXPECT_EQ(12345u, value);
+}
+
+TEST(LazyProtobufMessageTest, ParsePartially) {
+  DataMessage data_message = MakeDataMessage(2048);
+  std::string serialized;
+  ASSERT_TRUE(data_message.SerializeToString(&serialized));
+
+  LazyProtobufMessage<DataMessage> lazy_message;
+  lazy_message.Reset(serialized.data(), serialized.length());
+  DataMessage data_message2;
+  EXPECT_TRUE(lazy_message.ParsePartially(&data_message2));
+  EXPECT_EQ(data_message.type(), data_message2.type());
+  EXPECT_TRUE(data_message2.data().empty());
+
+  EXPECT_TRUE(lazy_message.ParsePartially(&data_message2, 4096));
+  EXPECT_EQ(data_message.data(), data_message2.data());
+}
+
+TEST(LazyProtobufMessageTest, CorruptedMessage) {
+  std::string serialized("\xff\xff\xff", 3);
+  LazyProtobufMessage<DataMessage> lazy_message;
+  lazy_message.Reset(serialized.data(), serialized.length());
+  EXPECT_FALSE(lazy_message.IsValid());
+  DataMessage data_message;
+  EXPECT_FALSE(lazy_message.ParsePartially(&data_message));
+
+  std::string text;
+  EXPECT_EQ(MessageIOError::ERR_FAILED_TO_SERIALIZE,
+            MessageIO<LazyProtobufMessage<DataMessage>>::Serialize(
+                &lazy_message, &text));
+}
+
+}  // namespace felicia
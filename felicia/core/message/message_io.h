@@ -14,6 +14,7 @@ class MessageIO;
 
 }  // namespace felicia
 
+#include "felicia/core/message/pod_message_io.h"
 #include "felicia/core/message/protobuf_message_io.h"
 #include "felicia/core/message/ros_header_io.h"
 #include "felicia/core/message/ros_message_io.h"
@@ -0,0 +1,98 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_POD_MESSAGE_IO_H_
+#define FELICIA_CORE_MESSAGE_POD_MESSAGE_IO_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+#include "third_party/chromium/base/strings/string_util.h"
+
+namespace felicia {
+
+namespace internal {
+
+// FNV-1a hash of |name| mixed with |size| and |alignment|.
+constexpr uint64_t PodTypeHash(const char* name, size_t size,
+                               size_t alignment) {
+  uint64_t hash = 14695981039346656037ull;
+  for (; *name; ++name) {
+    hash ^= static_cast<uint8_t>(*name);
+    hash *= 1099511628211ull;
+  }
+  for (size_t i = 0; i < sizeof(size_t) * 2; ++i) {
+    size_t value = i < sizeof(size_t) ? size : alignment;
+    hash ^= static_cast<uint8_t>(value >> ((i % sizeof(size_t)) * 8));
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace internal
+
+// PodMessageTraits<T> is specialized by FEL_POD_MESSAGE() for a type which
+// can be sent as it is in memory, without serialization.
+template <typename T>
+struct PodMessageTraits : std::false_type {
+  static constexpr uint64_t kTypeHash = 0;
+};
+
+// Declares |Type| as a POD message named |Name|, e.g,
+//
+//   struct ImuSample {
+//     float angular_velocity[3];
+//     float linear_acceleration[3];
+//     int64_t timestamp;
+//   };
+//   FEL_POD_MESSAGE(ImuSample, "felicia.ImuSample");
+//
+// Then Publisher<ImuSample> and Subscriber<ImuSample> copy the struct into
+// and out of the channel buffer with a single memcpy. The type is checked
+// by the hash of |Name|, size and alignment, so |Name| should be changed
+// whenever the layout is changed without changing its size. This should be
+// used in the global namespace.
+#define FEL_POD_MESSAGE(Type, Name)                                      \
+  namespace felicia {                                                    \
+  template <>                                                            \
+  struct PodMessageTraits<Type> : std::true_type {                       \
+    static_assert(std::is_standard_layout<Type>::value &&                \
+                      std::is_trivially_copyable<Type>::value,           \
+                  #Type " should be standard layout and trivially "      \
+                        "copyable.");                                    \
+    static constexpr const char* kName = Name;                           \
+    static constexpr uint64_t kTypeHash =                                \
+        internal::PodTypeHash(Name, sizeof(Type), alignof(Type));        \
+  };                                                                     \
+  }  // namespace felicia
+
+template <typename T>
+class MessageIO<T, std::enable_if_t<PodMessageTraits<T>::value>> {
+ public:
+  static MessageIOError Serialize(const T* pod_msg, std::string* text) {
+    text->assign(reinterpret_cast<const char*>(pod_msg), sizeof(T));
+    return MessageIOError::OK;
+  }
+
+  static MessageIOError Deserialize(const char* start, size_t size,
+                                    T* pod_msg) {
+    if (size != sizeof(T)) return MessageIOError::ERR_FAILED_TO_PARSE;
+
+    memcpy(pod_msg, start, sizeof(T));
+    return MessageIOError::OK;
+  }
+
+  static std::string TypeName() { return PodMessageTraits<T>::kName; }
+
+  static std::string Definition() { return base::EmptyString(); }
+
+  static std::string MD5Sum() { return base::EmptyString(); }
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_POD_MESSAGE_IO_H_
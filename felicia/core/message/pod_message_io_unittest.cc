@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gtest/gtest.h"
+
+#include "felicia/core/message/message_io.h"
+
+namespace felicia {
+
+struct PodSample {
+  float values[3];
+  int64_t timestamp;
+};
+
+struct PodSample2 {
+  float values[5];
+  int64_t timestamp;
+};
+
+}  // namespace felicia
+
+FEL_POD_MESSAGE(felicia::PodSample, "felicia.PodSample")
+FEL_POD_MESSAGE(felicia::PodSample2, "felicia.PodSample2")
+
+namespace felicia {
+
+TEST(PodMessageIOTest, SerializeAndDeserialize) {
+  PodSample sample{{1.f, 2.f, 3.f}, 12345};
+  std::string text;
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<PodSample>::Serialize(&sample, &text));
+  EXPECT_EQ(sizeof(PodSample), text.length());
+
+  PodSample sample2;
+  ASSERT_EQ(MessageIOError::OK, MessageIO<PodSample>::Deserialize(
+                                    text.data(), text.length(), &sample2));
+  EXPECT_EQ(0, memcmp(&sample, &sample2, sizeof(PodSample)));
+
+  EXPECT_EQ(MessageIOError::ERR_FAILED_TO_PARSE,
+            MessageIO<PodSample>::Deserialize(text.data(), text.length() - 1,
+                                              &sample2));
+}
+
+TEST(PodMessageIOTest, TypeHash) {
+  EXPECT_EQ("felicia.PodSample", MessageIO<PodSample>::TypeName());
+  EXPECT_TRUE(PodMessageTraits<PodSample>::value);
+  EXPECT_FALSE(PodMessageTraits<int>::value);
+
+  constexpr uint64_t type_hash = PodMessageTraits<PodSample>::kTypeHash;
+  constexpr uint64_t type_hash2 = PodMessageTraits<PodSample2>::kTypeHash;
+  EXPECT_NE(0u, type_hash);
+  EXPECT_NE(type_hash, type_hash2);
+  // Same name but different layout.
+  EXPECT_NE(type_hash, internal::PodTypeHash("felicia.PodSample",
+                                             sizeof(PodSample2),
+                                             alignof(PodSample2)));
+}
+
+}  // namespace felicia
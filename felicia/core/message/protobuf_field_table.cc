@@ -0,0 +1,71 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_field_table.h"
+
+#include <algorithm>
+
+namespace felicia {
+
+namespace {
+
+// Field numbers can be up to 2^29 - 1, so a direct lookup table is built only
+// when it doesn't waste too much memory.
+constexpr int kMaximumDirectLookupNumber = 256;
+
+}  // namespace
+
+ProtobufFieldTable::ProtobufFieldTable(
+    const google::protobuf::Descriptor* descriptor)
+    : descriptor_(descriptor) {
+  int field_count = descriptor->field_count();
+  fields_.reserve(field_count);
+  int max_number = 0;
+  for (int i = 0; i < field_count; ++i) {
+    const google::protobuf::FieldDescriptor* field_desc = descriptor->field(i);
+    Field field;
+    field.descriptor = field_desc;
+    field.type = field_desc->type();
+    field.is_repeated = field_desc->is_repeated();
+    field.is_packed = field_desc->is_packed();
+    field.name = field_desc->name();
+    field.json_name = field_desc->json_name();
+    fields_.push_back(std::move(field));
+    max_number = std::max(max_number, field_desc->number());
+  }
+
+  if (max_number <= kMaximumDirectLookupNumber) {
+    number_to_index_.resize(max_number + 1, -1);
+    for (int i = 0; i < field_count; ++i) {
+      number_to_index_[fields_[i].descriptor->number()] = i;
+    }
+  }
+}
+
+ProtobufFieldTable::~ProtobufFieldTable() = default;
+
+const ProtobufFieldTable::Field* ProtobufFieldTable::FindFieldByNumber(
+    int number) const {
+  if (!number_to_index_.empty()) {
+    if (number < 0 || static_cast<size_t>(number) >= number_to_index_.size())
+      return nullptr;
+    int index = number_to_index_[number];
+    return index < 0 ? nullptr : &fields_[index];
+  }
+
+  for (const Field& field : fields_) {
+    if (field.descriptor->number() == number) return &field;
+  }
+  return nullptr;
+}
+
+const ProtobufFieldTable::Field* ProtobufFieldTable::FindFieldByName(
+    const std::string& name) const {
+  for (const Field& field : fields_) {
+    if (field.name == name) return &field;
+  }
+  return nullptr;
+}
+
+}  // namespace felicia
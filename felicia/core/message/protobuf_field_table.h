@@ -0,0 +1,67 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_PROTOBUF_FIELD_TABLE_H_
+#define FELICIA_CORE_MESSAGE_PROTOBUF_FIELD_TABLE_H_
+
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "third_party/chromium/base/macros.h"
+
+#include "felicia/core/lib/base/export.h"
+
+namespace felicia {
+
+// ProtobufFieldTable holds everything about the fields of a message type that
+// reflection-based code needs per message, resolved once per type. Tables are
+// owned and cached by ProtobufLoader, so that nested message fields can point
+// to the table of their own type. Use ProtobufLoader::GetFieldTable() to get
+// one.
+//
+// The google::protobuf::Reflection isn't kept here, since it belongs to the
+// implementation of a message, e.g, a generated one or a DynamicMessage,
+// rather than to its descriptor. Get it from the message instead, which is a
+// single virtual call.
+class FEL_EXPORT ProtobufFieldTable {
+ public:
+  struct Field {
+    const google::protobuf::FieldDescriptor* descriptor;
+    google::protobuf::FieldDescriptor::Type type;
+    bool is_repeated;
+    bool is_packed;
+    std::string name;
+    std::string json_name;
+    // Only set if |type| is TYPE_MESSAGE.
+    const ProtobufFieldTable* message_table = nullptr;
+  };
+
+  ~ProtobufFieldTable();
+
+  const google::protobuf::Descriptor* descriptor() const { return descriptor_; }
+  const std::vector<Field>& fields() const { return fields_; }
+
+  // Returns nullptr if there is no field with |number|.
+  const Field* FindFieldByNumber(int number) const;
+  // Returns nullptr if there is no field with |name|.
+  const Field* FindFieldByName(const std::string& name) const;
+
+ private:
+  friend class ProtobufLoader;
+
+  explicit ProtobufFieldTable(const google::protobuf::Descriptor* descriptor);
+
+  const google::protobuf::Descriptor* descriptor_;
+  std::vector<Field> fields_;
+  // If field numbers are dense enough, |number_to_index_[number]| is the index
+  // to |fields_| or -1. Otherwise it is empty and |fields_| is searched.
+  std::vector<int> number_to_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProtobufFieldTable);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_PROTOBUF_FIELD_TABLE_H_
@@ -0,0 +1,61 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_json_message.h"
+
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/strings/string_util.h"
+
+#include "felicia/core/message/protobuf_json_transcoder.h"
+
+namespace felicia {
+
+ProtobufJsonMessage::ProtobufJsonMessage() = default;
+
+ProtobufJsonMessage::ProtobufJsonMessage(const ProtobufFieldTable* field_table)
+    : field_table_(field_table) {}
+
+ProtobufJsonMessage::ProtobufJsonMessage(const ProtobufJsonMessage& other) =
+    default;
+
+ProtobufJsonMessage& ProtobufJsonMessage::operator=(
+    const ProtobufJsonMessage& other) = default;
+
+// |field_table_| is kept in |other|, so that it can receive the next message.
+ProtobufJsonMessage::ProtobufJsonMessage(ProtobufJsonMessage&& other) noexcept
+    : field_table_(other.field_table_), json_(std::move(other.json_)) {}
+
+ProtobufJsonMessage& ProtobufJsonMessage::operator=(
+    ProtobufJsonMessage&& other) {
+  field_table_ = other.field_table_;
+  json_ = std::move(other.json_);
+  return *this;
+}
+
+ProtobufJsonMessage::~ProtobufJsonMessage() = default;
+
+void ProtobufJsonMessage::set_field_table(
+    const ProtobufFieldTable* field_table) {
+  field_table_ = field_table;
+}
+
+std::string ProtobufJsonMessage::GetTypeName() const {
+  if (field_table_) return field_table_->descriptor()->full_name();
+  return base::EmptyString();
+}
+
+const std::string& ProtobufJsonMessage::json() const& { return json_; }
+
+std::string&& ProtobufJsonMessage::json() && { return std::move(json_); }
+
+bool ProtobufJsonMessage::ParseFromArray(const char* data, size_t size) {
+  if (!field_table_) return false;
+  json_.clear();
+  ProtobufJsonTranscoder transcoder(field_table_);
+  Status s = transcoder.Transcode(data, size, &json_);
+  DLOG_IF(ERROR, !s.ok()) << s;
+  return s.ok();
+}
+
+}  // namespace felicia
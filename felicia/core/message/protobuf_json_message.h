@@ -0,0 +1,49 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_PROTOBUF_JSON_MESSAGE_H_
+#define FELICIA_CORE_MESSAGE_PROTOBUF_JSON_MESSAGE_H_
+
+#include <string>
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/message/protobuf_field_table.h"
+
+namespace felicia {
+
+// ProtobufJsonMessage is received in place of a protobuf message, and holds
+// its JSON, which is written by ProtobufJsonTranscoder straight from the
+// received bytes, without parsing them into a google::protobuf::Message.
+// It is only to be received, not to be published.
+class FEL_EXPORT ProtobufJsonMessage {
+ public:
+  ProtobufJsonMessage();
+  explicit ProtobufJsonMessage(const ProtobufFieldTable* field_table);
+  ProtobufJsonMessage(const ProtobufJsonMessage& other);
+  ProtobufJsonMessage& operator=(const ProtobufJsonMessage& other);
+  ProtobufJsonMessage(ProtobufJsonMessage&& other) noexcept;
+  ProtobufJsonMessage& operator=(ProtobufJsonMessage&& other);
+  ~ProtobufJsonMessage();
+
+  // The field table of the type of the message, which should be set before
+  // ParseFromArray().
+  const ProtobufFieldTable* field_table() const { return field_table_; }
+  void set_field_table(const ProtobufFieldTable* field_table);
+
+  std::string GetTypeName() const;
+
+  const std::string& json() const&;
+  std::string&& json() &&;
+
+  // Writes JSON of the message serialized in |data| with |size| to |json_|.
+  bool ParseFromArray(const char* data, size_t size);
+
+ private:
+  const ProtobufFieldTable* field_table_ = nullptr;  // not owned
+  std::string json_;
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_PROTOBUF_JSON_MESSAGE_H_
@@ -0,0 +1,509 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_json_transcoder.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "third_party/chromium/base/base64.h"
+#include "third_party/chromium/base/bit_cast.h"
+#include "third_party/chromium/base/json/string_escape.h"
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/strings/strcat.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+
+#include "felicia/core/lib/containers/data_internal.h"
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/message/protobuf_wire_reader.h"
+
+namespace felicia {
+
+namespace {
+
+typedef google::protobuf::FieldDescriptor FieldDescriptor;
+typedef ProtobufWireReader::WireFormatLite WireFormatLite;
+
+// Same as the default recursion limit of CodedInputStream in protobuf.
+constexpr int kMaximumRecursionDepth = 100;
+
+struct WireValue {
+  const ProtobufFieldTable::Field* field;
+  ProtobufWireReader::Field wire;
+};
+
+bool IsPackable(FieldDescriptor::Type type) {
+  return type != FieldDescriptor::TYPE_STRING &&
+         type != FieldDescriptor::TYPE_BYTES &&
+         type != FieldDescriptor::TYPE_MESSAGE &&
+         type != FieldDescriptor::TYPE_GROUP;
+}
+
+WireFormatLite::WireType WireTypeForFieldType(FieldDescriptor::Type type) {
+  return WireFormatLite::WireTypeForFieldType(
+      static_cast<WireFormatLite::FieldType>(type));
+}
+
+void AppendQuoted(base::StringPiece str, std::string* text) {
+  base::StrAppend(text, {"\"", str, "\""});
+}
+
+void AppendNumber(double value, std::string* text) {
+  if (std::isnan(value)) {
+    text->append("\"NaN\"");
+  } else if (std::isinf(value)) {
+    text->append(value > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+  } else {
+    text->append(base::NumberToString(value));
+  }
+}
+
+// Like SimpleFtoa() in protobuf, print with FLT_DIG digits and fall back to
+// more digits only if it doesn't round trip.
+void AppendNumber(float value, std::string* text) {
+  if (std::isnan(value) || std::isinf(value)) {
+    AppendNumber(static_cast<double>(value), text);
+    return;
+  }
+  std::string str = base::StringPrintf("%.*g", FLT_DIG, value);
+  if (strtof(str.c_str(), nullptr) != value)
+    str = base::StringPrintf("%.*g", FLT_DIG + 3, value);
+  text->append(str);
+}
+
+template <typename T>
+void AppendNumber(T value, std::string* text) {
+  text->append(base::NumberToString(value));
+}
+
+template <typename T>
+void AppendNumbers(base::StringPiece bytes, std::string* text) {
+  size_t count = bytes.length() / sizeof(T);
+  const char* ptr = bytes.data();
+  for (size_t i = 0; i < count; ++i) {
+    T value;
+    memcpy(&value, ptr + i * sizeof(T), sizeof(T));
+    if (i > 0) text->push_back(',');
+    AppendNumber(value, text);
+  }
+}
+
+bool AppendScalar(const ProtobufFieldTable::Field& field, uint64_t value,
+                  std::string* text) {
+  switch (field.type) {
+    case FieldDescriptor::TYPE_DOUBLE:
+      AppendNumber(bit_cast<double>(value), text);
+      return true;
+    case FieldDescriptor::TYPE_FLOAT:
+      AppendNumber(bit_cast<float>(static_cast<uint32_t>(value)), text);
+      return true;
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      AppendQuoted(base::NumberToString(static_cast<int64_t>(value)), text);
+      return true;
+    case FieldDescriptor::TYPE_SINT64:
+      AppendQuoted(base::NumberToString(WireFormatLite::ZigZagDecode64(value)),
+                   text);
+      return true;
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_FIXED64:
+      AppendQuoted(base::NumberToString(value), text);
+      return true;
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_SFIXED32:
+      AppendNumber(static_cast<int32_t>(value), text);
+      return true;
+    case FieldDescriptor::TYPE_SINT32:
+      AppendNumber(
+          WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(value)), text);
+      return true;
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_FIXED32:
+      AppendNumber(static_cast<uint32_t>(value), text);
+      return true;
+    case FieldDescriptor::TYPE_BOOL:
+      text->append(value ? "true" : "false");
+      return true;
+    case FieldDescriptor::TYPE_ENUM: {
+      int number = static_cast<int32_t>(value);
+      const google::protobuf::EnumValueDescriptor* enum_value_desc =
+          field.descriptor->enum_type()->FindValueByNumber(number);
+      if (enum_value_desc) {
+        AppendQuoted(enum_value_desc->name(), text);
+      } else {
+        AppendNumber(number, text);
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void AppendDefault(const ProtobufFieldTable::Field& field, std::string* text) {
+  switch (field.type) {
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      text->append("\"\"");
+      return;
+    case FieldDescriptor::TYPE_MESSAGE:
+      text->append("{}");
+      return;
+    case FieldDescriptor::TYPE_ENUM:
+      AppendQuoted(field.descriptor->enum_type()->value(0)->name(), text);
+      return;
+    default:
+      AppendScalar(field, 0, text);
+      return;
+  }
+}
+
+class JsonWriter {
+ public:
+  JsonWriter(ProtobufJsonTranscoder::BytesMode bytes_mode, std::string* text,
+             std::vector<base::StringPiece>* attachments)
+      : bytes_mode_(bytes_mode), text_(text), attachments_(attachments) {}
+
+  bool WriteMessage(const ProtobufFieldTable* field_table,
+                    base::StringPiece bytes, int depth);
+  // Writes a message serialized in |count| |pieces|, which are merged as if
+  // they were concatenated.
+  bool WriteMessage(const ProtobufFieldTable* field_table,
+                    const base::StringPiece* pieces, size_t count, int depth);
+
+ private:
+  bool WriteValue(const ProtobufFieldTable::Field& field,
+                  const ProtobufWireReader::Field& wire, int depth);
+  bool WriteRepeated(const ProtobufFieldTable::Field& field,
+                     const WireValue* begin, const WireValue* end, int depth);
+  bool WriteMap(const ProtobufFieldTable::Field& field, const WireValue* begin,
+                const WireValue* end, int depth);
+  void WriteBytes(base::StringPiece bytes);
+  void WriteData(uint32_t type, base::StringPiece bytes);
+
+  ProtobufJsonTranscoder::BytesMode bytes_mode_;
+  std::string* text_;
+  std::vector<base::StringPiece>* attachments_;
+
+  DISALLOW_COPY_AND_ASSIGN(JsonWriter);
+};
+
+bool JsonWriter::WriteMessage(const ProtobufFieldTable* field_table,
+                              base::StringPiece bytes, int depth) {
+  return WriteMessage(field_table, &bytes, 1, depth);
+}
+
+bool JsonWriter::WriteMessage(const ProtobufFieldTable* field_table,
+                              const base::StringPiece* pieces, size_t count,
+                              int depth) {
+  if (depth > kMaximumRecursionDepth) return false;
+
+  std::vector<WireValue> values;
+  bool sorted = true;
+  for (size_t i = 0; i < count; ++i) {
+    ProtobufWireReader reader(pieces[i].data(), pieces[i].length());
+    ProtobufWireReader::Field wire;
+    while (reader.ReadField(&wire)) {
+      const ProtobufFieldTable::Field* field =
+          field_table->FindFieldByNumber(wire.number);
+      // Unknown fields are dropped, like MessageToJsonString() does.
+      if (!field) continue;
+      if (!values.empty() && values.back().field > field) sorted = false;
+      values.push_back({field, wire});
+    }
+    if (!reader.ok()) return false;
+  }
+
+  // Serializers write fields in order, but elements of a repeated field are
+  // allowed to be interleaved with other fields.
+  if (!sorted) {
+    std::stable_sort(values.begin(), values.end(),
+                     [](const WireValue& a, const WireValue& b) {
+                       return a.field < b.field;
+                     });
+  }
+
+  const bool is_data_message =
+      bytes_mode_ == ProtobufJsonTranscoder::BYTES_MODE_BASE64 &&
+      field_table->descriptor()->full_name() ==
+          DataMessage::descriptor()->full_name();
+  uint32_t data_type = 0;
+
+  text_->push_back('{');
+  const WireValue* it = values.data();
+  const WireValue* end = values.data() + values.size();
+  while (it != end) {
+    const WireValue* last = it + 1;
+    while (last != end && last->field == it->field) ++last;
+
+    const ProtobufFieldTable::Field& field = *it->field;
+    if (it != values.data()) text_->push_back(',');
+    AppendQuoted(field.json_name, text_);
+    text_->push_back(':');
+
+    bool ret;
+    if (field.descriptor->is_map()) {
+      ret = WriteMap(field, it, last, depth);
+    } else if (field.is_repeated) {
+      ret = WriteRepeated(field, it, last, depth);
+    } else if (field.type == FieldDescriptor::TYPE_MESSAGE &&
+               last - it > 1) {
+      // A singular message field which appears more than once is merged.
+      std::vector<base::StringPiece> pieces;
+      ret = true;
+      for (const WireValue* value = it; value != last; ++value) {
+        if (value->wire.wire_type !=
+            WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+          ret = false;
+          break;
+        }
+        pieces.push_back(value->wire.bytes);
+      }
+      if (ret) {
+        ret = WriteMessage(field.message_table, pieces.data(), pieces.size(),
+                           depth + 1);
+      }
+    } else {
+      // Otherwise, the last one wins for a singular field.
+      const ProtobufWireReader::Field& wire = (last - 1)->wire;
+      if (is_data_message) {
+        int number = field.descriptor->number();
+        if (number == DataMessage::kTypeFieldNumber) {
+          data_type = static_cast<uint32_t>(wire.value);
+        } else if (number == DataMessage::kDataFieldNumber &&
+                   wire.wire_type ==
+                       WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+          WriteData(data_type, wire.bytes);
+          it = last;
+          continue;
+        }
+      }
+      ret = WriteValue(field, wire, depth);
+    }
+    if (!ret) return false;
+    it = last;
+  }
+  text_->push_back('}');
+  return true;
+}
+
+bool JsonWriter::WriteValue(const ProtobufFieldTable::Field& field,
+                            const ProtobufWireReader::Field& wire, int depth) {
+  switch (field.type) {
+    case FieldDescriptor::TYPE_STRING:
+      if (wire.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+        return false;
+      base::EscapeJSONString(wire.bytes, true, text_);
+      return true;
+    case FieldDescriptor::TYPE_BYTES:
+      if (wire.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+        return false;
+      WriteBytes(wire.bytes);
+      return true;
+    case FieldDescriptor::TYPE_MESSAGE:
+      if (wire.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+        return false;
+      return WriteMessage(field.message_table, wire.bytes, depth + 1);
+    case FieldDescriptor::TYPE_GROUP:
+      return false;
+    default:
+      if (wire.wire_type != WireTypeForFieldType(field.type)) return false;
+      return AppendScalar(field, wire.value, text_);
+  }
+}
+
+bool JsonWriter::WriteRepeated(const ProtobufFieldTable::Field& field,
+                               const WireValue* begin, const WireValue* end,
+                               int depth) {
+  bool is_packable = IsPackable(field.type);
+  bool first = true;
+  text_->push_back('[');
+  for (const WireValue* it = begin; it != end; ++it) {
+    const ProtobufWireReader::Field& wire = it->wire;
+    // Parsers should accept both packed and unpacked encodings regardless of
+    // the option.
+    if (is_packable &&
+        wire.wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      WireFormatLite::WireType wire_type = WireTypeForFieldType(field.type);
+      ProtobufWireReader reader(wire.bytes.data(), wire.bytes.length());
+      uint64_t value;
+      while (reader.ReadPackedValue(wire_type, &value)) {
+        if (!first) text_->push_back(',');
+        first = false;
+        AppendScalar(field, value, text_);
+      }
+      if (!reader.ok()) return false;
+    } else {
+      if (!first) text_->push_back(',');
+      first = false;
+      if (!WriteValue(field, wire, depth)) return false;
+    }
+  }
+  text_->push_back(']');
+  return true;
+}
+
+bool JsonWriter::WriteMap(const ProtobufFieldTable::Field& field,
+                          const WireValue* begin, const WireValue* end,
+                          int depth) {
+  const ProtobufFieldTable* entry_table = field.message_table;
+  const ProtobufFieldTable::Field* key_field =
+      entry_table->FindFieldByNumber(1);
+  const ProtobufFieldTable::Field* value_field =
+      entry_table->FindFieldByNumber(2);
+  DCHECK(key_field && value_field);
+
+  text_->push_back('{');
+  for (const WireValue* it = begin; it != end; ++it) {
+    if (it->wire.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+      return false;
+
+    ProtobufWireReader::Field key;
+    ProtobufWireReader::Field value;
+    bool has_key = false;
+    bool has_value = false;
+    ProtobufWireReader reader(it->wire.bytes.data(), it->wire.bytes.length());
+    ProtobufWireReader::Field wire;
+    while (reader.ReadField(&wire)) {
+      if (wire.number == 1) {
+        key = wire;
+        has_key = true;
+      } else if (wire.number == 2) {
+        value = wire;
+        has_value = true;
+      }
+    }
+    if (!reader.ok()) return false;
+
+    if (it != begin) text_->push_back(',');
+    // Keys of a map are always strings in JSON.
+    if (key_field->type == FieldDescriptor::TYPE_STRING) {
+      if (has_key) {
+        if (key.wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+          return false;
+        base::EscapeJSONString(key.bytes, true, text_);
+      } else {
+        text_->append("\"\"");
+      }
+    } else {
+      std::string key_text;
+      if (has_key && key.wire_type != WireTypeForFieldType(key_field->type))
+        return false;
+      if (!AppendScalar(*key_field, has_key ? key.value : 0, &key_text))
+        return false;
+      if (key_text[0] == '"') {
+        text_->append(key_text);
+      } else {
+        AppendQuoted(key_text, text_);
+      }
+    }
+    text_->push_back(':');
+    if (has_value) {
+      if (!WriteValue(*value_field, value, depth + 1)) return false;
+    } else {
+      AppendDefault(*value_field, text_);
+    }
+  }
+  text_->push_back('}');
+  return true;
+}
+
+void JsonWriter::WriteBytes(base::StringPiece bytes) {
+  if (bytes_mode_ == ProtobufJsonTranscoder::BYTES_MODE_ATTACHMENT) {
+    base::StrAppend(text_, {"{\"attachment\":",
+                            base::NumberToString(attachments_->size()), "}"});
+    attachments_->push_back(bytes);
+    return;
+  }
+
+  std::string encoded;
+  base::Base64Encode(bytes, &encoded);
+  AppendQuoted(encoded, text_);
+}
+
+void JsonWriter::WriteData(uint32_t type, base::StringPiece bytes) {
+  DataMessage::ElementType element_type;
+  DataMessage::ChannelType channel_type;
+  internal::GetElementaAndChannelType(type, &element_type, &channel_type);
+  size_t element_size = internal::GetElement1Size(element_type);
+  if (element_type == DataMessage::ELEMENT_TYPE_CUSTOM ||
+      element_size == static_cast<size_t>(-1) ||
+      bytes.length() % element_size != 0) {
+    WriteBytes(bytes);
+    return;
+  }
+
+  text_->push_back('[');
+  switch (element_type) {
+    case DataMessage::ELEMENT_TYPE_8U:
+      AppendNumbers<uint8_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_8S:
+      AppendNumbers<int8_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_16U:
+      AppendNumbers<uint16_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_16S:
+      AppendNumbers<int16_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_32U:
+      AppendNumbers<uint32_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_32S:
+      AppendNumbers<int32_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_64U:
+      AppendNumbers<uint64_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_64S:
+      AppendNumbers<int64_t>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_32F:
+      AppendNumbers<float>(bytes, text_);
+      break;
+    case DataMessage::ELEMENT_TYPE_64F:
+      AppendNumbers<double>(bytes, text_);
+      break;
+    default:
+      NOTREACHED();
+      break;
+  }
+  text_->push_back(']');
+}
+
+}  // namespace
+
+ProtobufJsonTranscoder::ProtobufJsonTranscoder(
+    const ProtobufFieldTable* field_table, BytesMode bytes_mode)
+    : field_table_(field_table), bytes_mode_(bytes_mode) {
+  DCHECK(field_table_);
+}
+
+ProtobufJsonTranscoder::~ProtobufJsonTranscoder() = default;
+
+Status ProtobufJsonTranscoder::Transcode(
+    const char* start, size_t size, std::string* text,
+    std::vector<base::StringPiece>* attachments) const {
+  DCHECK(bytes_mode_ == BYTES_MODE_BASE64 || attachments);
+  size_t text_size = text->size();
+  size_t attachments_size = attachments ? attachments->size() : 0;
+
+  JsonWriter writer(bytes_mode_, text, attachments);
+  if (!writer.WriteMessage(field_table_, base::StringPiece(start, size), 0)) {
+    text->resize(text_size);
+    if (attachments) attachments->resize(attachments_size);
+    return errors::InvalidArgument(
+        base::StringPrintf("Failed to transcode %s to json.",
+                           field_table_->descriptor()->full_name().c_str()));
+  }
+  return Status::OK();
+}
+
+}  // namespace felicia
@@ -0,0 +1,58 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_PROTOBUF_JSON_TRANSCODER_H_
+#define FELICIA_CORE_MESSAGE_PROTOBUF_JSON_TRANSCODER_H_
+
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/strings/string_piece.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/message/protobuf_field_table.h"
+
+namespace felicia {
+
+// ProtobufJsonTranscoder writes JSON directly from a serialized protobuf
+// message, without parsing it into a google::protobuf::Message. The output
+// follows the proto3 JSON mapping like google::protobuf::util::
+// MessageToJsonString() does, except for the followings:
+//
+// 1. The data of DataMessage is written as an array of numbers according to
+//    its type, instead of a base64 string.
+// 2. If BYTES_MODE_ATTACHMENT is used, every bytes field is written as
+//    {"attachment": <index>}, and the bytes are returned as they are, so that
+//    they can be sent as binary frames, e.g, over WebSocket.
+// 3. Well-known types like google.protobuf.Timestamp are written as normal
+//    messages.
+class FEL_EXPORT ProtobufJsonTranscoder {
+ public:
+  enum BytesMode {
+    BYTES_MODE_BASE64,
+    BYTES_MODE_ATTACHMENT,
+  };
+
+  explicit ProtobufJsonTranscoder(const ProtobufFieldTable* field_table,
+                                  BytesMode bytes_mode = BYTES_MODE_BASE64);
+  ~ProtobufJsonTranscoder();
+
+  // Appends JSON of a message, serialized in |start| with |size|, to |text|.
+  // If |bytes_mode_| is BYTES_MODE_ATTACHMENT, views of bytes fields are
+  // appended to |attachments|, which refer to the given buffer.
+  Status Transcode(const char* start, size_t size, std::string* text,
+                   std::vector<base::StringPiece>* attachments = nullptr) const;
+
+ private:
+  const ProtobufFieldTable* field_table_;
+  const BytesMode bytes_mode_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProtobufJsonTranscoder);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_PROTOBUF_JSON_TRANSCODER_H_
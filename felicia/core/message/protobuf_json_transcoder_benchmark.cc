@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_json_transcoder.h"
+
+#include "benchmark/benchmark.h"
+#include "google/protobuf/util/json_util.h"
+
+#include "felicia/core/lib/containers/data_constants.h"
+#include "felicia/core/message/protobuf_loader.h"
+
+namespace felicia {
+
+namespace {
+
+// |state.range(0)| is the number of points, each of which has 3 floats.
+std::string SerializedPoints(benchmark::State& state) {
+  DataMessage data_message;
+  data_message.set_type(DATA_TYPE_32F_C3);
+  std::vector<float> points(state.range(0) * 3);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = static_cast<float>(i) * 0.1f;
+  }
+  data_message.set_data(std::string(reinterpret_cast<char*>(points.data()),
+                                    points.size() * sizeof(float)));
+  std::string serialized;
+  data_message.SerializeToString(&serialized);
+  return serialized;
+}
+
+}  // namespace
+
+// The current path: parse into a message and call MessageToJsonString().
+static void BM_MessageToJsonString(benchmark::State& state) {
+  std::string serialized = SerializedPoints(state);
+  for (auto _ : state) {
+    DataMessage data_message;
+    data_message.ParseFromString(serialized);
+    std::string text;
+    google::protobuf::util::MessageToJsonString(data_message, &text);
+    benchmark::DoNotOptimize(text);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.length());
+}
+
+static void BM_TranscodeBase64(benchmark::State& state) {
+  std::string serialized = SerializedPoints(state);
+  ProtobufJsonTranscoder transcoder(
+      ProtobufLoader::GetInstance().GetFieldTable(DataMessage::descriptor()));
+  for (auto _ : state) {
+    std::string text;
+    transcoder.Transcode(serialized.data(), serialized.length(), &text);
+    benchmark::DoNotOptimize(text);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.length());
+}
+
+static void BM_TranscodeAttachment(benchmark::State& state) {
+  std::string serialized = SerializedPoints(state);
+  ProtobufJsonTranscoder transcoder(
+      ProtobufLoader::GetInstance().GetFieldTable(DataMessage::descriptor()),
+      ProtobufJsonTranscoder::BYTES_MODE_ATTACHMENT);
+  for (auto _ : state) {
+    std::string text;
+    std::vector<base::StringPiece> attachments;
+    transcoder.Transcode(serialized.data(), serialized.length(), &text,
+                         &attachments);
+    benchmark::DoNotOptimize(text);
+    benchmark::DoNotOptimize(attachments);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.length());
+}
+
+BENCHMARK(BM_MessageToJsonString)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_TranscodeBase64)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_TranscodeAttachment)->Arg(1000)->Arg(100000);
+
+}  // namespace felicia
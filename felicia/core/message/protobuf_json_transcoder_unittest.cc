@@ -0,0 +1,164 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_json_transcoder.h"
+
+#include "google/protobuf/util/json_util.h"
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+
+#include "felicia/core/lib/containers/data_constants.h"
+#include "felicia/core/message/message_io.h"
+#include "felicia/core/message/protobuf_loader.h"
+#include "felicia/core/message/test/simple_message.pb.h"
+#include "felicia/core/protobuf/master_data.pb.h"
+
+namespace felicia {
+
+namespace {
+
+template <typename T>
+void ExpectSameAsMessageToJsonString(const T& message) {
+  std::string serialized;
+  ASSERT_TRUE(message.SerializeToString(&serialized));
+
+  ProtobufJsonTranscoder transcoder(
+      ProtobufLoader::GetInstance().GetFieldTable(T::descriptor()));
+  std::string text;
+  EXPECT_TRUE(
+      transcoder.Transcode(serialized.data(), serialized.length(), &text).ok());
+
+  std::string expected;
+  google::protobuf::util::MessageToJsonString(message, &expected);
+  EXPECT_EQ(expected, text);
+}
+
+}  // namespace
+
+TEST(ProtobufJsonTranscoderTest, ScalarFields) {
+  SimpleMessage message;
+  message.set_data(-3);
+  message.set_timestamp(1.25);
+  ExpectSameAsMessageToJsonString(message);
+}
+
+TEST(ProtobufJsonTranscoderTest, NestedAndRepeatedFields) {
+  TopicInfo topic_info;
+  topic_info.set_topic("\"topic\"");
+  topic_info.set_type_name("felicia.SimpleMessage");
+  topic_info.set_impl_type(TopicInfo::ROS);
+  topic_info.set_status(TopicInfo::UNREGISTERED);
+  topic_info.mutable_topic_source()->add_channel_defs()->set_type(
+      ChannelDef::CHANNEL_TYPE_TCP);
+  topic_info.mutable_topic_source()->add_channel_defs()->set_type(
+      ChannelDef::CHANNEL_TYPE_UDP);
+  ExpectSameAsMessageToJsonString(topic_info);
+}
+
+TEST(ProtobufJsonTranscoderTest, DataMessage) {
+  const ProtobufFieldTable* field_table =
+      ProtobufLoader::GetInstance().GetFieldTable(DataMessage::descriptor());
+
+  DataMessage data_message;
+  data_message.set_type(DATA_TYPE_16S_C1);
+  int16_t data[] = {1, -2, 3};
+  data_message.set_data(std::string(reinterpret_cast<char*>(data),
+                                    sizeof(data)));
+  std::string serialized;
+  ASSERT_TRUE(data_message.SerializeToString(&serialized));
+
+  std::string text;
+  ProtobufJsonTranscoder transcoder(field_table);
+  EXPECT_TRUE(
+      transcoder.Transcode(serialized.data(), serialized.length(), &text).ok());
+  EXPECT_EQ(base::StringPrintf("{\"type\":%u,\"data\":[1,-2,3]}",
+                               DATA_TYPE_16S_C1),
+            text);
+
+  text.clear();
+  std::vector<base::StringPiece> attachments;
+  ProtobufJsonTranscoder transcoder2(
+      field_table, ProtobufJsonTranscoder::BYTES_MODE_ATTACHMENT);
+  EXPECT_TRUE(transcoder2
+                  .Transcode(serialized.data(), serialized.length(), &text,
+                             &attachments)
+                  .ok());
+  EXPECT_EQ(base::StringPrintf("{\"type\":%u,\"data\":{\"attachment\":0}}",
+                               DATA_TYPE_16S_C1),
+            text);
+  ASSERT_EQ(1u, attachments.size());
+  EXPECT_EQ(data_message.data(), attachments[0]);
+}
+
+TEST(ProtobufJsonTranscoderTest, CorruptedMessage) {
+  std::string serialized("\xff\xff\xff", 3);
+  std::string text("prefix");
+  ProtobufJsonTranscoder transcoder(
+      ProtobufLoader::GetInstance().GetFieldTable(TopicInfo::descriptor()));
+  EXPECT_FALSE(
+      transcoder.Transcode(serialized.data(), serialized.length(), &text).ok());
+  EXPECT_EQ("prefix", text);
+}
+
+TEST(ProtobufJsonTranscoderTest, MergeSingularMessageFields) {
+  // Each has one of the channel defs, and only the last has |topic|.
+  TopicInfo topic_info;
+  topic_info.set_topic("first");
+  topic_info.mutable_topic_source()->add_channel_defs()->set_type(
+      ChannelDef::CHANNEL_TYPE_TCP);
+  std::string serialized;
+  ASSERT_TRUE(topic_info.SerializeToString(&serialized));
+  topic_info.set_topic("second");
+  topic_info.mutable_topic_source()->mutable_channel_defs(0)->set_type(
+      ChannelDef::CHANNEL_TYPE_UDP);
+  ASSERT_TRUE(topic_info.AppendToString(&serialized));
+
+  // Parsing merges the occurrences of |topic_source|.
+  TopicInfo merged;
+  ASSERT_TRUE(merged.ParseFromString(serialized));
+  ASSERT_EQ(2, merged.topic_source().channel_defs_size());
+
+  ProtobufJsonTranscoder transcoder(
+      ProtobufLoader::GetInstance().GetFieldTable(TopicInfo::descriptor()));
+  std::string text;
+  EXPECT_TRUE(
+      transcoder.Transcode(serialized.data(), serialized.length(), &text).ok());
+  std::string expected;
+  google::protobuf::util::MessageToJsonString(merged, &expected);
+  EXPECT_EQ(expected, text);
+}
+
+TEST(ProtobufJsonTranscoderTest, ProtobufJsonMessage) {
+  TopicInfo topic_info;
+  topic_info.set_topic("topic");
+  topic_info.set_type_name("felicia.TopicInfo");
+  topic_info.mutable_topic_source()->add_channel_defs()->set_type(
+      ChannelDef::CHANNEL_TYPE_WS);
+  std::string serialized;
+  ASSERT_TRUE(topic_info.SerializeToString(&serialized));
+
+  ProtobufJsonMessage message(
+      ProtobufLoader::GetInstance().GetFieldTable(TopicInfo::descriptor()));
+  EXPECT_EQ("felicia.TopicInfo", message.GetTypeName());
+  ASSERT_EQ(MessageIOError::OK,
+            MessageIO<ProtobufJsonMessage>::Deserialize(
+                serialized.data(), serialized.length(), &message));
+  std::string expected;
+  google::protobuf::util::MessageToJsonString(topic_info, &expected);
+  EXPECT_EQ(expected, message.json());
+
+  // The field table is kept for the next message.
+  ProtobufJsonMessage moved = std::move(message);
+  EXPECT_EQ(expected, moved.json());
+  EXPECT_EQ(moved.field_table(), message.field_table());
+
+  std::string corrupted("\xff\xff\xff", 3);
+  EXPECT_EQ(MessageIOError::ERR_FAILED_TO_PARSE,
+            MessageIO<ProtobufJsonMessage>::Deserialize(
+                corrupted.data(), corrupted.length(), &message));
+  EXPECT_EQ(MessageIOError::ERR_FAILED_TO_SERIALIZE,
+            MessageIO<ProtobufJsonMessage>::Serialize(&message, &serialized));
+}
+
+}  // namespace felicia
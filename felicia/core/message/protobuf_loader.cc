@@ -4,8 +4,11 @@
 
 #include "felicia/core/message/protobuf_loader.h"
 
+#include <algorithm>
+
 #include "third_party/chromium/base/files/file_enumerator.h"
 #include "third_party/chromium/base/memory/ptr_util.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
 #include "third_party/chromium/base/strings/string_tokenizer.h"
 #include "third_party/chromium/base/strings/string_util.h"
 #include "third_party/chromium/build/build_config.h"
@@ -40,25 +43,52 @@ std::vector<base::FilePath> GetProtobufRootPath() {
   return root_paths;
 }
 
+ProtobufLoader::LoadMode GetLoadMode() {
+  const char* lazy_load_str = getenv("FEL_PROTOBUF_LAZY_LOAD");
+  if (lazy_load_str) {
+    int lazy_load;
+    if (base::StringToInt(lazy_load_str, &lazy_load) && lazy_load != 0)
+      return ProtobufLoader::LOAD_MODE_LAZY;
+  }
+  return ProtobufLoader::LOAD_MODE_EAGER;
+}
+
+// Returns the directory where .proto files declaring |type_name| are likely
+// to be, e.g, "felicia/drivers/" for "felicia.drivers.CameraFrameMessage".
+std::string GuessPackagePath(const std::string& type_name) {
+  size_t pos = type_name.rfind('.');
+  if (pos == std::string::npos) return base::EmptyString();
+  std::string package_path;
+  base::ReplaceChars(type_name.substr(0, pos + 1), ".", "/", &package_path);
+  return package_path;
+}
+
 }  // namespace
 
-ProtobufLoader::ProtobufLoader() = default;
+ProtobufLoader::ProtobufLoader(LoadMode load_mode) : load_mode_(load_mode) {}
 
 ProtobufLoader::~ProtobufLoader() = default;
 
 // static
 ProtobufLoader& ProtobufLoader::GetInstance() {
-  static base::NoDestructor<ProtobufLoader> protobuf_loader;
+  static base::NoDestructor<ProtobufLoader> protobuf_loader(GetLoadMode());
   return *protobuf_loader;
 }
 
+// static
+std::unique_ptr<ProtobufLoader> ProtobufLoader::CreateForTesting(
+    LoadMode load_mode) {
+  return base::WrapUnique(new ProtobufLoader(load_mode));
+}
+
 void ProtobufLoader::Load() {
-  if (source_tree_database_) return;
+  lock_.AssertAcquired();
+  if (loaded_) return;
+  loaded_ = true;
   std::vector<base::FilePath> root_paths = GetProtobufRootPath();
-  google::protobuf::compiler::DiskSourceTree source_tree;
   source_tree_database_.reset(
       new google::protobuf::compiler::SourceTreeDescriptorDatabase(
-          &source_tree));
+          &source_tree_));
   descriptor_pool_.reset(new google::protobuf::DescriptorPool(
       source_tree_database_.get(), &error_collector_));
 
@@ -75,7 +105,7 @@ void ProtobufLoader::Load() {
     std::string root_path_canonicalized;
     base::ReplaceChars(root_path.MaybeAsASCII(), "\\", "/",
                        &root_path_canonicalized);
-    source_tree.MapPath("", root_path_canonicalized);
+    source_tree_.MapPath("", root_path_canonicalized);
 
     base::FileEnumerator enumerator(
         root_path, true, base::FileEnumerator::FILES,
@@ -95,17 +125,53 @@ void ProtobufLoader::Load() {
 #if defined(BAZEL_BUILD)
       if (is_felicia_root && !StartsWith(relative_path, "felicia/")) continue;
 #endif  // defined(BAZEL_BUILD)
-      descriptor_pool_->FindFileByName(relative_path);
+      if (load_mode_ == LOAD_MODE_LAZY) {
+        pending_files_.push_back(std::move(relative_path));
+      } else {
+        descriptor_pool_->FindFileByName(relative_path);
+      }
     }
   }
 }
 
+const google::protobuf::Descriptor* ProtobufLoader::FindMessageTypeByName(
+    const std::string& type_name) {
+  lock_.AssertAcquired();
+  const google::protobuf::Descriptor* descriptor =
+      descriptor_pool_->FindMessageTypeByName(type_name);
+  if (descriptor || pending_files_.empty()) return descriptor;
+
+  // Files under the directory matching the package are tried first, because
+  // that is where most of the .proto files are placed.
+  std::string package_path = GuessPackagePath(type_name);
+  std::stable_partition(pending_files_.begin(), pending_files_.end(),
+                        [&package_path](const std::string& file) {
+                          return StartsWith(file, package_path);
+                        });
+
+  auto it = pending_files_.begin();
+  while (it != pending_files_.end() && !descriptor) {
+    descriptor_pool_->FindFileByName(*it);
+    ++it;
+    descriptor = descriptor_pool_->FindMessageTypeByName(type_name);
+  }
+  pending_files_.erase(pending_files_.begin(), it);
+  return descriptor;
+}
+
 bool ProtobufLoader::NewMessage(const std::string& type_name,
                                 const google::protobuf::Message** message) {
+  base::AutoLock l(lock_);
+  auto it = prototypes_.find(type_name);
+  if (it != prototypes_.end()) {
+    *message = it->second;
+    return true;
+  }
+
   Load();
 
   const google::protobuf::Descriptor* descriptor =
-      descriptor_pool_->FindMessageTypeByName(type_name);
+      FindMessageTypeByName(type_name);
   if (!descriptor) {
     LOG(ERROR) << "Failed to find message type: " << type_name
                << ". Maybe you forget to add the path to your protobuf to "
@@ -114,9 +180,35 @@ bool ProtobufLoader::NewMessage(const std::string& type_name,
   }
 
   *message = message_factory_.GetPrototype(descriptor);
+  prototypes_.insert_or_assign(type_name, *message);
   return true;
 }
 
+const ProtobufFieldTable* ProtobufLoader::GetFieldTable(
+    const google::protobuf::Descriptor* descriptor) {
+  base::AutoLock l(lock_);
+  return GetFieldTableLocked(descriptor);
+}
+
+const ProtobufFieldTable* ProtobufLoader::GetFieldTableLocked(
+    const google::protobuf::Descriptor* descriptor) {
+  lock_.AssertAcquired();
+  auto it = field_tables_.find(descriptor);
+  if (it != field_tables_.end()) return it->second.get();
+
+  ProtobufFieldTable* field_table = new ProtobufFieldTable(descriptor);
+  // Register before resolving nested messages, because a message type can
+  // refer to itself.
+  field_tables_.insert_or_assign(descriptor, base::WrapUnique(field_table));
+  for (ProtobufFieldTable::Field& field : field_table->fields_) {
+    if (field.type == google::protobuf::FieldDescriptor::TYPE_MESSAGE) {
+      field.message_table =
+          GetFieldTableLocked(field.descriptor->message_type());
+    }
+  }
+  return field_table;
+}
+
 void ProtobufLoader::ErrorCollector::AddError(
     const std::string& filename, const std::string& element_name,
     const google::protobuf::Message* descriptor,
@@ -6,15 +6,20 @@
 #define FELICIA_CORE_MESSAGE_PROTOBUF_LOADER_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "google/protobuf/compiler/importer.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/message.h"
+#include "third_party/chromium/base/containers/flat_map.h"
 #include "third_party/chromium/base/files/file_path.h"
 #include "third_party/chromium/base/macros.h"
 #include "third_party/chromium/base/no_destructor.h"
+#include "third_party/chromium/base/synchronization/lock.h"
 
 #include "felicia/core/lib/base/export.h"
+#include "felicia/core/message/protobuf_field_table.h"
 
 namespace felicia {
 
@@ -37,23 +42,66 @@ class FEL_EXPORT ProtobufLoader {
         const std::string& message) override;
   };
 
+  enum LoadMode {
+    // Parse every .proto under the root paths when it is first used.
+    LOAD_MODE_EAGER,
+    // Only enumerate .proto files when it is first used, and parse them one
+    // by one until a requested type is found.
+    LOAD_MODE_LAZY,
+  };
+
+  // The load mode is LOAD_MODE_LAZY if FEL_PROTOBUF_LAZY_LOAD is set to
+  // nonzero, otherwise LOAD_MODE_EAGER.
   static ProtobufLoader& GetInstance();
 
+  // Create a loader other than the singleton, e.g, to measure the cost of
+  // startup.
+  static std::unique_ptr<ProtobufLoader> CreateForTesting(LoadMode load_mode);
+
+  // Set |message| to the prototype of |type_name|. Prototypes are cached, so
+  // it only resolves |type_name| against the descriptor pool at the first
+  // call.
   bool NewMessage(const std::string& type_name,
                   const google::protobuf::Message** message) WARN_UNUSED_RESULT;
 
+  // Returns the field table of |descriptor|, which is built at the first call.
+  // |descriptor| can come from either the generated pool or this loader.
+  const ProtobufFieldTable* GetFieldTable(
+      const google::protobuf::Descriptor* descriptor);
+
+  LoadMode load_mode() const { return load_mode_; }
+
  private:
   friend class base::NoDestructor<ProtobufLoader>;
+  friend struct std::default_delete<ProtobufLoader>;
 
-  ProtobufLoader();
+  explicit ProtobufLoader(LoadMode load_mode);
   ~ProtobufLoader();
 
   void Load();
 
+  const google::protobuf::Descriptor* FindMessageTypeByName(
+      const std::string& type_name);
+
+  const ProtobufFieldTable* GetFieldTableLocked(
+      const google::protobuf::Descriptor* descriptor);
+
+  const LoadMode load_mode_;
+
+  base::Lock lock_;
+  bool loaded_ = false;
+  google::protobuf::compiler::DiskSourceTree source_tree_;
   std::unique_ptr<google::protobuf::compiler::SourceTreeDescriptorDatabase>
       source_tree_database_;
   std::unique_ptr<google::protobuf::DescriptorPool> descriptor_pool_;
   google::protobuf::DynamicMessageFactory message_factory_;
+  // Relative paths of .proto files which are not parsed yet. This is only
+  // used in LOAD_MODE_LAZY.
+  std::vector<std::string> pending_files_;
+  base::flat_map<std::string, const google::protobuf::Message*> prototypes_;
+  base::flat_map<const google::protobuf::Descriptor*,
+                 std::unique_ptr<ProtobufFieldTable>>
+      field_tables_;
 
   ErrorCollector error_collector_;
 
@@ -0,0 +1,104 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/message/protobuf_loader.h"
+
+#include "benchmark/benchmark.h"
+#include "google/protobuf/dynamic_message.h"
+
+#include "felicia/core/message/dynamic_protobuf_message.h"
+
+namespace felicia {
+
+namespace {
+
+constexpr const char* kTypeName = "felicia.map.PointcloudMessage";
+
+ProtobufLoader::LoadMode ToLoadMode(int64_t value) {
+  return value == 0 ? ProtobufLoader::LOAD_MODE_EAGER
+                    : ProtobufLoader::LOAD_MODE_LAZY;
+}
+
+void FillMessage(google::protobuf::Message* message) {
+  const google::protobuf::Descriptor* descriptor = message->GetDescriptor();
+  const google::protobuf::Reflection* reflection = message->GetReflection();
+  reflection->SetInt64(message, descriptor->FindFieldByName("timestamp"),
+                       123456789);
+  google::protobuf::Message* points = reflection->MutableMessage(
+      message, descriptor->FindFieldByName("points"));
+  const google::protobuf::Descriptor* data_descriptor = points->GetDescriptor();
+  points->GetReflection()->SetString(
+      points, data_descriptor->FindFieldByName("data"),
+      std::string(1024 * 1024, 'a'));
+}
+
+}  // namespace
+
+// Measures from the construction of a loader to the first resolved type,
+// which is what every CLI command or dynamic subscriber pays at startup.
+static void BM_FirstNewMessage(benchmark::State& state) {
+  for (auto _ : state) {
+    std::unique_ptr<ProtobufLoader> protobuf_loader =
+        ProtobufLoader::CreateForTesting(ToLoadMode(state.range(0)));
+    const google::protobuf::Message* message;
+    bool ret = protobuf_loader->NewMessage(kTypeName, &message);
+    benchmark::DoNotOptimize(ret);
+  }
+}
+
+static void BM_NewMessage(benchmark::State& state) {
+  std::unique_ptr<ProtobufLoader> protobuf_loader =
+      ProtobufLoader::CreateForTesting(ToLoadMode(state.range(0)));
+  const google::protobuf::Message* message;
+  if (!protobuf_loader->NewMessage(kTypeName, &message)) {
+    state.SkipWithError("Failed to load type");
+    return;
+  }
+  for (auto _ : state) {
+    bool ret = protobuf_loader->NewMessage(kTypeName, &message);
+    benchmark::DoNotOptimize(ret);
+  }
+}
+
+static void BM_DynamicMessageToString(benchmark::State& state) {
+  ProtobufLoader& protobuf_loader = ProtobufLoader::GetInstance();
+  const google::protobuf::Message* prototype;
+  if (!protobuf_loader.NewMessage(kTypeName, &prototype)) {
+    state.SkipWithError("Failed to load type");
+    return;
+  }
+  DynamicProtobufMessage message;
+  message.Reset(prototype->New());
+  FillMessage(message.message());
+  for (auto _ : state) {
+    std::string text = message.ToString();
+    benchmark::DoNotOptimize(text);
+  }
+}
+
+static void BM_DynamicMessageParse(benchmark::State& state) {
+  ProtobufLoader& protobuf_loader = ProtobufLoader::GetInstance();
+  const google::protobuf::Message* prototype;
+  if (!protobuf_loader.NewMessage(kTypeName, &prototype)) {
+    state.SkipWithError("Failed to load type");
+    return;
+  }
+  DynamicProtobufMessage message;
+  message.Reset(prototype->New());
+  FillMessage(message.message());
+  std::string serialized;
+  message.SerializeToString(&serialized);
+  for (auto _ : state) {
+    bool ret = message.ParseFromArray(serialized.data(), serialized.length());
+    benchmark::DoNotOptimize(ret);
+  }
+}
+
+// Arg(0): LOAD_MODE_EAGER, Arg(1): LOAD_MODE_LAZY
+BENCHMARK(BM_FirstNewMessage)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NewMessage)->Arg(0)->Arg(1);
+BENCHMARK(BM_DynamicMessageToString);
+BENCHMARK(BM_DynamicMessageParse);
+
+}  // namespace felicia
@@ -11,6 +11,8 @@
 
 #include "felicia/core/lib/base/export.h"
 #include "felicia/core/message/dynamic_protobuf_message.h"
+#include "felicia/core/message/lazy_protobuf_message.h"
+#include "felicia/core/message/protobuf_json_message.h"
 
 namespace felicia {
 
@@ -76,6 +78,71 @@ class MessageIO<
   static std::string MD5Sum() { return base::EmptyString(); }
 };
 
+// Subscribing ProtobufJsonMessage receives messages as JSON, transcoded from
+// the received bytes without parsing them.
+template <typename T>
+class MessageIO<
+    T, std::enable_if_t<std::is_same<ProtobufJsonMessage, T>::value>> {
+ public:
+  static MessageIOError Serialize(const T* json_msg, std::string* text) {
+    return MessageIOError::ERR_FAILED_TO_SERIALIZE;
+  }
+
+  static MessageIOError Deserialize(const char* start, size_t size,
+                                    T* json_msg) {
+    if (!json_msg->ParseFromArray(start, size))
+      return MessageIOError::ERR_FAILED_TO_PARSE;
+
+    return MessageIOError::OK;
+  }
+
+  static std::string TypeName() { return base::EmptyString(); }
+
+  static std::string Definition() { return base::EmptyString(); }
+
+  static std::string MD5Sum() { return base::EmptyString(); }
+};
+
+// Subscribing LazyProtobufMessage<T> receives messages published as T, and
+// defers parsing until a field is accessed.
+template <typename T>
+class MessageIO<T, std::enable_if_t<IsLazyProtobufMessage<T>::value>> {
+ public:
+  typedef typename T::MessageType MessageType;
+
+  static MessageIOError Serialize(const T* lazy_msg, std::string* text) {
+    if (!lazy_msg->IsValid()) return MessageIOError::ERR_FAILED_TO_SERIALIZE;
+
+    lazy_msg->serialized().CopyToString(text);
+    return MessageIOError::OK;
+  }
+
+  static MessageIOError Deserialize(const char* start, size_t size,
+                                    T* lazy_msg) {
+    lazy_msg->Reset(start, size);
+    return MessageIOError::OK;
+  }
+
+  // Keeps |buffer|, which holds the message in |start| with |size|, instead
+  // of copying the message out of it.
+  static MessageIOError Deserialize(scoped_refptr<net::IOBuffer> buffer,
+                                    const char* start, size_t size,
+                                    T* lazy_msg) {
+    lazy_msg->Reset(std::move(buffer), start, size);
+    return MessageIOError::OK;
+  }
+
+  static std::string TypeName() {
+    return MessageType::descriptor()->full_name();
+  }
+
+  static std::string Definition() {
+    return MessageType::descriptor()->DebugString();
+  }
+
+  static std::string MD5Sum() { return base::EmptyString(); }
+};
+
 }  // namespace felicia
 
 #endif  // FELICIA_CORE_MESSAGE_PROTOBUF_MESSAGE_IO_H_
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include "third_party/chromium/base/strings/string_number_conversions.h"
 
 #include "felicia/core/lib/strings/str_util.h"
+#include "felicia/core/message/protobuf_loader.h"
 #include "felicia/core/util/command_line_interface/text_style.h"
 
 namespace felicia {
@@ -17,16 +18,17 @@ namespace protobuf {
 constexpr size_t kMaximumContentLength = 100;
 
 void ProtobufMessageToString(const google::protobuf::Message& message,
-                             int depth, std::string* out);
+                             const ProtobufFieldTable* field_table, int depth,
+                             std::string* out);
 
-void ProtobufMessageToString(
-    std::vector<std::string>& entities, int depth,
-    const google::protobuf::Reflection* reflection,
-    const google::protobuf::Message& message,
-    const google::protobuf::FieldDescriptor* field_desc) {
-  switch (field_desc->type()) {
+void ProtobufMessageToString(std::vector<std::string>& entities, int depth,
+                             const google::protobuf::Reflection* reflection,
+                             const google::protobuf::Message& message,
+                             const ProtobufFieldTable::Field& field) {
+  const google::protobuf::FieldDescriptor* field_desc = field.descriptor;
+  switch (field.type) {
     case google::protobuf::FieldDescriptor::TYPE_DOUBLE: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<double>(message, field_desc);
         entities.push_back("[ ");
@@ -44,7 +46,7 @@ void ProtobufMessageToString(
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_FLOAT:
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<float>(message, field_desc);
         entities.push_back("[ ");
@@ -63,7 +65,7 @@ void ProtobufMessageToString(
     case google::protobuf::FieldDescriptor::TYPE_INT64:
     case google::protobuf::FieldDescriptor::TYPE_SFIXED64:
     case google::protobuf::FieldDescriptor::TYPE_SINT64: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int64_t>(message, field_desc);
         entities.push_back("[ ");
@@ -82,7 +84,7 @@ void ProtobufMessageToString(
     }
     case google::protobuf::FieldDescriptor::TYPE_UINT64:
     case google::protobuf::FieldDescriptor::TYPE_FIXED64: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<uint64_t>(message, field_desc);
         entities.push_back("[ ");
@@ -102,7 +104,7 @@ void ProtobufMessageToString(
     case google::protobuf::FieldDescriptor::TYPE_INT32:
     case google::protobuf::FieldDescriptor::TYPE_SFIXED32:
     case google::protobuf::FieldDescriptor::TYPE_SINT32: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int32_t>(message, field_desc);
         entities.push_back("[ ");
@@ -121,7 +123,7 @@ void ProtobufMessageToString(
     }
     case google::protobuf::FieldDescriptor::TYPE_FIXED32:
     case google::protobuf::FieldDescriptor::TYPE_UINT32: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<uint32_t>(message, field_desc);
         entities.push_back("[ ");
@@ -139,7 +141,7 @@ void ProtobufMessageToString(
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_BOOL: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<bool>(message, field_desc);
         entities.push_back("[ ");
@@ -158,7 +160,7 @@ void ProtobufMessageToString(
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_STRING: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<std::string>(message, field_desc);
         entities.push_back("[ ");
@@ -177,7 +179,7 @@ void ProtobufMessageToString(
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_MESSAGE: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         entities.push_back("[ ");
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<google::protobuf::Message>(
@@ -187,7 +189,8 @@ void ProtobufMessageToString(
         for (int i = 0; i < repeated_field_ref.size(); ++i) {
           std::string str;
           ProtobufMessageToString(
-              repeated_field_ref.Get(i, scratch_space.get()), depth + 1, &str);
+              repeated_field_ref.Get(i, scratch_space.get()),
+              field.message_table, depth + 1, &str);
           entities.push_back(base::StrCat({"{\n", str}));
           for (int j = 0; j < depth; j++) entities.push_back("  ");
           entities.push_back("}");
@@ -200,14 +203,14 @@ void ProtobufMessageToString(
       }
       std::string str;
       ProtobufMessageToString(reflection->GetMessage(message, field_desc),
-                              depth + 1, &str);
+                              field.message_table, depth + 1, &str);
       entities.push_back(base::StrCat({"{\n", str}));
       for (int j = 0; j < depth; j++) entities.push_back("  ");
       entities.push_back("}");
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_BYTES: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<std::string>(message, field_desc);
         entities.push_back("[ ");
@@ -238,7 +241,7 @@ void ProtobufMessageToString(
       return;
     }
     case google::protobuf::FieldDescriptor::TYPE_ENUM: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int>(message, field_desc);
         entities.push_back("[ ");
@@ -264,19 +267,18 @@ void ProtobufMessageToString(
 }
 
 void ProtobufMessageToString(const google::protobuf::Message& message,
-                             int depth, std::string* out) {
-  const google::protobuf::Descriptor* descriptor = message.GetDescriptor();
+                             const ProtobufFieldTable* field_table, int depth,
+                             std::string* out) {
   const google::protobuf::Reflection* reflection = message.GetReflection();
+  const std::vector<ProtobufFieldTable::Field>& fields = field_table->fields();
 
   std::vector<std::string> entities;
-  entities.reserve((descriptor->field_count() + depth) * 3);
+  entities.reserve((fields.size() + depth) * 3);
 
-  for (int i = 0; i < descriptor->field_count(); ++i) {
-    const google::protobuf::FieldDescriptor* field_desc = descriptor->field(i);
+  for (const ProtobufFieldTable::Field& field : fields) {
     for (int j = 0; j < depth; j++) entities.push_back("  ");
-    entities.push_back(
-        TextStyle::Blue(base::StrCat({field_desc->name(), ": "})));
-    ProtobufMessageToString(entities, depth, reflection, message, field_desc);
+    entities.push_back(TextStyle::Blue(base::StrCat({field.name, ": "})));
+    ProtobufMessageToString(entities, depth, reflection, message, field);
     entities.push_back("\n");
   }
 
@@ -285,7 +287,9 @@ void ProtobufMessageToString(const google::protobuf::Message& message,
 
 std::string ProtobufMessageToString(const google::protobuf::Message& message) {
   std::string ret;
-  ProtobufMessageToString(message, 0, &ret);
+  const ProtobufFieldTable* field_table =
+      ProtobufLoader::GetInstance().GetFieldTable(message.GetDescriptor());
+  ProtobufMessageToString(message, field_table, 0, &ret);
   return ret;
 }
 
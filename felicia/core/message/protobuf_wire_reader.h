@@ -0,0 +1,143 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_MESSAGE_PROTOBUF_WIRE_READER_H_
+#define FELICIA_CORE_MESSAGE_PROTOBUF_WIRE_READER_H_
+
+#include <stdint.h>
+
+#include "google/protobuf/wire_format_lite.h"
+#include "third_party/chromium/base/compiler_specific.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/strings/string_piece.h"
+
+namespace felicia {
+
+// ProtobufWireReader reads fields of a serialized protobuf message one by one
+// without copying. Every length delimited value is a view into the buffer
+// given at the construction, so the buffer should outlive it.
+//
+//   ProtobufWireReader reader(start, size);
+//   ProtobufWireReader::Field field;
+//   while (reader.ReadField(&field)) {
+//     ...
+//   }
+//   if (!reader.ok()) return ERR_FAILED_TO_PARSE;
+class ProtobufWireReader {
+ public:
+  typedef google::protobuf::internal::WireFormatLite WireFormatLite;
+
+  struct Field {
+    int number;
+    WireFormatLite::WireType wire_type;
+    // Set if |wire_type| is either VARINT, FIXED32 or FIXED64.
+    uint64_t value;
+    // Set if |wire_type| is LENGTH_DELIMITED.
+    base::StringPiece bytes;
+  };
+
+  ProtobufWireReader(const char* start, size_t size)
+      : ptr_(reinterpret_cast<const uint8_t*>(start)), end_(ptr_ + size) {}
+
+  bool ok() const { return ok_; }
+  bool done() const { return ptr_ == end_; }
+  // Returns the current position in the buffer.
+  const char* position() const { return reinterpret_cast<const char*>(ptr_); }
+
+  // Returns false if there is no more field or the buffer is corrupted. Call
+  // ok() to distinguish them. Groups are not supported and treated as
+  // corrupted.
+  ALWAYS_INLINE bool ReadField(Field* field) {
+    if (done() || !ok_) return false;
+    uint64_t tag;
+    if (!ReadVarint(&tag)) return Fail();
+    field->number = static_cast<int>(tag >> 3);
+    field->wire_type = static_cast<WireFormatLite::WireType>(tag & 7);
+    if (field->number == 0) return Fail();
+
+    switch (field->wire_type) {
+      case WireFormatLite::WIRETYPE_VARINT:
+        if (!ReadVarint(&field->value)) return Fail();
+        return true;
+      case WireFormatLite::WIRETYPE_FIXED64:
+        if (!ReadFixed(8, &field->value)) return Fail();
+        return true;
+      case WireFormatLite::WIRETYPE_FIXED32:
+        if (!ReadFixed(4, &field->value)) return Fail();
+        return true;
+      case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+        uint64_t length;
+        if (!ReadVarint(&length)) return Fail();
+        if (length > static_cast<uint64_t>(end_ - ptr_)) return Fail();
+        field->bytes = base::StringPiece(reinterpret_cast<const char*>(ptr_),
+                                         static_cast<size_t>(length));
+        ptr_ += length;
+        return true;
+      }
+      default:
+        return Fail();
+    }
+  }
+
+  // Reads a value of packed repeated field, whose wire type is either VARINT,
+  // FIXED32 or FIXED64.
+  ALWAYS_INLINE bool ReadPackedValue(WireFormatLite::WireType wire_type,
+                                     uint64_t* value) {
+    if (done() || !ok_) return false;
+    switch (wire_type) {
+      case WireFormatLite::WIRETYPE_VARINT:
+        if (!ReadVarint(value)) return Fail();
+        return true;
+      case WireFormatLite::WIRETYPE_FIXED64:
+        if (!ReadFixed(8, value)) return Fail();
+        return true;
+      case WireFormatLite::WIRETYPE_FIXED32:
+        if (!ReadFixed(4, value)) return Fail();
+        return true;
+      default:
+        return Fail();
+    }
+  }
+
+ private:
+  ALWAYS_INLINE bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && ptr_ < end_; shift += 7) {
+      uint8_t byte = *ptr_++;
+      result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Protobuf is always little endian on the wire.
+  ALWAYS_INLINE bool ReadFixed(size_t size, uint64_t* value) {
+    if (static_cast<size_t>(end_ - ptr_) < size) return false;
+    uint64_t result = 0;
+    for (size_t i = 0; i < size; ++i) {
+      result |= static_cast<uint64_t>(ptr_[i]) << (8 * i);
+    }
+    ptr_ += size;
+    *value = result;
+    return true;
+  }
+
+  bool Fail() {
+    ok_ = false;
+    return false;
+  }
+
+  const uint8_t* ptr_;
+  const uint8_t* end_;
+  bool ok_ = true;
+
+  DISALLOW_COPY_AND_ASSIGN(ProtobufWireReader);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_MESSAGE_PROTOBUF_WIRE_READER_H_
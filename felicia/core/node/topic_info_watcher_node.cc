@@ -10,6 +10,13 @@
 
 namespace felicia {
 
+void TopicInfoWatcherNode::Delegate::OnNewTopicInfos(
+    const std::vector<TopicInfo>& topic_infos) {
+  for (auto& topic_info : topic_infos) {
+    OnNewTopicInfo(topic_info);
+  }
+}
+
 TopicInfoWatcherNode::TopicInfoWatcherNode(std::unique_ptr<Delegate> delegate)
     : delegate_(std::move(delegate)) {}
 
@@ -18,7 +25,7 @@ TopicInfoWatcherNode::~TopicInfoWatcherNode() = default;
 void TopicInfoWatcherNode::OnInit() {
   MasterProxy& master_proxy = MasterProxy::GetInstance();
   master_proxy.master_notification_watcher_.RegisterAllTopicInfoCallback(
-      base::BindRepeating(&TopicInfoWatcherNode::Delegate::OnNewTopicInfo,
+      base::BindRepeating(&TopicInfoWatcherNode::Delegate::OnNewTopicInfos,
                           base::Unretained(delegate_.get())));
 }
 
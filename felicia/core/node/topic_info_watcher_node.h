@@ -5,6 +5,9 @@
 #ifndef FELICIA_CORE_NODE_TOPIC_INFO_WATCHER_NODE_H_
 #define FELICIA_CORE_NODE_TOPIC_INFO_WATCHER_NODE_H_
 
+#include <memory>
+#include <vector>
+
 #include "felicia/core/lib/base/export.h"
 #include "felicia/core/master/master_notification_watcher.h"
 #include "felicia/core/node/node_lifecycle.h"
@@ -18,6 +21,10 @@ class FEL_EXPORT TopicInfoWatcherNode : public NodeLifecycle {
     virtual ~Delegate() = default;
 
     virtual void OnNewTopicInfo(const TopicInfo& topic_info) = 0;
+    // Called with the TopicInfos which are changed together, e.g, when many
+    // nodes are brought up at once. By default, this calls OnNewTopicInfo()
+    // for each of them.
+    virtual void OnNewTopicInfos(const std::vector<TopicInfo>& topic_infos);
     virtual void OnError(Status s) = 0;
   };
 
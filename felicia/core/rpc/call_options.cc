@@ -0,0 +1,39 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/rpc/call_options.h"
+
+#include "third_party/chromium/base/logging.h"
+
+namespace felicia {
+
+CallOptions::CallOptions() = default;
+
+CallOptions::~CallOptions() = default;
+
+void CallOptions::StartCancel() {
+  base::AutoLock l(lock_);
+  cancelled_ = true;
+  // The callback runs under the lock, so that the call isn't finished and
+  // deleted while it's being cancelled.
+  if (cancel_callback_) std::move(cancel_callback_).Run();
+}
+
+void CallOptions::SetCancelCallback(base::OnceClosure callback) {
+  base::AutoLock l(lock_);
+  DCHECK(!cancel_callback_) << "The CallOptions is used by another call.";
+  if (cancelled_) {
+    std::move(callback).Run();
+    return;
+  }
+  cancel_callback_ = std::move(callback);
+}
+
+void CallOptions::ClearCancelCallback() {
+  base::AutoLock l(lock_);
+  cancel_callback_.Reset();
+  cancelled_ = false;
+}
+
+}  // namespace felicia
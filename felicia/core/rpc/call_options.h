@@ -0,0 +1,63 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_RPC_CALL_OPTIONS_H_
+#define FELICIA_CORE_RPC_CALL_OPTIONS_H_
+
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/base/export.h"
+
+namespace felicia {
+
+// Options for a call of a service client, which sets its deadline and lets
+// it be cancelled. A CallOptions should be used for one call at a time and
+// outlive the call. Once the call finishes, it can be used for the next
+// call, which a StartCancel() of the previous call doesn't cancel.
+//
+// CallOptions call_opts;
+// call_opts.set_timeout(base::TimeDelta::FromSeconds(1));
+// client->AddAsync(&request, &response, std::move(callback), &call_opts);
+//
+// // If you don't need the response any more.
+// call_opts.StartCancel();
+class FEL_EXPORT CallOptions {
+ public:
+  CallOptions();
+  ~CallOptions();
+
+  // Cancels the call, which then finishes with error::CANCELLED. If the call
+  // hasn't started yet, it is cancelled as soon as it starts.
+  void StartCancel();
+
+  // Called by the call to get notified by StartCancel(). |callback| runs
+  // immediately if StartCancel() is already called.
+  void SetCancelCallback(base::OnceClosure callback);
+  // Called by the call when it finishes. This also forgets StartCancel(),
+  // so that the next call isn't cancelled.
+  void ClearCancelCallback();
+
+  // If the call doesn't finish within |timeout| after it starts, it finishes
+  // with error::DEADLINE_EXCEEDED. Zero, which is the default, means no
+  // deadline.
+  base::TimeDelta timeout() const { return timeout_; }
+  void set_timeout(base::TimeDelta timeout) { timeout_ = timeout; }
+
+ private:
+  base::Lock lock_;
+  base::OnceClosure cancel_callback_ GUARDED_BY(lock_);
+  bool cancelled_ GUARDED_BY(lock_) = false;
+
+  base::TimeDelta timeout_;
+
+  DISALLOW_COPY_AND_ASSIGN(CallOptions);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_RPC_CALL_OPTIONS_H_
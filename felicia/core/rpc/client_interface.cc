@@ -18,5 +18,9 @@ void ClientInterface::set_service_info(const ServiceInfo& service_info) {
   service_info_ = service_info;
 }
 
+int ClientInterface::outstanding_calls() const { return 0; }
+
+bool ClientInterface::IsAvailable() const { return true; }
+
 }  // namespace rpc
 }  // namespace felicia
\ No newline at end of file
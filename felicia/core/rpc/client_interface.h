@@ -25,6 +25,12 @@ class FEL_EXPORT ClientInterface {
   virtual Status Run() = 0;
   virtual Status Shutdown() = 0;
 
+  // Used by the load balancing of ServiceClient. The number of the calls
+  // which haven't finished yet.
+  virtual int outstanding_calls() const;
+  // Returns false if the server seems to be gone.
+  virtual bool IsAvailable() const;
+
  protected:
   ServiceInfo service_info_;
 };
@@ -6,11 +6,14 @@
 #define FELICIA_CORE_RPC_GRPC_ASYNC_CALL_H_
 
 #include <memory>
+#include <string>
 
 #include "grpcpp/grpcpp.h"
-#include "third_party/chromium/base/strings/strcat.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/time/time.h"
 
 #include "felicia/core/lib/error/errors.h"
+#include "felicia/core/rpc/call_options.h"
 #include "felicia/core/rpc/grpc_client_cq_tag.h"
 #include "felicia/core/rpc/grpc_util.h"
 
@@ -24,34 +27,41 @@ class GrpcAsyncClientCall : public GrpcClientCQTag {
           Stub::*)(::grpc::ClientContext*, const RequestMessage&,
                    ::grpc::CompletionQueue*);
 
+  // |call_opts| can be null, otherwise it should outlive the call. The
+  // latency is recorded under |service| and |method|.
   GrpcAsyncClientCall(Stub* stub, const RequestMessage* request,
                       ResponseMessage* response,
                       PrepareAsyncFunction prepare_async_function,
-                      ::grpc::CompletionQueue* cq, StatusOnceCallback done)
-      : done_(std::move(done)) {
+                      ::grpc::CompletionQueue* cq, StatusOnceCallback done,
+                      CallOptions* call_opts, std::string service,
+                      const char* method)
+      : call_opts_(call_opts),
+        service_(std::move(service)),
+        method_(method),
+        start_(base::TimeTicks::Now()),
+        done_(std::move(done)) {
+    // This is set before the call starts, since the call may complete and
+    // delete this on the completion queue thread right after Finish().
+    ApplyCallOptions(call_opts_, &context_);
     call_ = (stub->*prepare_async_function)(&context_, *request, cq);
     call_->StartCall();
     call_->Finish(response, &status_, this);
   }
 
   void OnCompleted(bool ok) override {
-    Status s = FromGrpcStatus(status_);
-    if (s.ok() && !ok) {
-      s = errors::Internal("unexpected ok value at rpc completion");
-    }
-
-    if (!s.ok()) {
-      s = Status(s.error_code(),
-                 base::StrCat({s.error_message(),
-                               "\nAdditional GRPC error information:\n",
-                               context_.debug_error_string()}));
-    }
+    if (call_opts_) call_opts_->ClearCancelCallback();
+    RecordClientRpcLatency(service_, method_, base::TimeTicks::Now() - start_);
 
+    Status s = FromGrpcClientCallStatus(status_, ok, &context_);
     std::move(done_).Run(s);
     delete this;
   }
 
  private:
+  CallOptions* call_opts_;
+  std::string service_;
+  const char* method_;
+  base::TimeTicks start_;
   ::grpc::Status status_;
   ::grpc::ClientContext context_;
   std::unique_ptr<::grpc::ClientAsyncResponseReader<ResponseMessage>> call_;
@@ -0,0 +1,305 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_RPC_GRPC_ASYNC_CLIENT_STREAM_H_
+#define FELICIA_CORE_RPC_GRPC_ASYNC_CLIENT_STREAM_H_
+
+#include <memory>
+#include <string>
+
+#include "grpcpp/grpcpp.h"
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/memory/ref_counted.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/rpc/call_options.h"
+#include "felicia/core/rpc/grpc_client_cq_tag.h"
+#include "felicia/core/rpc/grpc_util.h"
+
+namespace felicia {
+
+// ClientStreamWriter is returned by a call of a bidirectional streaming
+// method to write the requests. Only one write can be in flight, so the next
+// request should be written once the callback of the previous Write() is
+// called.
+template <typename RequestMessage>
+class ClientStreamWriter
+    : public base::RefCountedThreadSafe<ClientStreamWriter<RequestMessage>> {
+ public:
+  // Writes |request|, which can be destroyed as soon as this returns.
+  // |callback| is called when it is written.
+  virtual void Write(const RequestMessage& request,
+                     StatusOnceCallback callback) = 0;
+
+  // Tells the server that no more requests follow. This should be called
+  // once, after the callback of the last Write() is called.
+  virtual void WritesDone() = 0;
+
+ protected:
+  friend class base::RefCountedThreadSafe<ClientStreamWriter<RequestMessage>>;
+  virtual ~ClientStreamWriter() = default;
+};
+
+// A call of a server streaming method. Each response is passed to
+// |on_response| on the completion queue thread, and the next one isn't read
+// until it returns, which keeps the server from writing ahead of the client.
+template <typename Stub, typename RequestMessage, typename ResponseMessage>
+class GrpcAsyncClientServerStreamingCall : public GrpcClientCQTag {
+ public:
+  using PrepareAsyncFunction =
+      std::unique_ptr<::grpc::ClientAsyncReader<ResponseMessage>> (Stub::*)(
+          ::grpc::ClientContext*, const RequestMessage&,
+          ::grpc::CompletionQueue*);
+  using OnResponseCallback =
+      base::RepeatingCallback<void(const ResponseMessage&)>;
+
+  // |call_opts| can be null, otherwise it should outlive the call. The
+  // latency is recorded under |service| and |method|.
+  GrpcAsyncClientServerStreamingCall(
+      Stub* stub, const RequestMessage* request,
+      PrepareAsyncFunction prepare_async_function, ::grpc::CompletionQueue* cq,
+      OnResponseCallback on_response, StatusOnceCallback done,
+      CallOptions* call_opts, std::string service, const char* method)
+      : call_opts_(call_opts),
+        service_(std::move(service)),
+        method_(method),
+        start_(base::TimeTicks::Now()),
+        on_response_(on_response),
+        done_(std::move(done)) {
+    ApplyCallOptions(call_opts_, &context_);
+    call_ = (stub->*prepare_async_function)(&context_, *request, cq);
+    call_->StartCall(this);
+  }
+
+  void OnCompleted(bool ok) override {
+    switch (state_) {
+      case STARTING:
+      case READING:
+        if (state_ == READING && ok) on_response_.Run(response_);
+        if (ok) {
+          state_ = READING;
+          call_->Read(&response_, this);
+        } else {
+          state_ = FINISHING;
+          call_->Finish(&status_, this);
+        }
+        return;
+      case FINISHING:
+        break;
+    }
+
+    if (call_opts_) call_opts_->ClearCancelCallback();
+    RecordClientRpcLatency(service_, method_, base::TimeTicks::Now() - start_);
+
+    std::move(done_).Run(FromGrpcClientCallStatus(status_, ok, &context_));
+    delete this;
+  }
+
+ private:
+  enum State {
+    STARTING,
+    READING,
+    FINISHING,
+  };
+
+  CallOptions* call_opts_;
+  std::string service_;
+  const char* method_;
+  base::TimeTicks start_;
+  State state_ = STARTING;
+  ResponseMessage response_;
+  ::grpc::Status status_;
+  ::grpc::ClientContext context_;
+  std::unique_ptr<::grpc::ClientAsyncReader<ResponseMessage>> call_;
+  OnResponseCallback on_response_;
+  StatusOnceCallback done_;
+};
+
+// A call of a bidirectional streaming method. The responses are read like
+// GrpcAsyncClientServerStreamingCall, and the call holds a reference to
+// itself from Start() until it finishes.
+template <typename Stub, typename RequestMessage, typename ResponseMessage>
+class GrpcAsyncClientBidiStreamingCall
+    : public ClientStreamWriter<RequestMessage> {
+ public:
+  using PrepareAsyncFunction = std::unique_ptr<
+      ::grpc::ClientAsyncReaderWriter<RequestMessage, ResponseMessage>> (
+      Stub::*)(::grpc::ClientContext*, ::grpc::CompletionQueue*);
+  using OnResponseCallback =
+      base::RepeatingCallback<void(const ResponseMessage&)>;
+
+  // |call_opts| can be null, otherwise it should outlive the call. The
+  // latency is recorded under |service| and |method|.
+  GrpcAsyncClientBidiStreamingCall(
+      Stub* stub, PrepareAsyncFunction prepare_async_function,
+      ::grpc::CompletionQueue* cq, OnResponseCallback on_response,
+      StatusOnceCallback done, CallOptions* call_opts, std::string service,
+      const char* method)
+      : call_opts_(call_opts),
+        service_(std::move(service)),
+        method_(method),
+        on_response_(on_response),
+        done_(std::move(done)) {
+    ApplyCallOptions(call_opts_, &context_);
+    call_ = (stub->*prepare_async_function)(&context_, cq);
+  }
+
+  void Start() {
+    start_ = base::TimeTicks::Now();
+    this->AddRef();  // Released when the call finishes.
+    call_->StartCall(&read_tag_);
+  }
+
+  void Write(const RequestMessage& request,
+             StatusOnceCallback callback) override {
+    {
+      base::AutoLock l(lock_);
+      if (!writes_done_ && !write_callback_) {
+        write_callback_ = std::move(callback);
+        if (!started_) {
+          pending_request_ = std::make_unique<RequestMessage>(request);
+          return;
+        }
+      }
+    }
+    if (callback) {
+      std::move(callback).Run(errors::FailedPrecondition(
+          "The previous write is in flight or writes are done."));
+      return;
+    }
+    this->AddRef();  // Released in OnWritten().
+    call_->Write(request, &write_tag_);
+  }
+
+  void WritesDone() override {
+    {
+      base::AutoLock l(lock_);
+      if (writes_done_) return;
+      writes_done_ = true;
+      if (!started_) {
+        pending_writes_done_ = true;
+        return;
+      }
+    }
+    this->AddRef();  // Released in OnWritesDone().
+    call_->WritesDone(&writes_done_tag_);
+  }
+
+ private:
+  typedef GrpcAsyncClientBidiStreamingCall<Stub, RequestMessage,
+                                           ResponseMessage>
+      Self;
+
+  class Tag : public GrpcClientCQTag {
+   public:
+    Tag(Self* call, void (Self::*callback)(bool))
+        : call_(call), callback_(callback) {}
+
+    void OnCompleted(bool ok) override { (call_->*callback_)(ok); }
+
+   private:
+    Self* call_;
+    void (Self::*callback_)(bool);
+  };
+
+  enum State {
+    STARTING,
+    READING,
+    FINISHING,
+  };
+
+  ~GrpcAsyncClientBidiStreamingCall() override = default;
+
+  // grpc takes no write until the call is started, so the write or the
+  // WritesDone() requested before that is issued here.
+  void OnStarted() {
+    std::unique_ptr<RequestMessage> request;
+    bool writes_done;
+    {
+      base::AutoLock l(lock_);
+      started_ = true;
+      request = std::move(pending_request_);
+      writes_done = pending_writes_done_;
+    }
+    if (request) {
+      this->AddRef();  // Released in OnWritten().
+      call_->Write(*request, &write_tag_);
+    } else if (writes_done) {
+      this->AddRef();  // Released in OnWritesDone().
+      call_->WritesDone(&writes_done_tag_);
+    }
+  }
+
+  void OnRead(bool ok) {
+    switch (state_) {
+      case STARTING:
+      case READING:
+        if (state_ == STARTING) OnStarted();
+        if (state_ == READING && ok) on_response_.Run(response_);
+        if (ok) {
+          state_ = READING;
+          call_->Read(&response_, &read_tag_);
+        } else {
+          state_ = FINISHING;
+          call_->Finish(&status_, &read_tag_);
+        }
+        return;
+      case FINISHING:
+        break;
+    }
+
+    if (call_opts_) call_opts_->ClearCancelCallback();
+    RecordClientRpcLatency(service_, method_, base::TimeTicks::Now() - start_);
+
+    std::move(done_).Run(FromGrpcClientCallStatus(status_, ok, &context_));
+    this->Release();
+  }
+
+  void OnWritten(bool ok) {
+    StatusOnceCallback callback;
+    {
+      base::AutoLock l(lock_);
+      callback = std::move(write_callback_);
+    }
+    std::move(callback).Run(ok ? Status::OK()
+                               : errors::Cancelled("The stream is closed."));
+    this->Release();
+  }
+
+  void OnWritesDone(bool ok) { this->Release(); }
+
+  CallOptions* call_opts_;
+  std::string service_;
+  const char* method_;
+  base::TimeTicks start_;
+  // Accessed only by the read chain, which runs one step at a time.
+  State state_ = STARTING;
+  ResponseMessage response_;
+  ::grpc::Status status_;
+  ::grpc::ClientContext context_;
+  std::unique_ptr<
+      ::grpc::ClientAsyncReaderWriter<RequestMessage, ResponseMessage>>
+      call_;
+  OnResponseCallback on_response_;
+  StatusOnceCallback done_;
+
+  Tag read_tag_{this, &Self::OnRead};
+  Tag write_tag_{this, &Self::OnWritten};
+  Tag writes_done_tag_{this, &Self::OnWritesDone};
+
+  base::Lock lock_;
+  StatusOnceCallback write_callback_ GUARDED_BY(lock_);
+  bool writes_done_ GUARDED_BY(lock_) = false;
+  bool started_ GUARDED_BY(lock_) = false;
+  // The write and the WritesDone() held until the call is started.
+  std::unique_ptr<RequestMessage> pending_request_ GUARDED_BY(lock_);
+  bool pending_writes_done_ GUARDED_BY(lock_) = false;
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_RPC_GRPC_ASYNC_CLIENT_STREAM_H_
@@ -92,13 +92,24 @@ class UntypedCall : public base::RefCountedThreadSafe<UntypedCall<Service>> {
   // the `::grpc::ServerContext` associated with the request.
   virtual void RequestCancelled(Service* service, bool ok) = 0;
 
+  // These are called when a request is read from, or a response is written
+  // to the stream of a streaming call. See grpc_streaming_call.h.
+  virtual void RequestRead(bool ok) {}
+  virtual void ResponseWritten(bool ok) {}
+
   // Associates a tag in a `::grpc::CompletionQueue` with a callback
   // for an incoming RPC.  An active Tag owns a reference on the corresponding
   // Call object.
   class Tag {
    public:
     // One enum value per supported callback.
-    enum Callback { kRequestReceived, kResponseSent, kCancelled };
+    enum Callback {
+      kRequestReceived,
+      kResponseSent,
+      kCancelled,
+      kRequestRead,
+      kResponseWritten
+    };
 
     Tag(UntypedCall* call, Callback cb) : call_(call), callback_(cb) {}
 
@@ -116,6 +127,12 @@ class UntypedCall : public base::RefCountedThreadSafe<UntypedCall<Service>> {
         case kCancelled:
           call_->RequestCancelled(service, ok);
           break;
+        case kRequestRead:
+          call_->RequestRead(ok);
+          break;
+        case kResponseWritten:
+          call_->ResponseWritten(ok);
+          break;
       }
       call_->Release();  // Ref acquired when tag handed to grpc.
     }
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef FELIICA_CORE_RPC_GRPC_CLIENT_IMPL_H_
 #define FELIICA_CORE_RPC_GRPC_CLIENT_IMPL_H_
 
+#include <atomic>
 #include <memory>
 
 #include "grpcpp/grpcpp.h"
@@ -24,10 +25,13 @@ limitations under the License.
 #include "third_party/chromium/base/strings/stringprintf.h"
 #include "third_party/chromium/base/threading/thread.h"
 
+#include "felicia/core/lib/error/errors.h"
 #include "felicia/core/lib/error/status.h"
 #include "felicia/core/protobuf/channel.pb.h"
+#include "felicia/core/rpc/call_options.h"
 #include "felicia/core/rpc/client_interface.h"
 #include "felicia/core/rpc/grpc_async_client_call.h"
+#include "felicia/core/rpc/grpc_async_client_stream.h"
 #include "felicia/core/rpc/grpc_client_cq_tag.h"
 #include "felicia/core/rpc/grpc_util.h"
 
@@ -61,6 +65,12 @@ class FEL_GRPC_CLIENT : public ClientInterface {
     return Status::OK();
   }
 
+  int outstanding_calls() const override { return outstanding_calls_; }
+
+  // Once a call fails with error::UNAVAILABLE, which means the server can't
+  // be reached, it is no longer available.
+  bool IsAvailable() const override { return !unavailable_; }
+
   void WaitUntilShutdown() { threads_.clear(); }
 
   void HandleRpcsLoop();
@@ -74,9 +84,16 @@ class FEL_GRPC_CLIENT : public ClientInterface {
   void RunRpcsLoops(int num_threads);
   void ShutdownClient();
 
+  // Counts the call, which finishes with |done|, as outstanding until it
+  // finishes.
+  StatusOnceCallback TrackCall(StatusOnceCallback done);
+  void OnCallDone(StatusOnceCallback done, Status s);
+
   std::unique_ptr<Stub> stub_;
   std::unique_ptr<::grpc::CompletionQueue> cq_;
   std::vector<std::unique_ptr<base::Thread>> threads_;
+  std::atomic<int> outstanding_calls_{0};
+  std::atomic<bool> unavailable_{false};
 
   DISALLOW_COPY_AND_ASSIGN(Client);
 };
@@ -143,17 +160,87 @@ void FEL_GRPC_CLIENT::ShutdownClient() {
   threads_.clear();
 }
 
-#define FEL_GRPC_CLIENT_METHOD_DECLARE(method)       \
-  void method##Async(const method##Request* request, \
+template <typename T>
+StatusOnceCallback FEL_GRPC_CLIENT::TrackCall(StatusOnceCallback done) {
+  ++outstanding_calls_;
+  return base::BindOnce(&Client::OnCallDone, base::Unretained(this),
+                        std::move(done));
+}
+
+template <typename T>
+void FEL_GRPC_CLIENT::OnCallDone(StatusOnceCallback done, Status s) {
+  --outstanding_calls_;
+  if (errors::IsUnavailable(s)) unavailable_ = true;
+  if (done) std::move(done).Run(std::move(s));
+}
+
+// Declares 2 overloads, where the one with |call_opts| sets a deadline or
+// cancels the call. See CallOptions. The overload without it comes last so
+// that it can be followed by override.
+#define FEL_GRPC_CLIENT_METHOD_DECLARE(method)                            \
+  void method##Async(const method##Request* request,                      \
+                     method##Response* response, StatusOnceCallback done, \
+                     CallOptions* call_opts);                             \
+  void method##Async(const method##Request* request,                      \
                      method##Response* response, StatusOnceCallback done)
 
-#define FEL_GRPC_CLIENT_METHOD_DEFINE(clazz, method)                  \
-  void clazz::method##Async(const method##Request* request,           \
-                            method##Response* response,               \
-                            StatusOnceCallback done) {                \
-    new GrpcAsyncClientCall<Stub, method##Request, method##Response>( \
-        stub_.get(), request, response, &Stub::PrepareAsync##method,  \
-        cq_.get(), std::move(done));                                  \
+#define FEL_GRPC_CLIENT_METHOD_DEFINE(clazz, method)                     \
+  void clazz::method##Async(const method##Request* request,              \
+                            method##Response* response,                  \
+                            StatusOnceCallback done,                     \
+                            CallOptions* call_opts) {                    \
+    new GrpcAsyncClientCall<Stub, method##Request, method##Response>(    \
+        stub_.get(), request, response, &Stub::PrepareAsync##method,     \
+        cq_.get(), TrackCall(std::move(done)), call_opts,                \
+        service_name(), #method);                                        \
+  }                                                                      \
+                                                                         \
+  void clazz::method##Async(const method##Request* request,              \
+                            method##Response* response,                  \
+                            StatusOnceCallback done) {                   \
+    method##Async(request, response, std::move(done), nullptr);          \
+  }
+
+// Declares a call of a server streaming method, where each response is
+// passed to |on_response| and |done| is called at last. See
+// GrpcAsyncClientServerStreamingCall.
+#define FEL_GRPC_CLIENT_SERVER_STREAMING_METHOD_DECLARE(method)           \
+  void method##Async(                                                     \
+      const method##Request* request,                                     \
+      base::RepeatingCallback<void(const method##Response&)> on_response, \
+      StatusOnceCallback done, CallOptions* call_opts = nullptr)
+
+#define FEL_GRPC_CLIENT_SERVER_STREAMING_METHOD_DEFINE(clazz, method)     \
+  void clazz::method##Async(                                              \
+      const method##Request* request,                                     \
+      base::RepeatingCallback<void(const method##Response&)> on_response, \
+      StatusOnceCallback done, CallOptions* call_opts) {                  \
+    new GrpcAsyncClientServerStreamingCall<Stub, method##Request,         \
+                                           method##Response>(             \
+        stub_.get(), request, &Stub::PrepareAsync##method, cq_.get(),     \
+        std::move(on_response), TrackCall(std::move(done)), call_opts,    \
+        service_name(), #method);                                         \
+  }
+
+// Declares a call of a bidirectional streaming method, which returns the
+// writer of the requests. The responses are passed to |on_response| and
+// |done| is called at last.
+#define FEL_GRPC_CLIENT_BIDI_STREAMING_METHOD_DECLARE(method)             \
+  scoped_refptr<ClientStreamWriter<method##Request>> method##Async(       \
+      base::RepeatingCallback<void(const method##Response&)> on_response, \
+      StatusOnceCallback done, CallOptions* call_opts = nullptr)
+
+#define FEL_GRPC_CLIENT_BIDI_STREAMING_METHOD_DEFINE(clazz, method)        \
+  scoped_refptr<ClientStreamWriter<method##Request>> clazz::method##Async( \
+      base::RepeatingCallback<void(const method##Response&)> on_response,  \
+      StatusOnceCallback done, CallOptions* call_opts) {                   \
+    auto call = base::MakeRefCounted<GrpcAsyncClientBidiStreamingCall<     \
+        Stub, method##Request, method##Response>>(                         \
+        stub_.get(), &Stub::PrepareAsync##method, cq_.get(),               \
+        std::move(on_response), TrackCall(std::move(done)), call_opts,     \
+        service_name(), #method);                                          \
+    call->Start();                                                         \
+    return call;                                                           \
   }
 
 }  // namespace rpc
@@ -34,9 +34,16 @@ class FEL_GRPC_SERVER : public ServerInterface {
 
   Status Start() override;
 
+  // Sets the number of threads to handle requests, which should be called
+  // before Run(). Requests are handled concurrently if it's more than 1.
+  // (Default: ResolveServiceServerRpcThreadNum())
+  void set_rpc_thread_num(int rpc_thread_num) {
+    rpc_thread_num_ = rpc_thread_num;
+  }
+
   // Non-blocking
   Status Run() override {
-    RunRpcsLoops(1);
+    RunRpcsLoops(rpc_thread_num_);
     return Status::OK();
   }
 
@@ -60,6 +67,7 @@ class FEL_GRPC_SERVER : public ServerInterface {
   std::unique_ptr<Service> service_;
   std::unique_ptr<::grpc::Server> server_;
   std::vector<std::unique_ptr<base::Thread>> threads_;
+  int rpc_thread_num_ = ResolveServiceServerRpcThreadNum();
 
   DISALLOW_COPY_AND_ASSIGN(Server);
 };
@@ -21,9 +21,11 @@ limitations under the License.
 #include "third_party/chromium/base/bind.h"
 #include "third_party/chromium/base/synchronization/lock.h"
 #include "third_party/chromium/base/thread_annotations.h"
+#include "third_party/chromium/base/time/time.h"
 
 #include "felicia/core/lib/error/status.h"
 #include "felicia/core/rpc/grpc_call.h"
+#include "felicia/core/rpc/grpc_streaming_call.h"
 #include "felicia/core/rpc/grpc_util.h"
 
 namespace felicia {
@@ -52,10 +54,26 @@ class FEL_GRPC_SERVICE {
   using GrpcCall =
       Call<ServiceImpl, GrpcAsyncService, RequestMessage, ResponseMessage>;
 
+  template <typename ServiceImpl, typename RequestMessage,
+            typename ResponseMessage>
+  using GrpcServerStreamingCall =
+      ServerStreamingCall<ServiceImpl, GrpcAsyncService, RequestMessage,
+                          ResponseMessage>;
+
+  template <typename ServiceImpl, typename RequestMessage,
+            typename ResponseMessage>
+  using GrpcBidiStreamingCall =
+      BidiStreamingCall<ServiceImpl, GrpcAsyncService, RequestMessage,
+                        ResponseMessage>;
+
   virtual void EnqueueRequests() = 0;
 
+  // Sends the response of |call| of |method| which was received at |start|.
   template <typename GrpcCall>
-  static void OnHandleRequest(GrpcCall* call, Status status) {
+  static void OnHandleRequest(GrpcCall* call, const char* method,
+                              base::TimeTicks start, Status status) {
+    RecordServerRpcLatency(service_name(), method,
+                           base::TimeTicks::Now() - start);
     call->SendResponse(ToGrpcStatus(std::move(status)));
   }
 
@@ -134,10 +152,62 @@ void FEL_GRPC_SERVICE::HandleRpcsLoop() {
         base::BindOnce(                                              \
             &clazz::OnHandleRequest<                                 \
                 GrpcCall<clazz, method##Request, method##Response>>, \
-            call));                                                  \
+            call, #method, base::TimeTicks::Now()));                 \
     FEL_ENQUEUE_REQUEST(clazz, method, supports_cancel);             \
   }
 
+// The handler of a server streaming method |method| is called like
+// |instance|->method(const method##Request* request,
+//                    ServerStreamWriter<method##Response>* writer), and it
+// should call writer->Finish() at last.
+#define FEL_ENQUEUE_SERVER_STREAMING_REQUEST(clazz, method)               \
+  do {                                                                    \
+    base::AutoLock l(lock_);                                              \
+    if (!is_shutdown_) {                                                  \
+      GrpcServerStreamingCall<clazz, method##Request, method##Response>:: \
+          EnqueueRequest(&async_service_, cq_.get(),                      \
+                         &GrpcAsyncService::Request##method,              \
+                         &clazz::Handle##method, #method);                \
+    }                                                                     \
+  } while (0)
+
+#define FEL_GRPC_SERVER_STREAMING_METHOD_DECLARE(clazz, method) \
+  void Handle##method(                                          \
+      GrpcServerStreamingCall<clazz, method##Request, method##Response>* call)
+
+#define FEL_GRPC_SERVER_STREAMING_METHOD_DEFINE(clazz, instance, method) \
+  void clazz::Handle##method(                                            \
+      GrpcServerStreamingCall<clazz, method##Request, method##Response>* \
+          call) {                                                        \
+    instance->method(&call->request_, call);                             \
+    FEL_ENQUEUE_SERVER_STREAMING_REQUEST(clazz, method);                 \
+  }
+
+// The handler of a bidirectional streaming method |method| is called like
+// |instance|->method(ServerStream<method##Request, method##Response>* stream),
+// and it should call stream->Finish() at last.
+#define FEL_ENQUEUE_BIDI_STREAMING_REQUEST(clazz, method)               \
+  do {                                                                  \
+    base::AutoLock l(lock_);                                            \
+    if (!is_shutdown_) {                                                \
+      GrpcBidiStreamingCall<clazz, method##Request, method##Response>:: \
+          EnqueueRequest(&async_service_, cq_.get(),                    \
+                         &GrpcAsyncService::Request##method,            \
+                         &clazz::Handle##method, #method);              \
+    }                                                                   \
+  } while (0)
+
+#define FEL_GRPC_BIDI_STREAMING_METHOD_DECLARE(clazz, method) \
+  void Handle##method(                                        \
+      GrpcBidiStreamingCall<clazz, method##Request, method##Response>* call)
+
+#define FEL_GRPC_BIDI_STREAMING_METHOD_DEFINE(clazz, instance, method)         \
+  void clazz::Handle##method(                                                  \
+      GrpcBidiStreamingCall<clazz, method##Request, method##Response>* call) { \
+    instance->method(call);                                                    \
+    FEL_ENQUEUE_BIDI_STREAMING_REQUEST(clazz, method);                         \
+  }
+
 }  // namespace rpc
 }  // namespace felicia
 
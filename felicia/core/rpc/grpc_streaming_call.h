@@ -0,0 +1,299 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_RPC_GRPC_STREAMING_CALL_H_
+#define FELICIA_CORE_RPC_GRPC_STREAMING_CALL_H_
+
+#include "grpcpp/grpcpp.h"
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/rpc/grpc_call.h"
+#include "felicia/core/rpc/grpc_util.h"
+
+namespace felicia {
+
+// ServerStreamWriter is handed to the handler of a server streaming method
+// to write the responses.
+//
+// Only one write can be in flight, so that a large data, e.g, a map, can be
+// streamed in chunks holding one chunk at a time. The next chunk should be
+// written once the callback of the previous Write() is called. A write fails
+// once the client cancels the call or goes away.
+template <typename ResponseMessage>
+class ServerStreamWriter {
+ public:
+  // Writes |response|, which can be destroyed as soon as this returns.
+  // |callback| is called when it is written.
+  virtual void Write(const ResponseMessage& response,
+                     StatusOnceCallback callback) = 0;
+
+  // Finishes the call with |status|. This should be called once, after the
+  // callback of the last Write() is called. The writer must not be used
+  // after this.
+  virtual void Finish(Status status) = 0;
+
+ protected:
+  virtual ~ServerStreamWriter() = default;
+};
+
+// ServerStream is handed to the handler of a bidirectional streaming method
+// to read the requests and to write the responses. Like the writes, only one
+// read can be in flight.
+template <typename RequestMessage, typename ResponseMessage>
+class ServerStream : public ServerStreamWriter<ResponseMessage> {
+ public:
+  // Reads the next request to |request|. |callback| is called when it is
+  // read, or with error::OUT_OF_RANGE if the client has finished writing.
+  virtual void Read(RequestMessage* request, StatusOnceCallback callback) = 0;
+
+ protected:
+  ~ServerStream() override = default;
+};
+
+// StreamingCall implements the writing side of the streaming calls, where
+// |Interface| is either ServerStreamWriter or ServerStream and |Stream| is
+// ::grpc::ServerAsyncWriter or ::grpc::ServerAsyncReaderWriter.
+template <typename Service, typename Interface, typename ResponseMessage,
+          typename Stream>
+class StreamingCall : protected UntypedCall<Service>, public Interface {
+ public:
+  void Write(const ResponseMessage& response,
+             StatusOnceCallback callback) override {
+    {
+      base::AutoLock l(lock_);
+      if (!finished_ && !write_callback_) {
+        write_callback_ = std::move(callback);
+      }
+    }
+    if (callback) {
+      std::move(callback).Run(
+          errors::FailedPrecondition("The previous write is in flight."));
+      return;
+    }
+    this->AddRef();  // Ref for grpc; released in Tag callback.
+    stream_.Write(response, &response_written_tag_);
+  }
+
+  void Finish(Status status) override {
+    {
+      base::AutoLock l(lock_);
+      if (finished_) return;
+      finished_ = true;
+    }
+    RecordServerRpcLatency(Service::service_name(), method_,
+                           base::TimeTicks::Now() - start_);
+    this->AddRef();  // Ref for grpc; released in Tag callback.
+    stream_.Finish(ToGrpcStatus(std::move(status)), &response_sent_tag_);
+    this->Release();  // Ref handed to the handler.
+  }
+
+ protected:
+  friend class base::RefCountedThreadSafe<UntypedCall<Service>>;
+  typedef typename UntypedCall<Service>::Tag Tag;
+
+  explicit StreamingCall(const char* method)
+      : method_(method), stream_(&ctx_) {}
+  ~StreamingCall() override = default;
+
+  // Holds a reference for the handler until it calls Finish().
+  void StartHandling() {
+    start_ = base::TimeTicks::Now();
+    this->AddRef();
+  }
+
+  void RequestCancelled(Service* service, bool ok) override {}
+
+  void ResponseWritten(bool ok) override {
+    StatusOnceCallback callback;
+    {
+      base::AutoLock l(lock_);
+      callback = std::move(write_callback_);
+    }
+    std::move(callback).Run(ok ? Status::OK()
+                               : errors::Cancelled("The stream is closed."));
+  }
+
+  const char* method_;
+  base::TimeTicks start_;
+  ::grpc::ServerContext ctx_;
+  Stream stream_;
+
+  // Used as void* completion markers from grpc to indicate different
+  // events of interest for a call.
+  Tag request_received_tag_{this, Tag::kRequestReceived};
+  Tag response_sent_tag_{this, Tag::kResponseSent};
+  Tag response_written_tag_{this, Tag::kResponseWritten};
+
+  base::Lock lock_;
+  StatusOnceCallback write_callback_ GUARDED_BY(lock_);
+  bool finished_ GUARDED_BY(lock_) = false;
+};
+
+template <typename Service, typename GrpcService, typename RequestMessage,
+          typename ResponseMessage>
+class ServerStreamingCall
+    : public StreamingCall<Service, ServerStreamWriter<ResponseMessage>,
+                           ResponseMessage,
+                           ::grpc::ServerAsyncWriter<ResponseMessage>> {
+ public:
+  // Represents the generic signature of a generated
+  // `GrpcService::RequestFoo()` method, where `Foo` is the name of a server
+  // streaming RPC method.
+  using EnqueueFunction = void (GrpcService::*)(
+      ::grpc::ServerContext*, RequestMessage*,
+      ::grpc::ServerAsyncWriter<ResponseMessage>*, ::grpc::CompletionQueue*,
+      ::grpc::ServerCompletionQueue*, void*);
+
+  // Represents the generic signature of a `Service::HandleFoo()`
+  // method, where `Foo` is the name of an RPC method.
+  using HandleRequestFunction = void (Service::*)(
+      ServerStreamingCall<Service, GrpcService, RequestMessage,
+                          ResponseMessage>*);
+
+  void RequestReceived(Service* service, bool ok) override {
+    if (ok) {
+      this->StartHandling();
+      (service->*handle_request_function_)(this);
+    }
+  }
+
+  // Enqueues a new request for the given service on the given
+  // completion queue, using the given `enqueue_function`.
+  //
+  // The request will be handled with the given
+  // `handle_request_function`, and its latency is recorded under |method|.
+  static void EnqueueRequest(GrpcService* grpc_service,
+                             ::grpc::ServerCompletionQueue* cq,
+                             EnqueueFunction enqueue_function,
+                             HandleRequestFunction handle_request_function,
+                             const char* method) {
+    auto call = new ServerStreamingCall<Service, GrpcService, RequestMessage,
+                                        ResponseMessage>(
+        handle_request_function, method);
+    call->AddRef();
+
+    (grpc_service->*enqueue_function)(&call->ctx_, &call->request_,
+                                      &call->stream_, cq, cq,
+                                      &call->request_received_tag_);
+  }
+
+  RequestMessage request_;
+
+ private:
+  friend class base::RefCountedThreadSafe<UntypedCall<Service>>;
+
+  ServerStreamingCall(HandleRequestFunction handle_request_function,
+                      const char* method)
+      : StreamingCall<Service, ServerStreamWriter<ResponseMessage>,
+                      ResponseMessage,
+                      ::grpc::ServerAsyncWriter<ResponseMessage>>(method),
+        handle_request_function_(handle_request_function) {}
+  ~ServerStreamingCall() override = default;
+
+  HandleRequestFunction handle_request_function_;
+};
+
+template <typename Service, typename GrpcService, typename RequestMessage,
+          typename ResponseMessage>
+class BidiStreamingCall
+    : public StreamingCall<
+          Service, ServerStream<RequestMessage, ResponseMessage>,
+          ResponseMessage,
+          ::grpc::ServerAsyncReaderWriter<ResponseMessage, RequestMessage>> {
+ public:
+  // Represents the generic signature of a generated
+  // `GrpcService::RequestFoo()` method, where `Foo` is the name of a
+  // bidirectional streaming RPC method.
+  using EnqueueFunction = void (GrpcService::*)(
+      ::grpc::ServerContext*,
+      ::grpc::ServerAsyncReaderWriter<ResponseMessage, RequestMessage>*,
+      ::grpc::CompletionQueue*, ::grpc::ServerCompletionQueue*, void*);
+
+  // Represents the generic signature of a `Service::HandleFoo()`
+  // method, where `Foo` is the name of an RPC method.
+  using HandleRequestFunction = void (Service::*)(
+      BidiStreamingCall<Service, GrpcService, RequestMessage,
+                        ResponseMessage>*);
+
+  void RequestReceived(Service* service, bool ok) override {
+    if (ok) {
+      this->StartHandling();
+      (service->*handle_request_function_)(this);
+    }
+  }
+
+  void Read(RequestMessage* request, StatusOnceCallback callback) override {
+    {
+      base::AutoLock l(this->lock_);
+      if (!this->finished_ && !read_callback_) {
+        read_callback_ = std::move(callback);
+      }
+    }
+    if (callback) {
+      std::move(callback).Run(
+          errors::FailedPrecondition("The previous read is in flight."));
+      return;
+    }
+    this->AddRef();  // Ref for grpc; released in Tag callback.
+    this->stream_.Read(request, &request_read_tag_);
+  }
+
+  // Enqueues a new request for the given service on the given
+  // completion queue, using the given `enqueue_function`.
+  //
+  // The request will be handled with the given
+  // `handle_request_function`, and its latency is recorded under |method|.
+  static void EnqueueRequest(GrpcService* grpc_service,
+                             ::grpc::ServerCompletionQueue* cq,
+                             EnqueueFunction enqueue_function,
+                             HandleRequestFunction handle_request_function,
+                             const char* method) {
+    auto call =
+        new BidiStreamingCall<Service, GrpcService, RequestMessage,
+                              ResponseMessage>(handle_request_function, method);
+    call->AddRef();
+
+    (grpc_service->*enqueue_function)(&call->ctx_, &call->stream_, cq, cq,
+                                      &call->request_received_tag_);
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<UntypedCall<Service>>;
+  typedef typename UntypedCall<Service>::Tag Tag;
+
+  BidiStreamingCall(HandleRequestFunction handle_request_function,
+                    const char* method)
+      : StreamingCall<
+            Service, ServerStream<RequestMessage, ResponseMessage>,
+            ResponseMessage,
+            ::grpc::ServerAsyncReaderWriter<ResponseMessage, RequestMessage>>(
+            method),
+        handle_request_function_(handle_request_function) {}
+  ~BidiStreamingCall() override = default;
+
+  void RequestRead(bool ok) override {
+    StatusOnceCallback callback;
+    {
+      base::AutoLock l(this->lock_);
+      callback = std::move(read_callback_);
+    }
+    std::move(callback).Run(
+        ok ? Status::OK()
+           : errors::OutOfRange("The client has finished writing."));
+  }
+
+  HandleRequestFunction handle_request_function_;
+
+  Tag request_read_tag_{this, Tag::kRequestRead};
+
+  StatusOnceCallback read_callback_ GUARDED_BY(this->lock_);
+};
+
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_RPC_GRPC_STREAMING_CALL_H_
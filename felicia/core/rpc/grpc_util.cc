@@ -4,11 +4,52 @@
 
 #include "felicia/core/rpc/grpc_util.h"
 
+#include <chrono>
+
+#include "third_party/chromium/base/bind.h"
 #include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/metrics/histogram_functions.h"
+#include "third_party/chromium/base/strings/strcat.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
 #include "third_party/chromium/base/strings/stringprintf.h"
 
+#include "felicia/core/lib/error/errors.h"
+
 namespace felicia {
 
+namespace {
+
+constexpr int kDefaultServiceServerRpcThreadNum = 1;
+
+}  // namespace
+
+void ApplyCallOptions(CallOptions* call_opts, ::grpc::ClientContext* context) {
+  if (!call_opts) return;
+  base::TimeDelta timeout = call_opts->timeout();
+  if (!timeout.is_zero()) {
+    context->set_deadline(std::chrono::system_clock::now() +
+                          std::chrono::microseconds(timeout.InMicroseconds()));
+  }
+  call_opts->SetCancelCallback(base::BindOnce(
+      &::grpc::ClientContext::TryCancel, base::Unretained(context)));
+}
+
+Status FromGrpcClientCallStatus(const ::grpc::Status& s, bool ok,
+                                ::grpc::ClientContext* context) {
+  Status status = FromGrpcStatus(s);
+  if (status.ok() && !ok) {
+    status = errors::Internal("unexpected ok value at rpc completion");
+  }
+
+  if (!status.ok()) {
+    status = Status(status.error_code(),
+                    base::StrCat({status.error_message(),
+                                  "\nAdditional GRPC error information:\n",
+                                  context->debug_error_string()}));
+  }
+  return status;
+}
+
 std::shared_ptr<::grpc::Channel> ConnectToGrpcServer(const std::string& ip,
                                                      uint16_t port) {
   auto channel =
@@ -24,4 +65,28 @@ std::shared_ptr<::grpc::Channel> ConnectToGrpcServer(const std::string& ip,
   return channel;
 }
 
-}  // namespace felicia
\ No newline at end of file
+int ResolveServiceServerRpcThreadNum() {
+  const char* thread_num_env = getenv("FEL_SERVICE_SERVER_RPC_THREADS");
+  if (thread_num_env) {
+    int value;
+    if (base::StringToInt(thread_num_env, &value) && value > 0) {
+      return value;
+    }
+  }
+
+  return kDefaultServiceServerRpcThreadNum;
+}
+
+void RecordClientRpcLatency(const std::string& service, const char* method,
+                            base::TimeDelta latency) {
+  base::UmaHistogramMicrosecondsTimes(
+      base::StrCat({"Felicia.Rpc.Client.", service, ".", method}), latency);
+}
+
+void RecordServerRpcLatency(const std::string& service, const char* method,
+                            base::TimeDelta latency) {
+  base::UmaHistogramMicrosecondsTimes(
+      base::StrCat({"Felicia.Rpc.Server.", service, ".", method}), latency);
+}
+
+}  // namespace felicia
@@ -7,9 +7,11 @@
 
 #include "grpcpp/grpcpp.h"
 #include "third_party/chromium/base/template_util.h"
+#include "third_party/chromium/base/time/time.h"
 
 #include "felicia/core/lib/base/export.h"
 #include "felicia/core/lib/error/status.h"
+#include "felicia/core/rpc/call_options.h"
 
 namespace felicia {
 
@@ -58,9 +60,34 @@ inline ::grpc::Status ToGrpcStatus(Status s) {
   }
 }
 
+// Sets the deadline of |context| and lets |call_opts| cancel it. This does
+// nothing if |call_opts| is null.
+FEL_EXPORT void ApplyCallOptions(CallOptions* call_opts,
+                                 ::grpc::ClientContext* context);
+
+// Returns the status of a client call which finished with |s| and |ok|,
+// appending the error information of |context| if it failed.
+FEL_EXPORT Status FromGrpcClientCallStatus(const ::grpc::Status& s, bool ok,
+                                           ::grpc::ClientContext* context);
+
 std::shared_ptr<::grpc::Channel> ConnectToGrpcServer(const std::string& ip,
                                                      uint16_t port);
 
+// Returns the number of threads for a service server to handle requests,
+// which is set by FEL_SERVICE_SERVER_RPC_THREADS.
+FEL_EXPORT int ResolveServiceServerRpcThreadNum();
+
+// Records |latency| of a call of |method| to the histogram
+// "Felicia.Rpc.Client.<service>.<method>", or
+// "Felicia.Rpc.Server.<service>.<method>" for the server side. They can be
+// read through base::StatisticsRecorder.
+FEL_EXPORT void RecordClientRpcLatency(const std::string& service,
+                                       const char* method,
+                                       base::TimeDelta latency);
+FEL_EXPORT void RecordServerRpcLatency(const std::string& service,
+                                       const char* method,
+                                       base::TimeDelta latency);
+
 }  // namespace felicia
 
 #endif  // FELICIA_CORE_RPC_GRPC_UTIL_H_
\ No newline at end of file
@@ -0,0 +1,32 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/rpc/load_balancer.h"
+
+namespace felicia {
+namespace rpc {
+
+LoadBalancer::LoadBalancer(LoadBalancingPolicy policy) : policy_(policy) {}
+
+LoadBalancer::~LoadBalancer() = default;
+
+int LoadBalancer::Pick(const std::vector<Candidate>& candidates) {
+  size_t size = candidates.size();
+  int picked = -1;
+  for (size_t i = 0; i < size; ++i) {
+    size_t index = (next_ + i) % size;
+    const Candidate& candidate = candidates[index];
+    if (!candidate.available) continue;
+    if (picked == -1 ||
+        candidate.outstanding_calls < candidates[picked].outstanding_calls) {
+      picked = static_cast<int>(index);
+    }
+    if (policy_ == ROUND_ROBIN) break;
+  }
+  if (picked != -1) next_ = picked + 1;
+  return picked;
+}
+
+}  // namespace rpc
+}  // namespace felicia
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_CORE_RPC_LOAD_BALANCER_H_
+#define FELICIA_CORE_RPC_LOAD_BALANCER_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+
+#include "felicia/core/lib/base/export.h"
+
+namespace felicia {
+namespace rpc {
+
+enum LoadBalancingPolicy {
+  // Calls go to the servers in turn.
+  ROUND_ROBIN,
+  // A call goes to the server with the fewest calls in flight, which suits
+  // the services whose calls take a varying time.
+  LEAST_OUTSTANDING_REQUESTS,
+};
+
+// LoadBalancer chooses the server for the next call among the servers of the
+// same service. This is not thread-safe.
+class FEL_EXPORT LoadBalancer {
+ public:
+  struct Candidate {
+    // False if the server can't take a call, e.g, it isn't connected yet or
+    // it has stopped responding.
+    bool available;
+    int outstanding_calls;
+  };
+
+  explicit LoadBalancer(LoadBalancingPolicy policy = ROUND_ROBIN);
+  ~LoadBalancer();
+
+  LoadBalancingPolicy policy() const { return policy_; }
+  void set_policy(LoadBalancingPolicy policy) { policy_ = policy; }
+
+  // Returns the index of |candidates| for the next call, or -1 if none of
+  // them is available. With LEAST_OUTSTANDING_REQUESTS, the ties are broken
+  // in turn.
+  int Pick(const std::vector<Candidate>& candidates);
+
+ private:
+  LoadBalancingPolicy policy_;
+  // Where to start looking from at the next Pick().
+  size_t next_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadBalancer);
+};
+
+}  // namespace rpc
+}  // namespace felicia
+
+#endif  // FELICIA_CORE_RPC_LOAD_BALANCER_H_
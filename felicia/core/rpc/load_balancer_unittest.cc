@@ -0,0 +1,40 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/core/rpc/load_balancer.h"
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+namespace rpc {
+
+TEST(LoadBalancerTest, RoundRobin) {
+  LoadBalancer load_balancer;
+  std::vector<LoadBalancer::Candidate> candidates = {
+      {true, 3}, {false, 0}, {true, 1}};
+  EXPECT_EQ(0, load_balancer.Pick(candidates));
+  EXPECT_EQ(2, load_balancer.Pick(candidates));
+  EXPECT_EQ(0, load_balancer.Pick(candidates));
+}
+
+TEST(LoadBalancerTest, LeastOutstandingRequests) {
+  LoadBalancer load_balancer(LEAST_OUTSTANDING_REQUESTS);
+  std::vector<LoadBalancer::Candidate> candidates = {
+      {true, 3}, {false, 0}, {true, 1}};
+  EXPECT_EQ(2, load_balancer.Pick(candidates));
+  EXPECT_EQ(2, load_balancer.Pick(candidates));
+
+  candidates[0].outstanding_calls = 1;
+  EXPECT_EQ(0, load_balancer.Pick(candidates));
+  EXPECT_EQ(2, load_balancer.Pick(candidates));
+}
+
+TEST(LoadBalancerTest, NoneAvailable) {
+  LoadBalancer load_balancer;
+  EXPECT_EQ(-1, load_balancer.Pick({}));
+  EXPECT_EQ(-1, load_balancer.Pick({{false, 0}, {false, 0}}));
+}
+
+}  // namespace rpc
+}  // namespace felicia
@@ -22,6 +22,7 @@ using Camera = felicia::drivers::DshowCamera;
 #else
 #error Not supported platform!
 #endif
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
 
 namespace felicia {
 namespace drivers {
@@ -29,6 +30,10 @@ namespace drivers {
 // static
 std::unique_ptr<CameraInterface> CameraFactory::NewCamera(
     const CameraDescriptor& descriptor) {
+  if (SyntheticCamera::IsSyntheticCameraDescriptor(descriptor)) {
+    return base::WrapUnique(new SyntheticCamera(descriptor));
+  }
+
 #if defined(OS_WIN) && !BUILDFLAG(TRAVIS)
   if (MfCamera::PlatformSupportsMediaFoundation()) {
     return base::WrapUnique(new MfCamera(descriptor));
@@ -44,21 +49,30 @@ std::unique_ptr<CameraInterface> CameraFactory::NewCamera(
 Status CameraFactory::GetCameraDescriptors(
     CameraDescriptors* camera_descriptors) {
   DCHECK(camera_descriptors->empty());
+  Status s;
 #if defined(OS_WIN) && !BUILDFLAG(TRAVIS)
   if (MfCamera::PlatformSupportsMediaFoundation()) {
-    return MfCamera::GetCameraDescriptors(camera_descriptors);
+    s = MfCamera::GetCameraDescriptors(camera_descriptors);
   } else {
-    return DshowCamera::GetCameraDescriptors(camera_descriptors);
+    s = DshowCamera::GetCameraDescriptors(camera_descriptors);
   }
 #else
-  return Camera::GetCameraDescriptors(camera_descriptors);
+  s = Camera::GetCameraDescriptors(camera_descriptors);
 #endif
+  if (!s.ok()) return s;
+
+  return SyntheticCamera::GetCameraDescriptors(camera_descriptors);
 }
 
 // static
 Status CameraFactory::GetSupportedCameraFormats(
     const CameraDescriptor& camera_descriptor, CameraFormats* camera_formats) {
   DCHECK(camera_formats->empty());
+  if (SyntheticCamera::IsSyntheticCameraDescriptor(camera_descriptor)) {
+    return SyntheticCamera::GetSupportedCameraFormats(camera_descriptor,
+                                                      camera_formats);
+  }
+
 #if defined(OS_WIN) && !BUILDFLAG(TRAVIS)
   if (MfCamera::PlatformSupportsMediaFoundation()) {
     return MfCamera::GetSupportedCameraFormats(camera_descriptor,
@@ -7,7 +7,9 @@
 #include "libyuv.h"
 #include "third_party/chromium/base/logging.h"
 
+#include "felicia/core/lib/image/jpeg_codec.h"
 #include "felicia/core/lib/unit/time_util.h"
+#include "felicia/drivers/camera/camera_errors.h"
 #include "felicia/drivers/camera/camera_frame_util.h"
 
 namespace felicia {
@@ -45,12 +47,29 @@ CameraFrame::CameraFrame(const CameraFrame& other)
 CameraFrame::CameraFrame(CameraFrame&& other) noexcept
     : data_(std::move(other.data_)),
       camera_format_(other.camera_format_),
-      timestamp_(other.timestamp_) {}
+      timestamp_(other.timestamp_),
+      data_pool_(std::move(other.data_pool_)) {}
+
+CameraFrame& CameraFrame::operator=(const CameraFrame& other) {
+  if (this == &other) return *this;
+  RecycleData();
+  data_ = other.data_;
+  camera_format_ = other.camera_format_;
+  timestamp_ = other.timestamp_;
+  return *this;
+}
 
-CameraFrame& CameraFrame::operator=(const CameraFrame& other) = default;
-CameraFrame& CameraFrame::operator=(CameraFrame&& other) = default;
+CameraFrame& CameraFrame::operator=(CameraFrame&& other) {
+  if (this == &other) return *this;
+  RecycleData();
+  data_ = std::move(other.data_);
+  camera_format_ = other.camera_format_;
+  timestamp_ = other.timestamp_;
+  data_pool_ = std::move(other.data_pool_);
+  return *this;
+}
 
-CameraFrame::~CameraFrame() = default;
+CameraFrame::~CameraFrame() { RecycleData(); }
 
 const Data& CameraFrame::data() const { return data_; }
 
@@ -78,6 +97,17 @@ void CameraFrame::set_timestamp(base::TimeDelta timestamp) {
 
 base::TimeDelta CameraFrame::timestamp() const { return timestamp_; }
 
+void CameraFrame::set_data_pool(scoped_refptr<DataPool> data_pool) {
+  data_pool_ = std::move(data_pool);
+}
+
+void CameraFrame::RecycleData() {
+  if (data_pool_) {
+    data_pool_->Recycle(std::move(data_));
+    data_pool_ = nullptr;
+  }
+}
+
 CameraFrameMessage CameraFrame::ToCameraFrameMessage(bool copy) {
   CameraFrameMessage message;
   if (copy) {
@@ -157,116 +187,300 @@ Status CameraFrame::FromRosImage(const sensor_msgs::Image& image,
 
 namespace {
 
-base::Optional<CameraFrame> ConvertToBGRA(const uint8_t* data,
-                                          size_t data_length,
-                                          const CameraFormat& camera_format,
-                                          base::TimeDelta timestamp) {
-  PixelFormat pixel_format = camera_format.pixel_format();
-  libyuv::FourCC src_format;
+using camera_internal::GetPlanes;
+using camera_internal::Planes;
+
+// A single pass conversion between the planes of 2 pixel formats.
+typedef int (*Conversion)(const Planes& src, const Planes& dst, int width,
+                          int height);
+
+// Followings adapt the libyuv functions, named after the layouts of their
+// source and destination, to Conversion.
+template <int (*Convert)(const uint8_t*, int, uint8_t*, int, int, int)>
+int PackedToPacked(const Planes& src, const Planes& dst, int width,
+                   int height) {
+  return Convert(src.data[0], src.stride[0], dst.data[0], dst.stride[0], width,
+                 height);
+}
+
+template <int (*Convert)(const uint8_t*, int, uint8_t*, int, uint8_t*, int,
+                         int, int)>
+int PackedToSemiPlanar(const Planes& src, const Planes& dst, int width,
+                       int height) {
+  return Convert(src.data[0], src.stride[0], dst.data[0], dst.stride[0],
+                 dst.data[1], dst.stride[1], width, height);
+}
+
+template <int (*Convert)(const uint8_t*, int, const uint8_t*, int,
+                         const uint8_t*, int, uint8_t*, int, int, int)>
+int PlanarToPacked(const Planes& src, const Planes& dst, int width,
+                   int height) {
+  return Convert(src.data[0], src.stride[0], src.data[1], src.stride[1],
+                 src.data[2], src.stride[2], dst.data[0], dst.stride[0], width,
+                 height);
+}
 
-  if (pixel_format == PIXEL_FORMAT_BGRA) {
-    LOG(ERROR) << "Its format is already PIXEL_FORMAT_BGRA.";
+template <int (*Convert)(const uint8_t*, int, const uint8_t*, int,
+                         const uint8_t*, int, uint8_t*, int, uint8_t*, int,
+                         int, int)>
+int PlanarToSemiPlanar(const Planes& src, const Planes& dst, int width,
+                       int height) {
+  return Convert(src.data[0], src.stride[0], src.data[1], src.stride[1],
+                 src.data[2], src.stride[2], dst.data[0], dst.stride[0],
+                 dst.data[1], dst.stride[1], width, height);
+}
+
+template <int (*Convert)(const uint8_t*, int, const uint8_t*, int, uint8_t*,
+                         int, int, int)>
+int SemiPlanarToPacked(const Planes& src, const Planes& dst, int width,
+                       int height) {
+  return Convert(src.data[0], src.stride[0], src.data[1], src.stride[1],
+                 dst.data[0], dst.stride[0], width, height);
+}
+
+// Returns the direct conversion from |pixel_format| to
+// |requested_pixel_format| other than PIXEL_FORMAT_BGRA, PIXEL_FORMAT_I420 and
+// PIXEL_FORMAT_YV12, which any format is converted to by libyuv::ConvertTo*()
+// in a single pass. Returns nullptr if there is none.
+//
+// Note that the names of the libyuv formats are in the order of the bytes in
+// a 32 bit word, so libyuv's ARGB is PIXEL_FORMAT_BGRA, BGRA is
+// PIXEL_FORMAT_ARGB, ABGR is PIXEL_FORMAT_RGBA, RGB24 is PIXEL_FORMAT_BGR and
+// RAW is PIXEL_FORMAT_RGB.
+Conversion GetDirectConversion(PixelFormat pixel_format,
+                               PixelFormat requested_pixel_format) {
+  switch (pixel_format) {
+    case PIXEL_FORMAT_I420:
+    case PIXEL_FORMAT_YV12:
+      switch (requested_pixel_format) {
+        case PIXEL_FORMAT_NV12:
+          return &PlanarToSemiPlanar<libyuv::I420ToNV12>;
+        case PIXEL_FORMAT_NV21:
+          return &PlanarToSemiPlanar<libyuv::I420ToNV21>;
+        case PIXEL_FORMAT_UYVY:
+          return &PlanarToPacked<libyuv::I420ToUYVY>;
+        case PIXEL_FORMAT_YUY2:
+          return &PlanarToPacked<libyuv::I420ToYUY2>;
+        case PIXEL_FORMAT_BGR:
+          return &PlanarToPacked<libyuv::I420ToRGB24>;
+        case PIXEL_FORMAT_RGBA:
+          return &PlanarToPacked<libyuv::I420ToABGR>;
+        case PIXEL_FORMAT_RGB:
+          return &PlanarToPacked<libyuv::I420ToRAW>;
+        case PIXEL_FORMAT_ARGB:
+          return &PlanarToPacked<libyuv::I420ToBGRA>;
+        default:
+          return nullptr;
+      }
+    case PIXEL_FORMAT_NV12:
+      switch (requested_pixel_format) {
+        case PIXEL_FORMAT_BGR:
+          return &SemiPlanarToPacked<libyuv::NV12ToRGB24>;
+        case PIXEL_FORMAT_RGBA:
+          return &SemiPlanarToPacked<libyuv::NV12ToABGR>;
+        default:
+          return nullptr;
+      }
+    case PIXEL_FORMAT_NV21:
+      switch (requested_pixel_format) {
+        case PIXEL_FORMAT_BGR:
+          return &SemiPlanarToPacked<libyuv::NV21ToRGB24>;
+        case PIXEL_FORMAT_RGBA:
+          return &SemiPlanarToPacked<libyuv::NV21ToABGR>;
+        default:
+          return nullptr;
+      }
+    case PIXEL_FORMAT_UYVY:
+      if (requested_pixel_format == PIXEL_FORMAT_NV12)
+        return &PackedToSemiPlanar<libyuv::UYVYToNV12>;
+      return nullptr;
+    case PIXEL_FORMAT_YUY2:
+      if (requested_pixel_format == PIXEL_FORMAT_NV12)
+        return &PackedToSemiPlanar<libyuv::YUY2ToNV12>;
+      return nullptr;
+    case PIXEL_FORMAT_RGB:
+      if (requested_pixel_format == PIXEL_FORMAT_BGR)
+        return &PackedToPacked<libyuv::RAWToRGB24>;
+      return nullptr;
+    case PIXEL_FORMAT_BGRA:
+      switch (requested_pixel_format) {
+        case PIXEL_FORMAT_NV12:
+          return &PackedToSemiPlanar<libyuv::ARGBToNV12>;
+        case PIXEL_FORMAT_NV21:
+          return &PackedToSemiPlanar<libyuv::ARGBToNV21>;
+        case PIXEL_FORMAT_UYVY:
+          return &PackedToPacked<libyuv::ARGBToUYVY>;
+        case PIXEL_FORMAT_YUY2:
+          return &PackedToPacked<libyuv::ARGBToYUY2>;
+        case PIXEL_FORMAT_BGR:
+          return &PackedToPacked<libyuv::ARGBToRGB24>;
+        case PIXEL_FORMAT_RGBA:
+          return &PackedToPacked<libyuv::ARGBToABGR>;
+        case PIXEL_FORMAT_RGB:
+          return &PackedToPacked<libyuv::ARGBToRAW>;
+        case PIXEL_FORMAT_ARGB:
+          return &PackedToPacked<libyuv::ARGBToBGRA>;
+        default:
+          return nullptr;
+      }
+    default:
+      return nullptr;
   }
+}
 
-  src_format = camera_format.ToLibyuvPixelFormat();
-  if (src_format == libyuv::FOURCC_ANY) return base::nullopt;
+bool IsI420OrYV12(PixelFormat pixel_format) {
+  return pixel_format == PIXEL_FORMAT_I420 || pixel_format == PIXEL_FORMAT_YV12;
+}
+
+// Returns true if JpegCodec::Decode() decodes to |pixel_format|.
+bool CanDecodeJpegTo(PixelFormat pixel_format) {
+  switch (pixel_format) {
+    case PIXEL_FORMAT_BGRA:
+    case PIXEL_FORMAT_BGR:
+    case PIXEL_FORMAT_BGRX:
+    case PIXEL_FORMAT_Y8:
+    case PIXEL_FORMAT_RGBA:
+    case PIXEL_FORMAT_RGBX:
+    case PIXEL_FORMAT_RGB:
+    case PIXEL_FORMAT_ARGB:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+base::Optional<CameraFrame> ConvertToRequestedPixelFormat(
+    const uint8_t* data, size_t data_length, const CameraFormat& camera_format,
+    PixelFormat requested_pixel_format, base::TimeDelta timestamp) {
+  if (camera_format.pixel_format() == PIXEL_FORMAT_MJPEG) {
+    CameraFrame camera_frame(Data(data, data_length), camera_format, timestamp);
+    if (requested_pixel_format == PIXEL_FORMAT_MJPEG) return camera_frame;
+    if (CanDecodeJpegTo(requested_pixel_format)) {
+      StatusOr<CameraFrame> status_or =
+          DecodeMjpeg(camera_frame, requested_pixel_format);
+      if (!status_or.ok()) return base::nullopt;
+      return std::move(status_or).ValueOrDie();
+    }
+  }
+  if (requested_pixel_format == PIXEL_FORMAT_MJPEG) return base::nullopt;
+
+  CameraFormat requested_camera_format = camera_format;
+  requested_camera_format.set_pixel_format(requested_pixel_format);
+  Data converted;
+  converted.resize(requested_camera_format.AllocationSize());
+  if (!ConvertToRequestedPixelFormat(data, data_length, camera_format,
+                                     requested_pixel_format,
+                                     converted.cast<uint8_t*>())) {
+    return base::nullopt;
+  }
+
+  return CameraFrame(std::move(converted), requested_camera_format, timestamp);
+}
+
+bool ConvertToRequestedPixelFormat(const uint8_t* data, size_t data_length,
+                                   const CameraFormat& camera_format,
+                                   PixelFormat requested_pixel_format,
+                                   uint8_t* out) {
+  PixelFormat pixel_format = camera_format.pixel_format();
+  if (requested_pixel_format == PIXEL_FORMAT_MJPEG) return false;
 
   const int width = camera_format.width();
   const int height = camera_format.height();
+  Planes dst = GetPlanes(out, requested_pixel_format, width, height);
+
+  if (requested_pixel_format == PIXEL_FORMAT_BGRA ||
+      IsI420OrYV12(requested_pixel_format)) {
+    libyuv::FourCC src_format = camera_format.ToLibyuvPixelFormat();
+    if (src_format == libyuv::FOURCC_ANY) return false;
+
+    if (requested_pixel_format == PIXEL_FORMAT_BGRA) {
+      return libyuv::ConvertToARGB(
+                 data, data_length, dst.data[0], dst.stride[0],
+                 0 /* crop_x_pos */, 0 /* crop_y_pos */, width, height, width,
+                 height, libyuv::RotationMode::kRotate0, src_format) == 0;
+    }
+    return libyuv::ConvertToI420(
+               data, data_length, dst.data[0], dst.stride[0], dst.data[1],
+               dst.stride[1], dst.data[2], dst.stride[2], 0 /* crop_x_pos */,
+               0 /* crop_y_pos */, width, height, width, height,
+               libyuv::RotationMode::kRotate0, src_format) == 0;
+  }
+
+  Conversion conversion =
+      GetDirectConversion(pixel_format, requested_pixel_format);
+  if (conversion) {
+    Planes src = GetPlanes(data, pixel_format, width, height);
+    return conversion(src, dst, width, height) == 0;
+  }
+
+  conversion = GetDirectConversion(PIXEL_FORMAT_BGRA, requested_pixel_format);
+  if (!conversion) return false;
+
   CameraFormat bgra_camera_format(width, height, PIXEL_FORMAT_BGRA,
                                   camera_format.frame_rate());
-  size_t length = bgra_camera_format.AllocationSize();
   Data tmp_bgra;
-  tmp_bgra.resize(length);
+  tmp_bgra.resize(bgra_camera_format.AllocationSize());
   uint8_t* tmp_bgra_ptr = tmp_bgra.cast<uint8_t*>();
-  if (libyuv::ConvertToARGB(data, data_length, tmp_bgra_ptr, width * 4,
-                            0 /* crop_x_pos */, 0 /* crop_y_pos */, width,
-                            height, width, height,
-                            libyuv::RotationMode::kRotate0, src_format) != 0) {
-    return base::nullopt;
+  if (!ConvertToRequestedPixelFormat(data, data_length, camera_format,
+                                     PIXEL_FORMAT_BGRA, tmp_bgra_ptr)) {
+    return false;
   }
+  Planes bgra = GetPlanes(tmp_bgra_ptr, PIXEL_FORMAT_BGRA, width, height);
+  return conversion(bgra, dst, width, height) == 0;
+}
 
-  return CameraFrame(std::move(tmp_bgra), bgra_camera_format, timestamp);
+bool CanConvertDirectly(PixelFormat pixel_format,
+                        PixelFormat requested_pixel_format) {
+  if (requested_pixel_format == PIXEL_FORMAT_MJPEG) return false;
+  if (requested_pixel_format == PIXEL_FORMAT_BGRA ||
+      IsI420OrYV12(requested_pixel_format)) {
+    return true;
+  }
+  return GetDirectConversion(pixel_format, requested_pixel_format) != nullptr;
 }
 
-}  // namespace
+StatusOr<CameraFrame> DecodeMjpeg(const CameraFrame& camera_frame,
+                                  PixelFormat requested_pixel_format,
+                                  int scale_denominator) {
+  if (camera_frame.pixel_format() != PIXEL_FORMAT_MJPEG) {
+    return felicia::errors::InvalidArgument("Not a MJPEG frame.");
+  }
 
-base::Optional<CameraFrame> ConvertToRequestedPixelFormat(
-    const uint8_t* data, size_t data_length, const CameraFormat& camera_format,
-    PixelFormat requested_pixel_format, base::TimeDelta timestamp) {
-  if (requested_pixel_format == PIXEL_FORMAT_MJPEG) {
-    return base::nullopt;
-  } else if (requested_pixel_format == PIXEL_FORMAT_BGRA) {
-    return ConvertToBGRA(data, data_length, camera_format, timestamp);
-  } else {
-    auto bgra_camera_frame_opt =
-        ConvertToBGRA(data, data_length, camera_format, timestamp);
-    if (!bgra_camera_frame_opt.has_value()) return base::nullopt;
-
-    CameraFrame bgra_camera_frame = std::move(bgra_camera_frame_opt.value());
-    const uint8_t* bgra_data = bgra_camera_frame.data().cast<const uint8_t*>();
-    int width = bgra_camera_frame.width();
-    int height = bgra_camera_frame.height();
-    CameraFormat camera_format = bgra_camera_frame.camera_format();
-    camera_format.set_pixel_format(requested_pixel_format);
-    size_t length = camera_format.AllocationSize();
-    Data tmp_camera_frame;
-    tmp_camera_frame.resize(length);
-    uint8_t* tmp_camera_frame_ptr = tmp_camera_frame.cast<uint8_t*>();
-
-    int ret = -1;
-    switch (requested_pixel_format) {
-      case PIXEL_FORMAT_I420:
-        ret = libyuv::ARGBToI420(
-            bgra_data, width * 4, tmp_camera_frame_ptr, width,
-            tmp_camera_frame_ptr + (width * height), width / 2,
-            tmp_camera_frame_ptr + (width * height) * 5 / 4, width / 2, width,
-            height);
-        break;
-      case PIXEL_FORMAT_YV12:
-        // No conversion in libyuv api.
-        break;
-      case PIXEL_FORMAT_NV12:
-        ret = libyuv::ARGBToNV12(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width, tmp_camera_frame_ptr + (width * height),
-                                 width, width, height);
-        break;
-      case PIXEL_FORMAT_NV21:
-        ret = libyuv::ARGBToNV21(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width, tmp_camera_frame_ptr + (width * height),
-                                 width, width, height);
-        break;
-      case PIXEL_FORMAT_UYVY:
-        ret = libyuv::ARGBToUYVY(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width * 2, width, height);
-        break;
-      case PIXEL_FORMAT_YUY2:
-        ret = libyuv::ARGBToYUY2(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width * 2, width, height);
-        break;
-      case PIXEL_FORMAT_BGR:
-        ret = libyuv::ARGBToRGB24(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                  width * 3, width, height);
-        break;
-      case PIXEL_FORMAT_RGBA:
-        ret = libyuv::ARGBToABGR(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width * 4, width, height);
-        break;
-      case PIXEL_FORMAT_RGB:
-        ret = libyuv::ARGBToRAW(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                width * 3, width, height);
-        break;
-      case PIXEL_FORMAT_ARGB:
-        ret = libyuv::ARGBToBGRA(bgra_data, width * 4, tmp_camera_frame_ptr,
-                                 width * 4, width, height);
-        break;
-      default:
-        break;
-    }
-    if (ret != 0) return base::nullopt;
+  Image image;
+  bool decode_directly = CanDecodeJpegTo(requested_pixel_format);
+  image.set_pixel_format(decode_directly ? requested_pixel_format
+                                         : PIXEL_FORMAT_BGRA);
+  Status s = JpegCodec::Decode(camera_frame.data().cast<const unsigned char*>(),
+                               camera_frame.length(), scale_denominator,
+                               &image);
+  if (!s.ok()) return s;
+
+  CameraFrame decoded(std::move(image), camera_frame.frame_rate(),
+                      camera_frame.timestamp());
+  if (decode_directly) return decoded;
+
+  base::Optional<CameraFrame> converted = ConvertToRequestedPixelFormat(
+      decoded.data().cast<const uint8_t*>(), decoded.length(),
+      decoded.camera_format(), requested_pixel_format, decoded.timestamp());
+  if (!converted) {
+    return errors::FailedToConvertToRequestedPixelFormat(
+        requested_pixel_format);
+  }
+  return std::move(converted.value());
+}
 
-    return CameraFrame(std::move(tmp_camera_frame), camera_format, timestamp);
+int GetMjpegScaleDenominator(const Sizei& size, const Sizei& min_size) {
+  int scale_denominator = 8;
+  while (scale_denominator > 1 &&
+         ((size.width() + scale_denominator - 1) / scale_denominator <
+              min_size.width() ||
+          (size.height() + scale_denominator - 1) / scale_denominator <
+              min_size.height())) {
+    scale_denominator /= 2;
   }
+  return scale_denominator;
 }
 
 }  // namespace drivers
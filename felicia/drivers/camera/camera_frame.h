@@ -15,11 +15,13 @@
 #endif  // defined(HAS_ROS)
 
 #include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/memory/scoped_refptr.h"
 #include "third_party/chromium/base/optional.h"
 #include "third_party/chromium/base/time/time.h"
 
 #include "felicia/core/lib/base/export.h"
 #include "felicia/core/lib/containers/data.h"
+#include "felicia/core/lib/containers/data_pool.h"
 #include "felicia/core/lib/error/statusor.h"
 #include "felicia/core/lib/image/image.h"
 #include "felicia/core/lib/unit/geometry/size.h"
@@ -57,6 +59,10 @@ class FEL_EXPORT CameraFrame {
   void set_timestamp(base::TimeDelta time);
   base::TimeDelta timestamp() const;
 
+  // Returns |data_| to |data_pool| when this is destroyed or assigned, unless
+  // it is moved out. A copy of this doesn't return its data.
+  void set_data_pool(scoped_refptr<DataPool> data_pool);
+
   CameraFrameMessage ToCameraFrameMessage(bool copy = true);
   Status FromCameraFrameMessage(const CameraFrameMessage& message);
   Status FromCameraFrameMessage(CameraFrameMessage&& message);
@@ -81,12 +87,46 @@ class FEL_EXPORT CameraFrame {
   Data data_;
   CameraFormat camera_format_;
   base::TimeDelta timestamp_;
+  scoped_refptr<DataPool> data_pool_;
+
+ private:
+  void RecycleData();
 };
 
+// A frame in PIXEL_FORMAT_MJPEG is copied as it is if PIXEL_FORMAT_MJPEG is
+// requested, and decoded by DecodeMjpeg() if JpegCodec can decode to
+// |requested_pixel_format|.
 FEL_EXPORT base::Optional<CameraFrame> ConvertToRequestedPixelFormat(
     const uint8_t* data, size_t data_length, const CameraFormat& camera_format,
     PixelFormat requested_pixel_format, base::TimeDelta timestamp);
 
+// Converts |data| of |camera_format| to |requested_pixel_format| and writes it
+// to |out|, which should be as large as the AllocationSize() of the requested
+// format. It converts in a single pass if libyuv has a direct route, otherwise
+// it goes through PIXEL_FORMAT_BGRA. Returns false if it fails to convert.
+FEL_EXPORT bool ConvertToRequestedPixelFormat(
+    const uint8_t* data, size_t data_length, const CameraFormat& camera_format,
+    PixelFormat requested_pixel_format, uint8_t* out);
+
+// Returns true if ConvertToRequestedPixelFormat() converts |pixel_format| to
+// |requested_pixel_format| in a single pass.
+FEL_EXPORT bool CanConvertDirectly(PixelFormat pixel_format,
+                                   PixelFormat requested_pixel_format);
+
+// Decodes |camera_frame| in PIXEL_FORMAT_MJPEG to |requested_pixel_format|,
+// scaled down by |scale_denominator|, which is 1, 2, 4 or 8, e.g, for the
+// subscribers which need only thumbnails. It decodes with libjpeg-turbo
+// straight to the pixel formats JpegCodec supports, and the others are
+// converted from PIXEL_FORMAT_BGRA.
+FEL_EXPORT StatusOr<CameraFrame> DecodeMjpeg(const CameraFrame& camera_frame,
+                                             PixelFormat requested_pixel_format,
+                                             int scale_denominator = 1);
+
+// Returns the largest of 1, 2, 4 and 8 to pass to DecodeMjpeg(), which keeps
+// a frame of |size| at least as large as |min_size|.
+FEL_EXPORT int GetMjpegScaleDenominator(const Sizei& size,
+                                        const Sizei& min_size);
+
 typedef base::RepeatingCallback<void(CameraFrame&&)> CameraFrameCallback;
 
 }  // namespace drivers
@@ -0,0 +1,69 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame.h"
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/strings/strcat.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr float kFrameRate = 30;
+
+constexpr PixelFormat kPixelFormats[] = {
+    PIXEL_FORMAT_I420, PIXEL_FORMAT_YV12, PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21,
+    PIXEL_FORMAT_UYVY, PIXEL_FORMAT_YUY2, PIXEL_FORMAT_BGRA, PIXEL_FORMAT_BGR,
+    PIXEL_FORMAT_RGBA, PIXEL_FORMAT_RGB,  PIXEL_FORMAT_ARGB,
+};
+
+}  // namespace
+
+static void BM_ConvertToRequestedPixelFormat(benchmark::State& state) {
+  PixelFormat pixel_format = static_cast<PixelFormat>(state.range(0));
+  PixelFormat requested_pixel_format = static_cast<PixelFormat>(state.range(1));
+  CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+  CameraFormat requested_camera_format(kWidth, kHeight, requested_pixel_format,
+                                       kFrameRate);
+  std::vector<uint8_t> data(camera_format.AllocationSize());
+  base::RandBytes(data.data(), data.size());
+  std::vector<uint8_t> out(requested_camera_format.AllocationSize());
+
+  for (auto _ : state) {
+    if (!ConvertToRequestedPixelFormat(data.data(), data.size(), camera_format,
+                                       requested_pixel_format, out.data())) {
+      state.SkipWithError("Failed to convert.");
+      break;
+    }
+  }
+
+  state.SetLabel(base::StrCat(
+      {CameraFormat::PixelFormatToString(pixel_format), " -> ",
+       CameraFormat::PixelFormatToString(requested_pixel_format),
+       CanConvertDirectly(pixel_format, requested_pixel_format)
+           ? " (direct)"
+           : " (via BGRA)"}));
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void PixelFormatPairs(benchmark::internal::Benchmark* benchmark) {
+  for (PixelFormat pixel_format : kPixelFormats) {
+    for (PixelFormat requested_pixel_format : kPixelFormats) {
+      if (pixel_format == requested_pixel_format) continue;
+      benchmark->Args({pixel_format, requested_pixel_format});
+    }
+  }
+}
+
+BENCHMARK(BM_ConvertToRequestedPixelFormat)->Apply(PixelFormatPairs);
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,223 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_jpeg_encoder.h"
+
+#include <algorithm>
+
+#include "third_party/chromium/base/barrier_closure.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/bind_helpers.h"
+#include "third_party/chromium/base/metrics/histogram_functions.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+
+#include "felicia/drivers/camera/camera_errors.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+bool CanEncode(PixelFormat pixel_format) {
+  switch (pixel_format) {
+    case PIXEL_FORMAT_BGRA:
+    case PIXEL_FORMAT_BGR:
+    case PIXEL_FORMAT_BGRX:
+    case PIXEL_FORMAT_Y8:
+    case PIXEL_FORMAT_RGBA:
+    case PIXEL_FORMAT_RGBX:
+    case PIXEL_FORMAT_RGB:
+    case PIXEL_FORMAT_ARGB:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Leaves room for the frames a bit larger than the previous one.
+size_t WithHeadroom(size_t size) { return size + size / 8; }
+
+// Returns the rows of the stripes to split an image of |width| x |height|
+// into |stripe_count| stripes, or 0 if it shouldn't be split. A restart
+// interval can't have more than 0xFFFF MCUs, which are 8 x 8 at the smallest.
+int GetStripeRows(int width, int height, int stripe_count) {
+  constexpr int kAlignment = JpegCodec::kStripeAlignment;
+  int mcus_per_aligned_rows = kAlignment / 8 * ((width + 7) / 8);
+  int max_rows = 0xFFFF / mcus_per_aligned_rows * kAlignment;
+  int rows = (height + stripe_count - 1) / stripe_count;
+  rows = (rows + kAlignment - 1) / kAlignment * kAlignment;
+  rows = std::min(rows, max_rows);
+  if (rows == 0 || rows >= height) return 0;
+  return rows;
+}
+
+}  // namespace
+
+CameraFrameJpegEncoder::CameraFrameJpegEncoder(
+    CameraFrameCallback camera_frame_callback, StatusCallback status_callback)
+    : camera_frame_callback_(camera_frame_callback),
+      status_callback_(status_callback) {}
+
+CameraFrameJpegEncoder::~CameraFrameJpegEncoder() { Stop(); }
+
+void CameraFrameJpegEncoder::Start(const JpegCodec::Options& options,
+                                   int worker_num,
+                                   size_t max_frames_in_flight) {
+  DCHECK(!IsRunning());
+  DCHECK_GE(worker_num, 0);
+  DCHECK_GT(max_frames_in_flight, 0u);
+  options_ = options;
+  max_frames_in_flight_ = max_frames_in_flight;
+  data_pool_ = base::MakeRefCounted<DataPool>(
+      DataPool::kDefaultMaxBuffersPerSize, DataPool::SIZE_CLASS_POWER_OF_2);
+  stripes_.clear();
+  last_size_ = 0;
+  frames_in_flight_ = 0;
+  dropped_frames_ = 0;
+
+  for (int i = 0; i < worker_num; ++i) {
+    auto worker_thread = std::make_unique<base::Thread>(
+        base::StringPrintf("CameraJpegStripeThread%d", i));
+    worker_thread->Start();
+    worker_threads_.push_back(std::move(worker_thread));
+  }
+  encoder_thread_ = std::make_unique<base::Thread>("CameraJpegEncoderThread");
+  encoder_thread_->Start();
+}
+
+void CameraFrameJpegEncoder::Stop() {
+  if (!IsRunning()) return;
+
+  // The encoder thread waits for the stripes it posts to the workers, so it
+  // stops first.
+  encoder_thread_->Stop();
+  encoder_thread_.reset();
+  for (auto& worker_thread : worker_threads_) {
+    worker_thread->Stop();
+  }
+  worker_threads_.clear();
+}
+
+bool CameraFrameJpegEncoder::IsRunning() const {
+  return encoder_thread_ && encoder_thread_->IsRunning();
+}
+
+bool CameraFrameJpegEncoder::Encode(CameraFrame camera_frame) {
+  DCHECK(IsRunning());
+  if (frames_in_flight_ >= max_frames_in_flight_) {
+    dropped_frames_++;
+    return false;
+  }
+  frames_in_flight_++;
+
+  encoder_thread_->task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&CameraFrameJpegEncoder::DoEncode, base::Unretained(this),
+                     std::move(camera_frame)));
+  return true;
+}
+
+void CameraFrameJpegEncoder::DoEncode(CameraFrame camera_frame) {
+  DCHECK(encoder_thread_->task_runner()->BelongsToCurrentThread());
+  base::TimeTicks start = base::TimeTicks::Now();
+  CameraFormat camera_format = camera_frame.camera_format();
+
+  if (camera_format.pixel_format() != PIXEL_FORMAT_MJPEG) {
+    if (!CanEncode(camera_format.pixel_format())) {
+      base::Optional<CameraFrame> bgr_frame = ConvertToRequestedPixelFormat(
+          camera_frame.data().cast<const uint8_t*>(), camera_frame.length(),
+          camera_format, PIXEL_FORMAT_BGR, camera_frame.timestamp());
+      if (!bgr_frame) {
+        frames_in_flight_--;
+        status_callback_.Run(
+            errors::FailedToConvertToRequestedPixelFormat(PIXEL_FORMAT_BGR));
+        return;
+      }
+      camera_frame = std::move(bgr_frame.value());
+      camera_format = camera_frame.camera_format();
+    }
+
+    // Borrows the data of |camera_frame| and gives it back, so that it goes
+    // back to its DataPool, if any, as |camera_frame| is destroyed.
+    Image image(Sizei(camera_format.width(), camera_format.height()),
+                camera_format.pixel_format(),
+                std::move(camera_frame.data()));
+    Data output = data_pool_->Acquire(WithHeadroom(last_size_));
+    Status s = EncodeImage(image, &output);
+    camera_frame.data() = std::move(image.data());
+    if (!s.ok()) {
+      data_pool_->Recycle(std::move(output));
+      frames_in_flight_--;
+      status_callback_.Run(s);
+      return;
+    }
+    last_size_ = output.size();
+
+    camera_format.set_pixel_format(PIXEL_FORMAT_MJPEG);
+    camera_frame =
+        CameraFrame(std::move(output), camera_format, camera_frame.timestamp());
+    camera_frame.set_data_pool(data_pool_);
+  }
+
+  base::UmaHistogramMicrosecondsTimes("Felicia.Camera.JpegEncoder.Encode",
+                                      base::TimeTicks::Now() - start);
+  camera_frame_callback_.Run(std::move(camera_frame));
+  frames_in_flight_--;
+}
+
+Status CameraFrameJpegEncoder::EncodeImage(const Image& image, Data* output) {
+  int stripe_rows = 0;
+  if (!worker_threads_.empty()) {
+    stripe_rows = GetStripeRows(image.width(), image.height(),
+                                worker_threads_.size() + 1);
+  }
+
+  // The output is grown up front as large as the whole previous frame, so
+  // the stripes are appended to the top one without reallocation.
+  JpegCodec::Options options = options_;
+  options.size_hint = WithHeadroom(last_size_);
+  if (stripe_rows == 0) return JpegCodec::Encode(image, options, output);
+
+  size_t stripe_count = (image.height() + stripe_rows - 1) / stripe_rows;
+  stripes_.resize(stripe_count - 1);
+  stripe_statuses_.assign(stripe_count, Status::OK());
+
+  base::WaitableEvent event;
+  base::RepeatingClosure done = base::BarrierClosure(
+      stripe_count - 1, base::BindOnce(&base::WaitableEvent::Signal,
+                                       base::Unretained(&event)));
+  for (size_t i = 1; i < stripe_count; ++i) {
+    int top = i * stripe_rows;
+    base::Thread* worker_thread =
+        worker_threads_[(i - 1) % worker_threads_.size()].get();
+    worker_thread->task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&CameraFrameJpegEncoder::EncodeStripe,
+                       base::Unretained(this), &image, top,
+                       std::min(stripe_rows, image.height() - top),
+                       &stripes_[i - 1], &stripe_statuses_[i], done));
+  }
+  stripe_statuses_[0] =
+      JpegCodec::EncodeStripe(image, 0, stripe_rows, options, output);
+  event.Wait();
+
+  for (const Status& s : stripe_statuses_) {
+    if (!s.ok()) return s;
+  }
+  return JpegCodec::AppendStripes(stripes_, output);
+}
+
+void CameraFrameJpegEncoder::EncodeStripe(const Image* image, int top,
+                                          int rows, Data* output,
+                                          Status* status,
+                                          base::OnceClosure done) {
+  JpegCodec::Options options = options_;
+  options.size_hint = WithHeadroom(output->size());
+  *status = JpegCodec::EncodeStripe(*image, top, rows, options, output);
+  std::move(done).Run();
+}
+
+}  // namespace drivers
+}  // namespace felicia
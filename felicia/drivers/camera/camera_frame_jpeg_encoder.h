@@ -0,0 +1,108 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_JPEG_ENCODER_H_
+#define FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_JPEG_ENCODER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/threading/thread.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/containers/data_pool.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/lib/image/jpeg_codec.h"
+#include "felicia/drivers/camera/camera_frame.h"
+
+namespace felicia {
+namespace drivers {
+
+// CameraFrameJpegEncoder compresses the CameraFrames to PIXEL_FORMAT_MJPEG
+// off the calling thread. A frame is split into horizontal stripes, which are
+// encoded in parallel on the worker threads and joined as the restart
+// intervals of a JPEG, so that a large frame takes about as long as a stripe
+// to encode. The frames are encoded one at a time and handed to
+// |camera_frame_callback| in the order they are given.
+//
+// The top stripe is encoded right into the output, which is taken from a
+// DataPool and goes back to it as the delivered frame is destroyed, and the
+// other stripes are appended to it in place. They are encoded into the
+// buffers of the previous frame. The buffers are grown up front as large as
+// they were, so a stream of frames of similar sizes is encoded without
+// allocation.
+//
+// The latency of each frame is recorded to the histogram
+// Felicia.Camera.JpegEncoder.Encode.
+class FEL_EXPORT CameraFrameJpegEncoder {
+ public:
+  static constexpr int kDefaultWorkerNum = 2;
+  static constexpr size_t kDefaultMaxFramesInFlight = 2;
+
+  CameraFrameJpegEncoder(CameraFrameCallback camera_frame_callback,
+                         StatusCallback status_callback);
+  ~CameraFrameJpegEncoder();
+
+  // Starts to encode with |options|. A frame is split into up to
+  // |worker_num| + 1 stripes, one of which is encoded on the encoder thread.
+  // If |worker_num| is 0, the frames are encoded as a whole. At most
+  // |max_frames_in_flight| frames can be between Encode() and the return of
+  // |camera_frame_callback|, and the frames given beyond that are dropped.
+  void Start(const JpegCodec::Options& options,
+             int worker_num = kDefaultWorkerNum,
+             size_t max_frames_in_flight = kDefaultMaxFramesInFlight);
+
+  // Waits until the frames given so far are delivered, and stops the threads.
+  // It does nothing if it isn't started.
+  void Stop();
+
+  bool IsRunning() const;
+
+  // Returns false if |camera_frame| is dropped because too many frames are in
+  // flight. The frames in PIXEL_FORMAT_MJPEG are delivered as they are, and
+  // the ones in a pixel format JpegCodec can't encode are converted to
+  // PIXEL_FORMAT_BGR first. This should be called on a single thread.
+  bool Encode(CameraFrame camera_frame);
+
+  size_t dropped_frames() const { return dropped_frames_; }
+
+ private:
+  // Runs on |encoder_thread_|.
+  void DoEncode(CameraFrame camera_frame);
+  Status EncodeImage(const Image& image, Data* output);
+  // Runs on a worker thread, or on |encoder_thread_| for the top stripe.
+  void EncodeStripe(const Image* image, int top, int rows, Data* output,
+                    Status* status, base::OnceClosure done);
+
+  CameraFrameCallback camera_frame_callback_;
+  StatusCallback status_callback_;
+
+  JpegCodec::Options options_;
+  size_t max_frames_in_flight_ = 0;
+
+  std::vector<std::unique_ptr<base::Thread>> worker_threads_;
+  std::unique_ptr<base::Thread> encoder_thread_;
+
+  scoped_refptr<DataPool> data_pool_;
+
+  // The stripes below the top one. Accessed on |encoder_thread_|, and on the
+  // worker threads while the stripes of a frame are encoded, each of which
+  // touches its own entry.
+  std::vector<Data> stripes_;
+  std::vector<Status> stripe_statuses_;
+  size_t last_size_ = 0;
+
+  std::atomic<size_t> frames_in_flight_{0};
+  std::atomic<size_t> dropped_frames_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(CameraFrameJpegEncoder);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_JPEG_ENCODER_H_
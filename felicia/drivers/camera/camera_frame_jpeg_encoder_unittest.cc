@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_jpeg_encoder.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+constexpr float kFrameRate = 30;
+
+void OnCameraFrame(std::vector<CameraFrame>* camera_frames,
+                   CameraFrame&& camera_frame) {
+  camera_frames->push_back(std::move(camera_frame));
+}
+
+void OnStatus(Status s) { ADD_FAILURE() << s; }
+
+CameraFrame NewCameraFrame(PixelFormat pixel_format, int index) {
+  CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (size_t i = 0; i < data.size(); ++i) {
+    pixels[i] = (i * 7 + index) & 0xFF;
+  }
+  return CameraFrame(std::move(data), camera_format,
+                     base::TimeDelta::FromMilliseconds(index));
+}
+
+Image Decode(const CameraFrame& camera_frame) {
+  Image image;
+  image.set_pixel_format(PIXEL_FORMAT_BGR);
+  EXPECT_TRUE(JpegCodec::Decode(
+                  camera_frame.data().cast<const unsigned char*>(),
+                  camera_frame.length(), &image)
+                  .ok());
+  return image;
+}
+
+}  // namespace
+
+TEST(CameraFrameJpegEncoderTest, EncodeInStripes) {
+  std::vector<CameraFrame> camera_frames;
+  CameraFrameJpegEncoder encoder(
+      base::BindRepeating(&OnCameraFrame, &camera_frames),
+      base::BindRepeating(&OnStatus));
+
+  constexpr int kFrames = 10;
+  JpegCodec::Options options;
+  options.quality = 90;
+  options.optimize_coding = false;
+  encoder.Start(options, 3, kFrames);
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_TRUE(encoder.Encode(NewCameraFrame(PIXEL_FORMAT_BGR, i)));
+  }
+  encoder.Stop();
+
+  ASSERT_EQ(static_cast<size_t>(kFrames), camera_frames.size());
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_EQ(PIXEL_FORMAT_MJPEG, camera_frames[i].pixel_format());
+    EXPECT_EQ(base::TimeDelta::FromMilliseconds(i),
+              camera_frames[i].timestamp());
+
+    // Decodes the same as the frame encoded as a whole.
+    CameraFrame camera_frame = NewCameraFrame(PIXEL_FORMAT_BGR, i);
+    Image image(Sizei(kWidth, kHeight), PIXEL_FORMAT_BGR,
+                std::move(camera_frame.data()));
+    Data expected;
+    ASSERT_TRUE(JpegCodec::Encode(image, options, &expected).ok());
+    Image expected_image = Decode(CameraFrame(
+        std::move(expected), camera_frames[i].camera_format(),
+        base::TimeDelta()));
+    Image decoded = Decode(camera_frames[i]);
+    EXPECT_EQ(expected_image.size(), decoded.size());
+    ASSERT_EQ(expected_image.data().size(), decoded.data().size());
+    EXPECT_EQ(0, memcmp(expected_image.data().cast<const char*>(),
+                        decoded.data().cast<const char*>(),
+                        decoded.data().size()));
+  }
+  EXPECT_EQ(0u, encoder.dropped_frames());
+}
+
+TEST(CameraFrameJpegEncoderTest, ConvertBeforeEncode) {
+  std::vector<CameraFrame> camera_frames;
+  CameraFrameJpegEncoder encoder(
+      base::BindRepeating(&OnCameraFrame, &camera_frames),
+      base::BindRepeating(&OnStatus));
+
+  encoder.Start(JpegCodec::Options(), 0);
+  EXPECT_TRUE(encoder.Encode(NewCameraFrame(PIXEL_FORMAT_I420, 0)));
+  encoder.Stop();
+
+  ASSERT_EQ(1u, camera_frames.size());
+  EXPECT_EQ(PIXEL_FORMAT_MJPEG, camera_frames[0].pixel_format());
+  EXPECT_EQ(Sizei(kWidth, kHeight), Decode(camera_frames[0]).size());
+}
+
+}  // namespace drivers
+}  // namespace felicia
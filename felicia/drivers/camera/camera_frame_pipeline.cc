@@ -0,0 +1,213 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_pipeline.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/metrics/histogram_functions.h"
+#include "third_party/chromium/base/strings/string_number_conversions.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+
+#include "felicia/drivers/camera/camera_errors.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+void RecordStageLatency(const char* stage, base::TimeDelta latency) {
+  base::UmaHistogramMicrosecondsTimes(
+      base::StringPrintf("Felicia.Camera.Pipeline.%s", stage), latency);
+}
+
+}  // namespace
+
+CameraFramePipeline::Frame::Frame() = default;
+
+CameraFramePipeline::Frame::Frame(Frame&& other) noexcept = default;
+
+CameraFramePipeline::Frame& CameraFramePipeline::Frame::operator=(
+    Frame&& other) = default;
+
+CameraFramePipeline::Frame::~Frame() = default;
+
+CameraFramePipeline::CameraFramePipeline(
+    CameraFrameCallback camera_frame_callback, StatusCallback status_callback)
+    : camera_frame_callback_(camera_frame_callback),
+      status_callback_(status_callback) {}
+
+CameraFramePipeline::~CameraFramePipeline() { Stop(); }
+
+// static
+int CameraFramePipeline::ResolveWorkerNum() {
+  const char* worker_num_env = getenv("FEL_CAMERA_CONVERSION_THREADS");
+  if (worker_num_env) {
+    int value;
+    if (base::StringToInt(worker_num_env, &value) && value > 0) {
+      return value;
+    }
+  }
+
+  return kDefaultWorkerNum;
+}
+
+void CameraFramePipeline::Start(const CameraFormat& camera_format,
+                                PixelFormat requested_pixel_format,
+                                int worker_num, size_t max_frames_in_flight) {
+  DCHECK(!IsRunning());
+  DCHECK_GT(worker_num, 0);
+  camera_format_ = camera_format;
+  requested_pixel_format_ = requested_pixel_format;
+  max_frames_in_flight_ =
+      max_frames_in_flight == 0 ? worker_num + 2 : max_frames_in_flight;
+  data_pool_ = base::MakeRefCounted<DataPool>();
+  next_pushed_sequence_ = 0;
+  next_delivered_sequence_ = 0;
+  frames_in_flight_ = 0;
+  dropped_frames_ = 0;
+
+  // Without the conversion, the frames go to the delivery thread right away.
+  if (NeedsConversion()) {
+    for (int i = 0; i < worker_num; ++i) {
+      auto worker_thread = std::make_unique<base::Thread>(
+          base::StringPrintf("CameraConversionThread%d", i));
+      worker_thread->Start();
+      worker_threads_.push_back(std::move(worker_thread));
+    }
+  }
+  delivery_thread_ = std::make_unique<base::Thread>("CameraDeliveryThread");
+  delivery_thread_->Start();
+}
+
+void CameraFramePipeline::Stop() {
+  if (!IsRunning()) return;
+
+  // Each thread runs the tasks posted so far before it stops, and the workers
+  // stop first because they post to the delivery thread.
+  for (auto& worker_thread : worker_threads_) {
+    worker_thread->Stop();
+  }
+  worker_threads_.clear();
+  delivery_thread_->Stop();
+  delivery_thread_.reset();
+  DCHECK(pending_frames_.empty());
+}
+
+bool CameraFramePipeline::IsRunning() const {
+  return delivery_thread_ && delivery_thread_->IsRunning();
+}
+
+bool CameraFramePipeline::Push(const uint8_t* data, size_t length,
+                               base::TimeDelta timestamp,
+                               base::TimeTicks dequeued) {
+  DCHECK(IsRunning());
+  if (frames_in_flight_ >= max_frames_in_flight_) {
+    dropped_frames_++;
+    return false;
+  }
+  frames_in_flight_++;
+
+  Frame frame;
+  frame.sequence = next_pushed_sequence_++;
+  if (camera_format_.pixel_format() == PixelFormat::PIXEL_FORMAT_MJPEG) {
+    // Its size varies for each frame, so it isn't worth pooling.
+    frame.data = Data(data, length);
+  } else {
+    frame.data = data_pool_->Acquire(length);
+    memcpy(frame.data.cast<uint8_t*>(), data, length);
+  }
+  frame.timestamp = timestamp;
+  frame.dequeued = dequeued;
+  frame.processed = base::TimeTicks::Now();
+  RecordStageLatency("Copy", frame.processed - dequeued);
+
+  if (NeedsConversion()) {
+    base::Thread* worker_thread =
+        worker_threads_[frame.sequence % worker_threads_.size()].get();
+    worker_thread->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&CameraFramePipeline::Convert,
+                                  base::Unretained(this), std::move(frame)));
+  } else {
+    bool pooled =
+        camera_format_.pixel_format() != PixelFormat::PIXEL_FORMAT_MJPEG;
+    frame.camera_frame.emplace(std::move(frame.data), camera_format_,
+                               timestamp);
+    if (pooled) frame.camera_frame->set_data_pool(data_pool_);
+    delivery_thread_->task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&CameraFramePipeline::Deliver,
+                                  base::Unretained(this), std::move(frame)));
+  }
+  return true;
+}
+
+DataPool::Stats CameraFramePipeline::data_pool_stats() const {
+  if (!data_pool_) return DataPool::Stats();
+  return data_pool_->stats();
+}
+
+bool CameraFramePipeline::NeedsConversion() const {
+  return requested_pixel_format_ != camera_format_.pixel_format();
+}
+
+void CameraFramePipeline::Convert(Frame frame) {
+  CameraFormat camera_format = camera_format_;
+  camera_format.set_pixel_format(requested_pixel_format_);
+  Data data = data_pool_->Acquire(camera_format.AllocationSize());
+  if (ConvertToRequestedPixelFormat(
+          frame.data.cast<const uint8_t*>(), frame.data.size(), camera_format_,
+          requested_pixel_format_, data.cast<uint8_t*>())) {
+    frame.camera_frame.emplace(std::move(data), camera_format,
+                               frame.timestamp);
+    frame.camera_frame->set_data_pool(data_pool_);
+  } else {
+    data_pool_->Recycle(std::move(data));
+    frame.status =
+        errors::FailedToConvertToRequestedPixelFormat(requested_pixel_format_);
+  }
+  if (camera_format_.pixel_format() != PixelFormat::PIXEL_FORMAT_MJPEG) {
+    data_pool_->Recycle(std::move(frame.data));
+  }
+
+  base::TimeTicks now = base::TimeTicks::Now();
+  RecordStageLatency("Conversion", now - frame.processed);
+  frame.processed = now;
+
+  delivery_thread_->task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&CameraFramePipeline::Deliver,
+                                base::Unretained(this), std::move(frame)));
+}
+
+void CameraFramePipeline::Deliver(Frame frame) {
+  DCHECK(delivery_thread_->task_runner()->BelongsToCurrentThread());
+  uint64_t sequence = frame.sequence;
+  pending_frames_.emplace(sequence, std::move(frame));
+
+  auto it = pending_frames_.begin();
+  while (it != pending_frames_.end() &&
+         it->first == next_delivered_sequence_) {
+    Frame& next_frame = it->second;
+    base::TimeTicks start = base::TimeTicks::Now();
+    RecordStageLatency("Reorder", start - next_frame.processed);
+
+    if (next_frame.camera_frame) {
+      camera_frame_callback_.Run(std::move(next_frame.camera_frame.value()));
+    } else {
+      status_callback_.Run(next_frame.status);
+    }
+
+    base::TimeTicks end = base::TimeTicks::Now();
+    RecordStageLatency("Callback", end - start);
+    RecordStageLatency("Total", end - next_frame.dequeued);
+
+    it = pending_frames_.erase(it);
+    next_delivered_sequence_++;
+    frames_in_flight_--;
+  }
+}
+
+}  // namespace drivers
+}  // namespace felicia
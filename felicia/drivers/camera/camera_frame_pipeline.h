@@ -0,0 +1,125 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PIPELINE_H_
+#define FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PIPELINE_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/memory/scoped_refptr.h"
+#include "third_party/chromium/base/optional.h"
+#include "third_party/chromium/base/threading/thread.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/containers/data_pool.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/drivers/camera/camera_frame.h"
+
+namespace felicia {
+namespace drivers {
+
+// CameraFramePipeline takes the raw frames off the capture thread of a
+// camera. Push() copies a frame and returns, so that the driver gets its
+// buffer back right away, and the frame is converted to the requested pixel
+// format on one of the worker threads. The frames are handed to
+// |camera_frame_callback| on a single delivery thread in the order they are
+// pushed, with the timestamps given to Push().
+//
+// The latency of each stage is recorded to the histograms
+// Felicia.Camera.Pipeline.{Copy,Conversion,Reorder,Callback,Total}.
+class FEL_EXPORT CameraFramePipeline {
+ public:
+  static constexpr int kDefaultWorkerNum = 2;
+
+  CameraFramePipeline(CameraFrameCallback camera_frame_callback,
+                      StatusCallback status_callback);
+  ~CameraFramePipeline();
+
+  // Returns the number of the workers from FEL_CAMERA_CONVERSION_THREADS, or
+  // kDefaultWorkerNum if it isn't set.
+  static int ResolveWorkerNum();
+
+  // Starts to take the frames of |camera_format|, which are converted to
+  // |requested_pixel_format|. At most |max_frames_in_flight| frames can be
+  // between Push() and the return of |camera_frame_callback|, and the frames
+  // pushed beyond that are dropped. If it is 0, it is |worker_num| + 2.
+  void Start(const CameraFormat& camera_format,
+             PixelFormat requested_pixel_format, int worker_num,
+             size_t max_frames_in_flight = 0);
+
+  // Waits until the frames pushed so far are delivered, and stops the
+  // threads. It does nothing if it isn't started.
+  void Stop();
+
+  bool IsRunning() const;
+
+  // Copies |length| bytes of |data| captured at |timestamp|. |dequeued| is
+  // when the driver handed the frame, from which the latencies are measured.
+  // Returns false if the frame is dropped because too many frames are in
+  // flight. This should be called on a single thread.
+  bool Push(const uint8_t* data, size_t length, base::TimeDelta timestamp,
+            base::TimeTicks dequeued);
+
+  size_t dropped_frames() const { return dropped_frames_; }
+  DataPool::Stats data_pool_stats() const;
+
+ private:
+  struct Frame {
+    Frame();
+    Frame(Frame&& other) noexcept;
+    Frame& operator=(Frame&& other);
+    ~Frame();
+
+    uint64_t sequence = 0;
+    Data data;
+    base::TimeDelta timestamp;
+    base::TimeTicks dequeued;
+    base::TimeTicks processed;
+    base::Optional<CameraFrame> camera_frame;
+    Status status;
+
+    DISALLOW_COPY_AND_ASSIGN(Frame);
+  };
+
+  bool NeedsConversion() const;
+
+  // Runs on a worker thread.
+  void Convert(Frame frame);
+  // Runs on |delivery_thread_|.
+  void Deliver(Frame frame);
+
+  CameraFrameCallback camera_frame_callback_;
+  StatusCallback status_callback_;
+
+  CameraFormat camera_format_;
+  PixelFormat requested_pixel_format_;
+  size_t max_frames_in_flight_ = 0;
+  scoped_refptr<DataPool> data_pool_;
+
+  std::vector<std::unique_ptr<base::Thread>> worker_threads_;
+  std::unique_ptr<base::Thread> delivery_thread_;
+
+  // Accessed only by Push().
+  uint64_t next_pushed_sequence_ = 0;
+  // Accessed only on |delivery_thread_|. The frames which are converted
+  // ahead of the ones pushed earlier wait in |pending_frames_|.
+  uint64_t next_delivered_sequence_ = 0;
+  std::map<uint64_t, Frame> pending_frames_;
+
+  std::atomic<size_t> frames_in_flight_{0};
+  std::atomic<size_t> dropped_frames_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(CameraFramePipeline);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PIPELINE_H_
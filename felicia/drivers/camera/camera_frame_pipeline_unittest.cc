@@ -0,0 +1,85 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_pipeline.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr float kFrameRate = 30;
+
+void OnCameraFrame(std::vector<CameraFrame>* camera_frames,
+                   CameraFrame&& camera_frame) {
+  camera_frames->push_back(std::move(camera_frame));
+}
+
+void OnStatus(Status s) { ADD_FAILURE() << s; }
+
+void WaitAndCount(base::WaitableEvent* event, int* count,
+                  CameraFrame&& camera_frame) {
+  event->Wait();
+  (*count)++;
+}
+
+}  // namespace
+
+TEST(CameraFramePipelineTest, DeliverInOrder) {
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_YUY2, kFrameRate);
+  std::vector<uint8_t> data(camera_format.AllocationSize());
+  std::vector<CameraFrame> camera_frames;
+  CameraFramePipeline pipeline(
+      base::BindRepeating(&OnCameraFrame, &camera_frames),
+      base::BindRepeating(&OnStatus));
+
+  constexpr int kFrames = 30;
+  pipeline.Start(camera_format, PIXEL_FORMAT_BGRA, 3, kFrames);
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_TRUE(pipeline.Push(data.data(), data.size(),
+                              base::TimeDelta::FromMilliseconds(i),
+                              base::TimeTicks::Now()));
+  }
+  pipeline.Stop();
+
+  ASSERT_EQ(static_cast<size_t>(kFrames), camera_frames.size());
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_EQ(PIXEL_FORMAT_BGRA, camera_frames[i].pixel_format());
+    EXPECT_EQ(base::TimeDelta::FromMilliseconds(i),
+              camera_frames[i].timestamp());
+  }
+  EXPECT_EQ(0u, pipeline.dropped_frames());
+}
+
+TEST(CameraFramePipelineTest, DropFramesBeyondLimit) {
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_I420, kFrameRate);
+  std::vector<uint8_t> data(camera_format.AllocationSize());
+  base::WaitableEvent event;
+  int count = 0;
+  CameraFramePipeline pipeline(
+      base::BindRepeating(&WaitAndCount, &event, &count),
+      base::BindRepeating(&OnStatus));
+
+  pipeline.Start(camera_format, PIXEL_FORMAT_I420, 1, 1);
+  EXPECT_TRUE(pipeline.Push(data.data(), data.size(), base::TimeDelta(),
+                            base::TimeTicks::Now()));
+  EXPECT_FALSE(pipeline.Push(data.data(), data.size(), base::TimeDelta(),
+                             base::TimeTicks::Now()));
+  event.Signal();
+  pipeline.Stop();
+
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(1u, pipeline.dropped_frames());
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,248 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_publisher.h"
+
+#include "third_party/chromium/base/bind.h"
+
+namespace felicia {
+namespace drivers {
+
+constexpr const char* CameraFramePublisher::kCompressedTopicSuffix;
+constexpr size_t CameraFramePublisher::kMaxTransformFramesInFlight;
+
+CameraFramePublisher::CameraFramePublisher(PublishMode publish_mode,
+                                           const JpegCodec::Options& options,
+                                           int worker_num)
+    : publish_mode_(publish_mode),
+      options_(options),
+      worker_num_(worker_num),
+      jpeg_encoder_(base::BindRepeating(&CameraFramePublisher::OnJpegFrame,
+                                        base::Unretained(this)),
+                    base::BindRepeating(&CameraFramePublisher::OnJpegError,
+                                        base::Unretained(this))) {}
+
+CameraFramePublisher::~CameraFramePublisher() { StopThreads(); }
+
+void CameraFramePublisher::AddTransform(
+    const std::string& topic_suffix,
+    std::unique_ptr<CameraFrameTransform> transform) {
+  TransformOutput output;
+  output.topic_suffix = topic_suffix;
+  output.transform = std::move(transform);
+  output.publisher = std::make_unique<Publisher<CameraFrameMessage>>();
+  transform_outputs_.push_back(std::move(output));
+}
+
+void CameraFramePublisher::RequestPublish(
+    const NodeInfo& node_info, const std::string& topic, int channel_types,
+    const communication::Settings& settings, StatusOnceCallback callback) {
+  callback = base::BindOnce(&CameraFramePublisher::OnPublished,
+                            base::Unretained(this), 0, node_info, topic,
+                            channel_types, settings, std::move(callback));
+  if (!transform_outputs_.empty()) {
+    transform_thread_ =
+        std::make_unique<base::Thread>("CameraFrameTransformThread");
+    transform_thread_->Start();
+    transform_frames_in_flight_ = 0;
+  }
+  switch (publish_mode_) {
+    case PUBLISH_MODE_RAW:
+      raw_publisher_.RequestPublish(node_info, topic, channel_types, settings,
+                                    std::move(callback));
+      break;
+    case PUBLISH_MODE_JPEG:
+      jpeg_encoder_.Start(options_, worker_num_);
+      jpeg_publisher_.RequestPublish(node_info, topic, channel_types, settings,
+                                     std::move(callback));
+      break;
+    case PUBLISH_MODE_RAW_AND_JPEG:
+      jpeg_encoder_.Start(options_, worker_num_);
+      raw_publisher_.RequestPublish(
+          node_info, topic, channel_types, settings,
+          base::BindOnce(&CameraFramePublisher::OnRawPublished,
+                         base::Unretained(this), node_info,
+                         topic + kCompressedTopicSuffix, channel_types,
+                         settings, std::move(callback)));
+      break;
+  }
+}
+
+void CameraFramePublisher::Publish(CameraFrame camera_frame) {
+  if (transform_thread_ && HasPublishingTransform()) {
+    if (transform_frames_in_flight_ >= kMaxTransformFramesInFlight) {
+      transform_dropped_frames_++;
+    } else {
+      transform_frames_in_flight_++;
+      // The frame is published raw or encoded as well, so the transforms
+      // take a copy of it.
+      transform_thread_->task_runner()->PostTask(
+          FROM_HERE, base::BindOnce(&CameraFramePublisher::DoTransform,
+                                    base::Unretained(this), camera_frame));
+    }
+  }
+  if (publish_mode_ & PUBLISH_MODE_RAW) {
+    // Copies the data only if it is encoded as well.
+    raw_publisher_.Publish(camera_frame.ToCameraFrameMessage(
+        publish_mode_ == PUBLISH_MODE_RAW_AND_JPEG));
+  }
+  if ((publish_mode_ & PUBLISH_MODE_JPEG) && jpeg_encoder_.IsRunning()) {
+    jpeg_encoder_.Encode(std::move(camera_frame));
+  }
+}
+
+void CameraFramePublisher::RequestUnpublish(const NodeInfo& node_info,
+                                            const std::string& topic,
+                                            StatusOnceCallback callback) {
+  StopThreads();
+  callback = base::BindOnce(&CameraFramePublisher::OnUnpublished,
+                            base::Unretained(this), 0, node_info, topic,
+                            std::move(callback));
+  switch (publish_mode_) {
+    case PUBLISH_MODE_RAW:
+      raw_publisher_.RequestUnpublish(node_info, topic, std::move(callback));
+      break;
+    case PUBLISH_MODE_JPEG:
+      jpeg_publisher_.RequestUnpublish(node_info, topic, std::move(callback));
+      break;
+    case PUBLISH_MODE_RAW_AND_JPEG:
+      raw_publisher_.RequestUnpublish(
+          node_info, topic,
+          base::BindOnce(&CameraFramePublisher::OnRawUnpublished,
+                         base::Unretained(this), node_info,
+                         topic + kCompressedTopicSuffix, std::move(callback)));
+      break;
+  }
+}
+
+void CameraFramePublisher::OnPublished(
+    size_t index, const NodeInfo& node_info, const std::string& topic,
+    int channel_types, const communication::Settings& settings,
+    StatusOnceCallback callback, Status s) {
+  if (!s.ok()) {
+    StopThreads();
+    // |transform_outputs_[index - 1]| failed, if it isn't the topic itself.
+    UnpublishTransforms(index > 0 ? index - 1 : 0, node_info, topic, s,
+                        std::move(callback));
+    return;
+  }
+  if (index == transform_outputs_.size()) {
+    internal::LogOrCallback(std::move(callback), s);
+    return;
+  }
+  TransformOutput& output = transform_outputs_[index];
+  output.publisher->RequestPublish(
+      node_info, topic + output.topic_suffix, channel_types, settings,
+      base::BindOnce(&CameraFramePublisher::OnPublished,
+                     base::Unretained(this), index + 1, node_info, topic,
+                     channel_types, settings, std::move(callback)));
+}
+
+void CameraFramePublisher::UnpublishTransforms(size_t index,
+                                               const NodeInfo& node_info,
+                                               const std::string& topic,
+                                               Status s,
+                                               StatusOnceCallback callback) {
+  if (index == 0) {
+    internal::LogOrCallback(std::move(callback), s);
+    return;
+  }
+  TransformOutput& output = transform_outputs_[index - 1];
+  output.publisher->RequestUnpublish(
+      node_info, topic + output.topic_suffix,
+      base::BindOnce(&CameraFramePublisher::OnTransformUnpublished,
+                     base::Unretained(this), index - 1, node_info, topic, s,
+                     std::move(callback)));
+}
+
+void CameraFramePublisher::OnTransformUnpublished(
+    size_t index, const NodeInfo& node_info, const std::string& topic,
+    Status s, StatusOnceCallback callback, Status unpublish_status) {
+  LOG_IF(ERROR, !unpublish_status.ok())
+      << "Failed to unpublish " << topic
+      << transform_outputs_[index].topic_suffix << ": " << unpublish_status;
+  UnpublishTransforms(index, node_info, topic, s, std::move(callback));
+}
+
+void CameraFramePublisher::OnUnpublished(size_t index,
+                                         const NodeInfo& node_info,
+                                         const std::string& topic,
+                                         StatusOnceCallback callback,
+                                         Status s) {
+  if (!s.ok() || index == transform_outputs_.size()) {
+    internal::LogOrCallback(std::move(callback), s);
+    return;
+  }
+  TransformOutput& output = transform_outputs_[index];
+  output.publisher->RequestUnpublish(
+      node_info, topic + output.topic_suffix,
+      base::BindOnce(&CameraFramePublisher::OnUnpublished,
+                     base::Unretained(this), index + 1, node_info, topic,
+                     std::move(callback)));
+}
+
+void CameraFramePublisher::OnRawPublished(
+    const NodeInfo& node_info, const std::string& topic, int channel_types,
+    const communication::Settings& settings, StatusOnceCallback callback,
+    Status s) {
+  if (!s.ok()) {
+    StopThreads();
+    internal::LogOrCallback(std::move(callback), s);
+    return;
+  }
+  jpeg_publisher_.RequestPublish(node_info, topic, channel_types, settings,
+                                 std::move(callback));
+}
+
+void CameraFramePublisher::OnRawUnpublished(const NodeInfo& node_info,
+                                            const std::string& topic,
+                                            StatusOnceCallback callback,
+                                            Status s) {
+  if (!s.ok()) {
+    internal::LogOrCallback(std::move(callback), s);
+    return;
+  }
+  jpeg_publisher_.RequestUnpublish(node_info, topic, std::move(callback));
+}
+
+bool CameraFramePublisher::HasPublishingTransform() const {
+  for (const TransformOutput& output : transform_outputs_) {
+    if (output.publisher->IsRegistered()) return true;
+  }
+  return false;
+}
+
+void CameraFramePublisher::DoTransform(CameraFrame camera_frame) {
+  DCHECK(transform_thread_->task_runner()->BelongsToCurrentThread());
+  for (TransformOutput& output : transform_outputs_) {
+    if (!output.publisher->IsRegistered()) continue;
+    StatusOr<CameraFrame> status_or = output.transform->Transform(camera_frame);
+    if (!status_or.ok()) {
+      LOG(ERROR) << "Failed to transform: " << status_or.status();
+      continue;
+    }
+    output.publisher->Publish(
+        status_or.ValueOrDie().ToCameraFrameMessage(false));
+  }
+  transform_frames_in_flight_--;
+}
+
+void CameraFramePublisher::StopThreads() {
+  jpeg_encoder_.Stop();
+  if (transform_thread_) {
+    transform_thread_->Stop();
+    transform_thread_.reset();
+  }
+}
+
+void CameraFramePublisher::OnJpegFrame(CameraFrame&& camera_frame) {
+  jpeg_publisher_.Publish(camera_frame.ToCameraFrameMessage(false));
+}
+
+void CameraFramePublisher::OnJpegError(Status s) {
+  LOG(ERROR) << "Failed to encode to JPEG: " << s;
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,143 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PUBLISHER_H_
+#define FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PUBLISHER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/threading/thread.h"
+
+#include "felicia/core/communication/publisher.h"
+#include "felicia/core/lib/base/export.h"
+#include "felicia/drivers/camera/camera_frame.h"
+#include "felicia/drivers/camera/camera_frame_jpeg_encoder.h"
+#include "felicia/drivers/camera/camera_frame_transform.h"
+
+namespace felicia {
+namespace drivers {
+
+// CameraFramePublisher publishes the CameraFrames of a camera as they are,
+// compressed to JPEG, or both, so that the frames don't have to be
+// compressed in user code. The JPEG frames are encoded off the calling
+// thread by a CameraFrameJpegEncoder, and published as CameraFrameMessages
+// in PIXEL_FORMAT_MJPEG. If the encoder falls behind, the frames are dropped
+// from the JPEG topic only.
+//
+// In PUBLISH_MODE_JPEG, the JPEG frames are published on the topic instead
+// of the raw ones. In PUBLISH_MODE_RAW_AND_JPEG, they are published on the
+// topic with kCompressedTopicSuffix alongside the raw ones.
+//
+// The frames can also be published at other resolutions by adding
+// CameraFrameTransforms, each on its own topic, e.g, "/camera/320x240" for a
+// viewer beside "/camera" for a recorder. They are transformed off the
+// calling thread, once for all the subscribers of a topic and only for the
+// topics being published, and published raw. If the transforms fall behind,
+// the frames are dropped from their topics only.
+class FEL_EXPORT CameraFramePublisher {
+ public:
+  enum PublishMode {
+    PUBLISH_MODE_RAW = 1 << 0,
+    PUBLISH_MODE_JPEG = 1 << 1,
+    PUBLISH_MODE_RAW_AND_JPEG = PUBLISH_MODE_RAW | PUBLISH_MODE_JPEG,
+  };
+
+  static constexpr const char* kCompressedTopicSuffix = "/compressed";
+  static constexpr size_t kMaxTransformFramesInFlight = 2;
+
+  explicit CameraFramePublisher(
+      PublishMode publish_mode,
+      const JpegCodec::Options& options = JpegCodec::Options(),
+      int worker_num = CameraFrameJpegEncoder::kDefaultWorkerNum);
+  ~CameraFramePublisher();
+
+  PublishMode publish_mode() const { return publish_mode_; }
+
+  // Publishes the frames transformed by |transform| on the topic with
+  // |topic_suffix|, e.g, "/320x240". It should be called before
+  // RequestPublish().
+  void AddTransform(const std::string& topic_suffix,
+                    std::unique_ptr<CameraFrameTransform> transform);
+
+  void RequestPublish(const NodeInfo& node_info, const std::string& topic,
+                      int channel_types,
+                      const communication::Settings& settings,
+                      StatusOnceCallback callback = StatusOnceCallback());
+
+  void Publish(CameraFrame camera_frame);
+
+  // Publishes the JPEG frames being encoded before it unpublishes.
+  void RequestUnpublish(const NodeInfo& node_info, const std::string& topic,
+                        StatusOnceCallback callback = StatusOnceCallback());
+
+  size_t dropped_frames() const { return jpeg_encoder_.dropped_frames(); }
+  size_t transform_dropped_frames() const { return transform_dropped_frames_; }
+
+ private:
+  struct TransformOutput {
+    std::string topic_suffix;
+    std::unique_ptr<CameraFrameTransform> transform;
+    std::unique_ptr<Publisher<CameraFrameMessage>> publisher;
+  };
+
+  // Publishes the transformed frames from |transform_outputs_[index]| on,
+  // once the ones before are published.
+  void OnPublished(size_t index, const NodeInfo& node_info,
+                   const std::string& topic, int channel_types,
+                   const communication::Settings& settings,
+                   StatusOnceCallback callback, Status s);
+  // Unpublishes the transformed frames of |transform_outputs_| before |index|
+  // backward, and runs |callback| with |s|, the error which failed to publish.
+  void UnpublishTransforms(size_t index, const NodeInfo& node_info,
+                           const std::string& topic, Status s,
+                           StatusOnceCallback callback);
+  void OnTransformUnpublished(size_t index, const NodeInfo& node_info,
+                              const std::string& topic, Status s,
+                              StatusOnceCallback callback,
+                              Status unpublish_status);
+  void OnUnpublished(size_t index, const NodeInfo& node_info,
+                     const std::string& topic, StatusOnceCallback callback,
+                     Status s);
+  void OnRawPublished(const NodeInfo& node_info, const std::string& topic,
+                      int channel_types,
+                      const communication::Settings& settings,
+                      StatusOnceCallback callback, Status s);
+  void OnRawUnpublished(const NodeInfo& node_info, const std::string& topic,
+                        StatusOnceCallback callback, Status s);
+
+  bool HasPublishingTransform() const;
+  // Runs on |transform_thread_|.
+  void DoTransform(CameraFrame camera_frame);
+
+  // Stops |jpeg_encoder_| and |transform_thread_|, which wait for the frames
+  // given so far.
+  void StopThreads();
+
+  // Runs on the encoder thread of |jpeg_encoder_|.
+  void OnJpegFrame(CameraFrame&& camera_frame);
+  void OnJpegError(Status s);
+
+  const PublishMode publish_mode_;
+  const JpegCodec::Options options_;
+  const int worker_num_;
+
+  Publisher<CameraFrameMessage> raw_publisher_;
+  Publisher<CameraFrameMessage> jpeg_publisher_;
+  CameraFrameJpegEncoder jpeg_encoder_;
+  std::vector<TransformOutput> transform_outputs_;
+  std::unique_ptr<base::Thread> transform_thread_;
+  std::atomic<size_t> transform_frames_in_flight_{0};
+  std::atomic<size_t> transform_dropped_frames_{0};
+
+  DISALLOW_COPY_AND_ASSIGN(CameraFramePublisher);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_PUBLISHER_H_
@@ -0,0 +1,198 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_synchronizer.h"
+
+#include <algorithm>
+
+#include "third_party/chromium/base/logging.h"
+
+namespace felicia {
+namespace drivers {
+
+CameraFrameSynchronizer::Options::Options() = default;
+
+CameraFrameSynchronizer::Camera::Camera() = default;
+
+CameraFrameSynchronizer::Camera::Camera(Camera&& other) noexcept = default;
+
+CameraFrameSynchronizer::Camera::~Camera() = default;
+
+CameraFrameSynchronizer::CameraFrameSynchronizer(
+    size_t camera_count, CameraFrameSetCallback camera_frame_set_callback,
+    const Options& options)
+    : camera_frame_set_callback_(camera_frame_set_callback),
+      options_(options),
+      cameras_(camera_count) {
+  DCHECK_GT(camera_count, 0u);
+  DCHECK_GT(options_.max_queue_size, 0u);
+  DCHECK_GE(options_.clock_offset_gain, 0);
+  DCHECK_LE(options_.clock_offset_gain, 1);
+}
+
+CameraFrameSynchronizer::~CameraFrameSynchronizer() = default;
+
+void CameraFrameSynchronizer::OnCameraFrame(size_t index,
+                                            CameraFrame camera_frame) {
+  base::AutoLock l(lock_);
+  DCHECK_LT(index, cameras_.size());
+  Camera& camera = cameras_[index];
+  if (!camera.arrival_offset) {
+    base::TimeDelta arrival = base::TimeTicks::Now() - base::TimeTicks();
+    camera.arrival_offset = camera_frame.timestamp() - arrival;
+  }
+
+  camera.camera_frames.push_back(std::move(camera_frame));
+  if (camera.camera_frames.size() > options_.max_queue_size) {
+    DropFrontFrame(index);
+  }
+
+  while (TryMakeSet()) {
+  }
+}
+
+void CameraFrameSynchronizer::Reset() {
+  base::AutoLock l(lock_);
+  for (Camera& camera : cameras_) {
+    camera.camera_frames.clear();
+    camera.arrival_offset.reset();
+    camera.clock_offset = base::TimeDelta();
+    camera.first_clock_offset = base::TimeDelta();
+    camera.dropped_frames = 0;
+  }
+  has_clock_offsets_ = false;
+  first_timestamp_ = base::TimeDelta();
+  last_timestamp_ = base::TimeDelta();
+  frame_sets_ = 0;
+  max_skew_ = base::TimeDelta();
+  total_skew_ = base::TimeDelta();
+}
+
+CameraFrameSynchronizer::Stats CameraFrameSynchronizer::stats() const {
+  base::AutoLock l(lock_);
+  Stats stats;
+  stats.frame_sets = frame_sets_;
+  stats.max_skew = max_skew_;
+  if (frame_sets_ > 0) stats.mean_skew = total_skew_ / frame_sets_;
+
+  base::TimeDelta elapsed = last_timestamp_ - first_timestamp_;
+  for (const Camera& camera : cameras_) {
+    CameraStats camera_stats;
+    camera_stats.clock_offset = camera.clock_offset;
+    if (elapsed > base::TimeDelta()) {
+      camera_stats.drift_ppm =
+          (camera.clock_offset - camera.first_clock_offset).InMicrosecondsF() /
+          elapsed.InMicrosecondsF() * 1e6;
+    }
+    camera_stats.dropped_frames = camera.dropped_frames;
+    stats.cameras.push_back(camera_stats);
+  }
+  return stats;
+}
+
+base::TimeDelta CameraFrameSynchronizer::CorrectedTimestamp(
+    size_t index, const CameraFrame& camera_frame) const {
+  return camera_frame.timestamp() - cameras_[index].clock_offset;
+}
+
+void CameraFrameSynchronizer::DropFrontFrame(size_t index) {
+  Camera& camera = cameras_[index];
+  camera.camera_frames.pop_front();
+  camera.dropped_frames++;
+}
+
+bool CameraFrameSynchronizer::AllCamerasHaveFrames() const {
+  for (const Camera& camera : cameras_) {
+    if (camera.camera_frames.empty()) return false;
+  }
+  return true;
+}
+
+void CameraFrameSynchronizer::EstimateInitialClockOffsets() {
+  // The frames of the cameras taken at the same time arrive at about the same
+  // time, if their latencies are alike.
+  for (Camera& camera : cameras_) {
+    camera.clock_offset =
+        camera.arrival_offset.value() - cameras_[0].arrival_offset.value();
+  }
+  has_clock_offsets_ = true;
+}
+
+bool CameraFrameSynchronizer::TryMakeSet() {
+  if (!AllCamerasHaveFrames()) return false;
+  if (options_.estimate_clock_offsets && !has_clock_offsets_) {
+    EstimateInitialClockOffsets();
+  }
+
+  // The set is made around the latest of the earliest frames, since the
+  // frames of the other cameras to pair with it have already arrived.
+  base::TimeDelta pivot = base::TimeDelta::Min();
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    pivot = std::max(pivot,
+                     CorrectedTimestamp(i, cameras_[i].camera_frames.front()));
+  }
+
+  bool dropped = false;
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    std::deque<CameraFrame>& camera_frames = cameras_[i].camera_frames;
+    if (CorrectedTimestamp(i, camera_frames.front()) <
+        pivot - options_.tolerance) {
+      DropFrontFrame(i);
+      dropped = true;
+      continue;
+    }
+    // Prefers the later frame if it is closer to |pivot|.
+    while (camera_frames.size() > 1) {
+      base::TimeDelta front = CorrectedTimestamp(i, camera_frames[0]);
+      base::TimeDelta next = CorrectedTimestamp(i, camera_frames[1]);
+      if (next > pivot || pivot - next >= pivot - front) break;
+      DropFrontFrame(i);
+    }
+  }
+  // Some cameras may not have the frames around |pivot| yet, or have the
+  // later frames around which a better set is made.
+  if (dropped) return AllCamerasHaveFrames();
+
+  std::vector<CameraFrame> camera_frames;
+  std::vector<base::TimeDelta> timestamps;
+  camera_frames.reserve(cameras_.size());
+  timestamps.reserve(cameras_.size());
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    std::deque<CameraFrame>& queue = cameras_[i].camera_frames;
+    timestamps.push_back(CorrectedTimestamp(i, queue.front()));
+    camera_frames.push_back(std::move(queue.front()));
+    queue.pop_front();
+  }
+
+  UpdateClockOffsets(timestamps);
+  camera_frame_set_callback_.Run(std::move(camera_frames));
+  return true;
+}
+
+void CameraFrameSynchronizer::UpdateClockOffsets(
+    const std::vector<base::TimeDelta>& timestamps) {
+  auto minmax = std::minmax_element(timestamps.begin(), timestamps.end());
+  base::TimeDelta skew = *minmax.second - *minmax.first;
+  max_skew_ = std::max(max_skew_, skew);
+  total_skew_ += skew;
+  last_timestamp_ = timestamps[0];
+  if (frame_sets_ == 0) {
+    first_timestamp_ = timestamps[0];
+    for (Camera& camera : cameras_) {
+      camera.first_clock_offset = camera.clock_offset;
+    }
+  }
+  frame_sets_++;
+
+  if (!options_.estimate_clock_offsets) return;
+  // The offsets of the others follow the error from the first camera, whose
+  // offset stays 0.
+  for (size_t i = 1; i < cameras_.size(); ++i) {
+    cameras_[i].clock_offset +=
+        (timestamps[i] - timestamps[0]) * options_.clock_offset_gain;
+  }
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,146 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_SYNCHRONIZER_H_
+#define FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_SYNCHRONIZER_H_
+
+#include <deque>
+#include <vector>
+
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/optional.h"
+#include "third_party/chromium/base/synchronization/lock.h"
+#include "third_party/chromium/base/thread_annotations.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/drivers/camera/camera_frame.h"
+
+namespace felicia {
+namespace drivers {
+
+typedef base::RepeatingCallback<void(std::vector<CameraFrame>&&)>
+    CameraFrameSetCallback;
+
+// CameraFrameSynchronizer pairs up the frames of N cameras, e.g, the left and
+// right frames of a StereoCameraInterface, by their timestamps. Unlike
+// MessageFilter, the number of the cameras is decided at runtime, and the
+// cameras don't have to share a clock.
+//
+// The timestamp of a frame is corrected to the clock of the first camera by
+// the clock offset of its camera. The offsets are first estimated from the
+// time the first frames arrive, and refined as the frames are paired, so that
+// they follow the cameras drifting apart. A set is made of the earliest
+// frames of the cameras as soon as their corrected timestamps are within the
+// tolerance of each other, so that at most a frame or two are buffered per
+// camera. The frames which can't be in any set are dropped.
+//
+// OnCameraFrame() can be called on the threads of the cameras. The callback
+// runs on the thread which completes a set, with a lock held, so it should
+// return quickly and not call back into this.
+class FEL_EXPORT CameraFrameSynchronizer {
+ public:
+  struct Options {
+    Options();
+
+    // The corrected timestamps of the frames in a set are at most this far
+    // apart. About a half of the frame interval is a good choice.
+    base::TimeDelta tolerance = base::TimeDelta::FromMilliseconds(10);
+    // The frames of a camera beyond this are dropped from the earliest, e.g,
+    // while another camera stalls.
+    size_t max_queue_size = 4;
+    // Estimates the clock offsets of the cameras. Turn it off if they are
+    // stamped by the same clock, e.g, by the Timestamper of a host.
+    bool estimate_clock_offsets = true;
+    // How much of the remaining error of a set is corrected at once, between 0
+    // and 1. The smaller, the less it is shaken by the jitter of timestamps.
+    double clock_offset_gain = 0.05;
+  };
+
+  struct CameraStats {
+    // The estimated offset of its clock from the clock of the first camera.
+    base::TimeDelta clock_offset;
+    // How fast |clock_offset| changes since the first set, in parts per
+    // million.
+    double drift_ppm = 0;
+    // The number of frames which are dropped without being in a set.
+    size_t dropped_frames = 0;
+  };
+
+  struct Stats {
+    size_t frame_sets = 0;
+    // The largest and the mean differences between the corrected timestamps
+    // of the frames in a set.
+    base::TimeDelta max_skew;
+    base::TimeDelta mean_skew;
+    std::vector<CameraStats> cameras;
+  };
+
+  CameraFrameSynchronizer(size_t camera_count,
+                          CameraFrameSetCallback camera_frame_set_callback,
+                          const Options& options = Options());
+  ~CameraFrameSynchronizer();
+
+  size_t camera_count() const { return cameras_.size(); }
+
+  // Takes the |camera_frame| of the camera at |index|, and calls the callback
+  // with the frames of all the cameras ordered by their indices if it
+  // completes a set.
+  void OnCameraFrame(size_t index, CameraFrame camera_frame);
+
+  // Drops the frames which are not in a set yet, and starts over, e.g, after
+  // the cameras are restarted: the clock offsets are estimated again, and
+  // stats() counts from the next set.
+  void Reset();
+
+  Stats stats() const;
+
+ private:
+  struct Camera {
+    Camera();
+    Camera(Camera&& other) noexcept;
+    ~Camera();
+
+    std::deque<CameraFrame> camera_frames;
+    // The offset of the timestamps of the first frame from the time it
+    // arrives, which is compared to the other cameras for the initial clock
+    // offset.
+    base::Optional<base::TimeDelta> arrival_offset;
+    base::TimeDelta clock_offset;
+    // The clock offset at the first set, for the drift.
+    base::TimeDelta first_clock_offset;
+    size_t dropped_frames = 0;
+  };
+
+  base::TimeDelta CorrectedTimestamp(size_t index, const CameraFrame& frame)
+      const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void DropFrontFrame(size_t index) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool AllCamerasHaveFrames() const EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void EstimateInitialClockOffsets() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Returns true if it makes a set.
+  bool TryMakeSet() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void UpdateClockOffsets(const std::vector<base::TimeDelta>& timestamps)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  CameraFrameSetCallback camera_frame_set_callback_;
+  const Options options_;
+
+  mutable base::Lock lock_;
+  std::vector<Camera> cameras_ GUARDED_BY(lock_);
+  bool has_clock_offsets_ GUARDED_BY(lock_) = false;
+  // The timestamp of the first frame of the first camera in the first set.
+  base::TimeDelta first_timestamp_ GUARDED_BY(lock_);
+  base::TimeDelta last_timestamp_ GUARDED_BY(lock_);
+  size_t frame_sets_ GUARDED_BY(lock_) = 0;
+  base::TimeDelta max_skew_ GUARDED_BY(lock_);
+  base::TimeDelta total_skew_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(CameraFrameSynchronizer);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_SYNCHRONIZER_H_
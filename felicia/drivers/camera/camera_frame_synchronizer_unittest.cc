@@ -0,0 +1,186 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_synchronizer.h"
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr float kFrameRate = 30;
+constexpr base::TimeDelta kFrameInterval =
+    base::TimeDelta::FromMicroseconds(33333);
+
+void OnCameraFrameSet(std::vector<std::vector<CameraFrame>>* camera_frame_sets,
+                      std::vector<CameraFrame>&& camera_frames) {
+  camera_frame_sets->push_back(std::move(camera_frames));
+}
+
+CameraFrame NewCameraFrame(base::TimeDelta timestamp) {
+  return CameraFrame(Data(), CameraFormat(4, 4, PIXEL_FORMAT_Y8, kFrameRate),
+                     timestamp);
+}
+
+}  // namespace
+
+TEST(CameraFrameSynchronizerTest, PairWithinTolerance) {
+  std::vector<std::vector<CameraFrame>> camera_frame_sets;
+  CameraFrameSynchronizer::Options options;
+  options.estimate_clock_offsets = false;
+  CameraFrameSynchronizer synchronizer(
+      2, base::BindRepeating(&OnCameraFrameSet, &camera_frame_sets), options);
+
+  constexpr int kFrames = 10;
+  for (int i = 0; i < kFrames; ++i) {
+    base::TimeDelta timestamp = kFrameInterval * i;
+    // The right frames are late by 3ms, and arrive first every other time.
+    base::TimeDelta jitter = base::TimeDelta::FromMilliseconds(i % 2 ? 3 : -3);
+    if (i % 2) {
+      synchronizer.OnCameraFrame(1, NewCameraFrame(timestamp + jitter));
+      synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+    } else {
+      synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+      synchronizer.OnCameraFrame(1, NewCameraFrame(timestamp + jitter));
+    }
+  }
+
+  ASSERT_EQ(static_cast<size_t>(kFrames), camera_frame_sets.size());
+  for (int i = 0; i < kFrames; ++i) {
+    ASSERT_EQ(2u, camera_frame_sets[i].size());
+    EXPECT_EQ(kFrameInterval * i, camera_frame_sets[i][0].timestamp());
+  }
+  CameraFrameSynchronizer::Stats stats = synchronizer.stats();
+  EXPECT_EQ(static_cast<size_t>(kFrames), stats.frame_sets);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(3), stats.max_skew);
+  EXPECT_EQ(0u, stats.cameras[0].dropped_frames);
+  EXPECT_EQ(0u, stats.cameras[1].dropped_frames);
+}
+
+TEST(CameraFrameSynchronizerTest, DropUnpairedFrames) {
+  std::vector<std::vector<CameraFrame>> camera_frame_sets;
+  CameraFrameSynchronizer::Options options;
+  options.estimate_clock_offsets = false;
+  CameraFrameSynchronizer synchronizer(
+      3, base::BindRepeating(&OnCameraFrameSet, &camera_frame_sets), options);
+
+  for (int i = 0; i < 6; ++i) {
+    base::TimeDelta timestamp = kFrameInterval * i;
+    synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+    // The second camera misses the third frame.
+    if (i != 2) synchronizer.OnCameraFrame(1, NewCameraFrame(timestamp));
+    synchronizer.OnCameraFrame(2, NewCameraFrame(timestamp));
+  }
+
+  ASSERT_EQ(5u, camera_frame_sets.size());
+  for (const std::vector<CameraFrame>& camera_frames : camera_frame_sets) {
+    EXPECT_EQ(camera_frames[0].timestamp(), camera_frames[1].timestamp());
+    EXPECT_EQ(camera_frames[0].timestamp(), camera_frames[2].timestamp());
+  }
+  CameraFrameSynchronizer::Stats stats = synchronizer.stats();
+  EXPECT_EQ(1u, stats.cameras[0].dropped_frames);
+  EXPECT_EQ(0u, stats.cameras[1].dropped_frames);
+  EXPECT_EQ(1u, stats.cameras[2].dropped_frames);
+}
+
+TEST(CameraFrameSynchronizerTest, LimitQueueSize) {
+  std::vector<std::vector<CameraFrame>> camera_frame_sets;
+  CameraFrameSynchronizer::Options options;
+  options.max_queue_size = 2;
+  options.estimate_clock_offsets = false;
+  CameraFrameSynchronizer synchronizer(
+      2, base::BindRepeating(&OnCameraFrameSet, &camera_frame_sets), options);
+
+  // The second camera stalls.
+  for (int i = 0; i < 5; ++i) {
+    synchronizer.OnCameraFrame(0, NewCameraFrame(kFrameInterval * i));
+  }
+  EXPECT_EQ(3u, synchronizer.stats().cameras[0].dropped_frames);
+
+  synchronizer.OnCameraFrame(1, NewCameraFrame(kFrameInterval * 4));
+  ASSERT_EQ(1u, camera_frame_sets.size());
+  EXPECT_EQ(kFrameInterval * 4, camera_frame_sets[0][0].timestamp());
+  EXPECT_EQ(4u, synchronizer.stats().cameras[0].dropped_frames);
+}
+
+TEST(CameraFrameSynchronizerTest, EstimateClockOffset) {
+  std::vector<std::vector<CameraFrame>> camera_frame_sets;
+  CameraFrameSynchronizer synchronizer(
+      2, base::BindRepeating(&OnCameraFrameSet, &camera_frame_sets));
+
+  // The clock of the second camera is ahead by 5s, and runs faster by 100ppm.
+  const base::TimeDelta kClockOffset = base::TimeDelta::FromSeconds(5);
+  constexpr double kDriftPpm = 100;
+  constexpr int kFrames = 600;
+  for (int i = 0; i < kFrames; ++i) {
+    base::TimeDelta timestamp = kFrameInterval * i;
+    synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+    synchronizer.OnCameraFrame(
+        1, NewCameraFrame(kClockOffset + timestamp * (1 + kDriftPpm / 1e6)));
+  }
+
+  ASSERT_EQ(static_cast<size_t>(kFrames), camera_frame_sets.size());
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_EQ(kFrameInterval * i, camera_frame_sets[i][0].timestamp());
+  }
+  CameraFrameSynchronizer::Stats stats = synchronizer.stats();
+  base::TimeDelta expected_clock_offset =
+      kClockOffset + kFrameInterval * (kFrames - 1) * (kDriftPpm / 1e6);
+  EXPECT_LT((stats.cameras[1].clock_offset - expected_clock_offset).magnitude(),
+            base::TimeDelta::FromMilliseconds(1));
+  EXPECT_NEAR(kDriftPpm, stats.cameras[1].drift_ppm, 15);
+  EXPECT_EQ(base::TimeDelta(), stats.cameras[0].clock_offset);
+}
+
+TEST(CameraFrameSynchronizerTest, Reset) {
+  std::vector<std::vector<CameraFrame>> camera_frame_sets;
+  CameraFrameSynchronizer synchronizer(
+      2, base::BindRepeating(&OnCameraFrameSet, &camera_frame_sets));
+
+  // The clock of the second camera is ahead by 5s, and the first camera
+  // misses a frame.
+  const base::TimeDelta kClockOffset = base::TimeDelta::FromSeconds(5);
+  for (int i = 0; i < 10; ++i) {
+    base::TimeDelta timestamp = kFrameInterval * i;
+    if (i != 5) synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+    synchronizer.OnCameraFrame(1, NewCameraFrame(kClockOffset + timestamp));
+  }
+  CameraFrameSynchronizer::Stats stats = synchronizer.stats();
+  EXPECT_EQ(9u, stats.frame_sets);
+  EXPECT_EQ(1u, stats.cameras[1].dropped_frames);
+
+  // After the cameras are restarted, the clock of the second camera is
+  // behind by 2s, and the timestamps start over.
+  synchronizer.Reset();
+  stats = synchronizer.stats();
+  EXPECT_EQ(0u, stats.frame_sets);
+  EXPECT_EQ(base::TimeDelta(), stats.max_skew);
+  EXPECT_EQ(base::TimeDelta(), stats.mean_skew);
+  EXPECT_EQ(0u, stats.cameras[1].dropped_frames);
+  EXPECT_EQ(base::TimeDelta(), stats.cameras[1].clock_offset);
+
+  camera_frame_sets.clear();
+  const base::TimeDelta kNewClockOffset = base::TimeDelta::FromSeconds(-2);
+  constexpr int kFrames = 10;
+  for (int i = 0; i < kFrames; ++i) {
+    base::TimeDelta timestamp = kFrameInterval * i;
+    synchronizer.OnCameraFrame(0, NewCameraFrame(timestamp));
+    synchronizer.OnCameraFrame(1, NewCameraFrame(kNewClockOffset + timestamp));
+  }
+  ASSERT_EQ(static_cast<size_t>(kFrames), camera_frame_sets.size());
+  stats = synchronizer.stats();
+  EXPECT_EQ(static_cast<size_t>(kFrames), stats.frame_sets);
+  EXPECT_EQ(0u, stats.cameras[1].dropped_frames);
+  EXPECT_LT((stats.cameras[1].clock_offset - kNewClockOffset).magnitude(),
+            base::TimeDelta::FromMilliseconds(1));
+  // The drift is measured from the first set after Reset(), not from the
+  // clock offset before it.
+  EXPECT_NEAR(0, stats.cameras[1].drift_ppm, 1);
+}
+
+}  // namespace drivers
+}  // namespace felicia
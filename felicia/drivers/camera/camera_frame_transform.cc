@@ -0,0 +1,302 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_transform.h"
+
+#include <algorithm>
+
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+
+#include "felicia/drivers/camera/camera_errors.h"
+#include "felicia/drivers/camera/camera_frame_util.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+// Returns true if libyuv scales |pixel_format| as it is.
+bool CanScaleDirectly(PixelFormat pixel_format) {
+  switch (pixel_format) {
+    case PIXEL_FORMAT_I420:
+    case PIXEL_FORMAT_YV12:
+    case PIXEL_FORMAT_Y8:
+    case PIXEL_FORMAT_BGRA:
+    case PIXEL_FORMAT_BGRX:
+    case PIXEL_FORMAT_RGBA:
+    case PIXEL_FORMAT_RGBX:
+    case PIXEL_FORMAT_ARGB:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsYuv(PixelFormat pixel_format) {
+  switch (pixel_format) {
+    case PIXEL_FORMAT_I420:
+    case PIXEL_FORMAT_YV12:
+    case PIXEL_FORMAT_NV12:
+    case PIXEL_FORMAT_NV21:
+    case PIXEL_FORMAT_UYVY:
+    case PIXEL_FORMAT_YUY2:
+      return true;
+    default:
+      return false;
+  }
+}
+
+int DivideRoundingUp(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+Data Allocate(DataPool* data_pool, size_t size) {
+  if (data_pool) return data_pool->Acquire(size);
+  Data data;
+  data.resize(size);
+  return data;
+}
+
+CameraFrame NewCameraFrame(const scoped_refptr<DataPool>& data_pool,
+                           const CameraFormat& camera_format,
+                           base::TimeDelta timestamp) {
+  CameraFrame camera_frame(
+      Allocate(data_pool.get(), camera_format.AllocationSize()), camera_format,
+      timestamp);
+  if (data_pool) camera_frame.set_data_pool(data_pool);
+  return camera_frame;
+}
+
+Status CropAndScale(const CameraFrame& camera_frame, const Recti& crop_rect,
+                    const Sizei& size, libyuv::FilterMode filter_mode,
+                    const scoped_refptr<DataPool>& data_pool,
+                    CameraFrame* out);
+
+// Decodes |camera_frame| in PIXEL_FORMAT_MJPEG at the smallest scale which
+// keeps |crop_rect| at least as large as |size|, and crops and scales it.
+Status DecodeAndCropAndScale(const CameraFrame& camera_frame,
+                             const Recti& crop_rect, const Sizei& size,
+                             libyuv::FilterMode filter_mode,
+                             const scoped_refptr<DataPool>& data_pool,
+                             CameraFrame* out) {
+  Sizei min_size(
+      DivideRoundingUp(static_cast<int64_t>(size.width()) *
+                           camera_frame.width(),
+                       crop_rect.width()),
+      DivideRoundingUp(static_cast<int64_t>(size.height()) *
+                           camera_frame.height(),
+                       crop_rect.height()));
+  int scale_denominator = GetMjpegScaleDenominator(
+      Sizei(camera_frame.width(), camera_frame.height()), min_size);
+  StatusOr<CameraFrame> status_or =
+      DecodeMjpeg(camera_frame, PIXEL_FORMAT_BGRA, scale_denominator);
+  if (!status_or.ok()) return status_or.status();
+  const CameraFrame& decoded = status_or.ValueOrDie();
+
+  Point<int> top_left(crop_rect.top_left().x() / scale_denominator,
+                      crop_rect.top_left().y() / scale_denominator);
+  Point<int> bottom_right(
+      std::min(DivideRoundingUp(crop_rect.bottom_right().x(),
+                                scale_denominator),
+               decoded.width()),
+      std::min(DivideRoundingUp(crop_rect.bottom_right().y(),
+                                scale_denominator),
+               decoded.height()));
+  return CropAndScale(decoded, Recti(top_left, bottom_right), size,
+                      filter_mode, data_pool, out);
+}
+
+// Converts |crop_rect| of |camera_frame| to |pixel_format| in a single pass.
+Status ConvertAndCrop(const CameraFrame& camera_frame, const Recti& crop_rect,
+                      PixelFormat pixel_format,
+                      const scoped_refptr<DataPool>& data_pool,
+                      CameraFrame* out) {
+  const CameraFormat& camera_format = camera_frame.camera_format();
+  *out = NewCameraFrame(
+      data_pool,
+      CameraFormat(crop_rect.size(), pixel_format, camera_frame.frame_rate()),
+      camera_frame.timestamp());
+  camera_internal::Planes dst = camera_internal::GetPlanes(
+      out->data().cast<uint8_t*>(), pixel_format, out->width(),
+      out->height());
+
+  int result;
+  if (pixel_format == PIXEL_FORMAT_BGRA) {
+    result = libyuv::ConvertToARGB(
+        camera_frame.data().cast<const uint8_t*>(), camera_frame.length(),
+        dst.data[0], dst.stride[0], crop_rect.top_left().x(),
+        crop_rect.top_left().y(), camera_frame.width(), camera_frame.height(),
+        crop_rect.width(), crop_rect.height(),
+        libyuv::RotationMode::kRotate0, camera_format.ToLibyuvPixelFormat());
+  } else {
+    result = libyuv::ConvertToI420(
+        camera_frame.data().cast<const uint8_t*>(), camera_frame.length(),
+        dst.data[0], dst.stride[0], dst.data[1], dst.stride[1], dst.data[2],
+        dst.stride[2], crop_rect.top_left().x(), crop_rect.top_left().y(),
+        camera_frame.width(), camera_frame.height(), crop_rect.width(),
+        crop_rect.height(), libyuv::RotationMode::kRotate0,
+        camera_format.ToLibyuvPixelFormat());
+  }
+  if (result != 0) {
+    return errors::FailedToConvertToRequestedPixelFormat(pixel_format);
+  }
+  return Status::OK();
+}
+
+Status CropAndScale(const CameraFrame& camera_frame, const Recti& crop_rect,
+                    const Sizei& size, libyuv::FilterMode filter_mode,
+                    const scoped_refptr<DataPool>& data_pool,
+                    CameraFrame* out) {
+  PixelFormat pixel_format = camera_frame.pixel_format();
+  if (pixel_format == PIXEL_FORMAT_MJPEG) {
+    return DecodeAndCropAndScale(camera_frame, crop_rect, size, filter_mode,
+                                 data_pool, out);
+  }
+
+  // The chroma of the YUV formats is shared by 2 x 2 or 2 x 1 pixels, so the
+  // crop has to start on even pixels.
+  Point<int> top_left = crop_rect.top_left();
+  if (IsYuv(pixel_format)) {
+    top_left = Point<int>(top_left.x() & ~1, top_left.y() & ~1);
+  }
+
+  if (!CanScaleDirectly(pixel_format)) {
+    CameraFrame cropped;
+    Status s = ConvertAndCrop(
+        camera_frame, Recti(top_left, crop_rect.bottom_right()),
+        CameraFrameTransform::GetOutputPixelFormat(pixel_format), data_pool,
+        &cropped);
+    if (!s.ok()) return s;
+    if (Sizei(cropped.width(), cropped.height()) == size) {
+      *out = std::move(cropped);
+      return Status::OK();
+    }
+    return CropAndScale(
+        cropped, Recti(Point<int>(0, 0), cropped.width(), cropped.height()),
+        size, filter_mode, data_pool, out);
+  }
+
+  const int x = top_left.x();
+  const int y = top_left.y();
+  const int width = crop_rect.bottom_right().x() - x;
+  const int height = crop_rect.bottom_right().y() - y;
+  camera_internal::Planes src = camera_internal::GetPlanes(
+      camera_frame.data().cast<const uint8_t*>(), pixel_format,
+      camera_frame.width(), camera_frame.height());
+  *out = NewCameraFrame(
+      data_pool, CameraFormat(size, pixel_format, camera_frame.frame_rate()),
+      camera_frame.timestamp());
+  camera_internal::Planes dst = camera_internal::GetPlanes(
+      out->data().cast<uint8_t*>(), pixel_format, size.width(),
+      size.height());
+
+  int result;
+  switch (pixel_format) {
+    case PIXEL_FORMAT_I420:
+    case PIXEL_FORMAT_YV12:
+      result = libyuv::I420Scale(
+          src.data[0] + y * src.stride[0] + x, src.stride[0],
+          src.data[1] + (y / 2) * src.stride[1] + x / 2, src.stride[1],
+          src.data[2] + (y / 2) * src.stride[2] + x / 2, src.stride[2], width,
+          height, dst.data[0], dst.stride[0], dst.data[1], dst.stride[1],
+          dst.data[2], dst.stride[2], size.width(), size.height(),
+          filter_mode);
+      break;
+    case PIXEL_FORMAT_Y8:
+      libyuv::ScalePlane(src.data[0] + y * src.stride[0] + x, src.stride[0],
+                         width, height, dst.data[0], dst.stride[0],
+                         size.width(), size.height(), filter_mode);
+      result = 0;
+      break;
+    default:
+      // Scaling doesn't care the order of the channels.
+      result = libyuv::ARGBScale(
+          src.data[0] + y * src.stride[0] + x * 4, src.stride[0], width,
+          height, dst.data[0], dst.stride[0], size.width(), size.height(),
+          filter_mode);
+      break;
+  }
+  if (result != 0) {
+    return felicia::errors::Internal(
+        base::StringPrintf("Failed to scale %s to %s.",
+                           Sizei(width, height).ToString().c_str(),
+                           size.ToString().c_str()));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+CameraFrameTransform::CameraFrameTransform(const Sizei& size,
+                                           libyuv::FilterMode filter_mode)
+    : size_(size),
+      filter_mode_(filter_mode),
+      data_pool_(base::MakeRefCounted<DataPool>()) {
+  DCHECK_GT(size_.width(), 0);
+  DCHECK_GT(size_.height(), 0);
+}
+
+CameraFrameTransform::CameraFrameTransform(const Recti& crop_rect,
+                                           const Sizei& size,
+                                           libyuv::FilterMode filter_mode)
+    : size_(size),
+      crop_rect_(crop_rect),
+      filter_mode_(filter_mode),
+      data_pool_(base::MakeRefCounted<DataPool>()) {
+  DCHECK_GT(size_.width(), 0);
+  DCHECK_GT(size_.height(), 0);
+}
+
+CameraFrameTransform::~CameraFrameTransform() = default;
+
+// static
+PixelFormat CameraFrameTransform::GetOutputPixelFormat(
+    PixelFormat pixel_format) {
+  if (CanScaleDirectly(pixel_format)) return pixel_format;
+  if (IsYuv(pixel_format)) return PIXEL_FORMAT_I420;
+  return PIXEL_FORMAT_BGRA;
+}
+
+StatusOr<CameraFrame> CameraFrameTransform::Transform(
+    const CameraFrame& camera_frame) const {
+  Recti frame_rect(Point<int>(0, 0), camera_frame.width(),
+                   camera_frame.height());
+  Recti crop_rect = crop_rect_.value_or(frame_rect);
+  if (crop_rect.top_left().x() < 0 || crop_rect.top_left().y() < 0 ||
+      crop_rect.bottom_right().x() > frame_rect.bottom_right().x() ||
+      crop_rect.bottom_right().y() > frame_rect.bottom_right().y()) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "Crop rect [%s, %s] is out of the frame %s.",
+        crop_rect.top_left().ToString().c_str(),
+        crop_rect.bottom_right().ToString().c_str(),
+        frame_rect.size().ToString().c_str()));
+  }
+
+  CameraFrame transformed;
+  Status s = CropAndScale(camera_frame, crop_rect, size_, filter_mode_,
+                          data_pool_, &transformed);
+  if (!s.ok()) return s;
+  return std::move(transformed);
+}
+
+StatusOr<std::vector<CameraFrame>> BuildCameraFramePyramid(
+    const CameraFrame& camera_frame, int levels,
+    scoped_refptr<DataPool> data_pool) {
+  DCHECK_GE(levels, 0);
+  std::vector<CameraFrame> pyramid;
+  pyramid.reserve(levels);
+  for (int i = 0; i < levels; ++i) {
+    const CameraFrame& above = i == 0 ? camera_frame : pyramid.back();
+    Sizei size((above.width() + 1) / 2, (above.height() + 1) / 2);
+    CameraFrame level;
+    Status s = CropAndScale(
+        above, Recti(Point<int>(0, 0), above.width(), above.height()), size,
+        libyuv::kFilterBox, data_pool, &level);
+    if (!s.ok()) return s;
+    pyramid.push_back(std::move(level));
+  }
+  return std::move(pyramid);
+}
+
+}  // namespace drivers
+}  // namespace felicia
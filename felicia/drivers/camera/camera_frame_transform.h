@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_TRANSFORM_H_
+#define FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_TRANSFORM_H_
+
+#include <vector>
+
+#include "libyuv.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/memory/scoped_refptr.h"
+#include "third_party/chromium/base/optional.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/containers/data_pool.h"
+#include "felicia/core/lib/error/statusor.h"
+#include "felicia/core/lib/unit/geometry/rect.h"
+#include "felicia/core/lib/unit/geometry/size.h"
+#include "felicia/drivers/camera/camera_frame.h"
+
+namespace felicia {
+namespace drivers {
+
+// CameraFrameTransform crops and scales CameraFrames with the SIMD kernels of
+// libyuv, so that a camera can be published once at every resolution its
+// subscribers need, e.g, 640x480 for a detector and 320x240 for a viewer.
+//
+// The frames in PIXEL_FORMAT_I420, PIXEL_FORMAT_YV12, PIXEL_FORMAT_Y8 and the
+// 4 bytes per pixel formats keep their pixel formats. The other YUV frames
+// come out in PIXEL_FORMAT_I420, and the rest in PIXEL_FORMAT_BGRA, as they
+// are converted and cropped in a single pass before scaled. A frame in
+// PIXEL_FORMAT_MJPEG is decoded by DecodeMjpeg() at the smallest scale which
+// is still larger than needed.
+//
+// The frames it returns are allocated from its DataPool and go back to it
+// when they are destroyed.
+class FEL_EXPORT CameraFrameTransform {
+ public:
+  // Scales the whole frame to |size|.
+  explicit CameraFrameTransform(
+      const Sizei& size, libyuv::FilterMode filter_mode = libyuv::kFilterBox);
+  // Crops |crop_rect| of the frame and scales it to |size|.
+  CameraFrameTransform(const Recti& crop_rect, const Sizei& size,
+                       libyuv::FilterMode filter_mode = libyuv::kFilterBox);
+  ~CameraFrameTransform();
+
+  const Sizei& size() const { return size_; }
+  const base::Optional<Recti>& crop_rect() const { return crop_rect_; }
+  libyuv::FilterMode filter_mode() const { return filter_mode_; }
+
+  // Returns the pixel format the frame in |pixel_format| comes out in.
+  static PixelFormat GetOutputPixelFormat(PixelFormat pixel_format);
+
+  // It is safe to call on multiple threads at once.
+  StatusOr<CameraFrame> Transform(const CameraFrame& camera_frame) const;
+
+ private:
+  const Sizei size_;
+  const base::Optional<Recti> crop_rect_;
+  const libyuv::FilterMode filter_mode_;
+  scoped_refptr<DataPool> data_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(CameraFrameTransform);
+};
+
+// Returns the |levels| levels of the image pyramid of |camera_frame| below
+// it, where each level is half the size of the one above, rounded up, and
+// scaled down from it with a box filter. Every level is in the output pixel
+// format of CameraFrameTransform. The levels are allocated from |data_pool|
+// if it is given.
+FEL_EXPORT StatusOr<std::vector<CameraFrame>> BuildCameraFramePyramid(
+    const CameraFrame& camera_frame, int levels,
+    scoped_refptr<DataPool> data_pool = nullptr);
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_CAMERA_FRAME_TRANSFORM_H_
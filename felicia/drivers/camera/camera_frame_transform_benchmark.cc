@@ -0,0 +1,100 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_transform.h"
+
+#include "benchmark/benchmark.h"
+#include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/strings/strcat.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+constexpr float kFrameRate = 30;
+
+constexpr PixelFormat kPixelFormats[] = {
+    PIXEL_FORMAT_I420, PIXEL_FORMAT_NV12, PIXEL_FORMAT_YUY2,
+    PIXEL_FORMAT_BGRA, PIXEL_FORMAT_BGR,  PIXEL_FORMAT_Y8,
+};
+
+constexpr Sizei kSizes[] = {{640, 480}, {320, 240}};
+
+CameraFrame NewRandomCameraFrame(PixelFormat pixel_format) {
+  CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  base::RandBytes(data.cast<char*>(), data.size());
+  return CameraFrame(std::move(data), camera_format, base::TimeDelta());
+}
+
+}  // namespace
+
+static void BM_Transform(benchmark::State& state) {
+  PixelFormat pixel_format = static_cast<PixelFormat>(state.range(0));
+  Sizei size(state.range(1), state.range(2));
+  libyuv::FilterMode filter_mode =
+      static_cast<libyuv::FilterMode>(state.range(3));
+  CameraFrame camera_frame = NewRandomCameraFrame(pixel_format);
+  CameraFrameTransform transform(size, filter_mode);
+
+  for (auto _ : state) {
+    StatusOr<CameraFrame> status_or = transform.Transform(camera_frame);
+    if (!status_or.ok()) {
+      state.SkipWithError("Failed to transform.");
+      break;
+    }
+  }
+
+  state.SetLabel(base::StrCat(
+      {CameraFormat::PixelFormatToString(pixel_format), " -> ",
+       CameraFormat::PixelFormatToString(
+           CameraFrameTransform::GetOutputPixelFormat(pixel_format)),
+       " ", size.ToString(),
+       filter_mode == libyuv::kFilterBox ? " (box)" : " (bilinear)"}));
+  state.SetBytesProcessed(state.iterations() * camera_frame.length());
+}
+
+static void TransformArgs(benchmark::internal::Benchmark* benchmark) {
+  for (PixelFormat pixel_format : kPixelFormats) {
+    for (const Sizei& size : kSizes) {
+      for (libyuv::FilterMode filter_mode :
+           {libyuv::kFilterBox, libyuv::kFilterBilinear}) {
+        benchmark->Args(
+            {pixel_format, size.width(), size.height(), filter_mode});
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_Transform)->Apply(TransformArgs);
+
+static void BM_BuildCameraFramePyramid(benchmark::State& state) {
+  PixelFormat pixel_format = static_cast<PixelFormat>(state.range(0));
+  CameraFrame camera_frame = NewRandomCameraFrame(pixel_format);
+  scoped_refptr<DataPool> data_pool = base::MakeRefCounted<DataPool>();
+
+  for (auto _ : state) {
+    StatusOr<std::vector<CameraFrame>> status_or =
+        BuildCameraFramePyramid(camera_frame, 4, data_pool);
+    if (!status_or.ok()) {
+      state.SkipWithError("Failed to build a pyramid.");
+      break;
+    }
+  }
+
+  state.SetLabel(CameraFormat::PixelFormatToString(pixel_format));
+  state.SetBytesProcessed(state.iterations() * camera_frame.length());
+}
+
+BENCHMARK(BM_BuildCameraFramePyramid)
+    ->Arg(PIXEL_FORMAT_I420)
+    ->Arg(PIXEL_FORMAT_NV12)
+    ->Arg(PIXEL_FORMAT_BGRA);
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame_transform.h"
+
+#include "gtest/gtest.h"
+
+#include "felicia/core/lib/image/jpeg_codec.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 640;
+constexpr int kHeight = 480;
+constexpr float kFrameRate = 30;
+
+CameraFrame NewCameraFrame(PixelFormat pixel_format) {
+  CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (size_t i = 0; i < data.size(); ++i) {
+    pixels[i] = (i * 7) & 0xFF;
+  }
+  return CameraFrame(std::move(data), camera_format,
+                     base::TimeDelta::FromMilliseconds(1));
+}
+
+// Returns a BGRA frame whose pixels are all (x, y, x + y, 0xFF) / 4.
+CameraFrame NewCoordinateFrame() {
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8_t* pixel = pixels + (y * kWidth + x) * 4;
+      pixel[0] = x / 4;
+      pixel[1] = y / 4;
+      pixel[2] = (x + y) / 4;
+      pixel[3] = 0xFF;
+    }
+  }
+  return CameraFrame(std::move(data), camera_format, base::TimeDelta());
+}
+
+void ExpectCameraFrame(const CameraFrame& camera_frame,
+                       PixelFormat pixel_format, const Sizei& size) {
+  EXPECT_EQ(pixel_format, camera_frame.pixel_format());
+  EXPECT_EQ(size.width(), camera_frame.width());
+  EXPECT_EQ(size.height(), camera_frame.height());
+  EXPECT_EQ(camera_frame.camera_format().AllocationSize(),
+            camera_frame.length());
+  EXPECT_EQ(kFrameRate, camera_frame.frame_rate());
+}
+
+}  // namespace
+
+TEST(CameraFrameTransformTest, Scale) {
+  const PixelFormat kPixelFormats[] = {
+      PIXEL_FORMAT_I420, PIXEL_FORMAT_YV12, PIXEL_FORMAT_NV12,
+      PIXEL_FORMAT_YUY2, PIXEL_FORMAT_BGRA, PIXEL_FORMAT_BGR,
+      PIXEL_FORMAT_Y8,   PIXEL_FORMAT_RGBA,
+  };
+  CameraFrameTransform transform(Sizei(320, 240));
+  for (PixelFormat pixel_format : kPixelFormats) {
+    CameraFrame camera_frame = NewCameraFrame(pixel_format);
+    StatusOr<CameraFrame> status_or = transform.Transform(camera_frame);
+    ASSERT_TRUE(status_or.ok()) << status_or.status();
+    const CameraFrame& transformed = status_or.ValueOrDie();
+    ExpectCameraFrame(transformed,
+                      CameraFrameTransform::GetOutputPixelFormat(pixel_format),
+                      Sizei(320, 240));
+    EXPECT_EQ(camera_frame.timestamp(), transformed.timestamp());
+  }
+}
+
+TEST(CameraFrameTransformTest, Crop) {
+  CameraFrameTransform transform(Recti(Point<int>(100, 40), 64, 32),
+                                 Sizei(64, 32));
+  StatusOr<CameraFrame> status_or = transform.Transform(NewCoordinateFrame());
+  ASSERT_TRUE(status_or.ok()) << status_or.status();
+  const CameraFrame& cropped = status_or.ValueOrDie();
+  ExpectCameraFrame(cropped, PIXEL_FORMAT_BGRA, Sizei(64, 32));
+  const uint8_t* pixels = cropped.data().cast<const uint8_t*>();
+  for (int y = 0; y < 32; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      const uint8_t* pixel = pixels + (y * 64 + x) * 4;
+      EXPECT_EQ((100 + x) / 4, pixel[0]);
+      EXPECT_EQ((40 + y) / 4, pixel[1]);
+      EXPECT_EQ((140 + x + y) / 4, pixel[2]);
+    }
+  }
+}
+
+TEST(CameraFrameTransformTest, CropOutOfFrame) {
+  CameraFrameTransform transform(Recti(Point<int>(600, 0), 64, 32),
+                                 Sizei(64, 32));
+  EXPECT_FALSE(transform.Transform(NewCoordinateFrame()).ok());
+}
+
+TEST(CameraFrameTransformTest, ScaleMjpeg) {
+  Image image(Sizei(kWidth, kHeight), PIXEL_FORMAT_BGRA,
+              std::move(NewCoordinateFrame().data()));
+  Data jpeg;
+  ASSERT_TRUE(JpegCodec::Encode(image, JpegCodec::Options(), &jpeg).ok());
+  CameraFrame camera_frame(
+      std::move(jpeg),
+      CameraFormat(kWidth, kHeight, PIXEL_FORMAT_MJPEG, kFrameRate),
+      base::TimeDelta());
+
+  CameraFrameTransform transform(Recti(Point<int>(320, 240), 320, 240),
+                                 Sizei(100, 75));
+  StatusOr<CameraFrame> status_or = transform.Transform(camera_frame);
+  ASSERT_TRUE(status_or.ok()) << status_or.status();
+  ExpectCameraFrame(status_or.ValueOrDie(), PIXEL_FORMAT_BGRA, Sizei(100, 75));
+}
+
+TEST(CameraFrameTransformTest, BuildPyramid) {
+  CameraFrame camera_frame = NewCameraFrame(PIXEL_FORMAT_NV12);
+  scoped_refptr<DataPool> data_pool = base::MakeRefCounted<DataPool>();
+  StatusOr<std::vector<CameraFrame>> status_or =
+      BuildCameraFramePyramid(camera_frame, 4, data_pool);
+  ASSERT_TRUE(status_or.ok()) << status_or.status();
+  const std::vector<CameraFrame>& pyramid = status_or.ValueOrDie();
+  const Sizei kExpectedSizes[] = {{320, 240}, {160, 120}, {80, 60}, {40, 30}};
+  ASSERT_EQ(4u, pyramid.size());
+  for (size_t i = 0; i < pyramid.size(); ++i) {
+    ExpectCameraFrame(pyramid[i], PIXEL_FORMAT_I420, kExpectedSizes[i]);
+  }
+}
+
+}  // namespace drivers
+}  // namespace felicia
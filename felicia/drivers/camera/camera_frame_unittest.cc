@@ -0,0 +1,182 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/camera_frame.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "felicia/core/lib/image/jpeg_codec.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 640;
+constexpr int kHeight = 480;
+constexpr float kFrameRate = 30;
+
+CameraFrame NewMjpegFrame() {
+  Data data;
+  data.resize(kWidth * kHeight * 3);
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (size_t i = 0; i < data.size(); ++i) {
+    pixels[i] = (i * 7) & 0xFF;
+  }
+  Image image(Sizei(kWidth, kHeight), PIXEL_FORMAT_BGR, std::move(data));
+  Data jpeg;
+  EXPECT_TRUE(JpegCodec::Encode(image, JpegCodec::Options(), &jpeg).ok());
+  return CameraFrame(
+      std::move(jpeg),
+      CameraFormat(kWidth, kHeight, PIXEL_FORMAT_MJPEG, kFrameRate),
+      base::TimeDelta::FromMilliseconds(1));
+}
+
+// Returns a frame in |pixel_format| converted from smooth gradients in
+// PIXEL_FORMAT_BGRA, so that the chroma subsampling of the YUV formats loses
+// little.
+Data NewGradientFrame(PixelFormat pixel_format) {
+  CameraFormat bgra_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+  Data bgra;
+  bgra.resize(bgra_format.AllocationSize());
+  uint8_t* pixels = bgra.cast<uint8_t*>();
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8_t* pixel = pixels + (y * kWidth + x) * 4;
+      pixel[0] = x * 255 / kWidth;
+      pixel[1] = y * 255 / kHeight;
+      pixel[2] = (x + y) * 255 / (kWidth + kHeight);
+      pixel[3] = 0xFF;
+    }
+  }
+  if (pixel_format == PIXEL_FORMAT_BGRA) return bgra;
+
+  CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  EXPECT_TRUE(ConvertToRequestedPixelFormat(bgra.cast<const uint8_t*>(),
+                                            bgra.size(), bgra_format,
+                                            pixel_format,
+                                            data.cast<uint8_t*>()));
+  return data;
+}
+
+}  // namespace
+
+// Each single pass conversion gives what going through PIXEL_FORMAT_BGRA
+// gives, within the rounding of the extra pass.
+TEST(CameraFrameTest, DirectConversionsMatchBgraRoute) {
+  constexpr PixelFormat kPixelFormats[] = {
+      PIXEL_FORMAT_I420, PIXEL_FORMAT_YV12, PIXEL_FORMAT_NV12,
+      PIXEL_FORMAT_NV21, PIXEL_FORMAT_UYVY, PIXEL_FORMAT_YUY2,
+      PIXEL_FORMAT_BGR,  PIXEL_FORMAT_RGBA, PIXEL_FORMAT_RGB,
+      PIXEL_FORMAT_ARGB,
+  };
+  constexpr int kMaxDifference = 3;
+
+  int direct_conversions = 0;
+  for (PixelFormat pixel_format : kPixelFormats) {
+    CameraFormat camera_format(kWidth, kHeight, pixel_format, kFrameRate);
+    Data data = NewGradientFrame(pixel_format);
+    const uint8_t* src = data.cast<const uint8_t*>();
+
+    CameraFormat bgra_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+    Data bgra;
+    bgra.resize(bgra_format.AllocationSize());
+    ASSERT_TRUE(ConvertToRequestedPixelFormat(src, data.size(), camera_format,
+                                              PIXEL_FORMAT_BGRA,
+                                              bgra.cast<uint8_t*>()));
+
+    for (PixelFormat requested_pixel_format : kPixelFormats) {
+      // BGRA, I420 and YV12 are always converted to in a single pass by
+      // libyuv::ConvertTo*().
+      if (requested_pixel_format == pixel_format ||
+          requested_pixel_format == PIXEL_FORMAT_I420 ||
+          requested_pixel_format == PIXEL_FORMAT_YV12 ||
+          !CanConvertDirectly(pixel_format, requested_pixel_format)) {
+        continue;
+      }
+      direct_conversions++;
+
+      CameraFormat requested_camera_format(kWidth, kHeight,
+                                           requested_pixel_format, kFrameRate);
+      Data direct;
+      direct.resize(requested_camera_format.AllocationSize());
+      ASSERT_TRUE(ConvertToRequestedPixelFormat(src, data.size(),
+                                                camera_format,
+                                                requested_pixel_format,
+                                                direct.cast<uint8_t*>()));
+      Data routed;
+      routed.resize(requested_camera_format.AllocationSize());
+      ASSERT_TRUE(ConvertToRequestedPixelFormat(
+          bgra.cast<const uint8_t*>(), bgra.size(), bgra_format,
+          requested_pixel_format, routed.cast<uint8_t*>()));
+
+      int max_difference = 0;
+      for (size_t i = 0; i < direct.size(); ++i) {
+        max_difference =
+            std::max(max_difference, abs(direct.cast<const uint8_t*>()[i] -
+                                         routed.cast<const uint8_t*>()[i]));
+      }
+      EXPECT_LE(max_difference, kMaxDifference)
+          << CameraFormat::PixelFormatToString(pixel_format) << " to "
+          << CameraFormat::PixelFormatToString(requested_pixel_format);
+    }
+  }
+  EXPECT_GT(direct_conversions, 0);
+}
+
+TEST(CameraFrameTest, DecodeMjpeg) {
+  CameraFrame camera_frame = NewMjpegFrame();
+  for (PixelFormat pixel_format : {PIXEL_FORMAT_BGRA, PIXEL_FORMAT_I420}) {
+    StatusOr<CameraFrame> status_or =
+        DecodeMjpeg(camera_frame, pixel_format, 4);
+    ASSERT_TRUE(status_or.ok());
+    const CameraFrame& decoded = status_or.ValueOrDie();
+    EXPECT_EQ(pixel_format, decoded.pixel_format());
+    EXPECT_EQ(kWidth / 4, decoded.width());
+    EXPECT_EQ(kHeight / 4, decoded.height());
+    EXPECT_EQ(decoded.camera_format().AllocationSize(), decoded.length());
+    EXPECT_EQ(camera_frame.timestamp(), decoded.timestamp());
+  }
+
+  CameraFrame raw(Data(), CameraFormat(kWidth, kHeight, PIXEL_FORMAT_BGR,
+                                       kFrameRate),
+                  base::TimeDelta());
+  EXPECT_FALSE(DecodeMjpeg(raw, PIXEL_FORMAT_BGRA).ok());
+}
+
+TEST(CameraFrameTest, ConvertMjpeg) {
+  CameraFrame camera_frame = NewMjpegFrame();
+  base::Optional<CameraFrame> mjpeg = ConvertToRequestedPixelFormat(
+      camera_frame.data().cast<const uint8_t*>(), camera_frame.length(),
+      camera_frame.camera_format(), PIXEL_FORMAT_MJPEG,
+      camera_frame.timestamp());
+  ASSERT_TRUE(mjpeg);
+  EXPECT_EQ(camera_frame.data().data(), mjpeg->data().data());
+
+  base::Optional<CameraFrame> bgr = ConvertToRequestedPixelFormat(
+      camera_frame.data().cast<const uint8_t*>(), camera_frame.length(),
+      camera_frame.camera_format(), PIXEL_FORMAT_BGR,
+      camera_frame.timestamp());
+  ASSERT_TRUE(bgr);
+  EXPECT_EQ(kWidth, bgr->width());
+  EXPECT_EQ(static_cast<size_t>(kWidth * kHeight * 3), bgr->length());
+}
+
+TEST(CameraFrameTest, GetMjpegScaleDenominator) {
+  Sizei size(1920, 1080);
+  EXPECT_EQ(8, GetMjpegScaleDenominator(size, Sizei(160, 120)));
+  EXPECT_EQ(4, GetMjpegScaleDenominator(size, Sizei(320, 240)));
+  EXPECT_EQ(2, GetMjpegScaleDenominator(size, Sizei(640, 480)));
+  EXPECT_EQ(1, GetMjpegScaleDenominator(size, Sizei(1280, 720)));
+  EXPECT_EQ(1, GetMjpegScaleDenominator(size, Sizei(3840, 2160)));
+}
+
+}  // namespace drivers
+}  // namespace felicia
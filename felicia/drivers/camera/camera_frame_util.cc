@@ -281,6 +281,49 @@ size_t AllocationSize(const CameraFormat& camera_format) {
   return total;
 }
 
+Planes GetPlanes(const uint8_t* data, PixelFormat pixel_format, int width,
+                 int height) {
+  Planes planes = {};
+  planes.data[0] = const_cast<uint8_t*>(data);
+  // Their sizes are aligned to multiple-of-two. See AllocationSize().
+  const int even_width = base::bits::Align(width, 2);
+  const int even_height = base::bits::Align(height, 2);
+  switch (pixel_format) {
+    case PIXEL_FORMAT_I420:
+    case PIXEL_FORMAT_YV12: {
+      const int u = pixel_format == PIXEL_FORMAT_I420 ? 1 : 2;
+      const int v = 3 - u;
+      planes.stride[0] = even_width;
+      planes.data[u] = planes.data[0] + even_width * even_height;
+      planes.stride[u] = even_width / 2;
+      planes.data[v] = planes.data[u] + (even_width / 2) * (even_height / 2);
+      planes.stride[v] = even_width / 2;
+      break;
+    }
+    case PIXEL_FORMAT_NV12:
+    case PIXEL_FORMAT_NV21:
+      planes.stride[0] = even_width;
+      planes.data[1] = planes.data[0] + even_width * even_height;
+      planes.stride[1] = even_width;
+      break;
+    case PIXEL_FORMAT_UYVY:
+    case PIXEL_FORMAT_YUY2:
+      planes.stride[0] = even_width * 2;
+      break;
+    case PIXEL_FORMAT_BGR:
+    case PIXEL_FORMAT_RGB:
+      planes.stride[0] = width * 3;
+      break;
+    case PIXEL_FORMAT_Y8:
+      planes.stride[0] = width;
+      break;
+    default:
+      planes.stride[0] = width * 4;
+      break;
+  }
+  return planes;
+}
+
 }  // namespace camera_internal
 }  // namespace drivers
 }  // namespace felicia
\ No newline at end of file
@@ -16,6 +16,18 @@ namespace camera_internal {
 
 FEL_EXPORT size_t AllocationSize(const CameraFormat& camera_format);
 
+// Pointers to and strides of the planes of a frame, where the planes of
+// PIXEL_FORMAT_YV12 are ordered like PIXEL_FORMAT_I420 so that both are
+// converted by the same functions. Packed formats use only the first plane.
+struct Planes {
+  uint8_t* data[3];
+  int stride[3];
+};
+
+// Returns the planes of |data| laid out as AllocationSize() expects.
+FEL_EXPORT Planes GetPlanes(const uint8_t* data, PixelFormat pixel_format,
+                            int width, int height);
+
 }  // namespace camera_internal
 }  // namespace drivers
 }  // namespace felicia
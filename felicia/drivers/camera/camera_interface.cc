@@ -4,12 +4,21 @@
 
 #include "felicia/drivers/camera/camera_interface.h"
 
+#include "felicia/core/lib/error/errors.h"
+
 namespace felicia {
 namespace drivers {
 
 CameraInterface::CameraInterface(const CameraDescriptor& camera_descriptor)
     : CameraInterfaceBase(camera_descriptor) {}
 
+Status CameraInterface::StartWithSharedSlotBuffer(
+    const CameraFormat& requested_camera_format,
+    WritableSharedSlotBuffer* slot_buffer, StatusCallback status_callback) {
+  return errors::Unimplemented(
+      "This camera can't capture into the shared memory.");
+}
+
 const CameraFormat& CameraInterface::camera_format() const {
   return camera_format_;
 }
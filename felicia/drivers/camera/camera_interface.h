@@ -8,6 +8,9 @@
 #include "felicia/drivers/camera/camera_interface_base.h"
 
 namespace felicia {
+
+class WritableSharedSlotBuffer;
+
 namespace drivers {
 
 class FEL_EXPORT CameraInterface : public CameraInterfaceBase {
@@ -18,6 +21,14 @@ class FEL_EXPORT CameraInterface : public CameraInterfaceBase {
                        CameraFrameCallback camera_frame_callback,
                        StatusCallback status_callback) = 0;
 
+  // Captures the frames right into the slots of |slot_buffer| in the pixel
+  // format of camera_format(), so that the readers in other processes read
+  // them with no copy. |slot_buffer| should outlive Stop(). Returns
+  // errors::Unimplemented() unless the camera supports it.
+  virtual Status StartWithSharedSlotBuffer(
+      const CameraFormat& requested_camera_format,
+      WritableSharedSlotBuffer* slot_buffer, StatusCallback status_callback);
+
   const CameraFormat& camera_format() const;
 
  protected:
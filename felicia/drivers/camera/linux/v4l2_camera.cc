@@ -21,6 +21,7 @@
 #include "third_party/chromium/base/stl_util.h"
 #include "third_party/chromium/base/strings/stringprintf.h"
 
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
 #include "felicia/core/lib/synchronization/scoped_event_signaller.h"
 #include "felicia/drivers/camera/camera_errors.h"
 
@@ -45,17 +46,18 @@ void FillV4L2Format(v4l2_format* format, uint32_t width, uint32_t height,
   format->fmt.pix.pixelformat = pixelformat_fourcc;
 }
 
-void FillV4L2Buffer(v4l2_buffer* buffer, int index) {
+void FillV4L2Buffer(v4l2_buffer* buffer, int index, v4l2_memory memory) {
   memset(buffer, 0, sizeof(*buffer));
-  buffer->memory = V4L2_MEMORY_MMAP;
+  buffer->memory = memory;
   buffer->index = index;
   buffer->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 }
 
-void FillV4L2RequestBuffer(v4l2_requestbuffers* requestbuffers, int count) {
+void FillV4L2RequestBuffer(v4l2_requestbuffers* requestbuffers, int count,
+                           v4l2_memory memory) {
   memset(requestbuffers, 0, sizeof(*requestbuffers));
   requestbuffers->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  requestbuffers->memory = V4L2_MEMORY_MMAP;
+  requestbuffers->memory = memory;
   requestbuffers->count = count;
 }
 
@@ -249,7 +251,7 @@ Status V4l2Camera::Start(const CameraFormat& requested_camera_format,
 
   for (size_t i = 0; i < buffers_.size(); ++i) {
     v4l2_buffer buffer;
-    FillV4L2Buffer(&buffer, i);
+    FillV4L2Buffer(&buffer, i, V4L2_MEMORY_MMAP);
 
     if (DoIoctl(fd_.get(), VIDIOC_QBUF, &buffer) < 0) {
       return felicia::errors::Unavailable(
@@ -262,6 +264,10 @@ Status V4l2Camera::Start(const CameraFormat& requested_camera_format,
     return felicia::errors::Unavailable("Failed to stream on.");
   }
 
+  pipeline_ = std::make_unique<CameraFramePipeline>(camera_frame_callback,
+                                                    status_callback);
+  pipeline_->Start(camera_format_, requested_pixel_format_,
+                   CameraFramePipeline::ResolveWorkerNum());
   thread_.Start();
   camera_frame_callback_ = camera_frame_callback;
   status_callback_ = status_callback;
@@ -277,6 +283,59 @@ Status V4l2Camera::Start(const CameraFormat& requested_camera_format,
   return Status::OK();
 }
 
+Status V4l2Camera::StartWithSharedSlotBuffer(
+    const CameraFormat& requested_camera_format,
+    WritableSharedSlotBuffer* slot_buffer, StatusCallback status_callback) {
+  if (!camera_state_.IsInitialized()) {
+    return camera_state_.InvalidStateError();
+  }
+
+  // The driver holds kNumVideoBuffers slots, and the rest are for the readers.
+  if (slot_buffer->slot_count() <= kNumVideoBuffers) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "The slot buffer should have more than %u slots.", kNumVideoBuffers));
+  }
+
+  CameraFormats camera_formats;
+  Status s = GetSupportedCameraFormats(camera_descriptor_, &camera_formats);
+  if (!s.ok()) return s;
+
+  const CameraFormat& final_camera_format =
+      GetBestMatchedCameraFormat(requested_camera_format, camera_formats);
+  s = SetCameraFormat(final_camera_format);
+  if (!s.ok()) return s;
+  // The frames are read as they are captured, so they aren't converted.
+  requested_pixel_format_ = camera_format_.pixel_format();
+  if (camera_format_.pixel_format() != PixelFormat::PIXEL_FORMAT_MJPEG &&
+      slot_buffer->slot_size() < camera_format_.AllocationSize()) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "The slot buffer should have slots of at least %zu bytes.",
+        camera_format_.AllocationSize()));
+  }
+
+  s = InitUserPtr(slot_buffer);
+  if (!s.ok()) return s;
+
+  for (size_t i = 0; i < queued_slots_.size(); ++i) {
+    s = EnqueueSlot(i, slot_buffer_->AcquireSlot());
+    if (!s.ok()) return s;
+  }
+
+  v4l2_buf_type capture_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (DoIoctl(fd_.get(), VIDIOC_STREAMON, &capture_type) < 0) {
+    return felicia::errors::Unavailable("Failed to stream on.");
+  }
+
+  thread_.Start();
+  status_callback_ = status_callback;
+  camera_state_.ToStarted();
+
+  thread_.task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&V4l2Camera::DoCaptureToSlot, AsWeakPtr()));
+
+  return Status::OK();
+}
+
 Status V4l2Camera::Stop() {
   if (!camera_state_.IsStarted()) {
     return camera_state_.InvalidStateError();
@@ -296,6 +355,19 @@ Status V4l2Camera::Stop() {
   if (thread_.IsRunning()) thread_.Stop();
   fd_.reset();
 
+  if (pipeline_) {
+    pipeline_->Stop();
+    DataPool::Stats stats = pipeline_->data_pool_stats();
+    DVLOG(1) << "Frame pool hit rate: " << stats.HitRate() << " ("
+             << stats.hits << " / " << stats.hits + stats.misses << ")";
+    DVLOG(1) << "Dropped frames: " << pipeline_->dropped_frames();
+    pipeline_.reset();
+  }
+
+  slot_buffer_ = nullptr;
+  queued_slots_.clear();
+  memory_ = V4L2_MEMORY_MMAP;
+
   camera_frame_callback_.Reset();
   status_callback_.Reset();
   camera_state_.ToStopped();
@@ -483,7 +555,7 @@ Status V4l2Camera::GetCameraSettingsInfo(
 
 Status V4l2Camera::InitMmap() {
   v4l2_requestbuffers requestbuffers;
-  FillV4L2RequestBuffer(&requestbuffers, kNumVideoBuffers);
+  FillV4L2RequestBuffer(&requestbuffers, kNumVideoBuffers, V4L2_MEMORY_MMAP);
 
   if (DoIoctl(fd_.get(), VIDIOC_REQBUFS, &requestbuffers) < 0) {
     return felicia::errors::Unavailable("Failed to request mmap buffers.");
@@ -491,7 +563,7 @@ Status V4l2Camera::InitMmap() {
 
   for (unsigned int i = 0; i < requestbuffers.count; ++i) {
     v4l2_buffer buffer;
-    FillV4L2Buffer(&buffer, i);
+    FillV4L2Buffer(&buffer, i, V4L2_MEMORY_MMAP);
 
     if (DoIoctl(fd_.get(), VIDIOC_QUERYBUF, &buffer) < 0) {
       return felicia::errors::Unavailable("Failed to query buffers.");
@@ -508,6 +580,40 @@ Status V4l2Camera::InitMmap() {
   return Status::OK();
 }
 
+Status V4l2Camera::InitUserPtr(WritableSharedSlotBuffer* slot_buffer) {
+  v4l2_requestbuffers requestbuffers;
+  FillV4L2RequestBuffer(&requestbuffers, kNumVideoBuffers,
+                        V4L2_MEMORY_USERPTR);
+
+  if (DoIoctl(fd_.get(), VIDIOC_REQBUFS, &requestbuffers) < 0) {
+    return felicia::errors::Unimplemented(
+        "Failed to request user pointer buffers.");
+  }
+
+  memory_ = V4L2_MEMORY_USERPTR;
+  slot_buffer_ = slot_buffer;
+  queued_slots_.assign(requestbuffers.count, -1);
+
+  return Status::OK();
+}
+
+Status V4l2Camera::EnqueueSlot(size_t index, int slot) {
+  DCHECK_GE(slot, 0);
+  v4l2_buffer buffer;
+  FillV4L2Buffer(&buffer, index, V4L2_MEMORY_USERPTR);
+  buffer.m.userptr =
+      reinterpret_cast<unsigned long>(slot_buffer_->slot_data(slot));
+  buffer.length = slot_buffer_->slot_size();
+
+  if (DoIoctl(fd_.get(), VIDIOC_QBUF, &buffer) < 0) {
+    return felicia::errors::Unavailable(
+        "Failed to enqueue V4L2 buffer to the driver.");
+  }
+  queued_slots_[index] = slot;
+
+  return Status::OK();
+}
+
 Status V4l2Camera::ClearMmap() {
   for (auto& buffer : buffers_) {
     const int result = munmap(buffer.start(), buffer.length());
@@ -570,7 +676,7 @@ void V4l2Camera::DoStop(base::WaitableEvent* event, Status* status) {
   }
 
   v4l2_requestbuffers requestbuffers;
-  FillV4L2RequestBuffer(&requestbuffers, 0);
+  FillV4L2RequestBuffer(&requestbuffers, 0, memory_);
   if (DoIoctl(fd_.get(), VIDIOC_REQBUFS, &requestbuffers) < 0) {
     *status = felicia::errors::Unavailable("Failed to request mmap buffers.");
     return;
@@ -582,44 +688,25 @@ void V4l2Camera::DoStop(base::WaitableEvent* event, Status* status) {
 void V4l2Camera::DoCapture() {
   DCHECK(thread_.task_runner()->BelongsToCurrentThread());
   v4l2_buffer buffer;
-  FillV4L2Buffer(&buffer, 0);
+  FillV4L2Buffer(&buffer, 0, V4L2_MEMORY_MMAP);
   if (DoIoctl(fd_.get(), VIDIOC_DQBUF, &buffer) < 0) {
     status_callback_.Run(felicia::errors::Unavailable(
         "Failed to dequeue V4L2 buffer from the driver."));
     return;
   }
+  base::TimeTicks dequeued = base::TimeTicks::Now();
 
-#ifdef V4L2_BUF_FLAG_ERROR
-  bool buf_error_flag_set = buffer.flags & V4L2_BUF_FLAG_ERROR;
-#else
-  bool buf_error_flag_set = false;
-#endif
-  if (buf_error_flag_set) {
-    status_callback_.Run(
-        felicia::errors::Unavailable("V4l2 Error flag was set."));
-  } else if (camera_format_.pixel_format() != PixelFormat::PIXEL_FORMAT_MJPEG &&
-             buffer.bytesused != camera_format_.AllocationSize()) {
-    buffer.bytesused = 0;
-    status_callback_.Run(errors::InvalidNumberOfBytesInBuffer());
+  Status s = GetBufferStatus(buffer);
+  if (!s.ok()) {
+    status_callback_.Run(s);
   } else {
     CameraBuffer& camera_buffer = buffers_[buffer.index];
     camera_buffer.set_payload(buffer.bytesused);
-    base::TimeDelta timestamp = timestamper_.timestamp();
-    if (requested_pixel_format_ == camera_format_.pixel_format()) {
-      Data data(camera_buffer.start(), camera_buffer.payload());
-      camera_frame_callback_.Run(
-          CameraFrame{std::move(data), camera_format_, timestamp});
-    } else {
-      base::Optional<CameraFrame> camera_frame = ConvertToRequestedPixelFormat(
-          camera_buffer.start(), camera_buffer.payload(), camera_format_,
-          requested_pixel_format_, timestamp);
-      if (camera_frame.has_value()) {
-        camera_frame_callback_.Run(std::move(camera_frame.value()));
-      } else {
-        status_callback_.Run(errors::FailedToConvertToRequestedPixelFormat(
-            requested_pixel_format_));
-      }
-    }
+    // The frame is copied here and converted on the pipeline, so that the
+    // buffer goes back to the driver without waiting for the conversion and
+    // the callback.
+    pipeline_->Push(camera_buffer.start(), camera_buffer.payload(),
+                    timestamper_.timestamp(), dequeued);
   }
 
   if (DoIoctl(fd_.get(), VIDIOC_QBUF, &buffer) < 0) {
@@ -632,6 +719,53 @@ void V4l2Camera::DoCapture() {
       FROM_HERE, base::BindOnce(&V4l2Camera::DoCapture, AsWeakPtr()));
 }
 
+void V4l2Camera::DoCaptureToSlot() {
+  DCHECK(thread_.task_runner()->BelongsToCurrentThread());
+  v4l2_buffer buffer;
+  FillV4L2Buffer(&buffer, 0, V4L2_MEMORY_USERPTR);
+  if (DoIoctl(fd_.get(), VIDIOC_DQBUF, &buffer) < 0) {
+    status_callback_.Run(felicia::errors::Unavailable(
+        "Failed to dequeue V4L2 buffer from the driver."));
+    return;
+  }
+
+  // The driver has written the frame right into the slot, so it only needs
+  // to be committed for the readers. A slot with a broken frame is queued
+  // again as it is.
+  int slot = queued_slots_[buffer.index];
+  Status s = GetBufferStatus(buffer);
+  if (!s.ok()) {
+    status_callback_.Run(s);
+  } else {
+    slot_buffer_->CommitSlot(slot, buffer.bytesused, timestamper_.timestamp());
+    slot = slot_buffer_->AcquireSlot();
+  }
+
+  s = EnqueueSlot(buffer.index, slot);
+  if (!s.ok()) {
+    status_callback_.Run(s);
+    return;
+  }
+
+  thread_.task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&V4l2Camera::DoCaptureToSlot, AsWeakPtr()));
+}
+
+Status V4l2Camera::GetBufferStatus(const v4l2_buffer& buffer) const {
+#ifdef V4L2_BUF_FLAG_ERROR
+  bool buf_error_flag_set = buffer.flags & V4L2_BUF_FLAG_ERROR;
+#else
+  bool buf_error_flag_set = false;
+#endif
+  if (buf_error_flag_set) {
+    return felicia::errors::Unavailable("V4l2 Error flag was set.");
+  } else if (camera_format_.pixel_format() != PixelFormat::PIXEL_FORMAT_MJPEG &&
+             buffer.bytesused != camera_format_.AllocationSize()) {
+    return errors::InvalidNumberOfBytesInBuffer();
+  }
+  return Status::OK();
+}
+
 namespace {
 
 CameraSettingsMode ValueToMode(int control_id, int64_t value) {
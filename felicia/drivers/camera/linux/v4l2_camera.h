@@ -18,6 +18,7 @@
 
 #include "felicia/core/util/timestamp/timestamper.h"
 #include "felicia/drivers/camera/camera_buffer.h"
+#include "felicia/drivers/camera/camera_frame_pipeline.h"
 #include "felicia/drivers/camera/camera_interface.h"
 
 namespace felicia {
@@ -38,6 +39,11 @@ class V4l2Camera : public CameraInterface,
   Status Start(const CameraFormat& requested_camera_format,
                CameraFrameCallback camera_frame_callback,
                StatusCallback status_callback) override;
+  // Captures with V4L2_MEMORY_USERPTR, where the driver writes the frames
+  // right into the slots.
+  Status StartWithSharedSlotBuffer(const CameraFormat& requested_camera_format,
+                                   WritableSharedSlotBuffer* slot_buffer,
+                                   StatusCallback status_callback) override;
   Status Stop() override;
 
   Status SetCameraSettings(const CameraSettings& camera_settings) override;
@@ -51,9 +57,15 @@ class V4l2Camera : public CameraInterface,
 
   Status InitMmap();
   Status ClearMmap();
+  Status InitUserPtr(WritableSharedSlotBuffer* slot_buffer);
+  // Queues the buffer at |index| to write to the slot of |slot_buffer_|.
+  Status EnqueueSlot(size_t index, int slot);
   Status SetCameraFormat(const CameraFormat& camera_format);
   void DoStop(base::WaitableEvent* event, Status* status);
   void DoCapture();
+  void DoCaptureToSlot();
+  // Returns an error if |buffer| dequeued from the driver is broken.
+  Status GetBufferStatus(const v4l2_buffer& buffer) const;
 
   void GetCameraSetting(int control_id, CameraSettingsModeValue* value);
   void GetCameraSetting(int control_id, CameraSettingsRangedValue* value);
@@ -68,7 +80,15 @@ class V4l2Camera : public CameraInterface,
 
   base::ScopedFD fd_;
 
+  v4l2_memory memory_ = V4L2_MEMORY_MMAP;
   std::vector<CameraBuffer> buffers_;
+  // Not owned. Set while it captures into the shared memory, and the slot
+  // each buffer is queued with is kept in |queued_slots_|.
+  WritableSharedSlotBuffer* slot_buffer_ = nullptr;
+  std::vector<int> queued_slots_;
+  // Converts and delivers the frames off |thread_|, so that the buffers are
+  // requeued as soon as they are copied.
+  std::unique_ptr<CameraFramePipeline> pipeline_;
   base::Thread thread_;
 
   Timestamper timestamper_;
@@ -7,25 +7,34 @@
 #include "third_party/chromium/base/memory/ptr_util.h"
 
 #include "felicia/drivers/camera/mac/avf_camera.h"
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
 
 namespace felicia {
 namespace drivers {
 
 // static
 std::unique_ptr<CameraInterface> CameraFactory::NewCamera(const CameraDescriptor& descriptor) {
+  if (SyntheticCamera::IsSyntheticCameraDescriptor(descriptor)) {
+    return base::WrapUnique(new SyntheticCamera(descriptor));
+  }
   return base::WrapUnique(new AvfCamera(descriptor));
 }
 
 // static
 Status CameraFactory::GetCameraDescriptors(CameraDescriptors* camera_descriptors) {
   DCHECK(camera_descriptors->empty());
-  return AvfCamera::GetCameraDescriptors(camera_descriptors);
+  Status s = AvfCamera::GetCameraDescriptors(camera_descriptors);
+  if (!s.ok()) return s;
+  return SyntheticCamera::GetCameraDescriptors(camera_descriptors);
 }
 
 // static
 Status CameraFactory::GetSupportedCameraFormats(const CameraDescriptor& camera_descriptor,
                                                 CameraFormats* camera_formats) {
   DCHECK(camera_formats->empty());
+  if (SyntheticCamera::IsSyntheticCameraDescriptor(camera_descriptor)) {
+    return SyntheticCamera::GetSupportedCameraFormats(camera_descriptor, camera_formats);
+  }
   return AvfCamera::GetSupportedCameraFormats(camera_descriptor, camera_formats);
 }
 
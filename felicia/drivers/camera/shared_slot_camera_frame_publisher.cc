@@ -0,0 +1,162 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/shared_slot_camera_frame_publisher.h"
+
+#include "third_party/chromium/base/bind.h"
+
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/core/master/master_proxy.h"
+#include "felicia/core/thread/main_thread.h"
+#include "felicia/drivers/camera/camera_frame_message.pb.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+template <typename RequestTy, typename ResponseTy>
+void OnTopicAsync(const RequestTy* request, const ResponseTy* response,
+                  StatusOnceCallback callback, Status s) {
+  internal::LogOrCallback(std::move(callback), s);
+}
+
+}  // namespace
+
+constexpr const char* SharedSlotCameraFramePublisher::kTypeName;
+constexpr size_t SharedSlotCameraFramePublisher::kDefaultSlotCount;
+
+SharedSlotCameraFramePublisher::SharedSlotCameraFramePublisher(
+    size_t slot_count)
+    : slot_count_(slot_count) {}
+
+SharedSlotCameraFramePublisher::~SharedSlotCameraFramePublisher() {
+  if (camera_) Stop();
+}
+
+Status SharedSlotCameraFramePublisher::Start(
+    CameraInterface* camera, const CameraFormat& requested_camera_format,
+    StatusCallback status_callback) {
+  DCHECK(camera);
+  if (camera_) {
+    return felicia::errors::FailedPrecondition("Camera is already started.");
+  }
+
+  auto slot_buffer = std::make_unique<WritableSharedSlotBuffer>(
+      slot_count_, requested_camera_format.AllocationSize());
+  Status s = camera->StartWithSharedSlotBuffer(
+      requested_camera_format, slot_buffer.get(), status_callback);
+  if (!s.ok()) return s;
+
+  camera_ = camera;
+  slot_buffer_ = std::move(slot_buffer);
+  broker_ = std::make_unique<PlatformHandleBroker>();
+  StatusOr<ChannelDef> status_or = broker_->Setup(base::BindRepeating(
+      &SharedSlotCameraFramePublisher::FillData, base::Unretained(this)));
+  if (!status_or.ok()) {
+    Stop();
+    return status_or.status();
+  }
+  channel_def_ = status_or.ValueOrDie();
+
+  return Status::OK();
+}
+
+Status SharedSlotCameraFramePublisher::Stop() {
+  if (!camera_) {
+    return felicia::errors::FailedPrecondition("Camera is not started.");
+  }
+
+  Status s = camera_->Stop();
+  camera_ = nullptr;
+  // The broker hands out the slots, so it goes first.
+  broker_.reset();
+  slot_buffer_.reset();
+  return s;
+}
+
+void SharedSlotCameraFramePublisher::RequestPublish(
+    const NodeInfo& node_info, const std::string& topic,
+    StatusOnceCallback callback) {
+  MainThread& main_thread = MainThread::GetInstance();
+  if (!main_thread.IsBoundToCurrentThread()) {
+    main_thread.PostTask(
+        FROM_HERE,
+        base::BindOnce(&SharedSlotCameraFramePublisher::RequestPublish,
+                       base::Unretained(this), node_info, topic,
+                       std::move(callback)));
+    return;
+  }
+
+  if (!camera_) {
+    internal::LogOrCallback(
+        std::move(callback),
+        felicia::errors::FailedPrecondition("Camera is not started."));
+    return;
+  }
+
+  PublishTopicRequest* request = new PublishTopicRequest();
+  *request->mutable_node_info() = node_info;
+  TopicInfo* topic_info = request->mutable_topic_info();
+  topic_info->set_topic(topic);
+  topic_info->set_type_name(kTypeName);
+  *topic_info->mutable_topic_source()->add_channel_defs() = channel_def_;
+  PublishTopicResponse* response = new PublishTopicResponse();
+
+  MasterProxy& master_proxy = MasterProxy::GetInstance();
+  master_proxy.PublishTopicAsync(
+      request, response,
+      base::BindOnce(&OnTopicAsync<PublishTopicRequest, PublishTopicResponse>,
+                     base::Owned(request), base::Owned(response),
+                     std::move(callback)));
+}
+
+void SharedSlotCameraFramePublisher::RequestUnpublish(
+    const NodeInfo& node_info, const std::string& topic,
+    StatusOnceCallback callback) {
+  MainThread& main_thread = MainThread::GetInstance();
+  if (!main_thread.IsBoundToCurrentThread()) {
+    main_thread.PostTask(
+        FROM_HERE,
+        base::BindOnce(&SharedSlotCameraFramePublisher::RequestUnpublish,
+                       base::Unretained(this), node_info, topic,
+                       std::move(callback)));
+    return;
+  }
+
+  UnpublishTopicRequest* request = new UnpublishTopicRequest();
+  *request->mutable_node_info() = node_info;
+  request->set_topic(topic);
+  UnpublishTopicResponse* response = new UnpublishTopicResponse();
+
+  MasterProxy& master_proxy = MasterProxy::GetInstance();
+  master_proxy.UnpublishTopicAsync(
+      request, response,
+      base::BindOnce(
+          &OnTopicAsync<UnpublishTopicRequest, UnpublishTopicResponse>,
+          base::Owned(request), base::Owned(response), std::move(callback)));
+}
+
+void SharedSlotCameraFramePublisher::FillData(
+    PlatformHandleBroker::Data* data) {
+  SharedSlotCameraFrameSourceMessage message;
+  *message.mutable_shm_endpoint() = slot_buffer_->ToShmEndPoint();
+  *message.mutable_camera_format() =
+      camera_->camera_format().ToCameraFormatMessage();
+  data->data = message.SerializeAsString();
+  const ShmPlatformHandle& platform_handle =
+      message.shm_endpoint().platform_handle();
+#if defined(OS_MACOSX) && !defined(OS_IOS)
+  data->platform_handle =
+      static_cast<mach_port_t>(platform_handle.mach_port());
+#elif defined(OS_WIN)
+#else
+  const FDPair& fd_pair = platform_handle.fd_pair();
+  data->platform_handle.fd = fd_pair.fd();
+  data->platform_handle.readonly_fd = fd_pair.readonly_fd();
+#endif
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_PUBLISHER_H_
+#define FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_PUBLISHER_H_
+
+#include <memory>
+#include <string>
+
+#include "third_party/chromium/base/macros.h"
+
+#include "felicia/core/channel/shared_memory/platform_handle_broker.h"
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/protobuf/master_data.pb.h"
+#include "felicia/drivers/camera/camera_interface.h"
+
+namespace felicia {
+namespace drivers {
+
+// SharedSlotCameraFramePublisher publishes the frames of a camera to the
+// SharedSlotCameraFrameSubscribers on the same host with no copy. The camera
+// captures the frames right into the slots of a WritableSharedSlotBuffer,
+// whose handle is handed to the subscribers by a PlatformHandleBroker, and
+// the subscribers read the frames in place.
+//
+// Unlike CameraFramePublisher, the frames never reach the calling thread, so
+// they are published in the format the camera captures, and the subscribers
+// read the latest frame instead of receiving every frame. The topic is
+// published with a ChannelDef of CHANNEL_TYPE_SHM, whose broker endpoint the
+// subscribers connect to. It should be used on the thread with an IO message
+// loop, e.g, the MainThread.
+class FEL_EXPORT SharedSlotCameraFramePublisher {
+ public:
+  static constexpr const char* kTypeName =
+      "felicia.drivers.SharedSlotCameraFrame";
+  // The camera holds some of the slots at a time, e.g, V4l2Camera holds 4,
+  // and the rest are for the subscribers.
+  static constexpr size_t kDefaultSlotCount = 8;
+
+  explicit SharedSlotCameraFramePublisher(
+      size_t slot_count = kDefaultSlotCount);
+  ~SharedSlotCameraFramePublisher();
+
+  // Starts |camera|, which should be initialized, to capture into the slots,
+  // each of which is as large as a frame in |requested_camera_format|.
+  // Returns errors::Unimplemented() if |camera| doesn't support
+  // CameraInterface::StartWithSharedSlotBuffer().
+  Status Start(CameraInterface* camera,
+               const CameraFormat& requested_camera_format,
+               StatusCallback status_callback);
+  // Stops the camera. The subscribers keep the shared memory mapped, but
+  // no more frames are written.
+  Status Stop();
+
+  bool IsStarted() const { return !!camera_; }
+
+  // The channel the subscribers connect to, which is valid after Start().
+  const ChannelDef& channel_def() const { return channel_def_; }
+
+  // Publishes the topic, whose type name is kTypeName. It should be called
+  // after Start().
+  void RequestPublish(const NodeInfo& node_info, const std::string& topic,
+                      StatusOnceCallback callback = StatusOnceCallback());
+
+  void RequestUnpublish(const NodeInfo& node_info, const std::string& topic,
+                        StatusOnceCallback callback = StatusOnceCallback());
+
+ private:
+  void FillData(PlatformHandleBroker::Data* data);
+
+  const size_t slot_count_;
+  CameraInterface* camera_ = nullptr;
+  std::unique_ptr<WritableSharedSlotBuffer> slot_buffer_;
+  std::unique_ptr<PlatformHandleBroker> broker_;
+  ChannelDef channel_def_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedSlotCameraFramePublisher);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_PUBLISHER_H_
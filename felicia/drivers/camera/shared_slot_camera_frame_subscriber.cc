@@ -0,0 +1,134 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/shared_slot_camera_frame_subscriber.h"
+
+#include <string.h>
+
+#include "third_party/chromium/base/bind.h"
+
+#include "felicia/core/lib/error/errors.h"
+#include "felicia/drivers/camera/camera_frame_message.pb.h"
+#include "felicia/drivers/camera/shared_slot_camera_frame_publisher.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+// The times to copy a frame again, when it is overwritten while it is
+// copied, before giving up.
+constexpr int kMaxReadRetries = 3;
+
+}  // namespace
+
+SharedSlotCameraFrameSubscriber::SharedSlotCameraFrameSubscriber() = default;
+
+SharedSlotCameraFrameSubscriber::~SharedSlotCameraFrameSubscriber() = default;
+
+void SharedSlotCameraFrameSubscriber::Connect(const TopicInfo& topic_info,
+                                              StatusOnceCallback callback) {
+  DCHECK(!slot_buffer_);
+  DCHECK(!callback.is_null());
+
+  if (topic_info.type_name() != SharedSlotCameraFramePublisher::kTypeName) {
+    std::move(callback).Run(felicia::errors::InvalidArgument(
+        "The topic isn't published by SharedSlotCameraFramePublisher."));
+    return;
+  }
+
+  for (const ChannelDef& channel_def :
+       topic_info.topic_source().channel_defs()) {
+    if (channel_def.type() != ChannelDef::CHANNEL_TYPE_SHM) continue;
+    broker_.WaitForBroker(
+        channel_def,
+        base::BindOnce(&SharedSlotCameraFrameSubscriber::OnReceiveData,
+                       base::Unretained(this), std::move(callback)));
+    return;
+  }
+
+  std::move(callback).Run(
+      felicia::errors::NotFound("The topic has no shared memory channel."));
+}
+
+bool SharedSlotCameraFrameSubscriber::ReadLatest(
+    ReadOnlySharedSlotBuffer::Slot* slot) {
+  DCHECK(slot_buffer_);
+  if (!slot_buffer_->ReadLatest(last_sequence_, slot)) return false;
+  last_sequence_ = slot->sequence;
+  return true;
+}
+
+bool SharedSlotCameraFrameSubscriber::ReadRetry(
+    const ReadOnlySharedSlotBuffer::Slot& slot) const {
+  DCHECK(slot_buffer_);
+  return slot_buffer_->ReadRetry(slot);
+}
+
+bool SharedSlotCameraFrameSubscriber::ReadLatestFrame(
+    CameraFrame* camera_frame) {
+  DCHECK(camera_frame);
+  for (int i = 0; i <= kMaxReadRetries; ++i) {
+    ReadOnlySharedSlotBuffer::Slot slot;
+    if (!ReadLatest(&slot)) return false;
+
+    Data data;
+    data.resize(slot.length);
+    memcpy(data.cast<char*>(), slot.data, slot.length);
+    // A newer frame has been written over it, so read that one instead.
+    if (ReadRetry(slot)) continue;
+
+    *camera_frame =
+        CameraFrame(std::move(data), camera_format_, slot.timestamp);
+    return true;
+  }
+  return false;
+}
+
+void SharedSlotCameraFrameSubscriber::OnReceiveData(
+    StatusOnceCallback callback,
+    StatusOr<PlatformHandleBroker::Data> status_or) {
+  if (!status_or.ok()) {
+    std::move(callback).Run(status_or.status());
+    return;
+  }
+
+  PlatformHandleBroker::Data data = status_or.ValueOrDie();
+  SharedSlotCameraFrameSourceMessage message;
+  if (!message.ParseFromString(data.data)) {
+    std::move(callback).Run(
+        felicia::errors::Unavailable("Failed to ParseFromString"));
+    return;
+  }
+
+  ShmPlatformHandle* platform_handle =
+      message.mutable_shm_endpoint()->mutable_platform_handle();
+#if defined(OS_MACOSX) && !defined(OS_IOS)
+  platform_handle->set_mach_port(static_cast<uint64_t>(data.platform_handle));
+#elif defined(OS_WIN)
+#else
+  platform_handle->mutable_fd_pair()->set_fd(data.platform_handle.fd);
+  platform_handle->mutable_fd_pair()->set_readonly_fd(
+      data.platform_handle.readonly_fd);
+#endif
+
+  Status s = camera_format_.FromCameraFormatMessage(message.camera_format());
+  if (!s.ok()) {
+    std::move(callback).Run(s);
+    return;
+  }
+
+  auto slot_buffer =
+      std::make_unique<ReadOnlySharedSlotBuffer>(message.shm_endpoint());
+  if (!slot_buffer->IsValid()) {
+    std::move(callback).Run(
+        felicia::errors::Unavailable("Failed to map the slot buffer."));
+    return;
+  }
+  slot_buffer_ = std::move(slot_buffer);
+  std::move(callback).Run(Status::OK());
+}
+
+}  // namespace drivers
+}  // namespace felicia
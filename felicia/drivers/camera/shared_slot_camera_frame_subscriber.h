@@ -0,0 +1,66 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_SUBSCRIBER_H_
+#define FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_SUBSCRIBER_H_
+
+#include <memory>
+
+#include "third_party/chromium/base/macros.h"
+
+#include "felicia/core/channel/shared_memory/platform_handle_broker.h"
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/protobuf/master_data.pb.h"
+#include "felicia/drivers/camera/camera_frame.h"
+
+namespace felicia {
+namespace drivers {
+
+// SharedSlotCameraFrameSubscriber maps the slots of a
+// SharedSlotCameraFramePublisher read-only, and reads the latest frame in
+// place, or copies it out as a CameraFrame. Connect() should be called on
+// the thread with an IO message loop, e.g, the MainThread, and the frames
+// can be read on any single thread once it is connected.
+class FEL_EXPORT SharedSlotCameraFrameSubscriber {
+ public:
+  SharedSlotCameraFrameSubscriber();
+  ~SharedSlotCameraFrameSubscriber();
+
+  // Connects to the publisher of |topic_info|, which should be published by
+  // a SharedSlotCameraFramePublisher on the same host.
+  void Connect(const TopicInfo& topic_info, StatusOnceCallback callback);
+
+  bool IsConnected() const { return !!slot_buffer_; }
+
+  // The format of the frames, which is valid once it is connected.
+  const CameraFormat& camera_format() const { return camera_format_; }
+
+  // Finds the latest frame written after the one read last, and returns false
+  // if there is none. |slot| points to the shared memory, which can be
+  // overwritten while it is read, so check ReadRetry() after reading it.
+  bool ReadLatest(ReadOnlySharedSlotBuffer::Slot* slot);
+  bool ReadRetry(const ReadOnlySharedSlotBuffer::Slot& slot) const;
+
+  // Copies the latest frame written after the one read last into
+  // |camera_frame|, and returns false if there is none.
+  bool ReadLatestFrame(CameraFrame* camera_frame);
+
+ private:
+  void OnReceiveData(StatusOnceCallback callback,
+                     StatusOr<PlatformHandleBroker::Data> status_or);
+
+  PlatformHandleBroker broker_;
+  std::unique_ptr<ReadOnlySharedSlotBuffer> slot_buffer_;
+  CameraFormat camera_format_;
+  int64_t last_sequence_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedSlotCameraFrameSubscriber);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_SHARED_SLOT_CAMERA_FRAME_SUBSCRIBER_H_
@@ -0,0 +1,150 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+#include "third_party/chromium/base/threading/platform_thread.h"
+#include "third_party/chromium/base/threading/thread.h"
+
+#include "felicia/drivers/camera/camera_factory.h"
+#include "felicia/drivers/camera/shared_slot_camera_frame_publisher.h"
+#include "felicia/drivers/camera/shared_slot_camera_frame_subscriber.h"
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr float kFrameRate = 100;
+
+// The first of the color bars in PIXEL_FORMAT_BGRA.
+constexpr uint32_t kFirstColor = 0xFFBFBFBF;
+
+void StartPublisher(SharedSlotCameraFramePublisher* publisher,
+                    CameraInterface* camera, Status* status,
+                    base::WaitableEvent* event) {
+  *status = publisher->Start(
+      camera, CameraFormat(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate),
+      StatusCallback());
+  event->Signal();
+}
+
+void StopPublisher(SharedSlotCameraFramePublisher* publisher,
+                   base::WaitableEvent* event) {
+  EXPECT_TRUE(publisher->Stop().ok());
+  event->Signal();
+}
+
+void OnConnect(Status* status, base::WaitableEvent* event, Status s) {
+  *status = s;
+  event->Signal();
+}
+
+void Connect(SharedSlotCameraFrameSubscriber* subscriber,
+             const TopicInfo& topic_info, Status* status,
+             base::WaitableEvent* event) {
+  subscriber->Connect(topic_info, base::BindOnce(&OnConnect, status, event));
+}
+
+}  // namespace
+
+// The subscriber reads the frames the synthetic camera writes into the slots,
+// as a subscriber in another process would. It connects on its own thread,
+// since it blocks until the broker of the publisher answers.
+TEST(SharedSlotCameraFrameTest, PublishAndRead) {
+  base::Thread io_thread("SharedSlotCameraFrameIOThread");
+  io_thread.StartWithOptions(
+      base::Thread::Options{base::MessageLoop::TYPE_IO, 0});
+  base::Thread subscriber_thread("SharedSlotCameraFrameSubscriberThread");
+  subscriber_thread.StartWithOptions(
+      base::Thread::Options{base::MessageLoop::TYPE_IO, 0});
+
+  std::unique_ptr<CameraInterface> camera = CameraFactory::NewCamera(
+      SyntheticCamera::NewCameraDescriptor(SyntheticCamera::kPatternSource));
+  ASSERT_TRUE(camera->Init().ok());
+
+  SharedSlotCameraFramePublisher publisher;
+  Status s;
+  {
+    base::WaitableEvent event;
+    io_thread.task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&StartPublisher, &publisher, camera.get(),
+                                  &s, &event));
+    event.Wait();
+  }
+  ASSERT_TRUE(s.ok()) << s;
+
+  TopicInfo topic_info;
+  topic_info.set_topic("camera");
+  topic_info.set_type_name(SharedSlotCameraFramePublisher::kTypeName);
+  *topic_info.mutable_topic_source()->add_channel_defs() =
+      publisher.channel_def();
+
+  auto* subscriber = new SharedSlotCameraFrameSubscriber();
+  {
+    base::WaitableEvent event;
+    subscriber_thread.task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&Connect, subscriber, topic_info, &s, &event));
+    event.Wait();
+  }
+  ASSERT_TRUE(s.ok()) << s;
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+  EXPECT_TRUE(camera_format == subscriber->camera_format());
+
+  // Reads the frames in place. The first frame can be at 0.
+  base::TimeDelta last_timestamp = base::TimeDelta::Min();
+  for (int frames = 0; frames < 3;) {
+    ReadOnlySharedSlotBuffer::Slot slot;
+    if (!subscriber->ReadLatest(&slot)) {
+      base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+      continue;
+    }
+    ASSERT_EQ(camera_format.AllocationSize(), slot.length);
+    uint32_t first_pixel = *reinterpret_cast<const uint32_t*>(slot.data);
+    if (subscriber->ReadRetry(slot)) continue;
+    EXPECT_EQ(kFirstColor, first_pixel);
+    EXPECT_GT(slot.timestamp, last_timestamp);
+    last_timestamp = slot.timestamp;
+    frames++;
+  }
+
+  // Copies a frame out.
+  CameraFrame camera_frame;
+  while (!subscriber->ReadLatestFrame(&camera_frame)) {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+  }
+  EXPECT_TRUE(camera_format == camera_frame.camera_format());
+  EXPECT_GT(camera_frame.timestamp(), last_timestamp);
+  EXPECT_EQ(kFirstColor, camera_frame.data().cast<const uint32_t*>()[0]);
+
+  // The broker of the subscriber lives on |subscriber_thread|.
+  subscriber_thread.task_runner()->DeleteSoon(FROM_HERE, subscriber);
+  subscriber_thread.Stop();
+  {
+    base::WaitableEvent event;
+    io_thread.task_runner()->PostTask(
+        FROM_HERE, base::BindOnce(&StopPublisher, &publisher, &event));
+    event.Wait();
+  }
+}
+
+TEST(SharedSlotCameraFrameTest, ConnectToOtherTopic) {
+  SharedSlotCameraFrameSubscriber subscriber;
+  TopicInfo topic_info;
+  topic_info.set_type_name("felicia.drivers.CameraFrameMessage");
+  Status s;
+  base::WaitableEvent event;
+  subscriber.Connect(topic_info, base::BindOnce(&OnConnect, &s, &event));
+  EXPECT_TRUE(event.IsSignaled());
+  EXPECT_FALSE(s.ok());
+  EXPECT_FALSE(subscriber.IsConnected());
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -11,6 +11,8 @@
 namespace felicia {
 namespace drivers {
 
+// The left and right frames are delivered by separate callbacks. Use
+// CameraFrameSynchronizer to pair them up by their timestamps.
 class FEL_EXPORT StereoCameraInterface : public CameraInterfaceBase {
  public:
   explicit StereoCameraInterface(const CameraDescriptor& camera_descriptor);
@@ -0,0 +1,392 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "libyuv.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/files/file_enumerator.h"
+#include "third_party/chromium/base/files/file_util.h"
+#include "third_party/chromium/base/stl_util.h"
+#include "third_party/chromium/base/strings/string_util.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+
+#include "felicia/core/channel/shared_memory/shared_slot_buffer.h"
+#include "felicia/core/lib/file/file_util.h"
+#include "felicia/core/lib/image/image.h"
+#include "felicia/core/lib/image/jpeg_codec.h"
+#include "felicia/drivers/camera/camera_errors.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr char kDeviceIdPrefix[] = "synthetic:";
+constexpr char kModelId[] = "synthetic";
+
+constexpr Sizei kSizes[] = {
+    {640, 480},
+    {1280, 720},
+    {1920, 1080},
+    {3840, 2160},
+};
+
+constexpr float kFrameRates[] = {30, 60, 120};
+
+constexpr PixelFormat kPixelFormats[] = {
+    PIXEL_FORMAT_I420, PIXEL_FORMAT_YV12, PIXEL_FORMAT_NV12, PIXEL_FORMAT_NV21,
+    PIXEL_FORMAT_UYVY, PIXEL_FORMAT_YUY2, PIXEL_FORMAT_BGRA, PIXEL_FORMAT_BGR,
+    PIXEL_FORMAT_RGBA, PIXEL_FORMAT_RGB,  PIXEL_FORMAT_ARGB,
+};
+
+bool IsSupportedPixelFormat(PixelFormat pixel_format) {
+  return std::find(std::begin(kPixelFormats), std::end(kPixelFormats),
+                   pixel_format) != std::end(kPixelFormats);
+}
+
+// Draws the 75% color bars of SMPTE in PIXEL_FORMAT_BGRA.
+Image NewColorBars(int width, int height) {
+  constexpr uint32_t kColors[] = {
+      0xFFBFBFBF, 0xFFBFBF00, 0xFF00BFBF, 0xFF00BF00,
+      0xFFBF00BF, 0xFFBF0000, 0xFF0000BF, 0xFF000000,
+  };
+  constexpr int kBars = base::size(kColors);
+
+  Data data;
+  data.resize(width * height * 4);
+  uint32_t* pixels = data.cast<uint32_t*>();
+  for (int x = 0; x < width; ++x) {
+    pixels[x] = kColors[x * kBars / width];
+  }
+  for (int y = 1; y < height; ++y) {
+    memcpy(pixels + y * width, pixels, width * 4);
+  }
+  return Image(Sizei(width, height), PIXEL_FORMAT_BGRA, std::move(data));
+}
+
+// Splits |stream| into the JPEG images between the SOI and the EOI markers.
+std::vector<std::string> SplitMotionJpeg(const std::string& stream) {
+  std::vector<std::string> images;
+  size_t start = stream.find("\xFF\xD8");
+  while (start != std::string::npos) {
+    size_t end = stream.find("\xFF\xD9", start + 2);
+    if (end == std::string::npos) break;
+    images.push_back(stream.substr(start, end + 2 - start));
+    start = stream.find("\xFF\xD8", end + 2);
+  }
+  return images;
+}
+
+bool IsMotionJpegFile(const base::FilePath& path) {
+  return path.MatchesExtension(FILE_PATH_LITERAL(".mjpeg")) ||
+         path.MatchesExtension(FILE_PATH_LITERAL(".mjpg"));
+}
+
+bool IsImageFile(const base::FilePath& path) {
+  return path.MatchesExtension(FILE_PATH_LITERAL(".jpg")) ||
+         path.MatchesExtension(FILE_PATH_LITERAL(".jpeg")) ||
+         path.MatchesExtension(FILE_PATH_LITERAL(".png"));
+}
+
+Status LoadImages(const base::FilePath& path, std::vector<Image>* images) {
+  if (base::DirectoryExists(path)) {
+    std::vector<base::FilePath> image_paths;
+    base::FileEnumerator enumerator(path, false, base::FileEnumerator::FILES);
+    for (base::FilePath image_path = enumerator.Next(); !image_path.empty();
+         image_path = enumerator.Next()) {
+      if (IsImageFile(image_path)) image_paths.push_back(image_path);
+    }
+    std::sort(image_paths.begin(), image_paths.end());
+
+    for (auto& image_path : image_paths) {
+      Image image;
+      Status s = image.Load(image_path, PIXEL_FORMAT_BGRA);
+      if (!s.ok()) return s;
+      images->push_back(std::move(image));
+    }
+  } else if (IsMotionJpegFile(path)) {
+    std::string stream;
+    if (!base::ReadFileToString(path, &stream)) {
+      return felicia::errors::InvalidArgument("Failed to read file.");
+    }
+
+    for (auto& jpeg : SplitMotionJpeg(stream)) {
+      Image image;
+      image.set_pixel_format(PIXEL_FORMAT_BGRA);
+      Status s = JpegCodec::Decode(
+          reinterpret_cast<const unsigned char*>(jpeg.data()), jpeg.length(),
+          &image);
+      if (!s.ok()) return s;
+      images->push_back(std::move(image));
+    }
+  } else {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "%s is neither a directory nor a Motion JPEG file.",
+        path.value().c_str()));
+  }
+
+  if (images->empty()) {
+    return felicia::errors::InvalidArgument(
+        base::StringPrintf("No image is found in %s.", path.value().c_str()));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+constexpr const char* SyntheticCamera::kPatternSource;
+
+SyntheticCamera::SyntheticCamera(const CameraDescriptor& camera_descriptor)
+    : CameraInterface(camera_descriptor), thread_("SyntheticCameraThread") {}
+
+SyntheticCamera::~SyntheticCamera() = default;
+
+// static
+CameraDescriptor SyntheticCamera::NewCameraDescriptor(
+    const std::string& source) {
+  return CameraDescriptor(base::StringPrintf("Synthetic Camera (%s)",
+                                             source.c_str()),
+                          kDeviceIdPrefix + source, kModelId);
+}
+
+// static
+bool SyntheticCamera::IsSyntheticCameraDescriptor(
+    const CameraDescriptor& camera_descriptor) {
+  return base::StartsWith(camera_descriptor.device_id(), kDeviceIdPrefix,
+                          base::CompareCase::SENSITIVE);
+}
+
+// static
+Status SyntheticCamera::GetCameraDescriptors(
+    CameraDescriptors* camera_descriptors) {
+  DCHECK(camera_descriptors);
+  const char* source = getenv("FEL_SYNTHETIC_CAMERA");
+  if (source && source[0] != '\0') {
+    camera_descriptors->push_back(NewCameraDescriptor(source));
+  }
+  return Status::OK();
+}
+
+// static
+Status SyntheticCamera::GetSupportedCameraFormats(
+    const CameraDescriptor& camera_descriptor, CameraFormats* camera_formats) {
+  DCHECK(camera_formats);
+  for (const Sizei& size : kSizes) {
+    for (PixelFormat pixel_format : kPixelFormats) {
+      for (float frame_rate : kFrameRates) {
+        camera_formats->emplace_back(size.width(), size.height(), pixel_format,
+                                     frame_rate);
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status SyntheticCamera::Init() {
+  if (!camera_state_.IsStopped()) {
+    return camera_state_.InvalidStateError();
+  }
+
+  std::string source = this->source();
+  if (source != kPatternSource && !base::PathExists(ToFilePath(source))) {
+    return felicia::errors::NotFound(
+        base::StringPrintf("%s doesn't exist.", source.c_str()));
+  }
+
+  camera_state_.ToInitialized();
+
+  return Status::OK();
+}
+
+Status SyntheticCamera::Start(const CameraFormat& requested_camera_format,
+                              CameraFrameCallback camera_frame_callback,
+                              StatusCallback status_callback) {
+  return DoStart(requested_camera_format, camera_frame_callback, nullptr,
+                 status_callback);
+}
+
+Status SyntheticCamera::StartWithSharedSlotBuffer(
+    const CameraFormat& requested_camera_format,
+    WritableSharedSlotBuffer* slot_buffer, StatusCallback status_callback) {
+  DCHECK(slot_buffer);
+  return DoStart(requested_camera_format, CameraFrameCallback(), slot_buffer,
+                 status_callback);
+}
+
+Status SyntheticCamera::DoStart(const CameraFormat& requested_camera_format,
+                                CameraFrameCallback camera_frame_callback,
+                                WritableSharedSlotBuffer* slot_buffer,
+                                StatusCallback status_callback) {
+  if (!camera_state_.IsInitialized()) {
+    return camera_state_.InvalidStateError();
+  }
+
+  // Any size and frame rate can be made, not only the supported formats.
+  if (requested_camera_format.width() <= 0 ||
+      requested_camera_format.height() <= 0 ||
+      requested_camera_format.frame_rate() <= 0) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "Invalid camera format: %s.",
+        requested_camera_format.ToString().c_str()));
+  }
+  if (!IsSupportedPixelFormat(requested_camera_format.pixel_format())) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "%s isn't supported.",
+        CameraFormat::PixelFormatToString(
+            requested_camera_format.pixel_format())
+            .c_str()));
+  }
+
+  if (slot_buffer &&
+      slot_buffer->slot_size() < requested_camera_format.AllocationSize()) {
+    return felicia::errors::InvalidArgument(base::StringPrintf(
+        "The slot buffer should have slots of at least %zu bytes.",
+        requested_camera_format.AllocationSize()));
+  }
+
+  std::vector<Data> frames;
+  Status s = LoadFrames(requested_camera_format, &frames);
+  if (!s.ok()) return s;
+
+  camera_format_ = requested_camera_format;
+  requested_pixel_format_ = requested_camera_format.pixel_format();
+  frames_ = std::move(frames);
+  data_pool_ = base::MakeRefCounted<DataPool>();
+  frame_count_ = 0;
+  dropped_frames_ = 0;
+
+  thread_.Start();
+  camera_frame_callback_ = camera_frame_callback;
+  slot_buffer_ = slot_buffer;
+  status_callback_ = status_callback;
+  camera_state_.ToStarted();
+
+  start_time_ = base::TimeTicks::Now();
+  start_timestamp_ = timestamper_.timestamp();
+  thread_.task_runner()->PostTask(
+      FROM_HERE, base::BindOnce(&SyntheticCamera::DoCapture, AsWeakPtr()));
+
+  return Status::OK();
+}
+
+Status SyntheticCamera::Stop() {
+  if (!camera_state_.IsStarted()) {
+    return camera_state_.InvalidStateError();
+  }
+
+  if (thread_.IsRunning()) thread_.Stop();
+  // |frame_count_| already counts the dropped frames as it skips them.
+  DVLOG(1) << "Dropped frames: " << dropped_frames_ << " / " << frame_count_;
+
+  frames_.clear();
+  camera_frame_callback_.Reset();
+  slot_buffer_ = nullptr;
+  status_callback_.Reset();
+  camera_state_.ToStopped();
+
+  return Status::OK();
+}
+
+std::string SyntheticCamera::source() const {
+  return camera_descriptor_.device_id().substr(strlen(kDeviceIdPrefix));
+}
+
+Status SyntheticCamera::LoadFrames(const CameraFormat& camera_format,
+                                   std::vector<Data>* frames) const {
+  std::vector<Image> images;
+  std::string source = this->source();
+  if (source == kPatternSource) {
+    images.push_back(
+        NewColorBars(camera_format.width(), camera_format.height()));
+  } else {
+    Status s = LoadImages(ToFilePath(source), &images);
+    if (!s.ok()) return s;
+  }
+
+  int width = camera_format.width();
+  int height = camera_format.height();
+  PixelFormat pixel_format = camera_format.pixel_format();
+  CameraFormat bgra_format(width, height, PIXEL_FORMAT_BGRA,
+                           camera_format.frame_rate());
+  for (auto& image : images) {
+    if (image.width() != width || image.height() != height) {
+      Data scaled;
+      scaled.resize(bgra_format.AllocationSize());
+      libyuv::ARGBScale(image.data().cast<const uint8_t*>(), image.width() * 4,
+                        image.width(), image.height(),
+                        scaled.cast<uint8_t*>(), width * 4, width, height,
+                        libyuv::kFilterBilinear);
+      image = Image(Sizei(width, height), PIXEL_FORMAT_BGRA,
+                    std::move(scaled));
+    }
+
+    if (pixel_format == PIXEL_FORMAT_BGRA) {
+      frames->push_back(std::move(image.data()));
+      continue;
+    }
+
+    Data frame;
+    frame.resize(camera_format.AllocationSize());
+    if (!ConvertToRequestedPixelFormat(
+            image.data().cast<const uint8_t*>(), image.data().size(),
+            bgra_format, pixel_format, frame.cast<uint8_t*>())) {
+      return errors::FailedToConvertToRequestedPixelFormat(pixel_format);
+    }
+    frames->push_back(std::move(frame));
+  }
+
+  return Status::OK();
+}
+
+void SyntheticCamera::DoCapture() {
+  DCHECK(thread_.task_runner()->BelongsToCurrentThread());
+  float frame_rate = camera_format_.frame_rate();
+  base::TimeDelta due =
+      base::TimeDelta::FromSecondsD(frame_count_ / frame_rate);
+
+  const Data& frame = frames_[frame_count_ % frames_.size()];
+  if (slot_buffer_) {
+    // A slot is committed as soon as it is written, so there is always one
+    // to acquire.
+    int slot = slot_buffer_->AcquireSlot();
+    DCHECK_GE(slot, 0);
+    memcpy(slot_buffer_->slot_data(slot), frame.cast<const char*>(),
+           frame.size());
+    slot_buffer_->CommitSlot(slot, frame.size(), start_timestamp_ + due);
+  } else {
+    Data data = data_pool_->Acquire(frame.size());
+    memcpy(data.cast<char*>(), frame.cast<const char*>(), frame.size());
+    CameraFrame camera_frame(std::move(data), camera_format_,
+                             start_timestamp_ + due);
+    camera_frame.set_data_pool(data_pool_);
+    camera_frame_callback_.Run(std::move(camera_frame));
+  }
+
+  // The frames due more than a frame interval ago are dropped.
+  base::TimeDelta now = base::TimeTicks::Now() - start_time_;
+  int64_t next_frame = frame_count_ + 1;
+  int64_t late_frame =
+      static_cast<int64_t>(std::ceil(now.InSecondsF() * frame_rate)) - 1;
+  if (late_frame > next_frame) {
+    dropped_frames_ += late_frame - next_frame;
+    next_frame = late_frame;
+  }
+  frame_count_ = next_frame;
+
+  base::TimeDelta delay =
+      base::TimeDelta::FromSecondsD(next_frame / frame_rate) - now;
+  thread_.task_runner()->PostDelayedTask(
+      FROM_HERE, base::BindOnce(&SyntheticCamera::DoCapture, AsWeakPtr()),
+      std::max(delay, base::TimeDelta()));
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -0,0 +1,105 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_DRIVERS_CAMERA_SYNTHETIC_SYNTHETIC_CAMERA_H_
+#define FELICIA_DRIVERS_CAMERA_SYNTHETIC_SYNTHETIC_CAMERA_H_
+
+#include <string>
+#include <vector>
+
+#include "third_party/chromium/base/memory/weak_ptr.h"
+#include "third_party/chromium/base/threading/thread.h"
+#include "third_party/chromium/base/time/time.h"
+
+#include "felicia/core/lib/containers/data_pool.h"
+#include "felicia/core/util/timestamp/timestamper.h"
+#include "felicia/drivers/camera/camera_interface.h"
+
+namespace felicia {
+namespace drivers {
+
+// SyntheticCamera generates the frames at the requested CameraFormat and
+// frame rate without a device, e.g, to load test the pipeline on machines
+// without cameras. The frames are made from the source given to
+// NewCameraDescriptor(), converted to the requested format once at Start(),
+// and delivered in turn.
+//
+// Like a device, the frames carry the time they are due from the start, and
+// the frames which are due while |camera_frame_callback_| is running for
+// more than a frame interval are dropped, so the frame rate is kept.
+// StartWithSharedSlotBuffer() writes the frames into the slots at the same
+// cadence, as a driver does.
+class FEL_EXPORT SyntheticCamera
+    : public CameraInterface,
+      public base::SupportsWeakPtr<SyntheticCamera> {
+ public:
+  // Color bars.
+  static constexpr const char* kPatternSource = "pattern";
+
+  ~SyntheticCamera() override;
+
+  // Returns the descriptor of the synthetic camera of |source|, which is
+  // kPatternSource, a directory of .jpg or .png images, or a Motion JPEG
+  // file(.mjpeg or .mjpg), which is a sequence of JPEG images.
+  static CameraDescriptor NewCameraDescriptor(const std::string& source);
+  static bool IsSyntheticCameraDescriptor(
+      const CameraDescriptor& camera_descriptor);
+
+  // Needed by CameraFactory
+  // Appends the descriptor of FEL_SYNTHETIC_CAMERA if it is set.
+  static Status GetCameraDescriptors(CameraDescriptors* camera_descriptors);
+  static Status GetSupportedCameraFormats(
+      const CameraDescriptor& camera_descriptor, CameraFormats* camera_formats);
+
+  // CameraInterface methods
+  Status Init() override;
+  Status Start(const CameraFormat& requested_camera_format,
+               CameraFrameCallback camera_frame_callback,
+               StatusCallback status_callback) override;
+  Status StartWithSharedSlotBuffer(const CameraFormat& requested_camera_format,
+                                   WritableSharedSlotBuffer* slot_buffer,
+                                   StatusCallback status_callback) override;
+  Status Stop() override;
+
+  size_t dropped_frames() const { return dropped_frames_; }
+
+ private:
+  friend class CameraFactory;
+
+  explicit SyntheticCamera(const CameraDescriptor& camera_descriptor);
+
+  std::string source() const;
+
+  // Loads the frames in |requested_camera_format| and starts to deliver them
+  // to either |camera_frame_callback| or |slot_buffer|.
+  Status DoStart(const CameraFormat& requested_camera_format,
+                 CameraFrameCallback camera_frame_callback,
+                 WritableSharedSlotBuffer* slot_buffer,
+                 StatusCallback status_callback);
+
+  // Fills |frames| with the frames of the source in |camera_format|.
+  Status LoadFrames(const CameraFormat& camera_format,
+                    std::vector<Data>* frames) const;
+
+  void DoCapture();
+
+  // The frames to deliver in turn.
+  std::vector<Data> frames_;
+  scoped_refptr<DataPool> data_pool_;
+  WritableSharedSlotBuffer* slot_buffer_ = nullptr;
+  base::Thread thread_;
+
+  Timestamper timestamper_;
+  base::TimeTicks start_time_;
+  base::TimeDelta start_timestamp_;
+  int64_t frame_count_ = 0;
+  size_t dropped_frames_ = 0;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SyntheticCamera);
+};
+
+}  // namespace drivers
+}  // namespace felicia
+
+#endif  // FELICIA_DRIVERS_CAMERA_SYNTHETIC_SYNTHETIC_CAMERA_H_
@@ -0,0 +1,199 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
+
+#include <stdlib.h>
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/files/scoped_temp_dir.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+#include "third_party/chromium/base/threading/platform_thread.h"
+
+#include "felicia/drivers/camera/camera_factory.h"
+
+namespace felicia {
+namespace drivers {
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+
+// Records the timestamps of the frames, sleeping for |slow_frame_delay| in
+// the first |slow_frames| of them, and wakes up Wait() after |frame_count|
+// frames.
+class FrameRecorder {
+ public:
+  FrameRecorder(size_t frame_count, size_t slow_frames,
+                base::TimeDelta slow_frame_delay)
+      : frame_count_(frame_count),
+        slow_frames_(slow_frames),
+        slow_frame_delay_(slow_frame_delay) {}
+
+  CameraFrameCallback GetCallback() {
+    return base::BindRepeating(&FrameRecorder::OnCameraFrame,
+                               base::Unretained(this));
+  }
+
+  // Read them after the camera is stopped.
+  const std::vector<base::TimeDelta>& timestamps() const {
+    return timestamps_;
+  }
+
+  void Wait() { event_.Wait(); }
+
+ private:
+  void OnCameraFrame(CameraFrame&& camera_frame) {
+    timestamps_.push_back(camera_frame.timestamp());
+    if (timestamps_.size() <= slow_frames_) {
+      base::PlatformThread::Sleep(slow_frame_delay_);
+    }
+    if (timestamps_.size() == frame_count_) event_.Signal();
+  }
+
+  const size_t frame_count_;
+  const size_t slow_frames_;
+  const base::TimeDelta slow_frame_delay_;
+  std::vector<base::TimeDelta> timestamps_;
+  base::WaitableEvent event_;
+};
+
+std::unique_ptr<CameraInterface> NewPatternCamera() {
+  return CameraFactory::NewCamera(
+      SyntheticCamera::NewCameraDescriptor(SyntheticCamera::kPatternSource));
+}
+
+}  // namespace
+
+TEST(SyntheticCameraTest, SelectedByFactory) {
+  setenv("FEL_SYNTHETIC_CAMERA", SyntheticCamera::kPatternSource, 1);
+  CameraDescriptors camera_descriptors;
+  ASSERT_TRUE(SyntheticCamera::GetCameraDescriptors(&camera_descriptors).ok());
+  ASSERT_EQ(1u, camera_descriptors.size());
+  const CameraDescriptor& camera_descriptor = camera_descriptors[0];
+  EXPECT_TRUE(SyntheticCamera::IsSyntheticCameraDescriptor(camera_descriptor));
+
+  std::unique_ptr<CameraInterface> camera =
+      CameraFactory::NewCamera(camera_descriptor);
+  EXPECT_TRUE(dynamic_cast<SyntheticCamera*>(camera.get()));
+  EXPECT_TRUE(camera->Init().ok());
+
+  CameraFormats camera_formats;
+  ASSERT_TRUE(CameraFactory::GetSupportedCameraFormats(camera_descriptor,
+                                                       &camera_formats)
+                  .ok());
+  EXPECT_FALSE(camera_formats.empty());
+
+  unsetenv("FEL_SYNTHETIC_CAMERA");
+  camera_descriptors.clear();
+  ASSERT_TRUE(SyntheticCamera::GetCameraDescriptors(&camera_descriptors).ok());
+  EXPECT_TRUE(camera_descriptors.empty());
+
+  EXPECT_FALSE(SyntheticCamera::IsSyntheticCameraDescriptor(
+      CameraDescriptor("Camera", "/dev/video0", "model")));
+}
+
+TEST(SyntheticCameraTest, KeepFrameRate) {
+  constexpr float kFrameRate = 30;
+  constexpr size_t kFrameCount = 10;
+  std::unique_ptr<CameraInterface> camera = NewPatternCamera();
+  ASSERT_TRUE(camera->Init().ok());
+
+  FrameRecorder recorder(kFrameCount, 0, base::TimeDelta());
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+  base::TimeTicks start_time = base::TimeTicks::Now();
+  ASSERT_TRUE(
+      camera->Start(camera_format, recorder.GetCallback(), StatusCallback())
+          .ok());
+  recorder.Wait();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+  ASSERT_TRUE(camera->Stop().ok());
+
+  // The frames are delivered as they are due, not as fast as they are made.
+  base::TimeDelta interval = base::TimeDelta::FromSecondsD(1 / kFrameRate);
+  EXPECT_GE(elapsed, interval * (kFrameCount - 1));
+
+  // Unless they are dropped, the frames are a frame interval apart.
+  auto* synthetic_camera = static_cast<SyntheticCamera*>(camera.get());
+  if (synthetic_camera->dropped_frames() > 0) return;
+  const std::vector<base::TimeDelta>& timestamps = recorder.timestamps();
+  ASSERT_GE(timestamps.size(), kFrameCount);
+  for (size_t i = 1; i < timestamps.size(); ++i) {
+    EXPECT_NEAR(interval.InMicroseconds(),
+                (timestamps[i] - timestamps[i - 1]).InMicroseconds(), 1);
+  }
+}
+
+TEST(SyntheticCameraTest, DropLateFrames) {
+  constexpr float kFrameRate = 30;
+  constexpr size_t kFrameCount = 10;
+  constexpr size_t kSlowFrames = 5;
+  std::unique_ptr<CameraInterface> camera = NewPatternCamera();
+  ASSERT_TRUE(camera->Init().ok());
+
+  // The slow frames take about 3 frame intervals each.
+  FrameRecorder recorder(kFrameCount, kSlowFrames,
+                         base::TimeDelta::FromMilliseconds(100));
+  CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_BGRA, kFrameRate);
+  ASSERT_TRUE(
+      camera->Start(camera_format, recorder.GetCallback(), StatusCallback())
+          .ok());
+  recorder.Wait();
+  ASSERT_TRUE(camera->Stop().ok());
+
+  // Every frame skipped between the delivered ones is counted as dropped,
+  // and no more.
+  auto* synthetic_camera = static_cast<SyntheticCamera*>(camera.get());
+  const std::vector<base::TimeDelta>& timestamps = recorder.timestamps();
+  ASSERT_GE(timestamps.size(), kFrameCount);
+  size_t skipped_frames = 0;
+  for (size_t i = 1; i < timestamps.size(); ++i) {
+    int64_t frames = std::llround(
+        (timestamps[i] - timestamps[i - 1]).InSecondsF() * kFrameRate);
+    ASSERT_GE(frames, 1);
+    skipped_frames += frames - 1;
+  }
+  EXPECT_GT(synthetic_camera->dropped_frames(), 0u);
+  EXPECT_EQ(skipped_frames, synthetic_camera->dropped_frames());
+}
+
+TEST(SyntheticCameraTest, InvalidCameraFormat) {
+  std::unique_ptr<CameraInterface> camera = NewPatternCamera();
+  ASSERT_TRUE(camera->Init().ok());
+  FrameRecorder recorder(1, 0, base::TimeDelta());
+  EXPECT_FALSE(camera
+                   ->Start(CameraFormat(0, kHeight, PIXEL_FORMAT_BGRA, 30),
+                           recorder.GetCallback(), StatusCallback())
+                   .ok());
+  EXPECT_FALSE(camera
+                   ->Start(CameraFormat(kWidth, kHeight, PIXEL_FORMAT_Z16, 30),
+                           recorder.GetCallback(), StatusCallback())
+                   .ok());
+}
+
+TEST(SyntheticCameraTest, KeepStateOnFailedStart) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  // The directory exists, but has no image to load.
+  std::unique_ptr<CameraInterface> camera = CameraFactory::NewCamera(
+      SyntheticCamera::NewCameraDescriptor(temp_dir.GetPath().value()));
+  ASSERT_TRUE(camera->Init().ok());
+
+  CameraFormat camera_format = camera->camera_format();
+  FrameRecorder recorder(1, 0, base::TimeDelta());
+  EXPECT_FALSE(camera
+                   ->Start(CameraFormat(kWidth, kHeight, PIXEL_FORMAT_BGRA, 30),
+                           recorder.GetCallback(), StatusCallback())
+                   .ok());
+  EXPECT_TRUE(camera_format == camera->camera_format());
+  EXPECT_FALSE(camera->Stop().ok());
+}
+
+}  // namespace drivers
+}  // namespace felicia
@@ -64,6 +64,17 @@ class TopicInfoWatcherDelegate : public TopicInfoWatcherNode::Delegate {
     uv_async_send(&handle_);
   }
 
+  void OnNewTopicInfos(const std::vector<TopicInfo>& topic_infos) override {
+    {
+      base::AutoLock l(lock_);
+      for (auto& topic_info : topic_infos) {
+        topic_info_queue_.push(topic_info);
+      }
+    }
+
+    uv_async_send(&handle_);
+  }
+
   static void OnAsync(uv_async_t* handle) {
     do {
       StatusOr<TopicInfo> status_or;
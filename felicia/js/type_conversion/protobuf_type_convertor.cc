@@ -9,6 +9,8 @@
 #include "google/protobuf/reflection.h"
 #include "third_party/chromium/base/logging.h"
 
+#include "felicia/core/message/protobuf_loader.h"
+
 namespace felicia {
 namespace js {
 
@@ -24,22 +26,22 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     Napi::Env env, const google::protobuf::Message& value) {
   Napi::Object obj = Napi::Object::New(env);
   obj["type"] = Napi::String::New(env, value.GetTypeName());
-  obj["message"] = ToJSObject(env, value);
+  const ProtobufFieldTable* field_table =
+      ProtobufLoader::GetInstance().GetFieldTable(value.GetDescriptor());
+  obj["message"] = ToJSObject(env, value, field_table);
 
   return obj;
 }
 
 // static
 Napi::Object TypeConvertor<google::protobuf::Message>::ToJSObject(
-    Napi::Env env, const google::protobuf::Message& value) {
-  const google::protobuf::Descriptor* descriptor = value.GetDescriptor();
+    Napi::Env env, const google::protobuf::Message& value,
+    const ProtobufFieldTable* field_table) {
   const google::protobuf::Reflection* reflection = value.GetReflection();
 
   Napi::Object obj = Napi::Object::New(env);
-  for (int i = 0; i < descriptor->field_count(); ++i) {
-    const google::protobuf::FieldDescriptor* field_desc = descriptor->field(i);
-    obj[field_desc->json_name()] =
-        ToJSValue(env, reflection, value, field_desc);
+  for (const ProtobufFieldTable::Field& field : field_table->fields()) {
+    obj[field.json_name] = ToJSValue(env, reflection, value, field);
   }
 
   return obj;
@@ -49,10 +51,11 @@ Napi::Object TypeConvertor<google::protobuf::Message>::ToJSObject(
 Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     Napi::Env env, const google::protobuf::Reflection* reflection,
     const google::protobuf::Message& message,
-    const google::protobuf::FieldDescriptor* field_desc) {
-  switch (field_desc->type()) {
+    const ProtobufFieldTable::Field& field) {
+  const google::protobuf::FieldDescriptor* field_desc = field.descriptor;
+  switch (field.type) {
     case google::protobuf::FieldDescriptor::TYPE_DOUBLE: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<double>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -64,7 +67,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
       return Napi::Number::New(env, reflection->GetDouble(message, field_desc));
     }
     case google::protobuf::FieldDescriptor::TYPE_FLOAT:
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<float>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -78,7 +81,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     case google::protobuf::FieldDescriptor::TYPE_SFIXED64:
     case google::protobuf::FieldDescriptor::TYPE_SINT64: {
       // Should return with Napi::BigInt once released officialy.
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int64_t>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -92,7 +95,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     case google::protobuf::FieldDescriptor::TYPE_UINT64:
     case google::protobuf::FieldDescriptor::TYPE_FIXED64: {
       // Should return with Napi::BigInt once released officialy.
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<uint64_t>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -106,7 +109,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     case google::protobuf::FieldDescriptor::TYPE_INT32:
     case google::protobuf::FieldDescriptor::TYPE_SFIXED32:
     case google::protobuf::FieldDescriptor::TYPE_SINT32: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int32_t>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -119,7 +122,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
     }
     case google::protobuf::FieldDescriptor::TYPE_FIXED32:
     case google::protobuf::FieldDescriptor::TYPE_UINT32: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<uint32_t>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -131,7 +134,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
       return Napi::Number::New(env, reflection->GetUInt32(message, field_desc));
     }
     case google::protobuf::FieldDescriptor::TYPE_BOOL: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<bool>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -143,7 +146,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
       return Napi::Boolean::New(env, reflection->GetBool(message, field_desc));
     }
     case google::protobuf::FieldDescriptor::TYPE_STRING: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<std::string>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -157,7 +160,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
           env, reflection->GetStringReference(message, field_desc, &scratch));
     }
     case google::protobuf::FieldDescriptor::TYPE_MESSAGE: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<google::protobuf::Message>(
                 message, field_desc);
@@ -166,14 +169,16 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
             repeated_field_ref.NewMessage());
         for (int i = 0; i < repeated_field_ref.size(); ++i) {
           array[i] =
-              ToJSObject(env, repeated_field_ref.Get(i, scratch_space.get()));
+              ToJSObject(env, repeated_field_ref.Get(i, scratch_space.get()),
+                         field.message_table);
         }
         return array;
       }
-      return ToJSObject(env, reflection->GetMessage(message, field_desc));
+      return ToJSObject(env, reflection->GetMessage(message, field_desc),
+                        field.message_table);
     }
     case google::protobuf::FieldDescriptor::TYPE_BYTES: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<std::string>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -193,7 +198,7 @@ Napi::Value TypeConvertor<google::protobuf::Message>::ToJSValue(
       return Napi::Uint8Array::New(env, data.length(), arrayBuffer, 0);
     }
     case google::protobuf::FieldDescriptor::TYPE_ENUM: {
-      if (field_desc->is_repeated()) {
+      if (field.is_repeated) {
         auto repeated_field_ref =
             reflection->GetRepeatedFieldRef<int>(message, field_desc);
         Napi::Array array = Napi::Array::New(env, repeated_field_ref.size());
@@ -9,6 +9,7 @@
 
 #include "google/protobuf/message.h"
 
+#include "felicia/core/message/protobuf_field_table.h"
 #include "felicia/js/type_conversion/type_convertor_forward.h"
 
 namespace felicia {
@@ -23,12 +24,13 @@ class TypeConvertor<google::protobuf::Message> {
 
  private:
   static Napi::Object ToJSObject(Napi::Env env,
-                                 const google::protobuf::Message& value);
+                                 const google::protobuf::Message& value,
+                                 const ProtobufFieldTable* field_table);
 
-  static Napi::Value ToJSValue(
-      Napi::Env env, const google::protobuf::Reflection* reflection,
-      const google::protobuf::Message& message,
-      const google::protobuf::FieldDescriptor* field_desc);
+  static Napi::Value ToJSValue(Napi::Env env,
+                               const google::protobuf::Reflection* reflection,
+                               const google::protobuf::Message& message,
+                               const ProtobufFieldTable::Field& field);
 };
 
 }  // namespace js
@@ -0,0 +1,292 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/map/depth_pointcloud_converter.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "third_party/chromium/base/barrier_closure.h"
+#include "third_party/chromium/base/bind.h"
+#include "third_party/chromium/base/bind_helpers.h"
+#include "third_party/chromium/base/logging.h"
+#include "third_party/chromium/base/strings/stringprintf.h"
+#include "third_party/chromium/base/synchronization/waitable_event.h"
+
+#include "felicia/drivers/camera/camera_errors.h"
+
+namespace felicia {
+namespace map {
+
+namespace {
+
+int SampledLength(int length, int decimation) {
+  return (length + decimation - 1) / decimation;
+}
+
+}  // namespace
+
+DepthPointcloudConverter::Options::Options() = default;
+
+DepthPointcloudConverter::DepthPointcloudConverter(
+    const Intrinsics& intrinsics, const Options& options)
+    : intrinsics_(intrinsics), options_(options) {
+  DCHECK_GT(intrinsics_.fx, 0);
+  DCHECK_GT(intrinsics_.fy, 0);
+  DCHECK_GT(options_.depth_scale, 0);
+  DCHECK_GE(options_.decimation, 1);
+  DCHECK_LE(options_.min_depth, options_.max_depth);
+  DCHECK_GE(options_.worker_num, 0);
+
+  for (int i = 0; i < options_.worker_num; ++i) {
+    auto worker_thread = std::make_unique<base::Thread>(
+        base::StringPrintf("DepthPointcloudThread%d", i));
+    worker_thread->Start();
+    worker_threads_.push_back(std::move(worker_thread));
+  }
+}
+
+DepthPointcloudConverter::~DepthPointcloudConverter() {
+  for (auto& worker_thread : worker_threads_) {
+    worker_thread->Stop();
+  }
+}
+
+Status DepthPointcloudConverter::Convert(
+    const drivers::DepthCameraFrame& depth_camera_frame,
+    Pointcloud* pointcloud) {
+  return ConvertDepthCameraFrame(depth_camera_frame, nullptr, pointcloud);
+}
+
+Status DepthPointcloudConverter::Convert(
+    const drivers::DepthCameraFrame& depth_camera_frame,
+    const drivers::CameraFrame& color_frame, Pointcloud* pointcloud) {
+  return ConvertDepthCameraFrame(depth_camera_frame, &color_frame, pointcloud);
+}
+
+Status DepthPointcloudConverter::Convert(
+    const float* depth, const Sizei& size, base::TimeDelta timestamp,
+    const drivers::CameraFrame* color_frame, Pointcloud* pointcloud) {
+  return DoConvert(depth, size, 1.f, timestamp, color_frame, pointcloud);
+}
+
+Status DepthPointcloudConverter::ConvertDepthCameraFrame(
+    const drivers::DepthCameraFrame& depth_camera_frame,
+    const drivers::CameraFrame* color_frame, Pointcloud* pointcloud) {
+  PixelFormat pixel_format = depth_camera_frame.pixel_format();
+  if (pixel_format != PIXEL_FORMAT_Z16 && pixel_format != PIXEL_FORMAT_Y16) {
+    return errors::InvalidArgument(base::StringPrintf(
+        "Depth should be 16 bits, but it's %s.",
+        drivers::CameraFormat::PixelFormatToString(pixel_format).c_str()));
+  }
+  Sizei size(depth_camera_frame.width(), depth_camera_frame.height());
+  if (depth_camera_frame.length() <
+      static_cast<size_t>(size.area()) * sizeof(uint16_t)) {
+    return drivers::errors::InvalidNumberOfBytesInBuffer();
+  }
+
+  return DoConvert(depth_camera_frame.data().cast<const uint16_t*>(), size,
+                   options_.depth_scale, depth_camera_frame.timestamp(),
+                   color_frame, pointcloud);
+}
+
+template <typename T>
+Status DepthPointcloudConverter::DoConvert(
+    const T* depth, const Sizei& size, float depth_scale,
+    base::TimeDelta timestamp, const drivers::CameraFrame* color_frame,
+    Pointcloud* pointcloud) {
+  if (size.width() <= 0 || size.height() <= 0) {
+    return errors::InvalidArgument("Depth is empty.");
+  }
+
+  ColorLayout color_layout;
+  if (color_frame) {
+    if (color_frame->width() != size.width() ||
+        color_frame->height() != size.height()) {
+      return errors::InvalidArgument(base::StringPrintf(
+          "Color should be the same size as depth, but %dx%d != %s.",
+          color_frame->width(), color_frame->height(),
+          size.ToString().c_str()));
+    }
+    switch (color_frame->pixel_format()) {
+      case PIXEL_FORMAT_BGR:
+        color_layout = {2, 1, 0, 3};
+        break;
+      case PIXEL_FORMAT_RGB:
+        color_layout = {0, 1, 2, 3};
+        break;
+      case PIXEL_FORMAT_BGRA:
+      case PIXEL_FORMAT_BGRX:
+        color_layout = {2, 1, 0, 4};
+        break;
+      case PIXEL_FORMAT_RGBA:
+      case PIXEL_FORMAT_RGBX:
+        color_layout = {0, 1, 2, 4};
+        break;
+      default:
+        return errors::InvalidArgument(base::StringPrintf(
+            "Can't color points with %s.",
+            drivers::CameraFormat::PixelFormatToString(
+                color_frame->pixel_format())
+                .c_str()));
+    }
+    if (color_frame->length() <
+        static_cast<size_t>(size.area()) * color_layout.bytes_per_pixel) {
+      return drivers::errors::InvalidNumberOfBytesInBuffer();
+    }
+  }
+
+  UpdateRays(size);
+  const int columns = column_rays_.size();
+  const int rows = row_rays_.size();
+
+  // Every band has room for all of its pixels, and the points are packed
+  // after the bands are done.
+  Data& points = pointcloud->points();
+  points.set_type(DATA_TYPE_32F_C3);
+  points.resize(columns * rows * sizeof(Point3f));
+  Data& colors = pointcloud->colors();
+  colors.clear();
+  if (color_frame) {
+    colors.set_type(DATA_TYPE_8U_C3);
+    colors.resize(columns * rows * sizeof(Color3u));
+  }
+  pointcloud->intensities().clear();
+  pointcloud->set_timestamp(timestamp);
+  Point3f* point_data = points.cast<Point3f*>();
+  Color3u* color_data = color_frame ? colors.cast<Color3u*>() : nullptr;
+  const uint8_t* color_frame_data =
+      color_frame ? color_frame->data().cast<const uint8_t*>() : nullptr;
+
+  size_t band_count =
+      std::min(worker_threads_.size() + 1, static_cast<size_t>(rows));
+  int band_rows = (rows + band_count - 1) / band_count;
+  band_count = (rows + band_rows - 1) / band_rows;
+  bands_.resize(band_count);
+  for (size_t i = 0; i < band_count; ++i) {
+    Band& band = bands_[i];
+    band.top = i * band_rows;
+    band.rows = std::min(band_rows, rows - band.top);
+    band.first_point = static_cast<size_t>(band.top) * columns;
+    band.point_count = 0;
+    band.zs.resize(columns);
+    band.xs.resize(columns);
+  }
+
+  base::WaitableEvent event;
+  base::RepeatingClosure done = base::BarrierClosure(
+      band_count - 1, base::BindOnce(&base::WaitableEvent::Signal,
+                                     base::Unretained(&event)));
+  for (size_t i = 1; i < band_count; ++i) {
+    base::Thread* worker_thread = worker_threads_[i - 1].get();
+    worker_thread->task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&DepthPointcloudConverter::ConvertBand<T>,
+                       base::Unretained(this), depth, size.width(),
+                       depth_scale, color_frame_data, &color_layout,
+                       point_data, color_data, &bands_[i], done));
+  }
+  ConvertBand(depth, size.width(), depth_scale, color_frame_data,
+              &color_layout, point_data, color_data, &bands_[0],
+              base::DoNothing());
+  event.Wait();
+
+  size_t point_count = bands_[0].point_count;
+  for (size_t i = 1; i < band_count; ++i) {
+    const Band& band = bands_[i];
+    memmove(point_data + point_count, point_data + band.first_point,
+            band.point_count * sizeof(Point3f));
+    if (color_data) {
+      memmove(color_data + point_count, color_data + band.first_point,
+              band.point_count * sizeof(Color3u));
+    }
+    point_count += band.point_count;
+  }
+  points.resize(point_count * sizeof(Point3f));
+  if (color_data) colors.resize(point_count * sizeof(Color3u));
+
+  return Status::OK();
+}
+
+void DepthPointcloudConverter::UpdateRays(const Sizei& size) {
+  if (rays_size_ == size) return;
+  rays_size_ = size;
+
+  const int decimation = options_.decimation;
+  column_rays_.resize(SampledLength(size.width(), decimation));
+  for (size_t i = 0; i < column_rays_.size(); ++i) {
+    column_rays_[i] = (i * decimation - intrinsics_.cx) / intrinsics_.fx;
+  }
+  row_rays_.resize(SampledLength(size.height(), decimation));
+  for (size_t i = 0; i < row_rays_.size(); ++i) {
+    row_rays_[i] = (i * decimation - intrinsics_.cy) / intrinsics_.fy;
+  }
+}
+
+template <typename T>
+void DepthPointcloudConverter::ConvertBand(
+    const T* depth, int width, float depth_scale, const uint8_t* colors,
+    const ColorLayout* color_layout, Point3f* points, Color3u* point_colors,
+    Band* band, base::OnceClosure done) {
+  const int decimation = options_.decimation;
+  // Keeps |min_depth| above 0, so that the pixels without depth are skipped.
+  const float min_depth =
+      std::max(options_.min_depth, std::numeric_limits<float>::min());
+  const float max_depth = options_.max_depth;
+  const int columns = column_rays_.size();
+  const float* column_rays = column_rays_.data();
+
+  // Every row is first converted into the depths and the x of its columns in
+  // loops without a branch or a dependency between the pixels, so that they
+  // can be vectorized, and then the valid points are packed in a second pass.
+  Point3f* out = points + band->first_point;
+  Color3u* out_colors =
+      point_colors ? point_colors + band->first_point : nullptr;
+  float* zs = band->zs.data();
+  float* xs = band->xs.data();
+  size_t n = 0;
+  for (int row = band->top; row < band->top + band->rows; ++row) {
+    const size_t offset = static_cast<size_t>(row) * decimation * width;
+    const T* depth_row = depth + offset;
+    const float row_ray = row_rays_[row];
+    if (decimation == 1) {
+      for (int column = 0; column < columns; ++column) {
+        zs[column] = depth_row[column] * depth_scale;
+      }
+    } else {
+      for (int column = 0; column < columns; ++column) {
+        zs[column] = depth_row[column * decimation] * depth_scale;
+      }
+    }
+    for (int column = 0; column < columns; ++column) {
+      xs[column] = column_rays[column] * zs[column];
+    }
+
+    if (out_colors) {
+      const int bpp = color_layout->bytes_per_pixel;
+      const uint8_t* color_row = colors + offset * bpp;
+      for (int column = 0; column < columns; ++column) {
+        const float z = zs[column];
+        out[n].set_xyz(xs[column], row_ray * z, z);
+        const uint8_t* color = color_row + column * decimation * bpp;
+        out_colors[n].set_rgb(color[color_layout->r], color[color_layout->g],
+                              color[color_layout->b]);
+        n += z >= min_depth && z <= max_depth;
+      }
+    } else {
+      for (int column = 0; column < columns; ++column) {
+        const float z = zs[column];
+        out[n].set_xyz(xs[column], row_ray * z, z);
+        n += z >= min_depth && z <= max_depth;
+      }
+    }
+  }
+  band->point_count = n;
+  std::move(done).Run();
+}
+
+}  // namespace map
+}  // namespace felicia
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef FELICIA_MAP_DEPTH_POINTCLOUD_CONVERTER_H_
+#define FELICIA_MAP_DEPTH_POINTCLOUD_CONVERTER_H_
+
+#include <memory>
+#include <vector>
+
+#include "third_party/chromium/base/callback.h"
+#include "third_party/chromium/base/macros.h"
+#include "third_party/chromium/base/threading/thread.h"
+
+#include "felicia/core/lib/base/export.h"
+#include "felicia/core/lib/error/status.h"
+#include "felicia/core/lib/unit/geometry/size.h"
+#include "felicia/drivers/camera/camera_frame.h"
+#include "felicia/drivers/camera/depth_camera_frame.h"
+#include "felicia/map/pointcloud.h"
+
+namespace felicia {
+namespace map {
+
+// DepthPointcloudConverter back-projects the pixels of depth images to the
+// points of a Pointcloud in the camera coordinates, x to the right, y to the
+// bottom and z to the front, in meters. The pixels without a valid depth are
+// skipped, so the points are not organized.
+//
+// A frame is split into horizontal bands, which are converted in parallel on
+// the worker threads. The rays of the pixels are computed once per image size.
+// A row is converted in vectorizable loops into the depths and the x of its
+// pixels, and then packed without a branch: every pixel is written, and only
+// the valid ones advance the output.
+//
+// The points and the colors are written into the Data of the given
+// Pointcloud, so converting a stream of frames into the same Pointcloud
+// doesn't reallocate them.
+class FEL_EXPORT DepthPointcloudConverter {
+ public:
+  struct Intrinsics {
+    float fx = 0;
+    float fy = 0;
+    float cx = 0;
+    float cy = 0;
+  };
+
+  struct Options {
+    Options();
+
+    // Meters per unit of the PIXEL_FORMAT_Z16 and PIXEL_FORMAT_Y16 depth
+    // images, e.g, 0.001 for the ones in millimeters.
+    float depth_scale = 0.001f;
+    // Only every |decimation|-th pixel of every |decimation|-th row is
+    // converted.
+    int decimation = 1;
+    // The points out of [|min_depth|, |max_depth|] meters are skipped. 0 is
+    // always skipped, since it means no depth.
+    float min_depth = 0;
+    float max_depth = 10;
+    // A frame is split into up to |worker_num| + 1 bands, one of which is
+    // converted on the calling thread. If |worker_num| is 0, the frames are
+    // converted as a whole.
+    int worker_num = 2;
+  };
+
+  DepthPointcloudConverter(const Intrinsics& intrinsics,
+                           const Options& options = Options());
+  ~DepthPointcloudConverter();
+
+  const Intrinsics& intrinsics() const { return intrinsics_; }
+  const Options& options() const { return options_; }
+
+  // Converts |depth_camera_frame|, which should be PIXEL_FORMAT_Z16 or
+  // PIXEL_FORMAT_Y16. The colors and the intensities of |pointcloud| are
+  // cleared.
+  Status Convert(const drivers::DepthCameraFrame& depth_camera_frame,
+                 Pointcloud* pointcloud);
+
+  // Same as above, but colors the points by the pixels of |color_frame|,
+  // which should be aligned to |depth_camera_frame| and of the same size.
+  // The colors are DATA_TYPE_8U_C3, and |color_frame| should be one of
+  // PIXEL_FORMAT_BGR, PIXEL_FORMAT_RGB, PIXEL_FORMAT_BGRA, PIXEL_FORMAT_BGRX,
+  // PIXEL_FORMAT_RGBA and PIXEL_FORMAT_RGBX.
+  Status Convert(const drivers::DepthCameraFrame& depth_camera_frame,
+                 const drivers::CameraFrame& color_frame,
+                 Pointcloud* pointcloud);
+
+  // Converts |depth| of |size|, whose pixels are in meters, e.g, from a
+  // stereo matcher. |color_frame| can be null.
+  Status Convert(const float* depth, const Sizei& size,
+                 base::TimeDelta timestamp,
+                 const drivers::CameraFrame* color_frame,
+                 Pointcloud* pointcloud);
+
+ private:
+  // The pixel offsets of the red, the green and the blue in a color pixel of
+  // |bytes_per_pixel|.
+  struct ColorLayout {
+    int r;
+    int g;
+    int b;
+    int bytes_per_pixel;
+  };
+
+  // The bands of a frame, each of which writes from its |first_point|.
+  struct Band {
+    int top;
+    int rows;
+    size_t first_point;
+    size_t point_count;
+    // The depths and the x of the sampled columns of the row being converted.
+    std::vector<float> zs;
+    std::vector<float> xs;
+  };
+
+  Status ConvertDepthCameraFrame(
+      const drivers::DepthCameraFrame& depth_camera_frame,
+      const drivers::CameraFrame* color_frame, Pointcloud* pointcloud);
+
+  template <typename T>
+  Status DoConvert(const T* depth, const Sizei& size, float depth_scale,
+                   base::TimeDelta timestamp,
+                   const drivers::CameraFrame* color_frame,
+                   Pointcloud* pointcloud);
+
+  // Computes the rays of the sampled columns and rows of |size|, if they are
+  // not for |size| yet.
+  void UpdateRays(const Sizei& size);
+
+  // Runs on a worker thread, or on the calling thread for the first band.
+  template <typename T>
+  void ConvertBand(const T* depth, int width, float depth_scale,
+                   const uint8_t* colors, const ColorLayout* color_layout,
+                   Point3f* points, Color3u* point_colors, Band* band,
+                   base::OnceClosure done);
+
+  const Intrinsics intrinsics_;
+  const Options options_;
+
+  std::vector<std::unique_ptr<base::Thread>> worker_threads_;
+
+  // (u - cx) / fx of the sampled columns and (v - cy) / fy of the sampled
+  // rows of |rays_size_|.
+  Sizei rays_size_;
+  std::vector<float> column_rays_;
+  std::vector<float> row_rays_;
+  std::vector<Band> bands_;
+
+  DISALLOW_COPY_AND_ASSIGN(DepthPointcloudConverter);
+};
+
+}  // namespace map
+}  // namespace felicia
+
+#endif  // FELICIA_MAP_DEPTH_POINTCLOUD_CONVERTER_H_
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/map/depth_pointcloud_converter.h"
+
+#include "benchmark/benchmark.h"
+#include "third_party/chromium/base/rand_util.h"
+#include "third_party/chromium/base/strings/strcat.h"
+
+namespace felicia {
+namespace map {
+
+namespace {
+
+constexpr float kFrameRate = 30;
+
+drivers::DepthCameraFrame NewRandomDepthCameraFrame(int width, int height) {
+  drivers::CameraFormat camera_format(width, height, PIXEL_FORMAT_Z16,
+                                      kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint16_t* pixels = data.cast<uint16_t*>();
+  for (int i = 0; i < width * height; ++i) {
+    // About a tenth of the pixels have no depth.
+    pixels[i] = base::RandInt(0, 9) == 0 ? 0 : base::RandInt(300, 8000);
+  }
+  drivers::CameraFrame camera_frame(std::move(data), camera_format,
+                                    base::TimeDelta());
+  return drivers::DepthCameraFrame(std::move(camera_frame), 0, 10000);
+}
+
+drivers::CameraFrame NewRandomColorFrame(int width, int height) {
+  drivers::CameraFormat camera_format(width, height, PIXEL_FORMAT_BGR,
+                                      kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  base::RandBytes(data.cast<char*>(), data.size());
+  return drivers::CameraFrame(std::move(data), camera_format,
+                              base::TimeDelta());
+}
+
+}  // namespace
+
+// Args are the width, the height, the decimation, the number of the workers
+// and whether the points are colored. A frame should take well below 33ms to
+// keep up with a 30Hz depth camera.
+static void BM_Convert(benchmark::State& state) {
+  int width = state.range(0);
+  int height = state.range(1);
+  DepthPointcloudConverter::Intrinsics intrinsics;
+  intrinsics.fx = intrinsics.fy = width * 0.9f;
+  intrinsics.cx = width / 2.f;
+  intrinsics.cy = height / 2.f;
+  DepthPointcloudConverter::Options options;
+  options.decimation = state.range(2);
+  options.worker_num = state.range(3);
+  bool with_colors = state.range(4);
+  DepthPointcloudConverter converter(intrinsics, options);
+  drivers::DepthCameraFrame depth_camera_frame =
+      NewRandomDepthCameraFrame(width, height);
+  drivers::CameraFrame color_frame = NewRandomColorFrame(width, height);
+  Pointcloud pointcloud;
+
+  for (auto _ : state) {
+    Status s = with_colors ? converter.Convert(depth_camera_frame, color_frame,
+                                               &pointcloud)
+                           : converter.Convert(depth_camera_frame, &pointcloud);
+    if (!s.ok()) {
+      state.SkipWithError("Failed to convert.");
+      break;
+    }
+  }
+
+  state.SetLabel(base::StrCat({Sizei(width, height).ToString(),
+                               with_colors ? " with colors" : ""}));
+  state.SetItemsProcessed(state.iterations() * width * height);
+}
+
+static void ConvertArgs(benchmark::internal::Benchmark* benchmark) {
+  for (const Sizei& size : {Sizei(640, 480), Sizei(1280, 720)}) {
+    for (int decimation : {1, 2}) {
+      for (int worker_num : {0, 1, 3}) {
+        for (int with_colors : {0, 1}) {
+          benchmark->Args({size.width(), size.height(), decimation, worker_num,
+                           with_colors});
+        }
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_Convert)->Apply(ConvertArgs)->UseRealTime();
+
+}  // namespace map
+}  // namespace felicia
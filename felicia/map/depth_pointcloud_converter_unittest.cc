@@ -0,0 +1,178 @@
+// Copyright (c) 2019 The Felicia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "felicia/map/depth_pointcloud_converter.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace felicia {
+namespace map {
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+constexpr float kFrameRate = 30;
+
+DepthPointcloudConverter::Intrinsics NewIntrinsics() {
+  DepthPointcloudConverter::Intrinsics intrinsics;
+  intrinsics.fx = 50;
+  intrinsics.fy = 40;
+  intrinsics.cx = kWidth / 2;
+  intrinsics.cy = kHeight / 2;
+  return intrinsics;
+}
+
+// Returns a depth frame in millimeters, whose pixel at (x, y) is
+// 1000 + x + y, except for the ones on the diagonal which have no depth.
+drivers::DepthCameraFrame NewDepthCameraFrame() {
+  drivers::CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_Z16,
+                                      kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint16_t* pixels = data.cast<uint16_t*>();
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      pixels[y * kWidth + x] = x == y ? 0 : 1000 + x + y;
+    }
+  }
+  drivers::CameraFrame camera_frame(std::move(data), camera_format,
+                                    base::TimeDelta::FromMilliseconds(1));
+  return drivers::DepthCameraFrame(std::move(camera_frame), 0, 10000);
+}
+
+// Returns a BGR frame whose pixels at (x, y) are (x, y, x + y).
+drivers::CameraFrame NewColorFrame() {
+  drivers::CameraFormat camera_format(kWidth, kHeight, PIXEL_FORMAT_BGR,
+                                      kFrameRate);
+  Data data;
+  data.resize(camera_format.AllocationSize());
+  uint8_t* pixels = data.cast<uint8_t*>();
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8_t* pixel = pixels + (y * kWidth + x) * 3;
+      pixel[0] = x;
+      pixel[1] = y;
+      pixel[2] = x + y;
+    }
+  }
+  return drivers::CameraFrame(std::move(data), camera_format,
+                              base::TimeDelta());
+}
+
+}  // namespace
+
+TEST(DepthPointcloudConverterTest, Convert) {
+  DepthPointcloudConverter::Intrinsics intrinsics = NewIntrinsics();
+  for (int worker_num : {0, 1, 3}) {
+    DepthPointcloudConverter::Options options;
+    options.worker_num = worker_num;
+    DepthPointcloudConverter converter(intrinsics, options);
+    Pointcloud pointcloud;
+    ASSERT_TRUE(converter.Convert(NewDepthCameraFrame(), &pointcloud).ok());
+
+    Data::ConstView<Point3f> points =
+        pointcloud.points().AsConstView<Point3f>();
+    ASSERT_EQ(static_cast<size_t>(kWidth * kHeight - kHeight), points.size());
+    EXPECT_TRUE(pointcloud.colors().empty());
+    EXPECT_EQ(base::TimeDelta::FromMilliseconds(1), pointcloud.timestamp());
+    size_t i = 0;
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth; ++x) {
+        if (x == y) continue;
+        float z = (1000 + x + y) * 0.001f;
+        EXPECT_FLOAT_EQ((x - intrinsics.cx) / intrinsics.fx * z,
+                        points[i].x());
+        EXPECT_FLOAT_EQ((y - intrinsics.cy) / intrinsics.fy * z,
+                        points[i].y());
+        EXPECT_FLOAT_EQ(z, points[i].z());
+        ++i;
+      }
+    }
+  }
+}
+
+TEST(DepthPointcloudConverterTest, ConvertWithColors) {
+  DepthPointcloudConverter converter(NewIntrinsics());
+  Pointcloud pointcloud;
+  ASSERT_TRUE(
+      converter.Convert(NewDepthCameraFrame(), NewColorFrame(), &pointcloud)
+          .ok());
+
+  Data::ConstView<Point3f> points = pointcloud.points().AsConstView<Point3f>();
+  Data::ConstView<Color3u> colors = pointcloud.colors().AsConstView<Color3u>();
+  ASSERT_EQ(points.size(), colors.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    // Recovers the pixel from the point.
+    int x = static_cast<int>(
+        std::round(points[i].x() / points[i].z() * 50 + kWidth / 2));
+    int y = static_cast<int>(
+        std::round(points[i].y() / points[i].z() * 40 + kHeight / 2));
+    EXPECT_EQ(x + y, colors[i].r());
+    EXPECT_EQ(y, colors[i].g());
+    EXPECT_EQ(x, colors[i].b());
+  }
+}
+
+TEST(DepthPointcloudConverterTest, DecimateAndFilter) {
+  DepthPointcloudConverter::Options options;
+  options.decimation = 2;
+  options.min_depth = 1.02f;
+  options.max_depth = 1.05f;
+  DepthPointcloudConverter converter(NewIntrinsics(), options);
+  Pointcloud pointcloud;
+  ASSERT_TRUE(converter.Convert(NewDepthCameraFrame(), &pointcloud).ok());
+
+  size_t expected_count = 0;
+  for (int y = 0; y < kHeight; y += 2) {
+    for (int x = 0; x < kWidth; x += 2) {
+      if (x == y) continue;
+      float z = (1000 + x + y) * 0.001f;
+      if (z >= options.min_depth && z <= options.max_depth) expected_count++;
+    }
+  }
+  Data::ConstView<Point3f> points = pointcloud.points().AsConstView<Point3f>();
+  EXPECT_EQ(expected_count, points.size());
+  for (const Point3f& point : points) {
+    EXPECT_GE(point.z(), options.min_depth);
+    EXPECT_LE(point.z(), options.max_depth);
+  }
+}
+
+TEST(DepthPointcloudConverterTest, ConvertFloatDepth) {
+  DepthPointcloudConverter converter(NewIntrinsics());
+  std::vector<float> depth(kWidth * kHeight, 2.f);
+  depth[0] = std::numeric_limits<float>::quiet_NaN();
+  depth[1] = std::numeric_limits<float>::infinity();
+  Pointcloud pointcloud;
+  ASSERT_TRUE(converter
+                  .Convert(depth.data(), Sizei(kWidth, kHeight),
+                           base::TimeDelta(), nullptr, &pointcloud)
+                  .ok());
+  Data::ConstView<Point3f> points = pointcloud.points().AsConstView<Point3f>();
+  ASSERT_EQ(depth.size() - 2, points.size());
+  EXPECT_FLOAT_EQ(2.f, points[0].z());
+}
+
+TEST(DepthPointcloudConverterTest, InvalidFrames) {
+  DepthPointcloudConverter converter(NewIntrinsics());
+  Pointcloud pointcloud;
+  drivers::CameraFrame color_frame = NewColorFrame();
+  drivers::DepthCameraFrame not_depth(color_frame, 0, 1);
+  EXPECT_FALSE(converter.Convert(not_depth, &pointcloud).ok());
+
+  drivers::CameraFrame small_color_frame(
+      Data(), drivers::CameraFormat(32, 24, PIXEL_FORMAT_BGR, kFrameRate),
+      base::TimeDelta());
+  EXPECT_FALSE(
+      converter.Convert(NewDepthCameraFrame(), small_color_frame, &pointcloud)
+          .ok());
+}
+
+}  // namespace map
+}  // namespace felicia
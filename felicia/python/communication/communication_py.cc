@@ -24,6 +24,10 @@ void AddCommunication(py::module& m) {
       .def_readwrite("buffer_size", &communication::Settings::buffer_size)
       .def_readwrite("is_dynamic_buffer",
                      &communication::Settings::is_dynamic_buffer)
+      .def_readwrite("is_chunked_transfer",
+                     &communication::Settings::is_chunked_transfer)
+      .def_readwrite("max_chunked_message_size",
+                     &communication::Settings::max_chunked_message_size)
       .def_readwrite("queue_size", &communication::Settings::queue_size)
       .def_readwrite("channel_settings",
                      &communication::Settings::channel_settings);
@@ -7,6 +7,7 @@
 
 #include "felicia/python/communication/ros_serialized_service_client_py.h"
 
+#include "felicia/core/lib/error/errors.h"
 #include "felicia/python/message/message_util.h"
 #include "felicia/python/type_conversion/callback.h"
 #include "felicia/python/type_conversion/protobuf.h"
@@ -39,8 +40,13 @@ class PyCallCallback {
 using PyOnConnectCallback = PyCallback<void(ServiceInfo::Status)>;
 
 PyRosSerializedServiceClient::PyRosSerializedServiceClient(
-    py::object ros_service) {
-  client_ = rpc::PyRosSerializedClient(ros_service);
+    py::object ros_service)
+    : ros_service_(ros_service) {}
+
+std::unique_ptr<rpc::PyRosSerializedClient>
+PyRosSerializedServiceClient::NewClient() {
+  py::gil_scoped_acquire acquire;
+  return std::make_unique<rpc::PyRosSerializedClient>(ros_service_);
 }
 
 void PyRosSerializedServiceClient::RequestRegister(
@@ -87,6 +93,12 @@ void PyRosSerializedServiceClient::Call(py::object py_request,
     py_callback(s);
     return;
   }
+
+  std::shared_ptr<rpc::PyRosSerializedClient> client = PickClient();
+  if (!client) {
+    py_callback(errors::Unavailable("No server is connected."));
+    return;
+  }
   py_callback.inc_ref();
 
   py::gil_scoped_release release;
@@ -94,7 +106,7 @@ void PyRosSerializedServiceClient::Call(py::object py_request,
   SerializedMessage* response = new SerializedMessage();
   request->set_serialized(std::move(text));
 
-  client_.Call(
+  client->Call(
       request, response,
       base::BindOnce(&PyCallCallback::Invoke,
                      base::Owned(new PyCallCallback(py_response, py_callback)),
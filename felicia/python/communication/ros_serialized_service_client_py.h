@@ -28,6 +28,12 @@ class PyRosSerializedServiceClient
 
   void Call(py::object py_request, py::object py_response,
             py::function py_callback);
+
+ protected:
+  std::unique_ptr<rpc::PyRosSerializedClient> NewClient() override;
+
+ private:
+  py::object ros_service_;
 };
 
 void AddRosSerializedServiceClient(py::module& m);
@@ -13,8 +13,15 @@ namespace felicia {
 
 using PyOnConnectCallback = PyCallback<void(ServiceInfo::Status)>;
 
-PyServiceClient::PyServiceClient(py::object client) {
-  client_ = rpc::PyClientBridge(client);
+PyServiceClient::PyServiceClient(py::object client) : client_(client) {
+  // The python client holds a single connection, so it can't be balanced
+  // among the servers.
+  max_providers_ = 1;
+}
+
+std::unique_ptr<rpc::PyClientBridge> PyServiceClient::NewClient() {
+  py::gil_scoped_acquire acquire;
+  return std::make_unique<rpc::PyClientBridge>(client_);
 }
 
 void PyServiceClient::RequestRegister(const NodeInfo& node_info,
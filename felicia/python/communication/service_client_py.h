@@ -26,6 +26,12 @@ class PyServiceClient : public ServiceClient<rpc::PyClientBridge> {
 
   void RequestUnregister(const NodeInfo& node_info, const std::string& service,
                          py::function py_callback = py::none());
+
+ protected:
+  std::unique_ptr<rpc::PyClientBridge> NewClient() override;
+
+ private:
+  py::object client_;
 };
 
 void AddServiceClient(py::module& m);
@@ -12,6 +12,7 @@
 
 #include "felicia/drivers/camera/camera_factory.h"
 #include "felicia/drivers/camera/camera_frame_message.pb.h"
+#include "felicia/drivers/camera/synthetic/synthetic_camera.h"
 #include "felicia/python/type_conversion/callback.h"
 #include "felicia/python/type_conversion/protobuf.h"
 
@@ -122,8 +123,13 @@ void AddCamera(py::module& m) {
       .def("camera_format", &CameraInterface::camera_format);
 
   py::class_<CameraDescriptor>(m, "CameraDescriptor")
+      .def(py::init<const std::string&, const std::string&,
+                    const std::string&>(),
+           py::arg("display_name"), py::arg("device_id"), py::arg("model_id"))
+      .def_static("synthetic", &SyntheticCamera::NewCameraDescriptor,
+                  py::arg("source"))
       .def_property_readonly("display_name", &CameraDescriptor::display_name)
-      .def_property_readonly("device_id", &CameraDescriptor::display_name)
+      .def_property_readonly("device_id", &CameraDescriptor::device_id)
       .def_property_readonly("model_id", &CameraDescriptor::model_id)
       .def("__str__", &CameraDescriptor::ToString);
 
@@ -170,6 +176,20 @@ void AddCamera(py::module& m) {
       .def_property_readonly("frame_rate", &CameraFrame::frame_rate)
       .def_property_readonly("timestamp", &CameraFrame::timestamp)
       .def("to_camera_frame_message", &CameraFrame::ToCameraFrameMessage)
+      .def(
+          "decode_mjpeg",
+          [](const CameraFrame& camera_frame,
+             PixelFormat requested_pixel_format, int scale_denominator) {
+            StatusOr<CameraFrame> status_or = DecodeMjpeg(
+                camera_frame, requested_pixel_format, scale_denominator);
+            if (!status_or.ok()) {
+              PyErr_SetString(PyExc_ValueError,
+                              status_or.status().error_message().c_str());
+              throw py::error_already_set();
+            }
+            return std::move(status_or).ValueOrDie();
+          },
+          py::arg("requested_pixel_format"), py::arg("scale_denominator") = 1)
       .def_buffer([](CameraFrame& camera_frame) {
         if (!camera_frame.camera_format().HasFixedSizedChannelPixelFormat()) {
           NotHaveFixedSizedChannelPixelFormat();
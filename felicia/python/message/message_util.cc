@@ -25,6 +25,8 @@ Status Serialize(const py::object& message, TopicInfo::ImplType impl_type,
         *text = py::str(buffer.attr("getvalue")());
         break;
       }
+      case TopicInfo::POD:
+        return errors::Unimplemented("POD message is not supported in python.");
       case TopicInfo_ImplType_TopicInfo_ImplType_INT_MIN_SENTINEL_DO_NOT_USE_:
       case TopicInfo_ImplType_TopicInfo_ImplType_INT_MAX_SENTINEL_DO_NOT_USE_:
         break;
@@ -47,6 +49,8 @@ Status Deserialize(const std::string& text, TopicInfo::ImplType impl_type,
         message->attr("deserialize")(py::bytes(text));
         break;
       }
+      case TopicInfo::POD:
+        return errors::Unimplemented("POD message is not supported in python.");
       case TopicInfo_ImplType_TopicInfo_ImplType_INT_MIN_SENTINEL_DO_NOT_USE_:
       case TopicInfo_ImplType_TopicInfo_ImplType_INT_MAX_SENTINEL_DO_NOT_USE_:
         break;
@@ -70,6 +74,7 @@ std::string GetMessageTypeNameFromPyObject(const py::object& message_type,
       message_type_name = py::str(message_type.attr("_type"));
       break;
     }
+    case TopicInfo::POD:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MIN_SENTINEL_DO_NOT_USE_:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MAX_SENTINEL_DO_NOT_USE_:
       break;
@@ -87,6 +92,7 @@ std::string GetMessageMD5SumFromPyObject(const py::object& message_type,
       md5sum = py::str(message_type.attr("_md5sum"));
       break;
     }
+    case TopicInfo::POD:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MIN_SENTINEL_DO_NOT_USE_:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MAX_SENTINEL_DO_NOT_USE_:
       break;
@@ -104,6 +110,7 @@ std::string GetMessageDefinitionFromPyObject(const py::object& message_type,
       definition = py::str(message_type.attr("_full_text"));
       break;
     }
+    case TopicInfo::POD:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MIN_SENTINEL_DO_NOT_USE_:
     case TopicInfo_ImplType_TopicInfo_ImplType_INT_MAX_SENTINEL_DO_NOT_USE_:
       break;
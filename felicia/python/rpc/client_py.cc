@@ -18,6 +18,11 @@ PyClientBridge::PyClientBridge() = default;
 
 PyClientBridge::PyClientBridge(py::object client) : client_(client) {}
 
+PyClientBridge::~PyClientBridge() {
+  py::gil_scoped_acquire acquire;
+  client_ = py::object();
+}
+
 void PyClientBridge::set_service_info(const ServiceInfo& service_info) {
   PyClient* py_client = client_.cast<PyClient*>();
   py_client->set_service_info(service_info);
@@ -52,6 +52,8 @@ class PyClientBridge {
  public:
   PyClientBridge();
   explicit PyClientBridge(py::object client);
+  // It may be deleted by ServiceClient without the GIL held.
+  ~PyClientBridge();
 
   void set_service_info(const ServiceInfo& service_info);
 
@@ -61,6 +63,10 @@ class PyClientBridge {
 
   Status Shutdown();
 
+  // The calls are made by the python client, so these aren't tracked.
+  int outstanding_calls() const { return 0; }
+  bool IsAvailable() const { return true; }
+
  private:
   py::object client_;
 };